@@ -0,0 +1,436 @@
+//*****************************************************************************
+//
+// bench.c - USB accessory pipes throughput and latency benchmark.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include <string.h>
+#include "inc/hw_types.h"
+
+#include "usb_android.h"
+#include "deferred_log.h"
+#include "bench.h"
+
+//*****************************************************************************
+//
+// Test state, only the TX counters are written by the frames callbacks (USB
+// interrupt), everything else is main loop only.
+//
+//*****************************************************************************
+static t_u8 g_ucBenchRequest = BENCH_TEST_NONE;
+static bool g_bBenchRequested = false;
+static t_u8 g_ucBenchTest = BENCH_TEST_NONE;
+static t_u32 g_ulBenchStartMs;
+static t_u32 g_ulBenchSeq;
+
+static t_u32 g_ulBenchRxBytes;
+static t_u32 g_ulBenchRxPackets;
+
+static volatile t_u32 g_ulBenchTxBytes;
+static volatile t_u32 g_ulBenchTxFrames;
+static volatile t_u32 g_ulBenchTxLost;
+
+// Echo test: the ping in flight and the bytes of its echo received so far.
+static bool g_bBenchPingOut;
+static t_u32 g_ulBenchPingSentMs;
+static t_u8 g_ucBenchEcho[BENCH_PING_SIZE];
+static t_u32 g_ulBenchEchoLen;
+static t_u32 g_ulBenchPingLost;
+
+// Echo test: round trip times of all the pings back.
+static t_u32 g_ulBenchRttHist[BENCH_RTT_BUCKETS];
+static t_u32 g_ulBenchNbRtt;
+static t_u32 g_ulBenchRttMin;
+static t_u32 g_ulBenchRttMax;
+
+static t_bench_report g_sBenchReport;
+
+//*****************************************************************************
+//
+// Big endian 32 bits helpers of the test frames.
+//
+//*****************************************************************************
+static void BENCH_put32(t_u8 *pucBuff, t_u32 ulValue)
+{
+    pucBuff[0] = (t_u8)(ulValue >> 24);
+    pucBuff[1] = (t_u8)(ulValue >> 16);
+    pucBuff[2] = (t_u8)(ulValue >> 8);
+    pucBuff[3] = (t_u8)ulValue;
+}
+
+static t_u32 BENCH_get32(const t_u8 *pucBuff)
+{
+    return ((t_u32)pucBuff[0] << 24) | ((t_u32)pucBuff[1] << 16) |
+           ((t_u32)pucBuff[2] << 8) | (t_u32)pucBuff[3];
+}
+
+//*****************************************************************************
+//
+// Source test frame completion, called from USB interrupt context.
+//
+//*****************************************************************************
+static void BENCH_txDone(void *pvCBData, int status)
+{
+    if(status == ANDROID_TX_DONE)
+    {
+        g_ulBenchTxBytes += (t_u32)pvCBData;
+        g_ulBenchTxFrames++;
+    }
+    else
+    {
+        g_ulBenchTxLost++;
+    }
+}
+
+//*****************************************************************************
+//
+// Fill and queue TX frames in place until the TX queue is full.
+//
+//*****************************************************************************
+static void BENCH_source(t_AndroidInstance handle)
+{
+    t_u8 *pucFrame;
+    t_u32 i;
+
+    while((pucFrame = ANDROID_txBorrow(handle)) != NULL)
+    {
+        BENCH_put32(pucFrame, g_ulBenchSeq++);
+        for(i = 4; i < ANDROID_TX_FRAME_SIZE; i++)
+        {
+            pucFrame[i] = (t_u8)i;
+        }
+        ANDROID_txSubmit(handle, ANDROID_TX_FRAME_SIZE, BENCH_txDone, (void *)ANDROID_TX_FRAME_SIZE);
+    }
+}
+
+//*****************************************************************************
+//
+// Send the next ping once the previous one is back or lost.
+//
+//*****************************************************************************
+static void BENCH_ping(t_AndroidInstance handle)
+{
+    t_u8 *pucFrame;
+    t_u32 i;
+
+    if(g_bBenchPingOut == true)
+    {
+        if(Delta_time_ms(g_ulBenchPingSentMs, GetTime_ms()) < BENCH_PING_TIMEOUT_MS)
+        {
+            return;
+        }
+        g_ulBenchPingLost++;
+        g_bBenchPingOut = false;
+    }
+
+    pucFrame = ANDROID_txBorrow(handle);
+    if(pucFrame == NULL)
+    {
+        return;
+    }
+
+    g_ulBenchSeq++;
+    g_ulBenchEchoLen = 0;
+    BENCH_put32(&pucFrame[0], g_ulBenchSeq);
+    BENCH_put32(&pucFrame[4], GetTime_us());
+    for(i = 8; i < BENCH_PING_SIZE; i++)
+    {
+        pucFrame[i] = (t_u8)i;
+    }
+    g_ulBenchPingSentMs = GetTime_ms();
+    g_bBenchPingOut = true;
+    ANDROID_txSubmit(handle, BENCH_PING_SIZE, NULL, NULL);
+}
+
+//*****************************************************************************
+//
+// Round trip times histogram: bucket of a time and upper bound of a bucket
+// (see BENCH_RTT_BUCKETS).
+//
+//*****************************************************************************
+static t_u32 BENCH_rttBucket(t_u32 ulRtt)
+{
+    t_u32 ulLog2;
+
+    if(ulRtt < BENCH_RTT_SUB_BUCKETS)
+    {
+        return ulRtt;
+    }
+    if(ulRtt >= (1UL << BENCH_RTT_MAX_LOG2))
+    {
+        return BENCH_RTT_BUCKETS - 1;
+    }
+
+    // Octave of the time: index of its most significant bit.
+    ulLog2 = BENCH_RTT_SUB_BUCKETS_LOG2;
+    while((ulRtt >> (ulLog2 + 1)) != 0)
+    {
+        ulLog2++;
+    }
+
+    return ((ulLog2 - BENCH_RTT_SUB_BUCKETS_LOG2 + 1) * BENCH_RTT_SUB_BUCKETS) +
+           ((ulRtt >> (ulLog2 - BENCH_RTT_SUB_BUCKETS_LOG2)) & (BENCH_RTT_SUB_BUCKETS - 1));
+}
+
+static t_u32 BENCH_rttBucketMax(t_u32 ulBucket)
+{
+    t_u32 ulShift;
+
+    if(ulBucket < BENCH_RTT_SUB_BUCKETS)
+    {
+        return ulBucket;
+    }
+    if(ulBucket == (BENCH_RTT_BUCKETS - 1))
+    {
+        return MAX_T_U32;
+    }
+
+    ulShift = (ulBucket / BENCH_RTT_SUB_BUCKETS) - 1;
+    return (((BENCH_RTT_SUB_BUCKETS + (ulBucket % BENCH_RTT_SUB_BUCKETS) + 1) << ulShift) - 1);
+}
+
+//*****************************************************************************
+//
+// Round trip percentiles from the histogram of the whole test, filled in the
+// report with the min and max.
+//
+//*****************************************************************************
+static t_u32 BENCH_rttPercentile(t_u32 ulPercent)
+{
+    t_u32 ulRank;
+    t_u32 ulCount;
+    t_u32 ulValue;
+    t_u32 i;
+
+    // Same rank as in the sorted times: ((n - 1) * p) / 100, counted from 0.
+    ulRank = ((g_ulBenchNbRtt - 1) * ulPercent) / 100;
+    ulCount = 0;
+    for(i = 0; i < (BENCH_RTT_BUCKETS - 1); i++)
+    {
+        ulCount += g_ulBenchRttHist[i];
+        if(ulCount > ulRank)
+        {
+            break;
+        }
+    }
+
+    ulValue = BENCH_rttBucketMax(i);
+    if(ulValue < g_ulBenchRttMin)
+    {
+        ulValue = g_ulBenchRttMin;
+    }
+    return (ulValue > g_ulBenchRttMax) ? g_ulBenchRttMax : ulValue;
+}
+
+static void BENCH_percentiles(t_bench_report *pReport)
+{
+    if(g_ulBenchNbRtt == 0)
+    {
+        return;
+    }
+
+    pReport->rtt_p50_us = BENCH_rttPercentile(50);
+    pReport->rtt_p90_us = BENCH_rttPercentile(90);
+    pReport->rtt_p99_us = BENCH_rttPercentile(99);
+    pReport->rtt_min_us = g_ulBenchRttMin;
+    pReport->rtt_max_us = g_ulBenchRttMax;
+}
+
+//*****************************************************************************
+//
+// End the current test, fill and log its report.
+//
+//*****************************************************************************
+static void BENCH_end(void)
+{
+    t_bench_report *pReport;
+#if (DLOG_LEVEL >= DLOG_LEVEL_INFO)
+    t_u32 ulKBs;
+#endif
+
+    pReport = &g_sBenchReport;
+    pReport->test = g_ucBenchTest;
+    pReport->duration_ms = Delta_time_ms(g_ulBenchStartMs, GetTime_ms());
+    pReport->rtt_p50_us = 0;
+    pReport->rtt_p90_us = 0;
+    pReport->rtt_p99_us = 0;
+    pReport->rtt_min_us = 0;
+    pReport->rtt_max_us = 0;
+
+    if(g_ucBenchTest == BENCH_TEST_SOURCE)
+    {
+        pReport->bytes = g_ulBenchTxBytes;
+        pReport->packets = g_ulBenchTxFrames;
+        pReport->lost = g_ulBenchTxLost;
+    }
+    else
+    {
+        pReport->bytes = g_ulBenchRxBytes;
+        pReport->packets = g_ulBenchRxPackets;
+        pReport->lost = g_ulBenchPingLost;
+        BENCH_percentiles(pReport);
+    }
+    g_ucBenchTest = BENCH_TEST_NONE;
+
+#if (DLOG_LEVEL >= DLOG_LEVEL_INFO)
+    // Bytes per millisecond = kB/s.
+    ulKBs = (pReport->duration_ms != 0) ? (pReport->bytes / pReport->duration_ms) : 0;
+    DLOG_INFO("Bench %d: %u bytes, %u packets in %u ms\n",
+              pReport->test, pReport->bytes, pReport->packets, pReport->duration_ms);
+    DLOG_INFO("Bench %d: %u.%03u MB/s, %u packets/s, %u lost\n",
+              pReport->test, ulKBs / 1000, ulKBs % 1000,
+              (pReport->duration_ms != 0) ? ((pReport->packets * 1000) / pReport->duration_ms) : 0,
+              pReport->lost);
+    if(pReport->test == BENCH_TEST_ECHO)
+    {
+        DLOG_INFO("Bench %d: RTT min %u us, p50 %u us, p90 %u us, p99 %u us, max %u us\n",
+                  pReport->test, pReport->rtt_min_us, pReport->rtt_p50_us, pReport->rtt_p90_us,
+                  pReport->rtt_p99_us, pReport->rtt_max_us);
+    }
+#endif
+}
+
+void BENCH_start(const t_u8 test/*in*/)
+{
+    g_ucBenchRequest = (test < BENCH_NB_TESTS) ? test : BENCH_TEST_NONE;
+    g_bBenchRequested = true;
+}
+
+void BENCH_stop(void)
+{
+    g_bBenchRequested = false;
+    g_ucBenchTest = BENCH_TEST_NONE;
+}
+
+bool BENCH_isRunning(void)
+{
+    return (g_ucBenchTest != BENCH_TEST_NONE);
+}
+
+//*****************************************************************************
+//
+//! This function consumes the data received during a test.
+//!
+//! \param data is the received data (one USB packet or the rest of it).
+//! \param len is the number of bytes at \e data.
+//!
+//! The sink test only counts the data, the echo test gathers the echo of the
+//! ping in flight and adds its round trip time to the histogram, min and max
+//! of the test once complete.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void BENCH_rx(const t_u8* const data/*in*/, const int len/*in*/)
+{
+    t_u32 ulRtt;
+    int i;
+
+    g_ulBenchRxBytes += len;
+    g_ulBenchRxPackets++;
+
+    if(g_ucBenchTest != BENCH_TEST_ECHO)
+    {
+        return;
+    }
+
+    for(i = 0; i < len; i++)
+    {
+        if(g_ulBenchEchoLen < BENCH_PING_SIZE)
+        {
+            g_ucBenchEcho[g_ulBenchEchoLen++] = data[i];
+        }
+    }
+
+    // Only the echo of the ping in flight counts (a late echo has an old sequence number).
+    if((g_ulBenchEchoLen == BENCH_PING_SIZE) && (g_bBenchPingOut == true) &&
+       (BENCH_get32(&g_ucBenchEcho[0]) == g_ulBenchSeq))
+    {
+        ulRtt = GetTime_us() - BENCH_get32(&g_ucBenchEcho[4]);
+        g_ulBenchRttHist[BENCH_rttBucket(ulRtt)]++;
+        g_ulBenchRttMin = (ulRtt < g_ulBenchRttMin) ? ulRtt : g_ulBenchRttMin;
+        g_ulBenchRttMax = (ulRtt > g_ulBenchRttMax) ? ulRtt : g_ulBenchRttMax;
+        g_ulBenchNbRtt++;
+        g_bBenchPingOut = false;
+    }
+    if(g_ulBenchEchoLen == BENCH_PING_SIZE)
+    {
+        g_ulBenchEchoLen = 0;
+    }
+}
+
+//*****************************************************************************
+//
+//! This function runs the benchmark.
+//!
+//! \param handle is the Android device instance.
+//!
+//! A requested test is started (the test in progress is ended first), the
+//! source and echo tests queue their frames and the test is ended once
+//! BENCH_DURATION_MS is elapsed.  To be called once per main loop iteration.
+//!
+//! \return Returns \e true when a test has ended, its report is ready.
+//
+//*****************************************************************************
+bool BENCH_process(t_AndroidInstance handle/*in*/)
+{
+    bool bEnded;
+
+    bEnded = false;
+
+    if(g_bBenchRequested == true)
+    {
+        g_bBenchRequested = false;
+        if(g_ucBenchTest != BENCH_TEST_NONE)
+        {
+            BENCH_end();
+            bEnded = true;
+        }
+
+        g_ucBenchTest = g_ucBenchRequest;
+        g_ulBenchStartMs = GetTime_ms();
+        g_ulBenchSeq = 0;
+        g_ulBenchRxBytes = 0;
+        g_ulBenchRxPackets = 0;
+        g_ulBenchTxBytes = 0;
+        g_ulBenchTxFrames = 0;
+        g_ulBenchTxLost = 0;
+        g_bBenchPingOut = false;
+        g_ulBenchEchoLen = 0;
+        g_ulBenchPingLost = 0;
+        memset(g_ulBenchRttHist, 0, sizeof(g_ulBenchRttHist));
+        g_ulBenchNbRtt = 0;
+        g_ulBenchRttMin = MAX_T_U32;
+        g_ulBenchRttMax = 0;
+    }
+
+    if(g_ucBenchTest == BENCH_TEST_NONE)
+    {
+        return bEnded;
+    }
+
+    if(Delta_time_ms(g_ulBenchStartMs, GetTime_ms()) >= BENCH_DURATION_MS)
+    {
+        BENCH_end();
+        return true;
+    }
+
+    if(g_ucBenchTest == BENCH_TEST_SOURCE)
+    {
+        BENCH_source(handle);
+    }
+    else if(g_ucBenchTest == BENCH_TEST_ECHO)
+    {
+        BENCH_ping(handle);
+    }
+
+    return bEnded;
+}
+
+void BENCH_getReport(t_bench_report* const report/*out*/)
+{
+    *report = g_sBenchReport;
+}
@@ -0,0 +1,103 @@
+//*****************************************************************************
+//
+// bench.h - USB accessory pipes throughput and latency benchmark.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * A test runs for BENCH_DURATION_MS on the accessory Bulk pipes, the data
+ * received meanwhile is not decoded as DemoKit commands (only a USB packet of
+ * exactly one SYSTEM BENCH command is, to stop the test early, so the test
+ * traffic never uses DEMOKIT_CMD_SIZE bytes packets):
+ * - BENCH_TEST_SINK: Android sends any data as fast as it can, EvalBot counts and drops it,
+ * - BENCH_TEST_SOURCE: EvalBot sends ANDROID_TX_FRAME_SIZE bytes frames (bytes 0-3 = frame
+ *   sequence number big endian) as fast as the TX queue accepts them, Android reads and drops them,
+ * - BENCH_TEST_ECHO: EvalBot sends BENCH_PING_SIZE bytes pings (bytes 0-3 = sequence number,
+ *   4-7 = send time, big endian), Android sends each ping back unchanged as soon as it is read,
+ *   EvalBot measures the round trip time.  A ping not back after BENCH_PING_TIMEOUT_MS is lost.
+ * Start a test with the DemoKit SYSTEM BENCH command or at each connection with
+ * BENCH_AUTOSTART defined to the test number at build time.
+ */
+#define BENCH_TEST_NONE     (0)
+#define BENCH_TEST_SINK     (1)
+#define BENCH_TEST_SOURCE   (2)
+#define BENCH_TEST_ECHO     (3)
+#define BENCH_NB_TESTS      (4)
+
+#define BENCH_DURATION_MS   (5000)
+
+#define BENCH_PING_SIZE         (ANDROID_TX_FRAME_SIZE)
+#define BENCH_PING_TIMEOUT_MS   (100)
+
+/*
+ * Round trip times histogram of the whole test for the percentiles: log2 octaves split in
+ * BENCH_RTT_SUB_BUCKETS linear buckets (about 12% resolution), 1 us buckets below
+ * BENCH_RTT_SUB_BUCKETS us, the last bucket holds all the times from 2^BENCH_RTT_MAX_LOG2 us.
+ * A percentile is the upper bound of its bucket, within the min and max (exact).
+ */
+#define BENCH_RTT_SUB_BUCKETS_LOG2  (3)
+#define BENCH_RTT_SUB_BUCKETS       (1 << BENCH_RTT_SUB_BUCKETS_LOG2)
+#define BENCH_RTT_MAX_LOG2          (20) /* 1.05 s, far above BENCH_PING_TIMEOUT_MS */
+#define BENCH_RTT_BUCKETS           (((BENCH_RTT_MAX_LOG2 - BENCH_RTT_SUB_BUCKETS_LOG2 + 1) * BENCH_RTT_SUB_BUCKETS) + 1)
+
+typedef struct
+{
+    t_u8 test; /* BENCH_TEST_XXX */
+    t_u32 duration_ms;
+    t_u32 bytes; /* Bytes received (sink, echo) or sent (source) */
+    t_u32 packets; /* USB packets received (sink, echo) or frames sent (source) */
+    t_u32 lost; /* Pings lost (echo) or frames not sent (source) */
+    t_u32 rtt_p50_us; /* Round trip percentiles of all the pings back (echo only) */
+    t_u32 rtt_p90_us;
+    t_u32 rtt_p99_us;
+    t_u32 rtt_min_us; /* Round trip min and max of all the pings back (echo only) */
+    t_u32 rtt_max_us;
+} t_bench_report;
+
+/* API */
+
+/* Request a test (BENCH_TEST_NONE stops the current test), started by next BENCH_process() */
+extern void BENCH_start(const t_u8 test/*in*/);
+
+/* Abort the current test without report (disconnection) */
+extern void BENCH_stop(void);
+
+/* Return true while a test is running (the received data goes to BENCH_rx()) */
+extern bool BENCH_isRunning(void);
+
+/* Consume received data (in place, from ANDROID_rxPeek()) */
+extern void BENCH_rx(const t_u8* const data/*in*/, const int len/*in*/);
+
+/* Run the test (once per main loop), return true when a test ends and its report is ready */
+extern bool BENCH_process(t_AndroidInstance handle/*in*/);
+
+/* Copy the report of the last test (also logged when the test ends) */
+extern void BENCH_getReport(t_bench_report* const report/*out*/);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BENCH_H__
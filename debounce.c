@@ -0,0 +1,60 @@
+//*****************************************************************************
+//
+// debounce.c - Bit-parallel inputs debounce with vertical counters.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "usb_android.h"
+#include "debounce.h"
+
+//*****************************************************************************
+//
+//! This function initializes a debounce engine.
+//!
+//! \param debounce is the debounce engine.
+//! \param state is the initial debounced state (usually the first sample).
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DEBOUNCE_init(t_debounce* const debounce/*out*/, const t_u32 state/*in*/)
+{
+    debounce->state = state;
+    debounce->cnt0 = 0;
+    debounce->cnt1 = 0;
+}
+
+//*****************************************************************************
+//
+//! This function adds one sample of all the inputs.
+//!
+//! \param debounce is the debounce engine.
+//! \param sample is the raw state of the inputs.
+//!
+//! For each bit: the 2 bits counter (cnt1:cnt0) is cleared when the sample
+//! equals the debounced state, otherwise it is incremented modulo 4 and the
+//! debounced state toggles when it wraps to 0 (DEBOUNCE_SAMPLES consecutive
+//! samples different from the debounced state).
+//!
+//! \return Returns the bits of the debounced state which toggled with this
+//! sample (press and release events), 0 if none.
+//
+//*****************************************************************************
+t_u32 DEBOUNCE_update(t_debounce* const debounce/*in/out*/, const t_u32 sample/*in*/)
+{
+    t_u32 delta;
+    t_u32 toggle;
+
+    delta = sample ^ debounce->state;
+
+    debounce->cnt1 = (debounce->cnt1 ^ debounce->cnt0) & delta;
+    debounce->cnt0 = ~debounce->cnt0 & delta;
+
+    toggle = delta & ~(debounce->cnt0 | debounce->cnt1);
+    debounce->state ^= toggle;
+
+    return toggle;
+}
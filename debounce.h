@@ -0,0 +1,58 @@
+//*****************************************************************************
+//
+// debounce.h - Bit-parallel inputs debounce with vertical counters.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __DEBOUNCE_H__
+#define __DEBOUNCE_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Each bit of a 32bits sample word is an input, all the inputs are debounced
+ * together: bit N of cnt0 and cnt1 is the 2 bits counter of input N
+ * ("vertical" counter).  The counter of an input runs while its sample
+ * differs from the debounced state and is cleared as soon as they match,
+ * the debounced state toggles after DEBOUNCE_SAMPLES consecutive different
+ * samples.  The cost of DEBOUNCE_update() is a few logical operations
+ * whatever the number of inputs.
+ */
+#define DEBOUNCE_SAMPLES    (4)
+
+typedef struct
+{
+    t_u32 state; /* Debounced state */
+    t_u32 cnt0; /* Vertical counter bit 0 */
+    t_u32 cnt1; /* Vertical counter bit 1 */
+} t_debounce;
+
+/* API */
+
+extern void DEBOUNCE_init(t_debounce* const debounce/*out*/, const t_u32 state/*in*/);
+
+/* Add one sample, return the bits which toggled in the debounced state (debounce->state) */
+extern t_u32 DEBOUNCE_update(t_debounce* const debounce/*in/out*/, const t_u32 sample/*in*/);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DEBOUNCE_H__
@@ -0,0 +1,147 @@
+//*****************************************************************************
+//
+// deferred_log.c - Deferred binary logging to the UART.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+
+#include "utils/uartstdio.h"
+
+#include "usb_android.h"
+#include "deferred_log.h"
+
+//*****************************************************************************
+//
+// The log ring.  Entries are added by DLOG_post() from any context and are
+// removed only by DLOG_process() from the main loop.  The number of entries
+// must be a power of 2.
+//
+//*****************************************************************************
+#define DLOG_RING_ENTRIES   (64)
+#define DLOG_RING_MASK      (DLOG_RING_ENTRIES - 1)
+
+//*****************************************************************************
+//
+// Space required in the UART TX buffer to format one entry without waiting
+// (timestamp + text).
+//
+//*****************************************************************************
+#define DLOG_LINE_MAX       (128)
+
+typedef struct
+{
+    const char* fmt;
+    t_u32 time_ms;
+    t_u32 args[DLOG_MAX_ARGS];
+} t_dlog_entry;
+
+static t_dlog_entry g_sDLOGRing[DLOG_RING_ENTRIES];
+
+// Free running ring indexes.
+static volatile t_u32 g_ulDLOGHead = 0;
+static volatile t_u32 g_ulDLOGTail = 0;
+
+// Number of entries lost because the ring was full.
+static volatile t_u32 g_ulDLOGDropped = 0;
+static t_u32 g_ulDLOGDroppedReported = 0;
+
+//*****************************************************************************
+//
+//! This function stores a log entry in the log ring.
+//!
+//! \param fmt is the UARTprintf() format string (must be a constant string).
+//! \param arg0 to arg5 are the format arguments.
+//!
+//! This function is used by the DLOG_XXX() macros.  Producers can run in
+//! thread or interrupt context, the slot is reserved and filled with
+//! interrupts masked (a few instructions) so an entry is always complete when
+//! it becomes visible to DLOG_process().  The consumer side never masks
+//! interrupts.  When the ring is full the entry is dropped and counted.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DLOG_post(const char* fmt/*in*/, t_u32 arg0, t_u32 arg1, t_u32 arg2, t_u32 arg3, t_u32 arg4, t_u32 arg5, ...)
+{
+    t_dlog_entry *pEntry;
+    tBoolean bIntDisabled;
+
+    bIntDisabled = IntMasterDisable();
+
+    if((g_ulDLOGHead - g_ulDLOGTail) >= DLOG_RING_ENTRIES)
+    {
+        g_ulDLOGDropped++;
+    }
+    else
+    {
+        pEntry = &g_sDLOGRing[g_ulDLOGHead & DLOG_RING_MASK];
+        pEntry->fmt = fmt;
+        pEntry->time_ms = GetTime_ms();
+        pEntry->args[0] = arg0;
+        pEntry->args[1] = arg1;
+        pEntry->args[2] = arg2;
+        pEntry->args[3] = arg3;
+        pEntry->args[4] = arg4;
+        pEntry->args[5] = arg5;
+        g_ulDLOGHead++;
+    }
+
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
+
+//*****************************************************************************
+//
+//! This function formats the pending log entries and sends them to the UART.
+//!
+//! With the buffered UART (UART_BUFFERED), entries are formatted only while
+//! the UART TX buffer has room for a full line so this function never waits
+//! for the serial port.  Without UART_BUFFERED only one entry is formatted
+//! per call.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DLOG_process(void)
+{
+    t_dlog_entry *pEntry;
+    t_u32 ulDropped;
+
+    while(g_ulDLOGTail != g_ulDLOGHead)
+    {
+#ifdef UART_BUFFERED
+        if(UARTTxBytesFree() < DLOG_LINE_MAX)
+        {
+            return;
+        }
+#endif
+        pEntry = &g_sDLOGRing[g_ulDLOGTail & DLOG_RING_MASK];
+        UARTprintf("[%d] ", pEntry->time_ms);
+        UARTprintf(pEntry->fmt, pEntry->args[0], pEntry->args[1],
+                   pEntry->args[2], pEntry->args[3], pEntry->args[4],
+                   pEntry->args[5]);
+        g_ulDLOGTail++;
+#ifndef UART_BUFFERED
+        break;
+#endif
+    }
+
+    ulDropped = g_ulDLOGDropped;
+    if((ulDropped != g_ulDLOGDroppedReported) && (g_ulDLOGTail == g_ulDLOGHead))
+    {
+        UARTprintf("[DLOG] %d entries dropped\n", ulDropped - g_ulDLOGDroppedReported);
+        g_ulDLOGDroppedReported = ulDropped;
+    }
+}
+
+bool DLOG_isEmpty(void)
+{
+    return (g_ulDLOGTail == g_ulDLOGHead);
+}
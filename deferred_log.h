@@ -0,0 +1,85 @@
+//*****************************************************************************
+//
+// deferred_log.h - Deferred binary logging to the UART.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __DEFERRED_LOG_H__
+#define __DEFERRED_LOG_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * The DLOG_XXX() macros only store the format string pointer, a timestamp and
+ * up to DLOG_MAX_ARGS 32bits arguments in a RAM ring (a few microseconds, can
+ * be used from interrupt context), the text is formatted and sent to the UART
+ * later by DLOG_process() when the main loop is idle.
+ * Warning the format string and the %s arguments must be constant strings
+ * (they are used after the DLOG_XXX() call returns).
+ *
+ * Log level is selected at compile time with DLOG_LEVEL, the DLOG_XXX() calls
+ * above DLOG_LEVEL are removed by the preprocessor (no code, no string).
+ */
+#define DLOG_LEVEL_NONE     (0)
+#define DLOG_LEVEL_ERROR    (1)
+#define DLOG_LEVEL_INFO     (2)
+#define DLOG_LEVEL_DEBUG    (3)
+
+#ifndef DLOG_LEVEL
+#define DLOG_LEVEL  DLOG_LEVEL_INFO
+#endif
+
+#define DLOG_MAX_ARGS   (6)
+
+/* The trailing 0 arguments fill the unused arguments, extra ones are ignored */
+#if (DLOG_LEVEL >= DLOG_LEVEL_ERROR)
+#define DLOG_ERROR(...)  DLOG_post(__VA_ARGS__, 0, 0, 0, 0, 0, 0)
+#else
+#define DLOG_ERROR(...)
+#endif
+
+#if (DLOG_LEVEL >= DLOG_LEVEL_INFO)
+#define DLOG_INFO(...)   DLOG_post(__VA_ARGS__, 0, 0, 0, 0, 0, 0)
+#else
+#define DLOG_INFO(...)
+#endif
+
+#if (DLOG_LEVEL >= DLOG_LEVEL_DEBUG)
+#define DLOG_DEBUG(...)  DLOG_post(__VA_ARGS__, 0, 0, 0, 0, 0, 0)
+#else
+#define DLOG_DEBUG(...)
+#endif
+
+/* API */
+
+/* Store a log entry (use DLOG_XXX() macros instead) */
+extern void DLOG_post(const char* fmt/*in*/, t_u32 arg0, t_u32 arg1, t_u32 arg2, t_u32 arg3, t_u32 arg4, t_u32 arg5, ...);
+
+/* Format and send pending log entries to the UART without blocking, to be called when the main loop is idle */
+extern void DLOG_process(void);
+
+/* Return true if no log entry is pending */
+extern bool DLOG_isEmpty(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DEFERRED_LOG_H__
@@ -0,0 +1,295 @@
+//*****************************************************************************
+//
+// demokit_protocol.c - Android DemoKit protocol decoder.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_types.h"
+
+#include "usb_android.h"
+#include "demokit_protocol.h"
+
+//*****************************************************************************
+//
+// The command jump table built at compile time from DEMOKIT_COMMANDS and
+// directly indexed by DEMOKIT_CMD_INDEX(type, id).
+//
+//*****************************************************************************
+#define DEMOKIT_HANDLER_ENTRY(type, id, handler) \
+    [DEMOKIT_CMD_INDEX(type, id)] = handler,
+
+static const t_demokit_cmd_handler g_pfnDemoKitHandlers[DEMOKIT_NB_TYPES * DEMOKIT_NB_IDS] =
+{
+    DEMOKIT_COMMANDS(DEMOKIT_HANDLER_ENTRY)
+};
+
+//*****************************************************************************
+//
+//! This function calls the handler of a DemoKit command.
+//!
+//! \param cmd is the command (DEMOKIT_CMD_SIZE bytes).
+//!
+//! The handler is read from a jump table indexed by the command type and id,
+//! the cost is the same for any command whatever the number of commands.
+//!
+//! \return Returns \e true if the command has a handler or \e false if the
+//! command is unknown (and ignored).
+//
+//*****************************************************************************
+bool DEMOKIT_dispatch(const t_u8* const cmd/*in*/)
+{
+    t_demokit_cmd_handler handler;
+
+    if((cmd[0] >= DEMOKIT_NB_TYPES) || (cmd[1] >= DEMOKIT_NB_IDS))
+    {
+        return false;
+    }
+
+    handler = g_pfnDemoKitHandlers[DEMOKIT_CMD_INDEX(cmd[0], cmd[1])];
+    if(handler == NULL)
+    {
+        return false;
+    }
+
+    handler(cmd);
+
+    return true;
+}
+
+//*****************************************************************************
+//
+//! This function initializes a DemoKit command decoder.
+//!
+//! \param decoder is the decoder to initialize.
+//! \param dispatch is called for each decoded command.
+//! \param pvData is passed back to \e dispatch.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DEMOKIT_decoderInit(t_demokit_decoder* const decoder/*out*/, t_demokit_dispatch dispatch/*in*/, void* pvData/*in*/)
+{
+    decoder->nb = 0;
+    decoder->dispatch = dispatch;
+    decoder->pvData = pvData;
+}
+
+//*****************************************************************************
+//
+//! This function drops the partial command kept by a decoder (to be called
+//! when the stream restarts, after a disconnection for example).
+//!
+//! \param decoder is the decoder to reset.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DEMOKIT_decoderReset(t_demokit_decoder* const decoder/*in/out*/)
+{
+    decoder->nb = 0;
+}
+
+//*****************************************************************************
+//
+//! This function decodes a buffer of any length containing DemoKit commands.
+//!
+//! \param decoder is the decoder state.
+//! \param buff is the received data.
+//! \param len is the number of bytes in \e buff.
+//!
+//! Every complete command is dispatched in order.  A command split between
+//! two buffers is kept in the decoder and dispatched once its last bytes are
+//! decoded.  Complete commands are dispatched directly from \e buff without
+//! copy.
+//!
+//! \return The number of commands dispatched.
+//
+//*****************************************************************************
+int DEMOKIT_decode(t_demokit_decoder* const decoder/*in/out*/, const t_u8* const buff/*in*/, const int len/*in*/)
+{
+    int i, nbcmd;
+
+    i = 0;
+    nbcmd = 0;
+
+    // Complete the partial command from the previous buffer.
+    if(decoder->nb != 0)
+    {
+        while((decoder->nb < DEMOKIT_CMD_SIZE) && (i < len))
+        {
+            decoder->cmd[decoder->nb++] = buff[i++];
+        }
+        if(decoder->nb < DEMOKIT_CMD_SIZE)
+        {
+            return 0;
+        }
+        decoder->dispatch(decoder->cmd, decoder->pvData);
+        decoder->nb = 0;
+        nbcmd++;
+    }
+
+    // Dispatch all complete commands in place.
+    while((len - i) >= DEMOKIT_CMD_SIZE)
+    {
+        decoder->dispatch(&buff[i], decoder->pvData);
+        i += DEMOKIT_CMD_SIZE;
+        nbcmd++;
+    }
+
+    // Keep the remaining bytes for the next buffer.
+    while(i < len)
+    {
+        decoder->cmd[decoder->nb++] = buff[i++];
+    }
+
+    return nbcmd;
+}
+
+//*****************************************************************************
+//
+//! This function initializes an outbound events frame.
+//!
+//! \param events is the events frame to initialize.
+//! \param window_ms is the maximum time in milliseconds an event waits before
+//! its frame is sent, 0 sends the events gathered during one loop iteration
+//! on the next call to DEMOKIT_eventsFlush().
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DEMOKIT_eventsInit(t_demokit_events* const events/*out*/, const t_u32 window_ms/*in*/)
+{
+    events->len = 0;
+    events->window_ms = window_ms;
+    events->first_ms = 0;
+    events->dropped = 0;
+}
+
+//*****************************************************************************
+//
+// Queue the events frame in the Android TX queue.
+//
+// The frame is kept (and retried on next flush) if the TX queue is full.
+//
+//*****************************************************************************
+static bool DEMOKIT_eventsSend(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/)
+{
+    if(ANDROID_write(handle, events->frame, events->len) != events->len)
+    {
+        return false;
+    }
+    events->len = 0;
+
+    return true;
+}
+
+//*****************************************************************************
+//
+//! This function adds an event to the outbound events frame.
+//!
+//! \param events is the events frame.
+//! \param handle is the Android device instance.
+//! \param type is the DemoKit command type of the event.
+//! \param id is the DemoKit command id of the event.
+//! \param value is the event value.
+//!
+//! If the frame is full it is sent first, the event is dropped (and counted
+//! in \e dropped) only if the Android TX queue is full too.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DEMOKIT_eventPost(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/,
+                       const t_u8 type/*in*/, const t_u8 id/*in*/, const t_u8 value/*in*/)
+{
+    if(events->len == DEMOKIT_EVENTS_FRAME_SIZE)
+    {
+        if(DEMOKIT_eventsSend(events, handle) == false)
+        {
+            events->dropped++;
+            return;
+        }
+    }
+
+    if(events->len == 0)
+    {
+        events->first_ms = GetTime_ms();
+    }
+
+    events->frame[events->len++] = type;
+    events->frame[events->len++] = id;
+    events->frame[events->len++] = value;
+}
+
+//*****************************************************************************
+//
+//! This function adds several commands bytes to the outbound events frame.
+//!
+//! \param events is the events frame.
+//! \param handle is the Android device instance.
+//! \param data is the bytes to add, the first byte is a command type.
+//! \param len is the number of bytes, a multiple of DEMOKIT_CMD_SIZE up to
+//! DEMOKIT_EVENTS_FRAME_SIZE.
+//!
+//! The bytes are never split between two frames: the frame is sent first if
+//! there is not enough room, the bytes are dropped (and counted once in
+//! \e dropped) only if the Android TX queue is full too.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DEMOKIT_eventsPostRaw(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/,
+                           const t_u8* const data/*in*/, const t_u8 len/*in*/)
+{
+    t_u8 i;
+
+    if((events->len + len) > DEMOKIT_EVENTS_FRAME_SIZE)
+    {
+        if(DEMOKIT_eventsSend(events, handle) == false)
+        {
+            events->dropped++;
+            return;
+        }
+    }
+
+    if(events->len == 0)
+    {
+        events->first_ms = GetTime_ms();
+    }
+
+    for(i = 0; i < len; i++)
+    {
+        events->frame[events->len++] = data[i];
+    }
+}
+
+//*****************************************************************************
+//
+//! This function sends the outbound events frame once its window is elapsed.
+//!
+//! \param events is the events frame.
+//! \param handle is the Android device instance.
+//!
+//! This function shall be called once per loop iteration after all the events
+//! of the iteration are posted, all these events are sent in one USB transfer.
+//!
+//! \return Returns \e true if a frame is queued in the Android TX queue.
+//
+//*****************************************************************************
+bool DEMOKIT_eventsFlush(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/)
+{
+    if(events->len == 0)
+    {
+        return false;
+    }
+
+    if(Delta_time_ms(events->first_ms, GetTime_ms()) < events->window_ms)
+    {
+        return false;
+    }
+
+    return DEMOKIT_eventsSend(events, handle);
+}
@@ -0,0 +1,226 @@
+//*****************************************************************************
+//
+// demokit_protocol.h - Android DemoKit protocol decoder.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __DEMOKIT_PROTOCOL_H__
+#define __DEMOKIT_PROTOCOL_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+DemoKit commands are 3 bytes long and are sent back to back on the Bulk pipes:
+ byte 0: command type
+ byte 1: command id
+ byte 2: value
+*/
+#define DEMOKIT_CMD_SIZE    (3)
+
+/* Command types */
+#define DEMOKIT_TYPE_BUTTON     (1) /* EvalBot => Android, value 1=pressed 0=released */
+#define DEMOKIT_TYPE_LED_SERVO  (2) /* Android => EvalBot, value 0 to 255 */
+#define DEMOKIT_TYPE_RELAY      (3) /* Android => EvalBot, value 0=Off other=On */
+#define DEMOKIT_TYPE_SYSTEM     (4) /* Android => EvalBot, EvalBot firmware services (not in DemoKit application) */
+#define DEMOKIT_TYPE_REFLEX     (5) /* Android => EvalBot, reflex rule of a button, value = REFLEX_XXX actions (reflex.h) */
+#define DEMOKIT_TYPE_TRAJECTORY (6) /* Android <=> EvalBot, timed motors setpoints (trajectory.h) */
+#define DEMOKIT_TYPE_SPEED      (7) /* Android => EvalBot, closed loop wheels speed (speed.h) */
+#define DEMOKIT_TYPE_ODOMETRY   (8) /* Android <=> EvalBot, robot pose frames (odometry.h) */
+#define DEMOKIT_NB_TYPES        (9)
+
+/* DEMOKIT_TYPE_BUTTON ids */
+#define DEMOKIT_ID_BUTTON1      (0) /* User Switch 1 */
+#define DEMOKIT_ID_BUTTON2      (1) /* User Switch 2 */
+#define DEMOKIT_ID_BUTTON3      (2) /* Bumper Left */
+#define DEMOKIT_ID_BUTTON4      (3) /* Bumper Right */
+
+/* DEMOKIT_TYPE_LED_SERVO ids */
+#define DEMOKIT_ID_LED1_RED     (0)
+#define DEMOKIT_ID_LED1_GREEN   (1)
+#define DEMOKIT_ID_LED1_BLUE    (2)
+#define DEMOKIT_ID_LED2_RED     (3)
+#define DEMOKIT_ID_LED2_GREEN   (4)
+#define DEMOKIT_ID_LED2_BLUE    (5)
+#define DEMOKIT_ID_LED3_RED     (6)
+#define DEMOKIT_ID_LED3_GREEN   (7)
+#define DEMOKIT_ID_LED3_BLUE    (8)
+#define DEMOKIT_ID_SERVO1       (0x10)
+#define DEMOKIT_ID_SERVO2       (0x11)
+#define DEMOKIT_ID_SERVO3       (0x12)
+
+/* DEMOKIT_TYPE_RELAY ids */
+#define DEMOKIT_ID_RELAY1       (0)
+#define DEMOKIT_ID_RELAY2       (1)
+
+/* DEMOKIT_TYPE_SYSTEM ids */
+#define DEMOKIT_ID_PROFILE      (0) /* Log profiling probes, value 1 = clear probes after dump */
+#define DEMOKIT_ID_MOTOR_RAMP   (1) /* Motors ramp time from 0 to 100% (slew rate limit), value in 10ms units, 0 = no limit */
+#define DEMOKIT_RAMP_UNIT_MS    (10)
+#define DEMOKIT_ID_BENCH        (2) /* Android => EvalBot, start a USB benchmark, value = BENCH_TEST_XXX (bench.h), 0 = stop */
+#define DEMOKIT_ID_BENCH_REPORT (3) /* EvalBot => Android, benchmark report frame header, value = BENCH_TEST_XXX */
+#define DEMOKIT_ID_USB_TRACE    (4) /* Dump the USB trace on the UART (usb_trace.h), value 1 = clear the trace after dump */
+
+/*
+ * Benchmark report frame: the DEMOKIT_ID_BENCH_REPORT command is followed by DEMOKIT_BENCH_PAYLOAD_SIZE
+ * bytes (not commands), 32 bits values big endian:
+ *  duration in ms, bytes, packets, round trip p50, p90 and p99 in us (echo test only, else 0),
+ *  lost (pings lost or frames not sent), round trip max and min in us (echo test only, else 0),
+ * then three padding bytes 0 (the frame stays a multiple of DEMOKIT_CMD_SIZE).
+ * The round trip values cover all the pings back during the test, the percentiles with about 12%
+ * resolution (histogram, see bench.h), the min and max are exact.
+ * The report is sent when the test ends, the data received during the test is not decoded as commands
+ * except a USB packet of exactly one SYSTEM BENCH command (stop or next test).
+ */
+#define DEMOKIT_BENCH_PAYLOAD_SIZE  (39)
+#define DEMOKIT_BENCH_FRAME_SIZE    (DEMOKIT_CMD_SIZE + DEMOKIT_BENCH_PAYLOAD_SIZE)
+
+/* DEMOKIT_TYPE_REFLEX ids are the DEMOKIT_TYPE_BUTTON ids */
+
+/* DEMOKIT_TYPE_TRAJECTORY ids, LEFT/RIGHT/DIR set the next setpoint fields (kept for the following setpoints) */
+#define DEMOKIT_ID_TRAJ_LEFT    (0) /* Android => EvalBot, left motor duty cycle 0 to 255 */
+#define DEMOKIT_ID_TRAJ_RIGHT   (1) /* Android => EvalBot, right motor duty cycle 0 to 255 */
+#define DEMOKIT_ID_TRAJ_DIR     (2) /* Android => EvalBot, TRAJ_DIR_XXX bits */
+#define DEMOKIT_ID_TRAJ_PUSH    (3) /* Android => EvalBot, queue the setpoint, value = delay from previous setpoint in 10ms units */
+#define DEMOKIT_ID_TRAJ_RUN     (4) /* Android => EvalBot, value 1=start 0=stop (queue flushed and motors stopped) */
+#define DEMOKIT_ID_TRAJ_STATUS  (5) /* EvalBot => Android, value = free setpoints (on queue full and when the queue is empty) */
+#define DEMOKIT_TRAJ_DELAY_UNIT_MS  (10)
+
+/* DEMOKIT_TYPE_SPEED ids */
+#define DEMOKIT_ID_SPEED_LEFT   (0) /* Left wheel target speed, value signed (-128 to 127) in 4mm/s units */
+#define DEMOKIT_ID_SPEED_RIGHT  (1) /* Right wheel target speed, value signed (-128 to 127) in 4mm/s units */
+#define DEMOKIT_ID_SPEED_OFF    (2) /* Speed control off and motors stopped (value ignored) */
+#define DEMOKIT_SPEED_UNIT_MM_S (4)
+
+/* DEMOKIT_TYPE_ODOMETRY ids */
+#define DEMOKIT_ID_ODOM_POSE    (0) /* EvalBot => Android, pose frame header, value = frame sequence number (wraps) */
+#define DEMOKIT_ID_ODOM_RATE    (1) /* Android => EvalBot, pose frames per second (1 to DEMOKIT_ODOM_RATE_MAX), 0 = off */
+#define DEMOKIT_ID_ODOM_RESET   (2) /* Android => EvalBot, the current pose becomes the origin (value ignored) */
+#define DEMOKIT_ODOM_RATE_MAX   (50)
+
+/*
+ * Pose frame: the DEMOKIT_ID_ODOM_POSE command is followed by DEMOKIT_ODOM_PAYLOAD_SIZE
+ * bytes (not commands, the frame keeps the commands alignment), 16 bits values big endian:
+ *  x in mm, y in mm (signed, wrap every 65.536m), heading (1<<16 = 360 degrees, counterclockwise)
+ * Pose frames are sent only once enabled by DEMOKIT_ID_ODOM_RATE (off on each connection).
+ */
+#define DEMOKIT_ODOM_PAYLOAD_SIZE   (6)
+#define DEMOKIT_ODOM_FRAME_SIZE     (DEMOKIT_CMD_SIZE + DEMOKIT_ODOM_PAYLOAD_SIZE)
+
+/* Command ids are below 1<<DEMOKIT_ID_BITS, (type, id) is a direct index in the handler table */
+#define DEMOKIT_ID_BITS         (5)
+#define DEMOKIT_NB_IDS          (1 << DEMOKIT_ID_BITS)
+#define DEMOKIT_CMD_INDEX(type, id) (((type) << DEMOKIT_ID_BITS) | (id))
+
+/* Command handler, cmd points to DEMOKIT_CMD_SIZE bytes */
+typedef void (*t_demokit_cmd_handler)(const t_u8* const cmd/*in*/);
+
+/*
+ * Commands handled by EvalBot: X(type, id, handler)
+ * Adding a command only requires a new entry here and its handler
+ * (handlers are implemented by the application).
+ * Commands without entry are ignored.
+ */
+#define DEMOKIT_COMMANDS(X) \
+    X(DEMOKIT_TYPE_LED_SERVO, DEMOKIT_ID_SERVO1, DemoKitServo1) \
+    X(DEMOKIT_TYPE_LED_SERVO, DEMOKIT_ID_SERVO2, DemoKitServo2) \
+    X(DEMOKIT_TYPE_RELAY, DEMOKIT_ID_RELAY1, DemoKitRelay1) \
+    X(DEMOKIT_TYPE_RELAY, DEMOKIT_ID_RELAY2, DemoKitRelay2) \
+    X(DEMOKIT_TYPE_SYSTEM, DEMOKIT_ID_PROFILE, DemoKitProfile) \
+    X(DEMOKIT_TYPE_SYSTEM, DEMOKIT_ID_MOTOR_RAMP, DemoKitMotorRamp) \
+    X(DEMOKIT_TYPE_SYSTEM, DEMOKIT_ID_BENCH, DemoKitBench) \
+    X(DEMOKIT_TYPE_SYSTEM, DEMOKIT_ID_USB_TRACE, DemoKitUsbTrace) \
+    X(DEMOKIT_TYPE_REFLEX, DEMOKIT_ID_BUTTON1, DemoKitReflex) \
+    X(DEMOKIT_TYPE_REFLEX, DEMOKIT_ID_BUTTON2, DemoKitReflex) \
+    X(DEMOKIT_TYPE_REFLEX, DEMOKIT_ID_BUTTON3, DemoKitReflex) \
+    X(DEMOKIT_TYPE_REFLEX, DEMOKIT_ID_BUTTON4, DemoKitReflex) \
+    X(DEMOKIT_TYPE_TRAJECTORY, DEMOKIT_ID_TRAJ_LEFT, DemoKitTrajectory) \
+    X(DEMOKIT_TYPE_TRAJECTORY, DEMOKIT_ID_TRAJ_RIGHT, DemoKitTrajectory) \
+    X(DEMOKIT_TYPE_TRAJECTORY, DEMOKIT_ID_TRAJ_DIR, DemoKitTrajectory) \
+    X(DEMOKIT_TYPE_TRAJECTORY, DEMOKIT_ID_TRAJ_PUSH, DemoKitTrajectory) \
+    X(DEMOKIT_TYPE_TRAJECTORY, DEMOKIT_ID_TRAJ_RUN, DemoKitTrajectory) \
+    X(DEMOKIT_TYPE_SPEED, DEMOKIT_ID_SPEED_LEFT, DemoKitSpeed) \
+    X(DEMOKIT_TYPE_SPEED, DEMOKIT_ID_SPEED_RIGHT, DemoKitSpeed) \
+    X(DEMOKIT_TYPE_SPEED, DEMOKIT_ID_SPEED_OFF, DemoKitSpeed) \
+    X(DEMOKIT_TYPE_ODOMETRY, DEMOKIT_ID_ODOM_RATE, DemoKitOdometry) \
+    X(DEMOKIT_TYPE_ODOMETRY, DEMOKIT_ID_ODOM_RESET, DemoKitOdometry)
+
+#define DEMOKIT_DECLARE_HANDLER(type, id, handler) \
+    extern void handler(const t_u8* const cmd/*in*/);
+DEMOKIT_COMMANDS(DEMOKIT_DECLARE_HANDLER)
+
+/* Called for each decoded command, cmd points to DEMOKIT_CMD_SIZE bytes */
+typedef void (*t_demokit_dispatch)(const t_u8* const cmd/*in*/, void* pvData/*in*/);
+
+/* Incremental decoder state, a partial command is kept until the next buffer */
+typedef struct
+{
+    t_u8 cmd[DEMOKIT_CMD_SIZE];
+    t_u8 nb; /* Number of bytes of the partial command in cmd */
+    t_demokit_dispatch dispatch;
+    void* pvData;
+} t_demokit_decoder;
+
+/*
+ * Outbound events aggregation: the events posted are gathered in one frame
+ * sent with a single ANDROID_write() when the frame is full or when the
+ * aggregation window of the first event is elapsed.
+ * Only complete commands are put in a frame (DemoKit does not reassemble commands across frames).
+ */
+#define DEMOKIT_EVENTS_FRAME_SIZE   ((ANDROID_TX_FRAME_SIZE / DEMOKIT_CMD_SIZE) * DEMOKIT_CMD_SIZE)
+
+typedef struct
+{
+    t_u8 frame[DEMOKIT_EVENTS_FRAME_SIZE];
+    t_u8 len; /* Number of bytes in frame */
+    t_u32 window_ms; /* Maximum time an event waits in frame, 0=sent on next DEMOKIT_eventsFlush() */
+    t_u32 first_ms; /* Time of the first event in frame */
+    t_u32 dropped; /* Number of events lost (frame full and TX queue full) */
+} t_demokit_events;
+
+/* API */
+
+extern void DEMOKIT_decoderInit(t_demokit_decoder* const decoder/*out*/, t_demokit_dispatch dispatch/*in*/, void* pvData/*in*/);
+
+extern void DEMOKIT_decoderReset(t_demokit_decoder* const decoder/*in/out*/);
+
+/* Call the handler registered in DEMOKIT_COMMANDS for cmd (constant time lookup), return false if no handler */
+extern bool DEMOKIT_dispatch(const t_u8* const cmd/*in*/);
+
+/* Decode len bytes, dispatch each complete command and return the number of commands dispatched */
+extern int DEMOKIT_decode(t_demokit_decoder* const decoder/*in/out*/, const t_u8* const buff/*in*/, const int len/*in*/);
+
+extern void DEMOKIT_eventsInit(t_demokit_events* const events/*out*/, const t_u32 window_ms/*in*/);
+
+/* Add one event to the frame (the frame is sent first if it is full) */
+extern void DEMOKIT_eventPost(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/,
+                              const t_u8 type/*in*/, const t_u8 id/*in*/, const t_u8 value/*in*/);
+
+/* Add len bytes (multiple of DEMOKIT_CMD_SIZE, up to DEMOKIT_EVENTS_FRAME_SIZE) kept in the same frame */
+extern void DEMOKIT_eventsPostRaw(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/,
+                                  const t_u8* const data/*in*/, const t_u8 len/*in*/);
+
+/* Send the frame if its window is elapsed (to be called once per loop), return true if a frame is sent */
+extern bool DEMOKIT_eventsFlush(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DEMOKIT_PROTOCOL_H__
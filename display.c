@@ -0,0 +1,287 @@
+//*****************************************************************************
+//
+// display.c - RAM framebuffer of the 96x16 OLED with sliced dirty columns flush.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_types.h"
+
+#include "drivers/display96x16x1.h"
+
+#include "usb_android.h"
+#include "display.h"
+
+//*****************************************************************************
+//
+// 5x7 font of the characters 0x20 to 0x7E, one byte per column (bit 0 = top
+// row).
+//
+//*****************************************************************************
+#define DISPLAY_FONT_FIRST  (0x20)
+#define DISPLAY_FONT_LAST   (0x7E)
+
+static const t_u8 g_ucDisplayFont[DISPLAY_FONT_LAST - DISPLAY_FONT_FIRST + 1][5] =
+{
+    { 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+    { 0x00, 0x00, 0x5F, 0x00, 0x00 }, // !
+    { 0x00, 0x07, 0x00, 0x07, 0x00 }, // "
+    { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, // #
+    { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, // $
+    { 0x23, 0x13, 0x08, 0x64, 0x62 }, // %
+    { 0x36, 0x49, 0x55, 0x22, 0x50 }, // &
+    { 0x00, 0x05, 0x03, 0x00, 0x00 }, // '
+    { 0x00, 0x1C, 0x22, 0x41, 0x00 }, // (
+    { 0x00, 0x41, 0x22, 0x1C, 0x00 }, // )
+    { 0x14, 0x08, 0x3E, 0x08, 0x14 }, // *
+    { 0x08, 0x08, 0x3E, 0x08, 0x08 }, // +
+    { 0x00, 0x50, 0x30, 0x00, 0x00 }, // ,
+    { 0x08, 0x08, 0x08, 0x08, 0x08 }, // -
+    { 0x00, 0x60, 0x60, 0x00, 0x00 }, // .
+    { 0x20, 0x10, 0x08, 0x04, 0x02 }, // /
+    { 0x3E, 0x51, 0x49, 0x45, 0x3E }, // 0
+    { 0x00, 0x42, 0x7F, 0x40, 0x00 }, // 1
+    { 0x42, 0x61, 0x51, 0x49, 0x46 }, // 2
+    { 0x21, 0x41, 0x45, 0x4B, 0x31 }, // 3
+    { 0x18, 0x14, 0x12, 0x7F, 0x10 }, // 4
+    { 0x27, 0x45, 0x45, 0x45, 0x39 }, // 5
+    { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, // 6
+    { 0x01, 0x71, 0x09, 0x05, 0x03 }, // 7
+    { 0x36, 0x49, 0x49, 0x49, 0x36 }, // 8
+    { 0x06, 0x49, 0x49, 0x29, 0x1E }, // 9
+    { 0x00, 0x36, 0x36, 0x00, 0x00 }, // :
+    { 0x00, 0x56, 0x36, 0x00, 0x00 }, // ;
+    { 0x08, 0x14, 0x22, 0x41, 0x00 }, // <
+    { 0x14, 0x14, 0x14, 0x14, 0x14 }, // =
+    { 0x00, 0x41, 0x22, 0x14, 0x08 }, // >
+    { 0x02, 0x01, 0x51, 0x09, 0x06 }, // ?
+    { 0x32, 0x49, 0x79, 0x41, 0x3E }, // @
+    { 0x7E, 0x11, 0x11, 0x11, 0x7E }, // A
+    { 0x7F, 0x49, 0x49, 0x49, 0x36 }, // B
+    { 0x3E, 0x41, 0x41, 0x41, 0x22 }, // C
+    { 0x7F, 0x41, 0x41, 0x22, 0x1C }, // D
+    { 0x7F, 0x49, 0x49, 0x49, 0x41 }, // E
+    { 0x7F, 0x09, 0x09, 0x09, 0x01 }, // F
+    { 0x3E, 0x41, 0x49, 0x49, 0x7A }, // G
+    { 0x7F, 0x08, 0x08, 0x08, 0x7F }, // H
+    { 0x00, 0x41, 0x7F, 0x41, 0x00 }, // I
+    { 0x20, 0x40, 0x41, 0x3F, 0x01 }, // J
+    { 0x7F, 0x08, 0x14, 0x22, 0x41 }, // K
+    { 0x7F, 0x40, 0x40, 0x40, 0x40 }, // L
+    { 0x7F, 0x02, 0x0C, 0x02, 0x7F }, // M
+    { 0x7F, 0x04, 0x08, 0x10, 0x7F }, // N
+    { 0x3E, 0x41, 0x41, 0x41, 0x3E }, // O
+    { 0x7F, 0x09, 0x09, 0x09, 0x06 }, // P
+    { 0x3E, 0x41, 0x51, 0x21, 0x5E }, // Q
+    { 0x7F, 0x09, 0x19, 0x29, 0x46 }, // R
+    { 0x46, 0x49, 0x49, 0x49, 0x31 }, // S
+    { 0x01, 0x01, 0x7F, 0x01, 0x01 }, // T
+    { 0x3F, 0x40, 0x40, 0x40, 0x3F }, // U
+    { 0x1F, 0x20, 0x40, 0x20, 0x1F }, // V
+    { 0x3F, 0x40, 0x38, 0x40, 0x3F }, // W
+    { 0x63, 0x14, 0x08, 0x14, 0x63 }, // X
+    { 0x07, 0x08, 0x70, 0x08, 0x07 }, // Y
+    { 0x61, 0x51, 0x49, 0x45, 0x43 }, // Z
+    { 0x00, 0x7F, 0x41, 0x41, 0x00 }, // [
+    { 0x02, 0x04, 0x08, 0x10, 0x20 }, // '\'
+    { 0x00, 0x41, 0x41, 0x7F, 0x00 }, // ]
+    { 0x04, 0x02, 0x01, 0x02, 0x04 }, // ^
+    { 0x40, 0x40, 0x40, 0x40, 0x40 }, // _
+    { 0x00, 0x01, 0x02, 0x04, 0x00 }, // `
+    { 0x20, 0x54, 0x54, 0x54, 0x78 }, // a
+    { 0x7F, 0x48, 0x44, 0x44, 0x38 }, // b
+    { 0x38, 0x44, 0x44, 0x44, 0x20 }, // c
+    { 0x38, 0x44, 0x44, 0x48, 0x7F }, // d
+    { 0x38, 0x54, 0x54, 0x54, 0x18 }, // e
+    { 0x08, 0x7E, 0x09, 0x01, 0x02 }, // f
+    { 0x0C, 0x52, 0x52, 0x52, 0x3E }, // g
+    { 0x7F, 0x08, 0x04, 0x04, 0x78 }, // h
+    { 0x00, 0x44, 0x7D, 0x40, 0x00 }, // i
+    { 0x20, 0x40, 0x44, 0x3D, 0x00 }, // j
+    { 0x7F, 0x10, 0x28, 0x44, 0x00 }, // k
+    { 0x00, 0x41, 0x7F, 0x40, 0x00 }, // l
+    { 0x7C, 0x04, 0x18, 0x04, 0x78 }, // m
+    { 0x7C, 0x08, 0x04, 0x04, 0x78 }, // n
+    { 0x38, 0x44, 0x44, 0x44, 0x38 }, // o
+    { 0x7C, 0x14, 0x14, 0x14, 0x08 }, // p
+    { 0x08, 0x14, 0x14, 0x18, 0x7C }, // q
+    { 0x7C, 0x08, 0x04, 0x04, 0x08 }, // r
+    { 0x48, 0x54, 0x54, 0x54, 0x20 }, // s
+    { 0x04, 0x3F, 0x44, 0x40, 0x20 }, // t
+    { 0x3C, 0x40, 0x40, 0x20, 0x7C }, // u
+    { 0x1C, 0x20, 0x40, 0x20, 0x1C }, // v
+    { 0x3C, 0x40, 0x30, 0x40, 0x3C }, // w
+    { 0x44, 0x28, 0x10, 0x28, 0x44 }, // x
+    { 0x0C, 0x50, 0x50, 0x50, 0x3C }, // y
+    { 0x44, 0x64, 0x54, 0x4C, 0x44 }, // z
+    { 0x00, 0x08, 0x36, 0x41, 0x00 }, // {
+    { 0x00, 0x00, 0x7F, 0x00, 0x00 }, // |
+    { 0x00, 0x41, 0x36, 0x08, 0x00 }, // }
+    { 0x10, 0x08, 0x08, 0x10, 0x08 }  // ~
+};
+
+//*****************************************************************************
+//
+// The framebuffer and its dirty columns, one bit per column of each line.
+//
+//*****************************************************************************
+#define DISPLAY_DIRTY_WORDS ((DISPLAY_COLUMNS + 31) / 32)
+
+static t_u8 g_ucDisplayFb[DISPLAY_LINES][DISPLAY_COLUMNS];
+static t_u32 g_ulDisplayDirty[DISPLAY_LINES][DISPLAY_DIRTY_WORDS];
+
+#define DISPLAY_IS_DIRTY(line, x) \
+    (g_ulDisplayDirty[line][(x) >> 5] & (1UL << ((x) & 31)))
+
+//*****************************************************************************
+//
+// Write one column byte, marked dirty only if it changes.
+//
+//*****************************************************************************
+static void DISPLAY_put(t_u32 ulLine, t_u32 ulX, t_u8 ucByte)
+{
+    if(g_ucDisplayFb[ulLine][ulX] != ucByte)
+    {
+        g_ucDisplayFb[ulLine][ulX] = ucByte;
+        g_ulDisplayDirty[ulLine][ulX >> 5] |= 1UL << (ulX & 31);
+    }
+}
+
+//*****************************************************************************
+//
+//! This function initializes the display and the framebuffer.
+//!
+//! The display is cleared with the blocking driver calls, the framebuffer
+//! matches the display (nothing dirty).
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DISPLAY_init(void)
+{
+    t_u32 ulLine, ulX;
+
+    Display96x16x1Init(true);
+    Display96x16x1Clear();
+    Display96x16x1DisplayOn();
+
+    for(ulLine = 0; ulLine < DISPLAY_LINES; ulLine++)
+    {
+        for(ulX = 0; ulX < DISPLAY_COLUMNS; ulX++)
+        {
+            g_ucDisplayFb[ulLine][ulX] = 0;
+        }
+        for(ulX = 0; ulX < DISPLAY_DIRTY_WORDS; ulX++)
+        {
+            g_ulDisplayDirty[ulLine][ulX] = 0;
+        }
+    }
+}
+
+void DISPLAY_clearLine(const t_u32 line/*in*/)
+{
+    t_u32 ulX;
+
+    for(ulX = 0; ulX < DISPLAY_COLUMNS; ulX++)
+    {
+        DISPLAY_put(line, ulX, 0);
+    }
+}
+
+//*****************************************************************************
+//
+//! This function draws a string in the framebuffer.
+//!
+//! \param str is the string, characters outside the font are drawn as spaces.
+//! \param x is the first column.
+//! \param line is the display line.
+//!
+//! Each character uses DISPLAY_CHAR_WIDTH columns (5 columns of font and one
+//! blank column), the string is clipped at the right of the display.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void DISPLAY_stringDraw(const char* const str/*in*/, const t_u32 x/*in*/, const t_u32 line/*in*/)
+{
+    const t_u8* pucGlyph;
+    t_u32 ulX;
+    t_u32 i, j;
+    t_u8 ucChar;
+
+    ulX = x;
+    for(i = 0; (str[i] != 0) && (ulX < DISPLAY_COLUMNS); i++)
+    {
+        ucChar = (t_u8)str[i];
+        if((ucChar < DISPLAY_FONT_FIRST) || (ucChar > DISPLAY_FONT_LAST))
+        {
+            ucChar = ' ';
+        }
+        pucGlyph = g_ucDisplayFont[ucChar - DISPLAY_FONT_FIRST];
+
+        for(j = 0; (j < DISPLAY_CHAR_WIDTH) && (ulX < DISPLAY_COLUMNS); j++, ulX++)
+        {
+            DISPLAY_put(line, ulX, (j < 5) ? pucGlyph[j] : 0);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! This function sends dirty columns to the display.
+//!
+//! \param max_columns is the maximum number of columns sent by this call.
+//!
+//! The dirty columns are sent from the top left, each run of contiguous dirty
+//! columns of a line is sent with one Display96x16x1ImageDraw() call.  This
+//! function must be called only from the main loop.
+//!
+//! \return Returns \e true if dirty columns are left for the next call.
+//
+//*****************************************************************************
+bool DISPLAY_flush(const t_u32 max_columns/*in*/)
+{
+    t_u32 ulLeft;
+    t_u32 ulLine;
+    t_u32 ulX, ulEnd;
+
+    ulLeft = max_columns;
+    for(ulLine = 0; ulLine < DISPLAY_LINES; ulLine++)
+    {
+        ulX = 0;
+        while(ulX < DISPLAY_COLUMNS)
+        {
+            if(g_ulDisplayDirty[ulLine][ulX >> 5] == 0)
+            {
+                // Skip the clean words.
+                ulX = (ulX | 31) + 1;
+                continue;
+            }
+            if(!DISPLAY_IS_DIRTY(ulLine, ulX))
+            {
+                ulX++;
+                continue;
+            }
+            if(ulLeft == 0)
+            {
+                return true;
+            }
+
+            // Run of dirty columns, limited to the slice.
+            ulEnd = ulX;
+            while((ulEnd < DISPLAY_COLUMNS) && ((ulEnd - ulX) < ulLeft) && DISPLAY_IS_DIRTY(ulLine, ulEnd))
+            {
+                g_ulDisplayDirty[ulLine][ulEnd >> 5] &= ~(1UL << (ulEnd & 31));
+                ulEnd++;
+            }
+
+            Display96x16x1ImageDraw(&g_ucDisplayFb[ulLine][ulX], ulX, ulLine, ulEnd - ulX, 1);
+            ulLeft -= ulEnd - ulX;
+            ulX = ulEnd;
+        }
+    }
+
+    return false;
+}
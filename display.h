@@ -0,0 +1,64 @@
+//*****************************************************************************
+//
+// display.h - RAM framebuffer of the 96x16 OLED with sliced dirty columns flush.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __DISPLAY_H__
+#define __DISPLAY_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * The application draws in a RAM copy of the display (no bus access), each
+ * column byte really changed is marked dirty.  DISPLAY_flush() sends at most
+ * a given number of dirty columns per call (one blocking
+ * Display96x16x1ImageDraw() per run of contiguous columns), it is called once
+ * per main loop iteration so a display update never holds the loop more than
+ * one slice.
+ * The display has DISPLAY_LINES lines of 8 pixels rows, one byte per column
+ * and line (bit 0 = top row), text uses a 5x7 font in CHAR_CELL_WIDTH cells.
+ */
+#define DISPLAY_COLUMNS     (96)
+#define DISPLAY_LINES       (2)
+#define DISPLAY_CHAR_WIDTH  (6) /* Same as CHAR_CELL_WIDTH of the display driver */
+
+/* Columns sent per flush slice, one text cell (the spinner) is sent in one slice */
+#define DISPLAY_FLUSH_COLUMNS   (DISPLAY_CHAR_WIDTH)
+
+/* API */
+
+/* Initialize and clear the display (blocking, call once at startup) */
+extern void DISPLAY_init(void);
+
+/* Clear one line of the framebuffer */
+extern void DISPLAY_clearLine(const t_u32 line/*in*/);
+
+/* Draw a string in the framebuffer from column x of the line (clipped to the display) */
+extern void DISPLAY_stringDraw(const char* const str/*in*/, const t_u32 x/*in*/, const t_u32 line/*in*/);
+
+/* Send at most max_columns dirty columns to the display, return true if dirty columns are left */
+extern bool DISPLAY_flush(const t_u32 max_columns/*in*/);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DISPLAY_H__
@@ -0,0 +1,77 @@
+//*****************************************************************************
+//
+// event.c - Event flags posted by interrupts and consumed by the main loop.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_types.h"
+#include "driverlib/cpu.h"
+#include "driverlib/interrupt.h"
+
+#include "usb_android.h"
+#include "event.h"
+
+//*****************************************************************************
+//
+// Pending events, one bit per EVENT_XXX.  The variable is in SRAM so each bit
+// is also mapped in the bit-band alias region.
+//
+//*****************************************************************************
+static volatile t_u32 g_ulEventFlags = 0;
+
+//*****************************************************************************
+//
+//! This function posts an event to the main loop.
+//!
+//! \param event is the event number (EVENT_XXX).
+//!
+//! The bit is set with a single store in the bit-band alias of
+//! g_ulEventFlags, there is no read-modify-write so an interrupt posting an
+//! event can not lose a bit posted by another interrupt which preempted it.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void EVENT_post(t_u32 event/*in*/)
+{
+    HWREGBITW(&g_ulEventFlags, event) = 1;
+}
+
+//*****************************************************************************
+//
+//! This function waits until at least one event is pending.
+//!
+//! The flags are tested with interrupts masked, so an interrupt occurring
+//! between the test and the WFI instruction can not be missed: WFI still
+//! wakes up the core when an interrupt is pending while masked, and the
+//! interrupt handler runs as soon as the interrupts are unmasked.
+//!
+//! \return Returns the mask of pending events (EVENT_MASK(EVENT_XXX) bits),
+//! all these events are cleared.
+//
+//*****************************************************************************
+t_u32 EVENT_wait(void)
+{
+    t_u32 ulEvents;
+
+    while(1)
+    {
+        IntMasterDisable();
+
+        ulEvents = g_ulEventFlags;
+        if(ulEvents != 0)
+        {
+            g_ulEventFlags = 0;
+            IntMasterEnable();
+            return ulEvents;
+        }
+
+        // Nothing to do, sleep until the next interrupt.
+        CPUwfi();
+
+        IntMasterEnable();
+    }
+}
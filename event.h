@@ -0,0 +1,53 @@
+//*****************************************************************************
+//
+// event.h - Event flags posted by interrupts and consumed by the main loop.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __EVENT_H__
+#define __EVENT_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Each interrupt handler posts its event bit with EVENT_post() (one atomic
+ * bit-band store, no read-modify-write so it is safe from any interrupt
+ * priority), the main loop gets and clears all pending events with
+ * EVENT_wait() and runs only the handlers of those events.
+ * When no event is pending EVENT_wait() puts the core in sleep mode (WFI)
+ * until the next interrupt.
+ */
+#define EVENT_TICK      (0) /* SysTick, 1 per millisecond */
+#define EVENT_USB       (1) /* USB controller interrupt (enumeration, pipe RX/TX) */
+#define EVENT_INPUT     (2) /* Switch or bumper GPIO edge */
+#define EVENT_TRAJ      (3) /* Trajectory setpoint applied by the timer */
+#define EVENT_NB        (4)
+
+#define EVENT_MASK(event)   (1UL << (event))
+
+extern void EVENT_post(t_u32 event/*in*/);
+
+extern t_u32 EVENT_wait(void); /* Return the mask of pending events (never 0) */
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __EVENT_H__
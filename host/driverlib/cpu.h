@@ -0,0 +1,18 @@
+//*****************************************************************************
+//
+// cpu.h - Host build: CPU instructions wrappers (simulated core).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __CPU_H__
+#define __CPU_H__
+
+extern unsigned int CPUcpsid(void);
+extern unsigned int CPUcpsie(void);
+extern unsigned int CPUprimask(void);
+extern void CPUwfi(void);
+
+#endif // __CPU_H__
@@ -0,0 +1,54 @@
+//*****************************************************************************
+//
+// gpio.h - Host build: GPIO driver API (simulated ports).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __GPIO_H__
+#define __GPIO_H__
+
+#define GPIO_PIN_0              0x00000001
+#define GPIO_PIN_1              0x00000002
+#define GPIO_PIN_2              0x00000004
+#define GPIO_PIN_3              0x00000008
+#define GPIO_PIN_4              0x00000010
+#define GPIO_PIN_5              0x00000020
+#define GPIO_PIN_6              0x00000040
+#define GPIO_PIN_7              0x00000080
+
+#define GPIO_DIR_MODE_IN        0x00000000
+#define GPIO_DIR_MODE_OUT       0x00000001
+#define GPIO_DIR_MODE_HW        0x00000002
+
+#define GPIO_FALLING_EDGE       0x00000000
+#define GPIO_RISING_EDGE        0x00000004
+#define GPIO_BOTH_EDGES         0x00000001
+#define GPIO_LOW_LEVEL          0x00000002
+#define GPIO_HIGH_LEVEL         0x00000007
+
+#define GPIO_STRENGTH_2MA       0x00000001
+#define GPIO_PIN_TYPE_STD       0x00000008
+#define GPIO_PIN_TYPE_STD_WPU   0x0000000A
+
+#define GPIO_PA6_USB0EPEN       0x00001808
+
+extern void GPIODirModeSet(unsigned int ulPort, unsigned char ucPins, unsigned int ulPinIO);
+extern void GPIOIntTypeSet(unsigned int ulPort, unsigned char ucPins, unsigned int ulIntType);
+extern void GPIOPadConfigSet(unsigned int ulPort, unsigned char ucPins, unsigned int ulStrength,
+                             unsigned int ulPadType);
+extern void GPIOPinIntEnable(unsigned int ulPort, unsigned char ucPins);
+extern void GPIOPinIntDisable(unsigned int ulPort, unsigned char ucPins);
+extern int GPIOPinIntStatus(unsigned int ulPort, tBoolean bMasked);
+extern void GPIOPinIntClear(unsigned int ulPort, unsigned char ucPins);
+extern int GPIOPinRead(unsigned int ulPort, unsigned char ucPins);
+extern void GPIOPinWrite(unsigned int ulPort, unsigned char ucPins, unsigned char ucVal);
+extern void GPIOPinTypeGPIOInput(unsigned int ulPort, unsigned char ucPins);
+extern void GPIOPinTypeGPIOOutput(unsigned int ulPort, unsigned char ucPins);
+extern void GPIOPinTypeUART(unsigned int ulPort, unsigned char ucPins);
+extern void GPIOPinTypeUSBDigital(unsigned int ulPort, unsigned char ucPins);
+extern void GPIOPinConfigure(unsigned int ulPinConfig);
+
+#endif // __GPIO_H__
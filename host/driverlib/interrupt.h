@@ -0,0 +1,19 @@
+//*****************************************************************************
+//
+// interrupt.h - Host build: NVIC API (simulated interrupt controller).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __INTERRUPT_H__
+#define __INTERRUPT_H__
+
+extern tBoolean IntMasterEnable(void);
+extern tBoolean IntMasterDisable(void);
+extern void IntEnable(unsigned int ulInterrupt);
+extern void IntDisable(unsigned int ulInterrupt);
+extern void IntPrioritySet(unsigned int ulInterrupt, unsigned char ucPriority);
+
+#endif // __INTERRUPT_H__
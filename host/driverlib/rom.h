@@ -0,0 +1,52 @@
+//*****************************************************************************
+//
+// rom.h - Host build: ROM API calls mapped to the simulated driverlib.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __ROM_H__
+#define __ROM_H__
+
+#include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/systick.h"
+#include "driverlib/timer.h"
+#include "driverlib/usb.h"
+
+#define ROM_SysCtlClockSet          SysCtlClockSet
+#define ROM_SysCtlClockGet          SysCtlClockGet
+#define ROM_SysCtlPeripheralEnable  SysCtlPeripheralEnable
+#define ROM_GPIOPinTypeUART         GPIOPinTypeUART
+#define ROM_GPIOPinTypeGPIOOutput   GPIOPinTypeGPIOOutput
+#define ROM_GPIOPinTypeUSBDigital   GPIOPinTypeUSBDigital
+#define ROM_GPIODirModeSet          GPIODirModeSet
+#define ROM_GPIOPadConfigSet        GPIOPadConfigSet
+#define ROM_GPIOIntTypeSet          GPIOIntTypeSet
+#define ROM_GPIOPinIntEnable        GPIOPinIntEnable
+#define ROM_GPIOPinIntClear         GPIOPinIntClear
+#define ROM_GPIOPinIntStatus        GPIOPinIntStatus
+#define ROM_GPIOPinRead             GPIOPinRead
+#define ROM_GPIOPinWrite            GPIOPinWrite
+#define ROM_SysTickPeriodSet        SysTickPeriodSet
+#define ROM_SysTickPeriodGet        SysTickPeriodGet
+#define ROM_SysTickValueGet         SysTickValueGet
+#define ROM_SysTickEnable           SysTickEnable
+#define ROM_SysTickIntEnable        SysTickIntEnable
+#define ROM_IntEnable               IntEnable
+#define ROM_IntMasterEnable         IntMasterEnable
+#define ROM_IntMasterDisable        IntMasterDisable
+#define ROM_IntPrioritySet          IntPrioritySet
+#define ROM_TimerConfigure          TimerConfigure
+#define ROM_TimerLoadSet            TimerLoadSet
+#define ROM_TimerIntEnable          TimerIntEnable
+#define ROM_TimerIntClear           TimerIntClear
+#define ROM_TimerEnable             TimerEnable
+#define ROM_TimerDisable            TimerDisable
+#define ROM_USBEndpointDataAvail    USBEndpointDataAvail
+#define ROM_USBFIFOFlush            USBFIFOFlush
+
+#endif // __ROM_H__
@@ -0,0 +1,33 @@
+//*****************************************************************************
+//
+// sysctl.h - Host build: system control API.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __SYSCTL_H__
+#define __SYSCTL_H__
+
+#define SYSCTL_PERIPH_USB0      0x10100001
+#define SYSCTL_PERIPH_TIMER0    0x10100001
+#define SYSCTL_PERIPH_TIMER1    0x10100002
+#define SYSCTL_PERIPH_TIMER2    0x10100004
+#define SYSCTL_PERIPH_GPIOA     0x20000001
+#define SYSCTL_PERIPH_GPIOB     0x20000002
+#define SYSCTL_PERIPH_GPIOC     0x20000004
+#define SYSCTL_PERIPH_GPIOD     0x20000008
+#define SYSCTL_PERIPH_GPIOE     0x20000010
+#define SYSCTL_PERIPH_GPIOF     0x20000020
+
+#define SYSCTL_SYSDIV_4         0x01C00000
+#define SYSCTL_USE_PLL          0x00000000
+#define SYSCTL_OSC_MAIN         0x00000000
+#define SYSCTL_XTAL_16MHZ       0x00000540
+
+extern void SysCtlPeripheralEnable(unsigned int ulPeripheral);
+extern void SysCtlClockSet(unsigned int ulConfig);
+extern unsigned int SysCtlClockGet(void);
+
+#endif // __SYSCTL_H__
@@ -0,0 +1,21 @@
+//*****************************************************************************
+//
+// systick.h - Host build: SysTick API (simulated timer).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __SYSTICK_H__
+#define __SYSTICK_H__
+
+extern void SysTickEnable(void);
+extern void SysTickDisable(void);
+extern void SysTickIntEnable(void);
+extern void SysTickIntDisable(void);
+extern void SysTickPeriodSet(unsigned int ulPeriod);
+extern unsigned int SysTickPeriodGet(void);
+extern unsigned int SysTickValueGet(void);
+
+#endif // __SYSTICK_H__
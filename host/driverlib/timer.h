@@ -0,0 +1,31 @@
+//*****************************************************************************
+//
+// timer.h - Host build: general purpose timers API (simulated timers).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#define TIMER_A                 0x000000ff
+#define TIMER_B                 0x0000ff00
+#define TIMER_BOTH              0x0000ffff
+
+#define TIMER_CFG_32_BIT_OS     0x00000021
+#define TIMER_CFG_32_BIT_PER    0x00000022
+
+#define TIMER_TIMA_TIMEOUT      0x00000001
+
+extern void TimerEnable(unsigned int ulBase, unsigned int ulTimer);
+extern void TimerDisable(unsigned int ulBase, unsigned int ulTimer);
+extern void TimerConfigure(unsigned int ulBase, unsigned int ulConfig);
+extern void TimerLoadSet(unsigned int ulBase, unsigned int ulTimer, unsigned int ulValue);
+extern unsigned int TimerValueGet(unsigned int ulBase, unsigned int ulTimer);
+extern void TimerIntEnable(unsigned int ulBase, unsigned int ulIntFlags);
+extern void TimerIntDisable(unsigned int ulBase, unsigned int ulIntFlags);
+extern void TimerIntClear(unsigned int ulBase, unsigned int ulIntFlags);
+
+#endif // __TIMER_H__
@@ -0,0 +1,15 @@
+//*****************************************************************************
+//
+// uart.h - Host build: UART API.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __UART_H__
+#define __UART_H__
+
+extern tBoolean UARTBusy(unsigned int ulBase);
+
+#endif // __UART_H__
@@ -0,0 +1,27 @@
+//*****************************************************************************
+//
+// usb.h - Host build: USB controller API (simulated endpoints FIFO).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __USB_H__
+#define __USB_H__
+
+#define USB_EP_0                0x00000000
+#define USB_EP_1                0x00000010
+#define USB_EP_2                0x00000020
+#define USB_EP_3                0x00000030
+
+#define USB_EP_HOST_IN          0x00000000
+#define USB_EP_HOST_OUT         0x00002000
+
+extern unsigned int USBEndpointDataAvail(unsigned int ulBase, unsigned int ulEndpoint);
+extern int USBEndpointDataGet(unsigned int ulBase, unsigned int ulEndpoint, unsigned char *pucData,
+                              unsigned int *pulSize);
+extern void USBEndpointDataToggleClear(unsigned int ulBase, unsigned int ulEndpoint, unsigned int ulFlags);
+extern void USBFIFOFlush(unsigned int ulBase, unsigned int ulEndpoint, unsigned int ulFlags);
+
+#endif // __USB_H__
@@ -0,0 +1,24 @@
+//*****************************************************************************
+//
+// display96x16x1.h - Host build: EvalBot OLED display driver API (simulated blocking bus).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __DISPLAY96X16X1_H__
+#define __DISPLAY96X16X1_H__
+
+#define CHAR_CELL_WIDTH         6
+
+extern void Display96x16x1Init(tBoolean bFast);
+extern void Display96x16x1Clear(void);
+extern void Display96x16x1ClearLine(unsigned int ulY);
+extern void Display96x16x1StringDraw(const char *pcStr, unsigned int ulX, unsigned int ulY);
+extern void Display96x16x1ImageDraw(const unsigned char *pucImage, unsigned int ulX, unsigned int ulY,
+                                    unsigned int ulWidth, unsigned int ulHeight);
+extern void Display96x16x1DisplayOn(void);
+extern void Display96x16x1DisplayOff(void);
+
+#endif // __DISPLAY96X16X1_H__
@@ -0,0 +1,33 @@
+//*****************************************************************************
+//
+// motor.h - Host build: EvalBot motors driver API (simulated H bridges).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __MOTOR_H__
+#define __MOTOR_H__
+
+typedef enum
+{
+    LEFT_SIDE = 0,
+    RIGHT_SIDE = 1
+}
+tSide;
+
+typedef enum
+{
+    FORWARD = 0,
+    REVERSE = 1
+}
+tDirection;
+
+extern void MotorsInit(void);
+extern void MotorDir(tSide eMotor, tDirection eDirection);
+extern void MotorRun(tSide eMotor);
+extern void MotorStop(tSide eMotor);
+extern void MotorSpeed(tSide eMotor, unsigned short usPercent);
+
+#endif // __MOTOR_H__
@@ -0,0 +1,383 @@
+//*****************************************************************************
+//
+// host_bench.c - Host benchmarks of the firmware: main loop latency,
+// enumeration time, DemoKit commands throughput and end to end latencies
+// with the simulated Android phone.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "drivers/motor.h"
+#include "usblib/usblib.h"
+
+#include "usb_android.h"
+#include "demokit_protocol.h"
+#include "sim.h"
+
+/*
+ * Each scenario runs in its own process (the firmware globals start from
+ * their reset values) and prints one line of key=value results.  The
+ * virtual times only depend on the firmware and the simulated timings, the
+ * host_ns values measure the host build itself.
+ */
+#define BENCH_HOST_COMMANDS         (21 * 500) /* Relay commands, 21 per 63 bytes packet */
+#define BENCH_HOST_CMDS_PER_PACKET  (ANDROID_TX_FRAME_SIZE / DEMOKIT_CMD_SIZE)
+#define BENCH_HOST_NAK_PERIOD_US    (10000) /* NAK scenario: the device NAKs 2ms every 10ms */
+#define BENCH_HOST_NAK_US           (2000)
+#define BENCH_HOST_HALT_PERIOD_US   (2000) /* Stall scenario: the device halts its Bulk IN endpoint every 2ms */
+#define BENCH_HOST_TIMEOUT_US       (20000000)
+#define BENCH_HOST_PLUG_US          (50000)
+#define BENCH_HOST_LATENCY_US       (10000000) /* Android latency scenarios run time */
+#define BENCH_HOST_LOAD_PERIOD_US   (1000) /* Load scenario: 85 commands (4 packets) written every 1ms */
+#define BENCH_HOST_LOAD_COMMANDS    (85)
+
+typedef struct
+{
+    const char *pcName;
+    void (*pfnRun)(void);
+} t_bench_host_scenario;
+
+static t_u32 g_ulBenchHostCommands;
+static t_u64 g_ullBenchHostStartUs;
+static t_u64 g_ullBenchHostEndUs;
+static struct timespec g_sBenchHostStartHost;
+static t_u32 g_ulBenchHostElapsedNs;
+
+static t_u64 BenchHostNs(const struct timespec *psFrom)
+{
+    struct timespec sNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+
+    return ((t_u64)(sNow.tv_sec - psFrom->tv_sec) * 1000000000ULL) + sNow.tv_nsec - psFrom->tv_nsec;
+}
+
+static void BenchHostPrintDist(const char *pcName, const t_sim_dist *psDist)
+{
+    printf(" %s_p50=%u %s_p90=%u %s_p99=%u %s_max=%u", pcName, psDist->p50, pcName, psDist->p90,
+           pcName, psDist->p99, pcName, psDist->max);
+}
+
+//*****************************************************************************
+//
+// Poll the connection report every millisecond, then run pfnConnected.
+//
+//*****************************************************************************
+static void BenchHostWaitConnected(void *pvData, t_u32 ulArg)
+{
+    t_android_connect_report sReport;
+
+    ANDROID_getConnectReport(&sReport);
+    if(sReport.connected_us == 0)
+    {
+        SIM_at(SIM_now_us() + 1000, BenchHostWaitConnected, pvData, ulArg);
+        return;
+    }
+
+    ((t_sim_action)pvData)(NULL, ulArg);
+}
+
+//*****************************************************************************
+//
+// Main loop latency with nothing plugged: SysTick, motors control and speed
+// timers, and the display refresh.
+//
+//*****************************************************************************
+static void BenchHostLoopIdle(void)
+{
+    t_sim_dist sLoopUs, sLoopNs;
+
+    SIM_init(NULL);
+    SIM_run(2000000, firmware_main);
+
+    SIM_loopLatency(&sLoopUs, &sLoopNs);
+    printf("scenario=loop_idle wakeups=%u", SIM_loopWakeups());
+    BenchHostPrintDist("loop_us", &sLoopUs);
+    BenchHostPrintDist("loop_host_ns", &sLoopNs);
+    printf("\n");
+}
+
+//*****************************************************************************
+//
+// Enumeration: accessory device plugged, time to ANDROID_isConnected().
+//
+//*****************************************************************************
+static void BenchHostConnected(void *pvData, t_u32 ulArg)
+{
+    SIM_stop();
+}
+
+static void BenchHostPlug(void *pvData, t_u32 ulArg)
+{
+    SIM_usbPlug(SIM_usbAccessoryDevice());
+}
+
+static void BenchHostEnumeration(void)
+{
+    t_android_connect_report sReport;
+    t_sim_usb_stats sStats;
+
+    SIM_init(NULL);
+    SIM_at(BENCH_HOST_PLUG_US, BenchHostPlug, NULL, 0);
+    SIM_at(BENCH_HOST_PLUG_US, BenchHostWaitConnected, BenchHostConnected, 0);
+    SIM_run(BENCH_HOST_TIMEOUT_US, firmware_main);
+
+    ANDROID_getConnectReport(&sReport);
+    SIM_usbStats(&sStats);
+    printf("scenario=enumeration plug_to_session_us=%u session_to_connected_us=%u plug_to_connected_us=%u"
+           " control_transfers=%u\n",
+           (sReport.plug_us != 0) ? (t_u32)(sReport.plug_us - BENCH_HOST_PLUG_US) : 0,
+           (sReport.connected_us != 0) ? (sReport.connected_us - sReport.plug_us) : 0,
+           (sReport.connected_us != 0) ? (t_u32)(sReport.connected_us - BENCH_HOST_PLUG_US) : 0,
+           sStats.control_transfers);
+}
+
+//*****************************************************************************
+//
+// Commands throughput: the device queues all the relay commands at once, the
+// run ends when the firmware wrote the LED of the last one.  With NAK periods
+// or endpoint halts (no command lost after each halt cleared) meanwhile.
+//
+//*****************************************************************************
+static void BenchHostGpioWrite(t_u32 ulPort, t_u8 ucPins, t_u8 ucValue)
+{
+    if((ulPort != LED1_PORT_BASE) || (ucPins != LED1_PIN) || (g_ullBenchHostStartUs == 0))
+    {
+        return;
+    }
+
+    if(++g_ulBenchHostCommands == BENCH_HOST_COMMANDS)
+    {
+        g_ullBenchHostEndUs = SIM_now_us();
+        g_ulBenchHostElapsedNs = (t_u32)BenchHostNs(&g_sBenchHostStartHost);
+        SIM_stop();
+    }
+}
+
+#define BENCH_HOST_RUN_PLAIN    (0)
+#define BENCH_HOST_RUN_NAK      (1)
+#define BENCH_HOST_RUN_HALT     (2)
+
+static void BenchHostHalt(void *pvData, t_u32 ulArg)
+{
+    SIM_usbHalt(true, 1);
+}
+
+static void BenchHostSendCommands(void *pvData, t_u32 ulRun)
+{
+    t_u8 ucPacket[BENCH_HOST_CMDS_PER_PACKET * DEMOKIT_CMD_SIZE];
+    t_u32 ulPacket, i;
+    t_u64 ullAt;
+
+    g_ullBenchHostStartUs = SIM_now_us();
+    clock_gettime(CLOCK_MONOTONIC, &g_sBenchHostStartHost);
+
+    for(ulPacket = 0; ulPacket < (BENCH_HOST_COMMANDS / BENCH_HOST_CMDS_PER_PACKET); ulPacket++)
+    {
+        for(i = 0; i < BENCH_HOST_CMDS_PER_PACKET; i++)
+        {
+            ucPacket[(i * DEMOKIT_CMD_SIZE) + 0] = DEMOKIT_TYPE_RELAY;
+            ucPacket[(i * DEMOKIT_CMD_SIZE) + 1] = DEMOKIT_ID_RELAY1;
+            ucPacket[(i * DEMOKIT_CMD_SIZE) + 2] = i & 1;
+        }
+        SIM_usbInQueue(1, ucPacket, sizeof(ucPacket));
+    }
+
+    if(ulRun == BENCH_HOST_RUN_NAK)
+    {
+        for(ullAt = g_ullBenchHostStartUs; ullAt < (g_ullBenchHostStartUs + BENCH_HOST_TIMEOUT_US);
+            ullAt += BENCH_HOST_NAK_PERIOD_US)
+        {
+            SIM_usbNak(true, ullAt, ullAt + BENCH_HOST_NAK_US);
+        }
+    }
+    else if(ulRun == BENCH_HOST_RUN_HALT)
+    {
+        for(ullAt = g_ullBenchHostStartUs + BENCH_HOST_HALT_PERIOD_US;
+            ullAt < (g_ullBenchHostStartUs + BENCH_HOST_TIMEOUT_US); ullAt += BENCH_HOST_HALT_PERIOD_US)
+        {
+            SIM_at(ullAt, BenchHostHalt, NULL, 0);
+        }
+    }
+}
+
+static void BenchHostCommandsRun(const char *pcName, t_u32 ulRun)
+{
+    t_sim_hooks sHooks;
+    t_sim_usb_stats sStats;
+    t_u64 ullElapsedUs;
+
+    SIM_init(NULL);
+    memset(&sHooks, 0, sizeof(sHooks));
+    sHooks.pfnGpioWrite = BenchHostGpioWrite;
+    SIM_hooks(&sHooks);
+    SIM_at(BENCH_HOST_PLUG_US, BenchHostPlug, NULL, 0);
+    SIM_at(BENCH_HOST_PLUG_US, BenchHostWaitConnected, BenchHostSendCommands, ulRun);
+    SIM_run(BENCH_HOST_TIMEOUT_US, firmware_main);
+
+    SIM_usbStats(&sStats);
+    ullElapsedUs = (g_ullBenchHostEndUs > g_ullBenchHostStartUs) ? (g_ullBenchHostEndUs - g_ullBenchHostStartUs) : 0;
+    printf("scenario=%s commands=%u elapsed_us=%u commands_per_s=%u host_ns_per_command=%u in_naks=%u"
+           " stalls=%u toggle_drops=%u\n",
+           pcName, g_ulBenchHostCommands, (t_u32)ullElapsedUs,
+           ullElapsedUs ? (t_u32)(((t_u64)g_ulBenchHostCommands * 1000000) / ullElapsedUs) : 0,
+           g_ulBenchHostCommands ? (g_ulBenchHostElapsedNs / g_ulBenchHostCommands) : 0,
+           sStats.in_naks, sStats.stalls, sStats.toggle_drops);
+}
+
+static void BenchHostCommands(void)
+{
+    BenchHostCommandsRun("commands", BENCH_HOST_RUN_PLAIN);
+}
+
+static void BenchHostCommandsNak(void)
+{
+    BenchHostCommandsRun("commands_nak", BENCH_HOST_RUN_NAK);
+}
+
+static void BenchHostCommandsStall(void)
+{
+    BenchHostCommandsRun("commands_stall", BENCH_HOST_RUN_HALT);
+}
+
+//*****************************************************************************
+//
+// Android phone: Open Accessory switch time, then the end to end latencies
+// with the DemoKit application (with and without background traffic).
+//
+//*****************************************************************************
+static void BenchHostAndroidPlug(void *pvData, t_u32 ulArg)
+{
+    SIM_androidPlug();
+}
+
+static void BenchHostAndroidSwitch(void)
+{
+    t_android_connect_report sReport;
+    t_sim_android_stats sAndroid;
+    t_sim_usb_stats sStats;
+
+    SIM_init(NULL);
+    SIM_androidInit(NULL);
+    SIM_at(BENCH_HOST_PLUG_US, BenchHostAndroidPlug, NULL, 0);
+    SIM_at(BENCH_HOST_PLUG_US, BenchHostWaitConnected, BenchHostConnected, 0);
+    SIM_run(BENCH_HOST_TIMEOUT_US, firmware_main);
+
+    ANDROID_getConnectReport(&sReport);
+    SIM_usbStats(&sStats);
+    SIM_androidStats(&sAndroid);
+    printf("scenario=android_switch plug_to_connected_us=%u control_transfers=%u enumerations=%u"
+           " strings=%u starts=%u\n",
+           (sReport.connected_us != 0) ? (t_u32)(sReport.connected_us - BENCH_HOST_PLUG_US) : 0,
+           sStats.control_transfers, sStats.enumerations, sAndroid.strings_received, sAndroid.starts);
+}
+
+static void BenchHostAndroidLatencyRun(const char *pcName, t_u32 ulLoadPeriodUs)
+{
+    t_sim_android_config sConfig;
+    t_sim_android_stats sAndroid;
+    t_sim_dist sButtonUs, sMotorUs;
+
+    SIM_init(NULL);
+    sConfig = g_sSimAndroidConfigDefault;
+    sConfig.load_period_us = ulLoadPeriodUs;
+    sConfig.load_commands = BENCH_HOST_LOAD_COMMANDS;
+    SIM_androidInit(&sConfig);
+    SIM_at(BENCH_HOST_PLUG_US, BenchHostAndroidPlug, NULL, 0);
+    SIM_run(BENCH_HOST_LATENCY_US, firmware_main);
+
+    SIM_androidStats(&sAndroid);
+    SIM_androidLatency(&sButtonUs, &sMotorUs);
+    printf("scenario=%s commands_sent=%u bytes_received=%u button_missed=%u motor_missed=%u", pcName,
+           sAndroid.commands_sent, sAndroid.bytes_received, sAndroid.button_missed, sAndroid.motor_missed);
+    printf(" button_to_phone_count=%u", sButtonUs.count);
+    BenchHostPrintDist("button_to_phone_us", &sButtonUs);
+    printf(" phone_to_motor_count=%u", sMotorUs.count);
+    BenchHostPrintDist("phone_to_motor_us", &sMotorUs);
+    printf("\n");
+}
+
+static void BenchHostAndroidLatency(void)
+{
+    BenchHostAndroidLatencyRun("android_latency", 0);
+}
+
+static void BenchHostAndroidLatencyLoad(void)
+{
+    BenchHostAndroidLatencyRun("android_latency_load", BENCH_HOST_LOAD_PERIOD_US);
+}
+
+static const t_bench_host_scenario g_sBenchHostScenarios[] =
+{
+    { "loop_idle", BenchHostLoopIdle },
+    { "enumeration", BenchHostEnumeration },
+    { "commands", BenchHostCommands },
+    { "commands_nak", BenchHostCommandsNak },
+    { "commands_stall", BenchHostCommandsStall },
+    { "android_switch", BenchHostAndroidSwitch },
+    { "android_latency", BenchHostAndroidLatency },
+    { "android_latency_load", BenchHostAndroidLatencyLoad }
+};
+#define BENCH_HOST_NB_SCENARIOS (sizeof(g_sBenchHostScenarios) / sizeof(g_sBenchHostScenarios[0]))
+
+//*****************************************************************************
+//
+// Run the scenarios given on the command line (all by default).
+//
+//*****************************************************************************
+int main(int argc, char *argv[])
+{
+    t_u32 i;
+    int iArg;
+    int iStatus;
+    int iFailed;
+    pid_t pid;
+
+    iFailed = 0;
+    for(i = 0; i < BENCH_HOST_NB_SCENARIOS; i++)
+    {
+        if(argc > 1)
+        {
+            for(iArg = 1; iArg < argc; iArg++)
+            {
+                if(strcmp(argv[iArg], g_sBenchHostScenarios[i].pcName) == 0)
+                {
+                    break;
+                }
+            }
+            if(iArg == argc)
+            {
+                continue;
+            }
+        }
+
+        fflush(stdout);
+        pid = fork();
+        if(pid == 0)
+        {
+            g_sBenchHostScenarios[i].pfnRun();
+            fflush(stdout);
+            _exit(0);
+        }
+
+        if((pid < 0) || (waitpid(pid, &iStatus, 0) != pid) || !WIFEXITED(iStatus) ||
+           (WEXITSTATUS(iStatus) != 0))
+        {
+            fprintf(stderr, "scenario %s failed\n", g_sBenchHostScenarios[i].pcName);
+            iFailed = 1;
+        }
+    }
+
+    return iFailed;
+}
@@ -0,0 +1,21 @@
+//*****************************************************************************
+//
+// hw_gpio.h - Host build: GPIO registers offsets.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __HW_GPIO_H__
+#define __HW_GPIO_H__
+
+#define GPIO_O_DATA         0x00000000
+#define GPIO_O_DIR          0x00000400
+#define GPIO_O_IM           0x00000410
+#define GPIO_O_RIS          0x00000414
+#define GPIO_O_MIS          0x00000418
+#define GPIO_O_ICR          0x0000041C
+#define GPIO_O_DEN          0x0000051C
+
+#endif // __HW_GPIO_H__
@@ -0,0 +1,28 @@
+//*****************************************************************************
+//
+// hw_ints.h - Host build: interrupt assignments (LM3S9B92 vector numbers).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __HW_INTS_H__
+#define __HW_INTS_H__
+
+#define FAULT_SYSTICK       15
+#define INT_GPIOA           16
+#define INT_GPIOB           17
+#define INT_GPIOC           18
+#define INT_GPIOD           19
+#define INT_GPIOE           20
+#define INT_UART0           21
+#define INT_TIMER0A         35
+#define INT_TIMER1A         37
+#define INT_TIMER2A         39
+#define INT_GPIOF           46
+#define INT_USB0            60
+
+#define NUM_INTERRUPTS      64
+
+#endif // __HW_INTS_H__
@@ -0,0 +1,25 @@
+//*****************************************************************************
+//
+// hw_memmap.h - Host build: peripherals base addresses.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __HW_MEMMAP_H__
+#define __HW_MEMMAP_H__
+
+#define GPIO_PORTA_BASE     0x40004000
+#define GPIO_PORTB_BASE     0x40005000
+#define GPIO_PORTC_BASE     0x40006000
+#define GPIO_PORTD_BASE     0x40007000
+#define UART0_BASE          0x4000C000
+#define GPIO_PORTE_BASE     0x40024000
+#define GPIO_PORTF_BASE     0x40025000
+#define TIMER0_BASE         0x40030000
+#define TIMER1_BASE         0x40031000
+#define TIMER2_BASE         0x40032000
+#define USB0_BASE           0x40050000
+
+#endif // __HW_MEMMAP_H__
@@ -0,0 +1,20 @@
+//*****************************************************************************
+//
+// hw_nvic.h - Host build: NVIC and SysTick registers.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __HW_NVIC_H__
+#define __HW_NVIC_H__
+
+#define NVIC_ST_RELOAD          0xE000E014
+#define NVIC_ST_CURRENT         0xE000E018
+#define NVIC_INT_CTRL           0xE000ED04
+#define NVIC_DBG_INT            0xE000EDF0
+
+#define NVIC_INT_CTRL_PEND_SYST 0x04000000
+
+#endif // __HW_NVIC_H__
@@ -0,0 +1,46 @@
+//*****************************************************************************
+//
+// hw_types.h - Host build: common types and register access macros.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __HW_TYPES_H__
+#define __HW_TYPES_H__
+
+/*
+ * The host/ headers replace the StellarisWare headers for the host build
+ * (host/Makefile).  They only declare the driverlib/usblib/board API used by
+ * the firmware, implemented by the simulator (host/sim_*.c).
+ * The "unsigned long" (32 bits) of the target prototypes is written
+ * "unsigned int" so the host build keeps the target data model.
+ */
+typedef unsigned char tBoolean;
+
+#ifndef true
+#define true 1
+#endif
+
+#ifndef false
+#define false 0
+#endif
+
+/*
+ * Registers are RAM words of the simulator, looked up by address on each
+ * access (the simulator updates the time based ones when they are read).
+ * A bit-band alias access is written back to its bit on the next simulator
+ * call (interrupt return, interrupt masking, WFI).
+ */
+extern volatile unsigned int *SimReg(unsigned int ulAddr);
+extern volatile unsigned int *SimBitBand(volatile void *pvAddr, unsigned int ulBit);
+
+#define HWREG(x)            (*SimReg((unsigned int)(x)))
+#define HWREGH(x)           (*(volatile unsigned short *)SimReg((unsigned int)(x)))
+#define HWREGB(x)           (*(volatile unsigned char *)SimReg((unsigned int)(x)))
+#define HWREGBITW(x, b)     (*SimBitBand((volatile void *)(x), (b)))
+#define HWREGBITH(x, b)     (*SimBitBand((volatile void *)(x), (b)))
+#define HWREGBITB(x, b)     (*SimBitBand((volatile void *)(x), (b)))
+
+#endif // __HW_TYPES_H__
@@ -0,0 +1,19 @@
+//*****************************************************************************
+//
+// lm3s9b92.h - Host build: LM3S9B92 registers used by the firmware.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __LM3S9B92_H__
+#define __LM3S9B92_H__
+
+#include "inc/hw_types.h"
+
+#define GPIO_PORTB_DATA_R   HWREG(0x400053FC)
+#define GPIO_PORTB_DIR_R    HWREG(0x40005400)
+#define GPIO_PORTB_DEN_R    HWREG(0x4000551C)
+
+#endif // __LM3S9B92_H__
@@ -0,0 +1,773 @@
+//*****************************************************************************
+//
+// replay_main.c - Replay a USB trace dump (usb_trace.h) against the host build
+// of the firmware and compare the new trace with the original one.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "drivers/motor.h"
+#include "usblib/usblib.h"
+
+#include "usb_android.h"
+#include "usb_trace.h"
+#include "sim.h"
+
+#ifndef USBTRACE_ENABLE
+#error "replay_main.c needs the USB trace (USBTRACE_ENABLE)"
+#endif
+
+/*
+ * The trace is split in sessions, one per USBHANDROIDOpen() (USBTRACE_DEVICE
+ * record) or per device without class driver (USB_EVENT_CONNECTED HCD event).
+ * A trace starting in the middle of a session (ring wrapped) is replayed with
+ * a device already in accessory mode.  The replayed device:
+ * - is plugged at REPLAY_PLUG_US with the identity of the first session
+ *   (accessory mode or not from its VID/PID, or a device without driver),
+ * - answers the driver control requests with the recorded results (a failed
+ *   request stalls),
+ * - queues the recorded Bulk IN packets at their time from the session open
+ *   in the trace (the reception time, the replayed one adds the bus time),
+ * - gets a VBUS power fault at the recorded USB_EVENT_POWER_FAULT time,
+ * - disconnects at the recorded close time of the session (device without
+ *   driver: USB_EVENT_DISCONNECTED, the cable is unplugged) and comes back
+ *   with the identity of the next session, plugged again after an unplug or
+ *   a power fault.  The recorded gap includes the enumeration, the
+ *   enumeration time of the replay (plug or re-attach) is taken off.
+ * The Bulk OUT frames sent on local inputs (buttons) and the HCD events
+ * without device are not replayed.
+ * The records of each type are compared in order with the trace, their times
+ * from the session open.  Exit code 0 when the same records are replayed, 2
+ * otherwise.
+ */
+#define REPLAY_PLUG_US          (50000)
+#define REPLAY_POLL_US          (20)
+#define REPLAY_END_MARGIN_US    (100000)
+#define REPLAY_TIMEOUT_US       (5000000) /* A session not opened in the replay ends the run */
+#define REPLAY_LINE_MAX         (512)
+
+#define REPLAY_ANDROID_EVENT_CLOSE  (2) /* ANDROID_EVENT_CLOSE of usb_host_android.c */
+
+typedef struct
+{
+    t_u8 type; /* USBTRACE_XXX */
+    t_u64 time_us;
+    t_u8 data[64];
+    t_u32 len; /* Data bytes (Bulk IN packet, control IN data stage) */
+    t_u32 value; /* Control result, Bulk OUT length or event */
+    t_u8 status; /* Bulk OUT */
+    t_u8 setup[8];
+    t_u16 vid;
+    t_u16 pid;
+} t_replay_record;
+
+typedef struct
+{
+    t_replay_record *psRecords;
+    t_u32 ulCount;
+} t_replay_trace;
+
+typedef struct
+{
+    t_u32 ulFirst; /* Index of the USBTRACE_DEVICE or USB_EVENT_CONNECTED record (first record if partial) */
+    t_u32 ulEnd; /* Index after the last record */
+    t_u64 ullOpenUs;
+    t_u64 ullCloseUs; /* 0 = no close recorded */
+    t_u64 ullFaultUs; /* USB_EVENT_POWER_FAULT, 0 = none */
+    t_u16 vid;
+    t_u16 pid;
+    bool bUnknown; /* Device without class driver (HCD events only) */
+    bool bPartial; /* Trace start in the middle of a session (ring wrapped), no USBTRACE_DEVICE record */
+} t_replay_session;
+
+static t_replay_trace g_sReplayOrig;
+static t_replay_session *g_psReplaySessions;
+static t_u32 g_ulReplayNbSessions;
+
+// Replay progress.
+static t_u32 g_ulReplaySession; /* Session of the device attached */
+static t_u32 g_ulReplayControl; /* Next control record of the session */
+static t_u64 g_ullReplayAttachUs;
+static bool g_bReplayPlug; /* Next device plugged (cable unplugged or VBUS off), re-attached otherwise */
+static bool g_bReplayPlugged; /* Device of the session plugged */
+static t_u64 g_ullReplayEnumUs[2]; /* Re-attach [0] and plug [1] to open time of the replay, estimated until seen */
+static t_u64 *g_pullReplayOpenUs;
+static t_u32 g_ulReplayNbOpened;
+static t_u32 g_ulReplayRecordsSeen;
+static t_u8 *g_pucReplayRing;
+
+static t_u8 g_ucReplayDeviceDesc[18];
+static t_u8 g_ucReplayConfigDesc[32];
+static t_sim_usb_device g_sReplayDevice;
+
+//*****************************************************************************
+//
+// Trace decoding.
+//
+//*****************************************************************************
+static t_u32 ReplayVarint(const t_u8 *pucData, t_u32 ulSize, t_u32 *pulIdx)
+{
+    t_u32 ulValue;
+    t_u32 ulShift;
+
+    ulValue = 0;
+    ulShift = 0;
+    while((*pulIdx < ulSize) && (ulShift < 35))
+    {
+        ulValue |= (t_u32)(pucData[*pulIdx] & 0x7F) << ulShift;
+        if((pucData[(*pulIdx)++] & 0x80) == 0)
+        {
+            break;
+        }
+        ulShift += 7;
+    }
+
+    return ulValue;
+}
+
+static bool ReplayDecode(const t_u8 *pucData, t_u32 ulSize, t_u32 ulBaseUs, t_replay_trace *psTrace)
+{
+    t_replay_record *psRecord;
+    t_u64 ullTime;
+    t_u32 ulIdx, ulEnd, ulLen;
+
+    memset(psTrace, 0, sizeof(*psTrace));
+    ullTime = ulBaseUs;
+    ulIdx = 0;
+    while(ulIdx < ulSize)
+    {
+        ulEnd = ulIdx + pucData[ulIdx];
+        if((pucData[ulIdx] < 3) || (ulEnd > ulSize))
+        {
+            return false;
+        }
+
+        psTrace->psRecords = realloc(psTrace->psRecords, (psTrace->ulCount + 1) * sizeof(t_replay_record));
+        psRecord = &psTrace->psRecords[psTrace->ulCount++];
+        memset(psRecord, 0, sizeof(*psRecord));
+        psRecord->type = pucData[ulIdx + 1];
+        ulIdx += 2;
+        ullTime += ReplayVarint(pucData, ulEnd, &ulIdx);
+        psRecord->time_us = ullTime;
+
+        switch(psRecord->type)
+        {
+            case USBTRACE_DEVICE:
+            {
+                if((ulEnd - ulIdx) < 4)
+                {
+                    return false;
+                }
+                psRecord->vid = pucData[ulIdx] | (pucData[ulIdx + 1] << 8);
+                psRecord->pid = pucData[ulIdx + 2] | (pucData[ulIdx + 3] << 8);
+                break;
+            }
+
+            case USBTRACE_CONTROL:
+            {
+                if((ulEnd - ulIdx) < 8)
+                {
+                    return false;
+                }
+                memcpy(psRecord->setup, &pucData[ulIdx], 8);
+                ulIdx += 8;
+                psRecord->value = ReplayVarint(pucData, ulEnd, &ulIdx);
+                psRecord->len = ulEnd - ulIdx;
+                memcpy(psRecord->data, &pucData[ulIdx], psRecord->len);
+                break;
+            }
+
+            case USBTRACE_BULK_IN:
+            {
+                ulLen = ulEnd - ulIdx;
+                psRecord->len = (ulLen < sizeof(psRecord->data)) ? ulLen : sizeof(psRecord->data);
+                memcpy(psRecord->data, &pucData[ulIdx], psRecord->len);
+                break;
+            }
+
+            case USBTRACE_BULK_OUT:
+            {
+                psRecord->value = ReplayVarint(pucData, ulEnd, &ulIdx);
+                psRecord->status = (ulIdx < ulEnd) ? pucData[ulIdx] : 0;
+                break;
+            }
+
+            case USBTRACE_HCD_EVENT:
+            case USBTRACE_ANDROID_EVENT:
+            {
+                psRecord->value = ReplayVarint(pucData, ulEnd, &ulIdx);
+                break;
+            }
+
+            default:
+            {
+                break;
+            }
+        }
+        ulIdx = ulEnd;
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//
+// Read the last complete dump of a UART log (other lines are ignored).
+//
+//*****************************************************************************
+static void ReplayLoad(const char *pcFile)
+{
+    char cLine[REPLAY_LINE_MAX];
+    t_u8 *pucData;
+    t_u32 ulSize, ulBaseUs, ulDropped, ulBytes;
+    t_u8 *pucDump;
+    t_u32 ulDumpSize, ulDumpBase;
+    bool bIn;
+    char *pcHex;
+    FILE *pFile;
+
+    pFile = fopen(pcFile, "r");
+    if(pFile == NULL)
+    {
+        perror(pcFile);
+        exit(1);
+    }
+
+    pucData = NULL;
+    pucDump = NULL;
+    ulSize = 0;
+    ulBaseUs = 0;
+    ulDumpSize = 0;
+    ulDumpBase = 0;
+    bIn = false;
+    while(fgets(cLine, sizeof(cLine), pFile) != NULL)
+    {
+        pcHex = strstr(cLine, "USBTRACE ");
+        if(pcHex == NULL)
+        {
+            continue;
+        }
+        pcHex += strlen("USBTRACE ");
+
+        if(sscanf(pcHex, "BEGIN %u %u %u", &ulBytes, &ulBaseUs, &ulDropped) == 3)
+        {
+            pucData = realloc(pucData, ulBytes + 1);
+            ulSize = 0;
+            bIn = true;
+        }
+        else if(strncmp(pcHex, "END", 3) == 0)
+        {
+            if(bIn)
+            {
+                free(pucDump);
+                pucDump = pucData;
+                ulDumpSize = ulSize;
+                ulDumpBase = ulBaseUs;
+                pucData = NULL;
+            }
+            bIn = false;
+        }
+        else if(bIn)
+        {
+            while((pcHex[0] != 0) && (pcHex[1] != 0) && (pcHex[0] != '\r') && (pcHex[0] != '\n'))
+            {
+                char cByte[3] = { pcHex[0], pcHex[1], 0 };
+
+                if(ulSize < ulBytes)
+                {
+                    pucData[ulSize++] = (t_u8)strtoul(cByte, NULL, 16);
+                }
+                pcHex += 2;
+            }
+        }
+    }
+    fclose(pFile);
+    free(pucData);
+
+    if(pucDump == NULL)
+    {
+        fprintf(stderr, "%s: no complete USBTRACE dump\n", pcFile);
+        exit(1);
+    }
+    if(!ReplayDecode(pucDump, ulDumpSize, ulDumpBase, &g_sReplayOrig))
+    {
+        fprintf(stderr, "%s: corrupted trace\n", pcFile);
+        exit(1);
+    }
+    free(pucDump);
+}
+
+// Record of a session open: the driver opened or a device without driver.
+static bool ReplayIsOpen(const t_replay_record *psRecord)
+{
+    return (psRecord->type == USBTRACE_DEVICE) ||
+           ((psRecord->type == USBTRACE_HCD_EVENT) && (psRecord->value == USB_EVENT_CONNECTED));
+}
+
+// Split in sessions, a trace starting in the middle of a session (ring
+// wrapped) gives a first session without USBTRACE_DEVICE record, the driver
+// is then in accessory mode.  The HCD events out of a session are skipped.
+static void ReplaySplit(const t_replay_trace *psTrace, t_replay_session **ppsSessions, t_u32 *pulCount)
+{
+    t_replay_session *psSession;
+    const t_replay_record *psRecord;
+    t_u32 i;
+
+    *ppsSessions = NULL;
+    *pulCount = 0;
+    psSession = NULL;
+    for(i = 0; i < psTrace->ulCount; i++)
+    {
+        psRecord = &psTrace->psRecords[i];
+        if(ReplayIsOpen(psRecord) || ((psSession == NULL) && (psRecord->type != USBTRACE_HCD_EVENT)))
+        {
+            *ppsSessions = realloc(*ppsSessions, (*pulCount + 1) * sizeof(t_replay_session));
+            psSession = &(*ppsSessions)[(*pulCount)++];
+            memset(psSession, 0, sizeof(*psSession));
+            psSession->ulFirst = i;
+            psSession->ullOpenUs = psRecord->time_us;
+            psSession->vid = 0x18D1;
+            psSession->pid = 0x2D00;
+            psSession->bPartial = true;
+            if(psRecord->type == USBTRACE_DEVICE)
+            {
+                psSession->vid = psRecord->vid;
+                psSession->pid = psRecord->pid;
+                psSession->bPartial = false;
+            }
+            else if(psRecord->type == USBTRACE_HCD_EVENT)
+            {
+                psSession->bUnknown = true;
+                psSession->bPartial = false;
+            }
+        }
+        if(psSession == NULL)
+        {
+            continue;
+        }
+        psSession->ulEnd = i + 1;
+        if(psSession->ullCloseUs != 0)
+        {
+            continue;
+        }
+        if(psSession->bUnknown ?
+           ((psRecord->type == USBTRACE_HCD_EVENT) && (psRecord->value == USB_EVENT_DISCONNECTED)) :
+           ((psRecord->type == USBTRACE_ANDROID_EVENT) && (psRecord->value == REPLAY_ANDROID_EVENT_CLOSE)))
+        {
+            psSession->ullCloseUs = psRecord->time_us;
+        }
+        if((psRecord->type == USBTRACE_HCD_EVENT) && (psRecord->value == USB_EVENT_POWER_FAULT) &&
+           (psSession->ullFaultUs == 0))
+        {
+            psSession->ullFaultUs = psRecord->time_us;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Replayed device.
+//
+//*****************************************************************************
+static int ReplayControl(void *pvDevice, const tUSBRequest *psSetup, t_u8 *pucData, t_u32 ulSize)
+{
+    const t_replay_session *psSession;
+    const t_replay_record *psRecord;
+    t_u32 ulLen;
+    t_u32 i;
+
+    psSession = &g_psReplaySessions[g_ulReplaySession];
+    for(i = g_ulReplayControl; i < psSession->ulEnd; i++)
+    {
+        psRecord = &g_sReplayOrig.psRecords[i];
+        if((psRecord->type != USBTRACE_CONTROL) || (psRecord->setup[0] != psSetup->bmRequestType) ||
+           (psRecord->setup[1] != psSetup->bRequest))
+        {
+            continue;
+        }
+        g_ulReplayControl = i + 1;
+
+        // A failed request (IN without data, OUT partly sent) stalls.
+        if(psSetup->bmRequestType & USB_RTYPE_DIR_IN)
+        {
+            if(psRecord->value == 0)
+            {
+                return SIM_USB_STALL;
+            }
+            ulLen = (psRecord->value < ulSize) ? psRecord->value : ulSize;
+            memset(pucData, 0, ulLen);
+            memcpy(pucData, psRecord->data, (psRecord->len < ulLen) ? psRecord->len : ulLen);
+            return ulLen;
+        }
+        return (psRecord->value == psSetup->wLength) ? (int)ulSize : SIM_USB_STALL;
+    }
+
+    return SIM_USB_STALL;
+}
+
+// Replayed device of a session with a driver: the recorded identity.
+static void ReplayDevice(const t_replay_session *psSession)
+{
+    const t_sim_usb_device *psAccessory;
+
+    // Accessory descriptors with the recorded identity, a device not in
+    // accessory mode has a mass storage interface.
+    psAccessory = SIM_usbAccessoryDevice();
+    memcpy(g_ucReplayDeviceDesc, psAccessory->pucDeviceDesc, sizeof(g_ucReplayDeviceDesc));
+    memcpy(g_ucReplayConfigDesc, psAccessory->pucConfigDesc, sizeof(g_ucReplayConfigDesc));
+    g_ucReplayDeviceDesc[8] = (t_u8)psSession->vid;
+    g_ucReplayDeviceDesc[9] = (t_u8)(psSession->vid >> 8);
+    g_ucReplayDeviceDesc[10] = (t_u8)psSession->pid;
+    g_ucReplayDeviceDesc[11] = (t_u8)(psSession->pid >> 8);
+    if(!((psSession->vid == 0x18D1) && ((psSession->pid == 0x2D00) || (psSession->pid == 0x2D01))))
+    {
+        g_ucReplayConfigDesc[9 + 5] = USB_CLASS_MASS_STORAGE; /* bInterfaceClass of interface 0 */
+    }
+    g_sReplayDevice = *psAccessory;
+    g_sReplayDevice.pucDeviceDesc = g_ucReplayDeviceDesc;
+    g_sReplayDevice.pucConfigDesc = g_ucReplayConfigDesc;
+    g_sReplayDevice.pfnControl = ReplayControl;
+}
+
+static void ReplayAttach(void *pvData, t_u32 ulSession)
+{
+    const t_replay_session *psSession;
+    const t_sim_usb_device *psDevice;
+
+    g_ulReplaySession = ulSession;
+    psSession = &g_psReplaySessions[ulSession];
+    g_ulReplayControl = psSession->ulFirst;
+    psDevice = SIM_usbUnknownDevice();
+    if(!psSession->bUnknown)
+    {
+        ReplayDevice(psSession);
+        psDevice = &g_sReplayDevice;
+    }
+
+    g_ullReplayAttachUs = SIM_now_us();
+    g_bReplayPlugged = g_bReplayPlug;
+    if(g_bReplayPlug)
+    {
+        // Unplugged first, VBUS stays off after a power fault until then.
+        g_bReplayPlug = false;
+        SIM_usbUnplug();
+        SIM_usbPlug(psDevice);
+    }
+    else
+    {
+        SIM_usbDeviceAttach(psDevice);
+    }
+}
+
+static void ReplayBulkIn(void *pvData, t_u32 ulRecord)
+{
+    const t_replay_record *psRecord;
+
+    psRecord = &g_sReplayOrig.psRecords[ulRecord];
+    SIM_usbInQueue(1, psRecord->data, psRecord->len);
+}
+
+static void ReplayStop(void *pvData, t_u32 ulArg)
+{
+    SIM_stop();
+}
+
+static void ReplayPowerFault(void *pvData, t_u32 ulSession)
+{
+    g_bReplayPlug = true;
+    SIM_usbPowerFault();
+}
+
+static void ReplayDetach(void *pvData, t_u32 ulSession)
+{
+    const t_replay_session *psSession;
+    t_u64 ullGapUs;
+
+    // After a power fault the device is already removed.
+    psSession = &g_psReplaySessions[ulSession];
+    if(psSession->ullFaultUs == 0)
+    {
+        if(psSession->bUnknown)
+        {
+            g_bReplayPlug = true;
+            SIM_usbUnplug();
+        }
+        else
+        {
+            SIM_usbDeviceDetach();
+        }
+    }
+    if((ulSession + 1) >= g_ulReplayNbSessions)
+    {
+        SIM_at(SIM_now_us() + REPLAY_END_MARGIN_US, ReplayStop, NULL, 0);
+        return;
+    }
+
+    // The recorded gap includes the enumeration of the next session: the one
+    // of the last plug or re-attach of the replay is taken off (the bus reset
+    // time before the first re-attach).
+    ullGapUs = g_psReplaySessions[ulSession + 1].ullOpenUs - g_psReplaySessions[ulSession].ullCloseUs;
+    SIM_at(SIM_now_us() + ((ullGapUs > g_ullReplayEnumUs[g_bReplayPlug]) ?
+                           (ullGapUs - g_ullReplayEnumUs[g_bReplayPlug]) : 0), ReplayAttach, NULL, ulSession + 1);
+}
+
+// A session opened: its Bulk IN packets, power fault and close are scheduled.
+static void ReplaySessionOpen(t_u32 ulSession, t_u64 ullOpenUs)
+{
+    const t_replay_session *psSession;
+    const t_replay_record *psRecord;
+    t_u64 ullEndUs;
+    t_u32 i;
+
+    psSession = &g_psReplaySessions[ulSession];
+    g_pullReplayOpenUs[ulSession] = ullOpenUs;
+    g_ullReplayEnumUs[g_bReplayPlugged] = ullOpenUs - g_ullReplayAttachUs;
+    g_ulReplayNbOpened = ulSession + 1;
+
+    for(i = psSession->ulFirst; i < psSession->ulEnd; i++)
+    {
+        psRecord = &g_sReplayOrig.psRecords[i];
+        if(psRecord->type == USBTRACE_BULK_IN)
+        {
+            SIM_at(ullOpenUs + (psRecord->time_us - psSession->ullOpenUs), ReplayBulkIn, NULL, i);
+        }
+    }
+
+    if(psSession->ullFaultUs != 0)
+    {
+        SIM_at(ullOpenUs + (psSession->ullFaultUs - psSession->ullOpenUs), ReplayPowerFault, NULL, ulSession);
+    }
+    if(psSession->ullCloseUs != 0)
+    {
+        SIM_at(ullOpenUs + (psSession->ullCloseUs - psSession->ullOpenUs), ReplayDetach, NULL, ulSession);
+    }
+    else if((ulSession + 1) == g_ulReplayNbSessions)
+    {
+        ullEndUs = g_sReplayOrig.psRecords[g_sReplayOrig.ulCount - 1].time_us;
+        SIM_at(ullOpenUs + (ullEndUs - psSession->ullOpenUs) + REPLAY_END_MARGIN_US, ReplayStop, NULL, 0);
+    }
+}
+
+//*****************************************************************************
+//
+// Follow the trace recorded by the replayed driver: the session opens (driver
+// open or device without driver) start the session timings.
+//
+//*****************************************************************************
+static void ReplayPoll(void *pvData, t_u32 ulArg)
+{
+    t_replay_trace sTrace;
+    t_u32 ulSize, ulBaseUs;
+    t_u32 i;
+
+    if(USBTRACE_records() != g_ulReplayRecordsSeen)
+    {
+        ulSize = USBTRACE_copy(g_pucReplayRing, USBTRACE_SIZE, &ulBaseUs);
+        ReplayDecode(g_pucReplayRing, ulSize, ulBaseUs, &sTrace);
+        if(USBTRACE_records() != sTrace.ulCount)
+        {
+            fprintf(stderr, "replay trace ring overflow (USBTRACE_SIZE)\n");
+            exit(1);
+        }
+        for(i = g_ulReplayRecordsSeen; i < sTrace.ulCount; i++)
+        {
+            if(ReplayIsOpen(&sTrace.psRecords[i]) && (g_ulReplayNbOpened < g_ulReplayNbSessions))
+            {
+                ReplaySessionOpen(g_ulReplayNbOpened, sTrace.psRecords[i].time_us);
+            }
+        }
+        g_ulReplayRecordsSeen = sTrace.ulCount;
+        free(sTrace.psRecords);
+    }
+
+    SIM_at(SIM_now_us() + REPLAY_POLL_US, ReplayPoll, NULL, 0);
+}
+
+//*****************************************************************************
+//
+// Comparison of the two traces: the records of each type are matched in
+// order session by session, the times are taken from the session open.
+//
+//*****************************************************************************
+static bool ReplaySame(const t_replay_record *psOrig, const t_replay_record *psNew)
+{
+    return (psOrig->value == psNew->value) && (psOrig->status == psNew->status) && (psOrig->len == psNew->len) &&
+           (memcmp(psOrig->data, psNew->data, psOrig->len) == 0) &&
+           (memcmp(psOrig->setup, psNew->setup, sizeof(psOrig->setup)) == 0) &&
+           (psOrig->vid == psNew->vid) && (psOrig->pid == psNew->pid);
+}
+
+// Index of the next record of a type in a session, ulEnd if none.
+static t_u32 ReplayNext(const t_replay_trace *psTrace, const t_replay_session *psSession, t_u32 ulIdx, t_u8 ucType)
+{
+    while((ulIdx < psSession->ulEnd) && (psTrace->psRecords[ulIdx].type != ucType))
+    {
+        ulIdx++;
+    }
+
+    return ulIdx;
+}
+
+static t_u32 ReplayCompare(const t_replay_trace *psReplay, const t_replay_session *psSessions, t_u32 ulCount,
+                           t_u8 ucType, t_sim_dist *psShift, t_u32 *pulOrig, t_u32 *pulReplay)
+{
+    const t_replay_session *psOrigSession, *psNewSession;
+    const t_replay_record *psOrig, *psNew;
+    t_sim_samples sShift;
+    t_u32 ulDiffs;
+    t_u32 i, j, k;
+    t_i32 lShift;
+
+    memset(&sShift, 0, sizeof(sShift));
+    ulDiffs = 0;
+    *pulOrig = 0;
+    *pulReplay = 0;
+    for(i = 0; i < g_ulReplayNbSessions; i++)
+    {
+        psOrigSession = &g_psReplaySessions[i];
+        for(j = ReplayNext(&g_sReplayOrig, psOrigSession, psOrigSession->ulFirst, ucType); j < psOrigSession->ulEnd;
+            j = ReplayNext(&g_sReplayOrig, psOrigSession, j + 1, ucType))
+        {
+            (*pulOrig)++;
+        }
+        if(i >= ulCount)
+        {
+            continue;
+        }
+
+        psNewSession = &psSessions[i];
+        j = ReplayNext(&g_sReplayOrig, psOrigSession, psOrigSession->ulFirst, ucType);
+        for(k = ReplayNext(psReplay, psNewSession, psNewSession->ulFirst, ucType); k < psNewSession->ulEnd;
+            k = ReplayNext(psReplay, psNewSession, k + 1, ucType))
+        {
+            (*pulReplay)++;
+            if(j >= psOrigSession->ulEnd)
+            {
+                continue;
+            }
+
+            psOrig = &g_sReplayOrig.psRecords[j];
+            psNew = &psReplay->psRecords[k];
+            lShift = (t_i32)((psNew->time_us - psNewSession->ullOpenUs) - (psOrig->time_us - psOrigSession->ullOpenUs));
+            SIM_samplesAdd(&sShift, (lShift < 0) ? -lShift : lShift);
+            if(!ReplaySame(psOrig, psNew))
+            {
+                ulDiffs++;
+            }
+            j = ReplayNext(&g_sReplayOrig, psOrigSession, j + 1, ucType);
+        }
+    }
+    SIM_samplesDist(&sShift, psShift);
+    SIM_samplesFree(&sShift);
+
+    return ulDiffs;
+}
+
+static bool ReplayReport(void)
+{
+    static const char * const pcTypes[USBTRACE_NB_TYPES] =
+    {
+        "", "device", "control", "bulk_in", "bulk_out", "hcd_event", "android_event"
+    };
+    t_replay_trace sReplay;
+    t_replay_session *psSessions;
+    t_u32 ulNbSessions, ulSize, ulBaseUs;
+    t_u32 ulOrig, ulNew, ulDiffs;
+    t_sim_dist sShift;
+    bool bSame;
+    t_u32 i;
+
+    ulSize = USBTRACE_copy(g_pucReplayRing, USBTRACE_SIZE, &ulBaseUs);
+    ReplayDecode(g_pucReplayRing, ulSize, ulBaseUs, &sReplay);
+    ReplaySplit(&sReplay, &psSessions, &ulNbSessions);
+
+    // The open of a partial session is not in the trace, the session is
+    // compared from its first Bulk IN packet.
+    if((ulNbSessions > 0) && g_psReplaySessions[0].bPartial)
+    {
+        g_psReplaySessions[0].ulFirst = ReplayNext(&g_sReplayOrig, &g_psReplaySessions[0], 0, USBTRACE_BULK_IN);
+        psSessions[0].ulFirst = ReplayNext(&sReplay, &psSessions[0], psSessions[0].ulFirst, USBTRACE_BULK_IN);
+    }
+    bSame = (ulNbSessions == g_ulReplayNbSessions);
+
+    printf("trace records=%u sessions=%u partial=%u replay_sessions=%u\n", g_sReplayOrig.ulCount,
+           g_ulReplayNbSessions, g_psReplaySessions[0].bPartial, ulNbSessions);
+
+    for(i = 1; (i < g_ulReplayNbSessions) && (i < ulNbSessions); i++)
+    {
+        printf("session=%u reconnect_us trace=%u replay=%u\n", i,
+               (t_u32)(g_psReplaySessions[i].ullOpenUs - g_psReplaySessions[i - 1].ullCloseUs),
+               (t_u32)(psSessions[i].ullOpenUs - psSessions[i - 1].ullCloseUs));
+    }
+
+    // Records shift from the session open (absolute value).
+    for(i = 1; i < USBTRACE_NB_TYPES; i++)
+    {
+        ulDiffs = ReplayCompare(&sReplay, psSessions, ulNbSessions, i, &sShift, &ulOrig, &ulNew);
+        printf("%s trace=%u replay=%u diffs=%u shift_us p50=%u p90=%u p99=%u max=%u\n", pcTypes[i], ulOrig, ulNew,
+               ulDiffs, sShift.p50, sShift.p90, sShift.p99, sShift.max);
+        if((ulOrig != ulNew) || (ulDiffs != 0))
+        {
+            bSame = false;
+        }
+    }
+    printf("result=%s\n", bSame ? "OK" : "DIFF");
+
+    free(psSessions);
+    free(sReplay.psRecords);
+
+    return bSame;
+}
+
+int main(int argc, char *argv[])
+{
+    t_u64 ullEndUs;
+    bool bQuiet;
+    int iArg;
+
+    bQuiet = false;
+    iArg = 1;
+    if((argc > 1) && (strcmp(argv[1], "-q") == 0))
+    {
+        bQuiet = true;
+        iArg++;
+    }
+    if(iArg != (argc - 1))
+    {
+        fprintf(stderr, "usage: %s [-q] uart_log_with_usbtrace_dump\n", argv[0]);
+        return 1;
+    }
+
+    ReplayLoad(argv[iArg]);
+    ReplaySplit(&g_sReplayOrig, &g_psReplaySessions, &g_ulReplayNbSessions);
+    if(g_ulReplayNbSessions == 0)
+    {
+        fprintf(stderr, "%s: no session in the trace\n", argv[iArg]);
+        return 1;
+    }
+    g_pullReplayOpenUs = calloc(g_ulReplayNbSessions, sizeof(t_u64));
+    g_pucReplayRing = malloc(USBTRACE_SIZE);
+
+    // Run up to the trace duration plus the timeout, the last session ends the run earlier.
+    ullEndUs = REPLAY_PLUG_US + REPLAY_TIMEOUT_US +
+               (g_sReplayOrig.psRecords[g_sReplayOrig.ulCount - 1].time_us - g_psReplaySessions[0].ullOpenUs);
+
+    SIM_init(NULL);
+    SIM_uartEcho(!bQuiet);
+    g_ullReplayEnumUs[0] = g_sSimTimingDefault.usb_reset_ms * 1000;
+    g_ullReplayEnumUs[1] = g_ullReplayEnumUs[0];
+    g_bReplayPlug = true;
+    SIM_at(REPLAY_PLUG_US, ReplayAttach, NULL, 0);
+    SIM_at(REPLAY_PLUG_US, ReplayPoll, NULL, 0);
+    SIM_run(ullEndUs, firmware_main);
+
+    printf("end_ms=%u sessions_opened=%u\n", (t_u32)(SIM_now_us() / 1000), g_ulReplayNbOpened);
+    return ReplayReport() ? 0 : 2;
+}
@@ -0,0 +1,267 @@
+//*****************************************************************************
+//
+// sim.h - Deterministic EvalBot simulator of the host build.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __SIM_H__
+#define __SIM_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * The firmware runs unchanged on a virtual 50MHz core: its code takes no
+ * virtual time, only the simulated hardware does, except the handling of each
+ * received Bulk IN packet (usb_rx_packet_cycles and usb_rx_byte_cycles, the
+ * data traffic loads the core).  The time advances when the
+ * core sleeps (WFI) up to the next hardware event, and while a blocking
+ * driver call runs (USB control transfer, display bus, pipe read/write), the
+ * interrupts are then serviced on time as on the target.
+ * All the interrupts have the same priority (no nesting), an interrupt is
+ * taken on the next simulator call once unmasked.
+ * A run is fully deterministic: same script, same timings, same result.
+ *
+ * The USB host controller and the usblib host stack (OTG session, enumeration,
+ * class drivers, pipes) are simulated with a Full Speed bus model, the device
+ * is a t_sim_usb_device: descriptors, control requests handler and Bulk
+ * endpoints, its timing is scripted (IN packets arrival time, NAK periods).
+ */
+#define SIM_CLOCK_HZ            (50000000)
+#define SIM_CYCLES_PER_US       (SIM_CLOCK_HZ / 1000000)
+
+/* Hardware timings, see g_sSimTimingDefault */
+typedef struct
+{
+    t_u32 usb_reset_ms; /* Device connection to enumeration start (bus reset and recovery, blocking) */
+    t_u32 usb_stage_us; /* One control transfer stage (setup or status) */
+    t_u32 usb_packet_us; /* Bulk transaction overhead (token and handshake), plus the data at 12Mbit/s */
+    t_u32 usb_rx_packet_cycles; /* Firmware time per Bulk IN packet read (interrupt, pipe callback, RX ring) */
+    t_u32 usb_rx_byte_cycles; /* Firmware time per byte of it (FIFO read, commands decoding in the main loop) */
+    t_u32 display_byte_us; /* OLED bus time per byte (blocking) */
+    t_u32 uart_baud; /* UART TX drain rate (10 bits per character) */
+} t_sim_timing;
+
+extern const t_sim_timing g_sSimTimingDefault;
+
+/* Observers of the simulated outputs, called when the firmware writes them (any member can be NULL) */
+typedef struct
+{
+    void (*pfnGpioWrite)(t_u32 ulPort, t_u8 ucPins, t_u8 ucValue);
+    void (*pfnMotor)(tSide eSide, bool bRun, tDirection eDir, t_u16 usSpeed);
+    void (*pfnUartLine)(const char *pcLine);
+} t_sim_hooks;
+
+/* Samples and their distribution */
+typedef struct
+{
+    t_u32 *pulData;
+    t_u32 ulCount;
+    t_u32 ulSize;
+} t_sim_samples;
+
+typedef struct
+{
+    t_u32 count;
+    t_u32 min;
+    t_u32 p50;
+    t_u32 p90;
+    t_u32 p99;
+    t_u32 max;
+    t_u32 mean;
+} t_sim_dist;
+
+/* Action run at a virtual time (hardware context, not an interrupt) */
+typedef void (*t_sim_action)(void *pvData, t_u32 ulArg);
+
+/* USB device */
+#define SIM_USB_STALL   (-1)
+
+typedef struct
+{
+    const t_u8 *pucDeviceDesc; /* 18 bytes */
+    const t_u8 *pucConfigDesc; /* wTotalLength bytes, interface 0 gives the class */
+
+    /* Non standard control request, return the data stage length or SIM_USB_STALL (NULL = stall all) */
+    int (*pfnControl)(void *pvDevice, const tUSBRequest *psSetup, t_u8 *pucData, t_u32 ulSize);
+
+    /* Bulk OUT packet received by the device (can be NULL) */
+    void (*pfnBulkOut)(void *pvDevice, t_u32 ulEndpoint, const t_u8 *pucData, t_u32 ulSize);
+
+    t_u32 ulControlDelayUs; /* Device processing time of each control request */
+    void *pvDevice;
+} t_sim_usb_device;
+
+typedef struct
+{
+    t_u32 control_transfers;
+    t_u32 in_packets;
+    t_u32 in_bytes;
+    t_u32 out_packets;
+    t_u32 out_bytes;
+    t_u32 in_naks; /* IN transactions delayed by a NAK period */
+    t_u32 out_naks; /* OUT transactions delayed by a NAK period */
+    t_u32 stalls; /* Bulk transactions stalled by a halted endpoint */
+    t_u32 toggle_drops; /* Bulk packets dropped on a data toggle mismatch (lost data) */
+    t_u32 enumerations;
+} t_sim_usb_stats;
+
+/* API */
+
+/* Reset the simulator with the given timings (NULL = g_sSimTimingDefault) */
+extern void SIM_init(const t_sim_timing *psTiming);
+
+extern void SIM_hooks(const t_sim_hooks *psHooks);
+
+/* Run entry (firmware_main) until the virtual time end_us or SIM_stop() */
+extern void SIM_run(t_u64 end_us, int (*pfnEntry)(void));
+
+/* End the run at the current time (returns, the run ends at the next simulator call) */
+extern void SIM_stop(void);
+
+extern t_u64 SIM_now_us(void);
+
+extern t_u64 SIM_nowCycles(void);
+
+/* Schedule an action at a virtual time (past times run at once on the next event) */
+extern void SIM_at(t_u64 at_us, t_sim_action pfnAction, void *pvData, t_u32 ulArg);
+
+/* Consume virtual time from the firmware context (blocking driver call), interrupts are serviced */
+extern void SIM_advance(t_u32 us);
+
+/* Main loop latency: from a WFI wake-up to the next WFI, in virtual us and in host ns */
+extern void SIM_loopLatency(t_sim_dist *psVirtualUs, t_sim_dist *psHostNs);
+
+extern t_u32 SIM_loopWakeups(void);
+
+extern void SIM_samplesAdd(t_sim_samples *psSamples, t_u32 ulValue);
+
+extern void SIM_samplesDist(const t_sim_samples *psSamples, t_sim_dist *psDist);
+
+extern void SIM_samplesFree(t_sim_samples *psSamples);
+
+/* Peripherals (sim_periph.c) */
+
+/* Drive input pins of a port (edges raise the GPIO interrupt as configured) */
+extern void SIM_gpioInput(t_u32 ulPort, t_u8 ucPins, t_u8 ucValue);
+
+extern t_u8 SIM_gpioOutput(t_u32 ulPort);
+
+extern void SIM_motorGet(tSide eSide, bool *pbRun, tDirection *peDir, t_u16 *pusSpeed);
+
+/* Print the UART output on stdout with the virtual time */
+extern void SIM_uartEcho(bool bEcho);
+
+/* USB (sim_usb.c) */
+
+/* Plug the cable with a device (OTG session starts on next poll) */
+extern void SIM_usbPlug(const t_sim_usb_device *psDevice);
+
+extern void SIM_usbUnplug(void);
+
+/* Device side disconnection and connection, the session is kept (device re-enumeration) */
+extern void SIM_usbDeviceDetach(void);
+
+extern void SIM_usbDeviceAttach(const t_sim_usb_device *psDevice);
+
+/* Device queues data on a Bulk IN endpoint (split in max packet size packets) */
+extern void SIM_usbInQueue(t_u32 ulEndpoint, const t_u8 *pucData, t_u32 ulSize);
+
+/* Number of queued IN packets not yet transferred */
+extern t_u32 SIM_usbInPending(void);
+
+/* The device NAKs all the IN (bIn) or OUT transactions between start_us and end_us */
+extern void SIM_usbNak(bool bIn, t_u64 start_us, t_u64 end_us);
+
+/* The device halts its Bulk IN (bIn) or OUT endpoint: STALL until CLEAR_FEATURE(ENDPOINT_HALT) */
+extern void SIM_usbHalt(bool bIn, t_u32 ulEndpoint);
+
+/* VBUS power fault: USB_EVENT_POWER_FAULT, the device is removed and VBUS stays off until the cable is unplugged */
+extern void SIM_usbPowerFault(void);
+
+extern void SIM_usbStats(t_sim_usb_stats *psStats);
+
+/* Device already in accessory mode (VID 0x18D1 PID 0x2D00, Bulk IN EP1 and OUT EP2 of 64 bytes) */
+extern const t_sim_usb_device *SIM_usbAccessoryDevice(void);
+
+/* Device without class driver in the firmware (HID interface): USB_EVENT_CONNECTED/DISCONNECTED */
+extern const t_sim_usb_device *SIM_usbUnknownDevice(void);
+
+/* Android phone (sim_android.c) */
+
+/*
+ * The phone is first seen as a mass storage device, it answers the Open
+ * Accessory requests (protocol 1), then on ACCESSORY_START it disconnects and
+ * comes back in accessory mode (VID 0x18D1 PID 0x2D00).  Once the DemoKit
+ * application is open it runs the latency probes:
+ *  - phone to motor: Relay1 toggles, from the phone write to the left motor driver call
+ *  - button to phone: User Switch 1 toggles, from the pin edge to the button command read by the phone
+ * A probe is missed when the next one starts before its end.
+ */
+#define SIM_ANDROID_NB_STRINGS  (6)
+#define SIM_ANDROID_STRING_MAX  (64)
+
+typedef struct
+{
+    t_u32 start_to_detach_ms; /* ACCESSORY_START to the phone disconnection */
+    t_u32 detach_to_attach_ms; /* Phone switch to accessory mode */
+    t_u32 app_open_ms; /* Accessory connection to the DemoKit application start */
+    t_u32 motor_period_us; /* Phone to motor probes period, 0 = off */
+    t_u32 button_period_us; /* Button press and release period, 0 = off */
+    t_u32 probe_jitter_us; /* Random delay (0 to jitter) added to each probe period */
+    t_u32 load_period_us; /* Background commands (ignored by EvalBot) period, 0 = off */
+    t_u32 load_commands; /* Background commands per write */
+} t_sim_android_config;
+
+extern const t_sim_android_config g_sSimAndroidConfigDefault;
+
+typedef struct
+{
+    t_u32 protocol_requests;
+    t_u32 strings_received;
+    t_u32 starts;
+    t_u32 commands_sent;
+    t_u32 bytes_received;
+    t_u32 buttons_received;
+    t_u32 motor_missed;
+    t_u32 button_missed;
+} t_sim_android_stats;
+
+/* Reset the phone (NULL = g_sSimAndroidConfigDefault), call after SIM_init(), sets the pfnMotor hook */
+extern void SIM_androidInit(const t_sim_android_config *psConfig);
+
+extern void SIM_androidPlug(void);
+
+extern bool SIM_androidAppOpen(void);
+
+extern void SIM_androidStats(t_sim_android_stats *psStats);
+
+/* Identity string received with ACCESSORY_SEND_STRING (ACCESSORY_STRING_XXX index) */
+extern const char *SIM_androidString(t_u32 ulIndex);
+
+extern void SIM_androidLatency(t_sim_dist *psButtonToPhoneUs, t_sim_dist *psPhoneToMotorUs);
+
+/* main() of main.c, renamed by host/Makefile */
+extern int firmware_main(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SIM_H__
@@ -0,0 +1,398 @@
+//*****************************************************************************
+//
+// sim_android.c - Simulated Android phone: Open Accessory switch and DemoKit
+// application traffic for the end to end latency measures.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "drivers/motor.h"
+#include "usblib/usblib.h"
+
+#include "usb_android.h"
+#include "demokit_protocol.h"
+#include "sim.h"
+
+/* Open Accessory requests (vendor, device recipient) */
+#define SIM_ANDROID_GET_PROTOCOL    (51)
+#define SIM_ANDROID_SEND_STRING     (52)
+#define SIM_ANDROID_START           (53)
+#define SIM_ANDROID_PROTOCOL        (1)
+
+#define SIM_ANDROID_MAX_PACKET      (64)
+
+typedef struct
+{
+    t_sim_android_config sConfig;
+    t_sim_android_stats sStats;
+    t_sim_usb_device sAccessory;
+    char cStrings[SIM_ANDROID_NB_STRINGS][SIM_ANDROID_STRING_MAX];
+
+    /* Probes in flight: one relay toggle and one button toggle at a time */
+    bool bMotorPending;
+    bool bMotorRun;
+    t_u64 ullMotorSentUs;
+    bool bButtonPending;
+    t_u8 ucButtonValue;
+    t_u64 ullButtonPressUs;
+
+    t_sim_samples sButtonToPhoneUs;
+    t_sim_samples sPhoneToMotorUs;
+    bool bApp;
+    t_u32 ulSession; /* Actions of a previous accessory session are dropped */
+    t_u32 ulRandom;
+} t_sim_android;
+
+static t_sim_android g_sSimAndroid;
+
+const t_sim_android_config g_sSimAndroidConfigDefault =
+{
+    50,     /* start_to_detach_ms */
+    500,    /* detach_to_attach_ms */
+    200,    /* app_open_ms */
+    20000,  /* motor_period_us */
+    50000,  /* button_period_us */
+    1000,   /* probe_jitter_us */
+    0,      /* load_period_us */
+    21      /* load_commands */
+};
+
+//*****************************************************************************
+//
+// Phone before the switch: mass storage interface (the ANDROID class driver
+// is registered for it), Bulk IN EP1 and OUT EP2.
+//
+//*****************************************************************************
+static const t_u8 g_ucSimAndroidDeviceDesc[18] =
+{
+    18, USB_DTYPE_DEVICE, 0x00, 0x02, 0x00, 0x00, 0x00, MAX_PACKET_SIZE_EP0,
+    0xD1, 0x18, 0x22, 0x4E, 0x00, 0x01, 1, 2, 3, 1
+};
+
+static const t_u8 g_ucSimAndroidConfigDesc[32] =
+{
+    9, USB_DTYPE_CONFIGURATION, 32, 0, 1, 1, 0, 0x80, 250,
+    9, USB_DTYPE_INTERFACE, 0, 0, 2, USB_CLASS_MASS_STORAGE, 0x06, 0x50, 0,
+    7, USB_DTYPE_ENDPOINT, USB_EP_DESC_IN | 1, USB_EP_ATTR_BULK, SIM_ANDROID_MAX_PACKET, 0, 0,
+    7, USB_DTYPE_ENDPOINT, 2, USB_EP_ATTR_BULK, SIM_ANDROID_MAX_PACKET, 0, 0
+};
+
+static int SimAndroidControl(void *pvDevice, const tUSBRequest *psSetup, t_u8 *pucData, t_u32 ulSize);
+
+static const t_sim_usb_device g_sSimAndroidPhone =
+{
+    g_ucSimAndroidDeviceDesc,
+    g_ucSimAndroidConfigDesc,
+    SimAndroidControl,
+    NULL,
+    50,
+    &g_sSimAndroid
+};
+
+//*****************************************************************************
+//
+// Probe period with a pseudo random jitter (same sequence on each run), the
+// probes are not in phase with the firmware tick.
+//
+//*****************************************************************************
+static t_u64 SimAndroidProbeAt(t_u32 ulPeriodUs)
+{
+    t_u32 ulJitter;
+
+    ulJitter = 0;
+    if(g_sSimAndroid.sConfig.probe_jitter_us != 0)
+    {
+        g_sSimAndroid.ulRandom = (g_sSimAndroid.ulRandom * 1103515245) + 12345;
+        ulJitter = (g_sSimAndroid.ulRandom >> 8) % g_sSimAndroid.sConfig.probe_jitter_us;
+    }
+
+    return SIM_now_us() + ulPeriodUs + ulJitter;
+}
+
+//*****************************************************************************
+//
+// DemoKit application: writes one Bulk IN transfer (the phone write time is
+// not modelled, the data is queued at once).
+//
+//*****************************************************************************
+static void SimAndroidWrite(t_u8 ucType, t_u8 ucId, t_u8 ucValue, t_u32 ulCount)
+{
+    t_u8 ucData[SIM_ANDROID_MAX_PACKET * 4];
+    t_u32 i;
+
+    if(ulCount > (sizeof(ucData) / DEMOKIT_CMD_SIZE))
+    {
+        ulCount = sizeof(ucData) / DEMOKIT_CMD_SIZE;
+    }
+    for(i = 0; i < ulCount; i++)
+    {
+        ucData[(i * DEMOKIT_CMD_SIZE) + 0] = ucType;
+        ucData[(i * DEMOKIT_CMD_SIZE) + 1] = ucId;
+        ucData[(i * DEMOKIT_CMD_SIZE) + 2] = ucValue;
+    }
+
+    SIM_usbInQueue(1, ucData, ulCount * DEMOKIT_CMD_SIZE);
+    g_sSimAndroid.sStats.commands_sent += ulCount;
+}
+
+// Phone to motor probe: Relay1 toggles the left motor, the latency ends when
+// the motor driver is set to the new state.
+static void SimAndroidMotorProbe(void *pvData, t_u32 ulSession)
+{
+    if(!g_sSimAndroid.bApp || (ulSession != g_sSimAndroid.ulSession))
+    {
+        return;
+    }
+
+    if(g_sSimAndroid.bMotorPending)
+    {
+        g_sSimAndroid.sStats.motor_missed++;
+    }
+    g_sSimAndroid.bMotorRun = !g_sSimAndroid.bMotorRun;
+    g_sSimAndroid.bMotorPending = true;
+    g_sSimAndroid.ullMotorSentUs = SIM_now_us();
+    SimAndroidWrite(DEMOKIT_TYPE_RELAY, DEMOKIT_ID_RELAY1, g_sSimAndroid.bMotorRun ? 1 : 0, 1);
+
+    SIM_at(SimAndroidProbeAt(g_sSimAndroid.sConfig.motor_period_us), SimAndroidMotorProbe, NULL, ulSession);
+}
+
+// Background load: commands without handler in EvalBot (LED1 red).
+static void SimAndroidLoad(void *pvData, t_u32 ulSession)
+{
+    if(!g_sSimAndroid.bApp || (ulSession != g_sSimAndroid.ulSession))
+    {
+        return;
+    }
+
+    SimAndroidWrite(DEMOKIT_TYPE_LED_SERVO, DEMOKIT_ID_LED1_RED, 0, g_sSimAndroid.sConfig.load_commands);
+
+    SIM_at(SIM_now_us() + g_sSimAndroid.sConfig.load_period_us, SimAndroidLoad, NULL, ulSession);
+}
+
+// Button to phone probe: User Switch 1 pressed then released (half period
+// each), the latency ends when the phone reads the button command.
+static void SimAndroidButtonProbe(void *pvData, t_u32 ulSession)
+{
+    if(!g_sSimAndroid.bApp || (ulSession != g_sSimAndroid.ulSession))
+    {
+        return;
+    }
+
+    if(g_sSimAndroid.bButtonPending)
+    {
+        g_sSimAndroid.sStats.button_missed++;
+    }
+    g_sSimAndroid.ucButtonValue ^= 1;
+    g_sSimAndroid.bButtonPending = true;
+    g_sSimAndroid.ullButtonPressUs = SIM_now_us();
+    // Active low.
+    SIM_gpioInput(USER_SW1_PORT_BASE, USER_SW1_PIN, g_sSimAndroid.ucButtonValue ? 0 : USER_SW1_PIN);
+
+    SIM_at(SimAndroidProbeAt(g_sSimAndroid.sConfig.button_period_us / 2), SimAndroidButtonProbe, NULL, ulSession);
+}
+
+static void SimAndroidAppOpen(void *pvData, t_u32 ulSession)
+{
+    if(ulSession != g_sSimAndroid.ulSession)
+    {
+        return;
+    }
+    g_sSimAndroid.bApp = true;
+
+    // Left motor speed set once, the probes only switch it on and off (no
+    // ramp, the probe ends on the first motor driver call).
+    SimAndroidWrite(DEMOKIT_TYPE_SYSTEM, DEMOKIT_ID_MOTOR_RAMP, 0, 1);
+    SimAndroidWrite(DEMOKIT_TYPE_LED_SERVO, DEMOKIT_ID_SERVO1, 255, 1);
+
+    if(g_sSimAndroid.sConfig.motor_period_us != 0)
+    {
+        SIM_at(SimAndroidProbeAt(g_sSimAndroid.sConfig.motor_period_us), SimAndroidMotorProbe, NULL, ulSession);
+    }
+    if(g_sSimAndroid.sConfig.button_period_us != 0)
+    {
+        SIM_at(SimAndroidProbeAt(g_sSimAndroid.sConfig.button_period_us / 2), SimAndroidButtonProbe, NULL,
+               ulSession);
+    }
+    if(g_sSimAndroid.sConfig.load_period_us != 0)
+    {
+        SIM_at(SIM_now_us() + g_sSimAndroid.sConfig.load_period_us, SimAndroidLoad, NULL, ulSession);
+    }
+}
+
+//*****************************************************************************
+//
+// DemoKit application: commands received from EvalBot.
+//
+//*****************************************************************************
+static void SimAndroidBulkOut(void *pvDevice, t_u32 ulEndpoint, const t_u8 *pucData, t_u32 ulSize)
+{
+    t_u32 i;
+
+    g_sSimAndroid.sStats.bytes_received += ulSize;
+    if(!g_sSimAndroid.bApp)
+    {
+        return;
+    }
+
+    // Only the button commands are decoded (no pose frames, they are off).
+    for(i = 0; (i + DEMOKIT_CMD_SIZE) <= ulSize; i += DEMOKIT_CMD_SIZE)
+    {
+        if((pucData[i] != DEMOKIT_TYPE_BUTTON) || (pucData[i + 1] != DEMOKIT_ID_BUTTON1))
+        {
+            continue;
+        }
+
+        g_sSimAndroid.sStats.buttons_received++;
+        if(g_sSimAndroid.bButtonPending && (pucData[i + 2] == g_sSimAndroid.ucButtonValue))
+        {
+            g_sSimAndroid.bButtonPending = false;
+            SIM_samplesAdd(&g_sSimAndroid.sButtonToPhoneUs,
+                           (t_u32)(SIM_now_us() - g_sSimAndroid.ullButtonPressUs));
+        }
+    }
+}
+
+static void SimAndroidMotor(tSide eSide, bool bRun, tDirection eDir, t_u16 usSpeed)
+{
+    if((eSide != LEFT_SIDE) || !g_sSimAndroid.bMotorPending || (bRun != g_sSimAndroid.bMotorRun))
+    {
+        return;
+    }
+
+    g_sSimAndroid.bMotorPending = false;
+    SIM_samplesAdd(&g_sSimAndroid.sPhoneToMotorUs, (t_u32)(SIM_now_us() - g_sSimAndroid.ullMotorSentUs));
+}
+
+//*****************************************************************************
+//
+// Open Accessory switch: the identity is recorded, then on ACCESSORY_START
+// the phone disconnects and comes back in accessory mode.
+//
+//*****************************************************************************
+static void SimAndroidAttach(void *pvData, t_u32 ulArg)
+{
+    g_sSimAndroid.ulSession++;
+    g_sSimAndroid.bApp = false;
+    g_sSimAndroid.bMotorPending = false;
+    g_sSimAndroid.bButtonPending = false;
+    SIM_usbDeviceAttach(&g_sSimAndroid.sAccessory);
+    SIM_at(SIM_now_us() + ((t_u64)g_sSimAndroid.sConfig.app_open_ms * 1000), SimAndroidAppOpen, NULL,
+           g_sSimAndroid.ulSession);
+}
+
+static void SimAndroidDetach(void *pvData, t_u32 ulArg)
+{
+    SIM_usbDeviceDetach();
+    SIM_at(SIM_now_us() + ((t_u64)g_sSimAndroid.sConfig.detach_to_attach_ms * 1000), SimAndroidAttach,
+           NULL, 0);
+}
+
+static int SimAndroidControl(void *pvDevice, const tUSBRequest *psSetup, t_u8 *pucData, t_u32 ulSize)
+{
+    t_u32 ulLen;
+
+    if((psSetup->bmRequestType & USB_RTYPE_TYPE_M) != USB_RTYPE_VENDOR)
+    {
+        return SIM_USB_STALL;
+    }
+
+    switch(psSetup->bRequest)
+    {
+        case SIM_ANDROID_GET_PROTOCOL:
+        {
+            g_sSimAndroid.sStats.protocol_requests++;
+            if(ulSize < 2)
+            {
+                return SIM_USB_STALL;
+            }
+            pucData[0] = SIM_ANDROID_PROTOCOL;
+            pucData[1] = 0;
+            return 2;
+        }
+
+        case SIM_ANDROID_SEND_STRING:
+        {
+            if(psSetup->wIndex >= SIM_ANDROID_NB_STRINGS)
+            {
+                return SIM_USB_STALL;
+            }
+            g_sSimAndroid.sStats.strings_received++;
+            ulLen = (ulSize < (SIM_ANDROID_STRING_MAX - 1)) ? ulSize : (SIM_ANDROID_STRING_MAX - 1);
+            memcpy(g_sSimAndroid.cStrings[psSetup->wIndex], pucData, ulLen);
+            g_sSimAndroid.cStrings[psSetup->wIndex][ulLen] = 0;
+            return ulSize;
+        }
+
+        case SIM_ANDROID_START:
+        {
+            g_sSimAndroid.sStats.starts++;
+            SIM_at(SIM_now_us() + ((t_u64)g_sSimAndroid.sConfig.start_to_detach_ms * 1000), SimAndroidDetach,
+                   NULL, 0);
+            return 0;
+        }
+
+        default:
+        {
+            return SIM_USB_STALL;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// API
+//
+//*****************************************************************************
+void SIM_androidInit(const t_sim_android_config *psConfig)
+{
+    t_sim_hooks sHooks;
+
+    SIM_samplesFree(&g_sSimAndroid.sButtonToPhoneUs);
+    SIM_samplesFree(&g_sSimAndroid.sPhoneToMotorUs);
+    memset(&g_sSimAndroid, 0, sizeof(g_sSimAndroid));
+    g_sSimAndroid.sConfig = (psConfig != NULL) ? *psConfig : g_sSimAndroidConfigDefault;
+    g_sSimAndroid.ulRandom = 1;
+
+    // Same descriptors as the device already in accessory mode, with the application behind.
+    g_sSimAndroid.sAccessory = *SIM_usbAccessoryDevice();
+    g_sSimAndroid.sAccessory.pfnBulkOut = SimAndroidBulkOut;
+    g_sSimAndroid.sAccessory.pvDevice = &g_sSimAndroid;
+
+    memset(&sHooks, 0, sizeof(sHooks));
+    sHooks.pfnMotor = SimAndroidMotor;
+    SIM_hooks(&sHooks);
+}
+
+void SIM_androidPlug(void)
+{
+    SIM_usbPlug(&g_sSimAndroidPhone);
+}
+
+bool SIM_androidAppOpen(void)
+{
+    return g_sSimAndroid.bApp;
+}
+
+void SIM_androidStats(t_sim_android_stats *psStats)
+{
+    *psStats = g_sSimAndroid.sStats;
+}
+
+const char *SIM_androidString(t_u32 ulIndex)
+{
+    return (ulIndex < SIM_ANDROID_NB_STRINGS) ? g_sSimAndroid.cStrings[ulIndex] : "";
+}
+
+void SIM_androidLatency(t_sim_dist *psButtonToPhoneUs, t_sim_dist *psPhoneToMotorUs)
+{
+    SIM_samplesDist(&g_sSimAndroid.sButtonToPhoneUs, psButtonToPhoneUs);
+    SIM_samplesDist(&g_sSimAndroid.sPhoneToMotorUs, psPhoneToMotorUs);
+}
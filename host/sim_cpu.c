@@ -0,0 +1,975 @@
+//*****************************************************************************
+//
+// sim_cpu.c - Simulated core: virtual time, interrupts, SysTick and timers.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_nvic.h"
+#include "inc/hw_types.h"
+#include "driverlib/cpu.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/systick.h"
+#include "driverlib/timer.h"
+#include "drivers/motor.h"
+#include "usblib/usblib.h"
+
+#include "usb_android.h"
+#include "sim.h"
+#include "sim_hw.h"
+
+#define SIM_DWT_CYCCNT  (0xE0001004)
+
+/* Interrupts taken back to back before a handler is declared stuck (source never cleared) */
+#define SIM_IRQ_STORM   (100000)
+
+const t_sim_timing g_sSimTimingDefault =
+{
+    20, /* usb_reset_ms */
+    125, /* usb_stage_us */
+    5, /* usb_packet_us */
+    250, /* usb_rx_packet_cycles */
+    40, /* usb_rx_byte_cycles: about 120 cycles per DemoKit command */
+    25, /* display_byte_us: I2C at 400kHz */
+    115200 /* uart_baud */
+};
+
+t_sim_timing g_sSimTiming;
+t_sim_hooks g_sSimHooks;
+t_u64 g_ullSimCycles;
+
+//*****************************************************************************
+//
+// Vector table of the firmware (startup_ccs.c), by interrupt number.
+//
+//*****************************************************************************
+extern void SysTickIntHandler(void);
+extern void USB0IntHandler(void);
+extern void GPIOInputIntHandler(void);
+extern void TrajectoryTimerIntHandler(void);
+extern void MotorCtrlTimerIntHandler(void);
+extern void SpeedTimerIntHandler(void);
+extern void UARTStdioIntHandler(void);
+
+typedef struct
+{
+    t_u32 ulInterrupt;
+    void (*pfnHandler)(void);
+} t_sim_vector;
+
+static const t_sim_vector g_sSimVectors[] =
+{
+    { FAULT_SYSTICK, SysTickIntHandler },
+    { INT_GPIOD, GPIOInputIntHandler },
+    { INT_GPIOE, GPIOInputIntHandler },
+    { INT_UART0, UARTStdioIntHandler },
+    { INT_TIMER0A, TrajectoryTimerIntHandler },
+    { INT_TIMER1A, MotorCtrlTimerIntHandler },
+    { INT_TIMER2A, SpeedTimerIntHandler },
+    { INT_USB0, USB0IntHandler }
+};
+#define SIM_NB_VECTORS  (sizeof(g_sSimVectors) / sizeof(g_sSimVectors[0]))
+
+//*****************************************************************************
+//
+// Scheduled actions, a binary heap ordered by time then scheduling order.
+//
+//*****************************************************************************
+typedef struct
+{
+    t_u64 ullAt;
+    t_u64 ullSeq;
+    t_sim_action pfnAction;
+    void *pvData;
+    t_u32 ulArg;
+} t_sim_event;
+
+static t_sim_event *g_psSimHeap;
+static t_u32 g_ulSimHeapCount;
+static t_u32 g_ulSimHeapSize;
+static t_u64 g_ullSimSeq;
+
+// Interrupt lines level (peripherals), enable (NVIC) and core state.
+static t_u64 g_ullSimIrqLevel;
+static t_u64 g_ullSimIrqEnabled;
+static bool g_bSimPrimask;
+static bool g_bSimInIsr;
+
+// SysTick.
+static bool g_bSimSysTickOn;
+static bool g_bSimSysTickInt;
+static bool g_bSimSysTickPending;
+static t_u32 g_ulSimSysTickPeriod;
+static t_u64 g_ullSimSysTickStart;
+static t_u64 g_ullSimSysTickNext;
+
+// General purpose timers 0 to 2 (timer A only, 32 bits mode).
+typedef struct
+{
+    t_u32 ulBase;
+    t_u32 ulInterrupt;
+    bool bPeriodic;
+    bool bOn;
+    t_u32 ulLoad;
+    t_u32 ulRaw;
+    t_u32 ulMask;
+    t_u64 ullNext;
+} t_sim_timer;
+
+static t_sim_timer g_sSimTimers[3];
+
+// Run control.
+static jmp_buf g_sSimExit;
+static bool g_bSimRunning;
+static t_u64 g_ullSimEnd;
+
+// Main loop latency.
+static bool g_bSimAwake;
+static t_u64 g_ullSimWakeCycles;
+static struct timespec g_sSimWakeHost;
+static t_u32 g_ulSimWakeups;
+static t_sim_samples g_sSimLoopUs;
+static t_sim_samples g_sSimLoopNs;
+
+// Registers and the pending bit-band alias write.
+#define SIM_REGS    (256)
+typedef struct
+{
+    t_u32 ulAddr;
+    volatile unsigned int ulValue;
+} t_sim_reg;
+
+static t_sim_reg g_sSimRegs[SIM_REGS];
+static t_u32 g_ulSimCycCntOffset;
+static t_u32 g_ulSimCycCntLast;
+
+static volatile unsigned int *g_pulSimBitBandWord;
+static t_u32 g_ulSimBitBandBit;
+static volatile unsigned int g_ulSimBitBandValue;
+
+//*****************************************************************************
+//
+// Write back the pending bit-band alias write to its word.
+//
+//*****************************************************************************
+static void SimBitBandCommit(void)
+{
+    if(g_pulSimBitBandWord == NULL)
+    {
+        return;
+    }
+
+    if(g_ulSimBitBandValue & 1)
+    {
+        *g_pulSimBitBandWord |= (1U << g_ulSimBitBandBit);
+    }
+    else
+    {
+        *g_pulSimBitBandWord &= ~(1U << g_ulSimBitBandBit);
+    }
+    g_pulSimBitBandWord = NULL;
+}
+
+volatile unsigned int *SimBitBand(volatile void *pvAddr, unsigned int ulBit)
+{
+    SimBitBandCommit();
+
+    g_pulSimBitBandWord = (volatile unsigned int *)pvAddr;
+    g_ulSimBitBandBit = ulBit & 31;
+    g_ulSimBitBandValue = (*g_pulSimBitBandWord >> g_ulSimBitBandBit) & 1;
+
+    return &g_ulSimBitBandValue;
+}
+
+//*****************************************************************************
+//
+// Return the word of a register.  The time based registers are updated
+// before each access, the other ones are plain RAM words.
+//
+//*****************************************************************************
+volatile unsigned int *SimReg(unsigned int ulAddr)
+{
+    t_u32 ulIdx;
+
+    SimBitBandCommit();
+
+    ulIdx = (ulAddr >> 2) % SIM_REGS;
+    while((g_sSimRegs[ulIdx].ulAddr != 0) && (g_sSimRegs[ulIdx].ulAddr != ulAddr))
+    {
+        ulIdx = (ulIdx + 1) % SIM_REGS;
+    }
+    if(g_sSimRegs[ulIdx].ulAddr == 0)
+    {
+        g_sSimRegs[ulIdx].ulAddr = ulAddr;
+        g_sSimRegs[ulIdx].ulValue = 0;
+    }
+
+    switch(ulAddr)
+    {
+        case NVIC_INT_CTRL:
+            g_sSimRegs[ulIdx].ulValue = g_bSimSysTickPending ? NVIC_INT_CTRL_PEND_SYST : 0;
+            break;
+
+        case NVIC_ST_CURRENT:
+            g_sSimRegs[ulIdx].ulValue = SysTickValueGet();
+            break;
+
+        case SIM_DWT_CYCCNT:
+            // A write sets the counter, seen on the next access.
+            if(g_sSimRegs[ulIdx].ulValue != g_ulSimCycCntLast)
+            {
+                g_ulSimCycCntOffset = (t_u32)g_ullSimCycles - g_sSimRegs[ulIdx].ulValue;
+            }
+            g_ulSimCycCntLast = (t_u32)g_ullSimCycles - g_ulSimCycCntOffset;
+            g_sSimRegs[ulIdx].ulValue = g_ulSimCycCntLast;
+            break;
+
+        default:
+            break;
+    }
+
+    return &g_sSimRegs[ulIdx].ulValue;
+}
+
+//*****************************************************************************
+//
+// Scheduled actions.
+//
+//*****************************************************************************
+static bool SimEventBefore(const t_sim_event *psA, const t_sim_event *psB)
+{
+    return (psA->ullAt < psB->ullAt) || ((psA->ullAt == psB->ullAt) && (psA->ullSeq < psB->ullSeq));
+}
+
+void SimAtCycles(t_u64 ullAt, t_sim_action pfnAction, void *pvData, t_u32 ulArg)
+{
+    t_sim_event sEvent;
+    t_u32 ulIdx;
+
+    if(g_ulSimHeapCount == g_ulSimHeapSize)
+    {
+        g_ulSimHeapSize = g_ulSimHeapSize ? (g_ulSimHeapSize * 2) : 64;
+        g_psSimHeap = realloc(g_psSimHeap, g_ulSimHeapSize * sizeof(t_sim_event));
+    }
+
+    sEvent.ullAt = ullAt;
+    sEvent.ullSeq = g_ullSimSeq++;
+    sEvent.pfnAction = pfnAction;
+    sEvent.pvData = pvData;
+    sEvent.ulArg = ulArg;
+
+    ulIdx = g_ulSimHeapCount++;
+    while((ulIdx > 0) && SimEventBefore(&sEvent, &g_psSimHeap[(ulIdx - 1) / 2]))
+    {
+        g_psSimHeap[ulIdx] = g_psSimHeap[(ulIdx - 1) / 2];
+        ulIdx = (ulIdx - 1) / 2;
+    }
+    g_psSimHeap[ulIdx] = sEvent;
+}
+
+static void SimHeapPop(t_sim_event *psEvent)
+{
+    t_sim_event sLast;
+    t_u32 ulIdx, ulChild;
+
+    *psEvent = g_psSimHeap[0];
+    sLast = g_psSimHeap[--g_ulSimHeapCount];
+
+    ulIdx = 0;
+    while((ulChild = (ulIdx * 2) + 1) < g_ulSimHeapCount)
+    {
+        if(((ulChild + 1) < g_ulSimHeapCount) && SimEventBefore(&g_psSimHeap[ulChild + 1], &g_psSimHeap[ulChild]))
+        {
+            ulChild++;
+        }
+        if(!SimEventBefore(&g_psSimHeap[ulChild], &sLast))
+        {
+            break;
+        }
+        g_psSimHeap[ulIdx] = g_psSimHeap[ulChild];
+        ulIdx = ulChild;
+    }
+    g_psSimHeap[ulIdx] = sLast;
+}
+
+//*****************************************************************************
+//
+// Time of the next hardware event (action, SysTick wrap or timer timeout).
+//
+//*****************************************************************************
+static t_u64 SimNextEvent(void)
+{
+    t_u64 ullNext;
+    t_u32 i;
+
+    ullNext = (g_ulSimHeapCount != 0) ? g_psSimHeap[0].ullAt : SIM_NEVER;
+    if(g_bSimSysTickOn && (g_ullSimSysTickNext < ullNext))
+    {
+        ullNext = g_ullSimSysTickNext;
+    }
+    for(i = 0; i < 3; i++)
+    {
+        if(g_sSimTimers[i].bOn && (g_sSimTimers[i].ullNext < ullNext))
+        {
+            ullNext = g_sSimTimers[i].ullNext;
+        }
+    }
+
+    return ullNext;
+}
+
+//*****************************************************************************
+//
+// Run the hardware events due at the current time.
+//
+//*****************************************************************************
+static void SimFireDue(void)
+{
+    t_sim_event sEvent;
+    t_sim_timer *psTimer;
+    t_u32 i;
+
+    if(g_bSimSysTickOn)
+    {
+        while(g_ullSimSysTickNext <= g_ullSimCycles)
+        {
+            if(g_bSimSysTickInt)
+            {
+                g_bSimSysTickPending = true;
+            }
+            g_ullSimSysTickNext += g_ulSimSysTickPeriod;
+        }
+    }
+
+    for(i = 0; i < 3; i++)
+    {
+        psTimer = &g_sSimTimers[i];
+        while(psTimer->bOn && (psTimer->ullNext <= g_ullSimCycles))
+        {
+            psTimer->ulRaw |= TIMER_TIMA_TIMEOUT;
+            SimIrqSet(psTimer->ulInterrupt, (psTimer->ulRaw & psTimer->ulMask) != 0);
+            if(psTimer->bPeriodic)
+            {
+                psTimer->ullNext += psTimer->ulLoad ? psTimer->ulLoad : 1;
+            }
+            else
+            {
+                psTimer->bOn = false;
+            }
+        }
+    }
+
+    while((g_ulSimHeapCount != 0) && (g_psSimHeap[0].ullAt <= g_ullSimCycles))
+    {
+        SimHeapPop(&sEvent);
+        sEvent.pfnAction(sEvent.pvData, sEvent.ulArg);
+    }
+}
+
+//*****************************************************************************
+//
+// Interrupts.
+//
+//*****************************************************************************
+static bool SimIrqPending(t_u32 ulInterrupt)
+{
+    if(ulInterrupt == FAULT_SYSTICK)
+    {
+        return g_bSimSysTickPending;
+    }
+
+    return ((g_ullSimIrqLevel & g_ullSimIrqEnabled) >> ulInterrupt) & 1;
+}
+
+static bool SimIrqAny(void)
+{
+    return g_bSimSysTickPending || ((g_ullSimIrqLevel & g_ullSimIrqEnabled) != 0);
+}
+
+void SimIrqSet(t_u32 ulInterrupt, bool bAsserted)
+{
+    if(bAsserted)
+    {
+        g_ullSimIrqLevel |= (1ULL << ulInterrupt);
+    }
+    else
+    {
+        g_ullSimIrqLevel &= ~(1ULL << ulInterrupt);
+    }
+}
+
+//*****************************************************************************
+//
+// Take the pending interrupts (vector order, no nesting) if they are not
+// masked.
+//
+//*****************************************************************************
+static void SimDispatch(void)
+{
+    t_u32 i;
+    t_u32 ulStorm;
+    bool bTaken;
+
+    if(g_bSimPrimask || g_bSimInIsr)
+    {
+        return;
+    }
+
+    ulStorm = 0;
+    do
+    {
+        bTaken = false;
+        for(i = 0; i < SIM_NB_VECTORS; i++)
+        {
+            if(SimIrqPending(g_sSimVectors[i].ulInterrupt))
+            {
+                if(g_sSimVectors[i].ulInterrupt == FAULT_SYSTICK)
+                {
+                    g_bSimSysTickPending = false;
+                }
+
+                SimBitBandCommit();
+                g_bSimInIsr = true;
+                g_sSimVectors[i].pfnHandler();
+                SimBitBandCommit();
+                g_bSimInIsr = false;
+
+                bTaken = true;
+                break;
+            }
+        }
+
+        if(++ulStorm > SIM_IRQ_STORM)
+        {
+            fprintf(stderr, "sim: interrupt %u never cleared by its handler\n", g_sSimVectors[i].ulInterrupt);
+            exit(2);
+        }
+    }while(bTaken && !g_bSimPrimask);
+}
+
+//*****************************************************************************
+//
+// Stop the run if its end time is reached before ullNext.
+//
+//*****************************************************************************
+static void SimCheckEnd(t_u64 ullNext)
+{
+    if(!g_bSimRunning)
+    {
+        longjmp(g_sSimExit, 1);
+    }
+
+    if(g_ullSimEnd <= ullNext)
+    {
+        if(g_ullSimCycles < g_ullSimEnd)
+        {
+            g_ullSimCycles = g_ullSimEnd;
+        }
+        longjmp(g_sSimExit, 1);
+    }
+}
+
+void SimAdvanceTo(t_u64 ullAt)
+{
+    t_u64 ullNext;
+
+    for(;;)
+    {
+        SimDispatch();
+
+        ullNext = SimNextEvent();
+        if(ullNext > ullAt)
+        {
+            break;
+        }
+        SimCheckEnd(ullNext);
+        if(ullNext > g_ullSimCycles)
+        {
+            g_ullSimCycles = ullNext;
+        }
+        SimFireDue();
+    }
+
+    SimCheckEnd(ullAt);
+    if(ullAt > g_ullSimCycles)
+    {
+        g_ullSimCycles = ullAt;
+    }
+    SimDispatch();
+}
+
+//*****************************************************************************
+//
+// Main loop latency samples.
+//
+//*****************************************************************************
+static t_u32 SimHostElapsedNs(const struct timespec *psFrom)
+{
+    struct timespec sNow;
+    t_i64 llNs;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    llNs = ((t_i64)(sNow.tv_sec - psFrom->tv_sec) * 1000000000LL) + (sNow.tv_nsec - psFrom->tv_nsec);
+
+    return (llNs > 0xFFFFFFFFLL) ? 0xFFFFFFFF : (t_u32)llNs;
+}
+
+//*****************************************************************************
+//
+// Core driverlib functions.
+//
+//*****************************************************************************
+unsigned int CPUcpsid(void)
+{
+    bool bOld;
+
+    SimBitBandCommit();
+    bOld = g_bSimPrimask;
+    g_bSimPrimask = true;
+
+    return bOld;
+}
+
+unsigned int CPUcpsie(void)
+{
+    bool bOld;
+
+    SimBitBandCommit();
+    bOld = g_bSimPrimask;
+    g_bSimPrimask = false;
+    SimDispatch();
+
+    return bOld;
+}
+
+unsigned int CPUprimask(void)
+{
+    return g_bSimPrimask;
+}
+
+//*****************************************************************************
+//
+// Sleep until an interrupt is pending (masked or not), the time jumps to the
+// next hardware events.  The main loop work between a wake-up and the next
+// sleep is one latency sample.
+//
+//*****************************************************************************
+void CPUwfi(void)
+{
+    t_u64 ullNext;
+
+    SimBitBandCommit();
+
+    if(g_bSimAwake)
+    {
+        SIM_samplesAdd(&g_sSimLoopUs, (t_u32)((g_ullSimCycles - g_ullSimWakeCycles) / SIM_CYCLES_PER_US));
+        SIM_samplesAdd(&g_sSimLoopNs, SimHostElapsedNs(&g_sSimWakeHost));
+        g_bSimAwake = false;
+    }
+
+    while(!SimIrqAny())
+    {
+        ullNext = SimNextEvent();
+        SimCheckEnd(ullNext);
+        if(ullNext > g_ullSimCycles)
+        {
+            g_ullSimCycles = ullNext;
+        }
+        SimFireDue();
+    }
+
+    g_ulSimWakeups++;
+    g_bSimAwake = true;
+    g_ullSimWakeCycles = g_ullSimCycles;
+    clock_gettime(CLOCK_MONOTONIC, &g_sSimWakeHost);
+
+    SimDispatch();
+}
+
+tBoolean IntMasterEnable(void)
+{
+    return CPUcpsie();
+}
+
+tBoolean IntMasterDisable(void)
+{
+    return CPUcpsid();
+}
+
+void IntEnable(unsigned int ulInterrupt)
+{
+    if(ulInterrupt == FAULT_SYSTICK)
+    {
+        g_bSimSysTickInt = true;
+    }
+    else if(ulInterrupt < NUM_INTERRUPTS)
+    {
+        g_ullSimIrqEnabled |= (1ULL << ulInterrupt);
+    }
+}
+
+void IntDisable(unsigned int ulInterrupt)
+{
+    if(ulInterrupt == FAULT_SYSTICK)
+    {
+        g_bSimSysTickInt = false;
+    }
+    else if(ulInterrupt < NUM_INTERRUPTS)
+    {
+        g_ullSimIrqEnabled &= ~(1ULL << ulInterrupt);
+    }
+}
+
+void IntPrioritySet(unsigned int ulInterrupt, unsigned char ucPriority)
+{
+}
+
+void SysCtlPeripheralEnable(unsigned int ulPeripheral)
+{
+}
+
+void SysCtlClockSet(unsigned int ulConfig)
+{
+}
+
+unsigned int SysCtlClockGet(void)
+{
+    return SIM_CLOCK_HZ;
+}
+
+//*****************************************************************************
+//
+// SysTick, counts down from the period minus one and wraps.
+//
+//*****************************************************************************
+void SysTickEnable(void)
+{
+    if(!g_bSimSysTickOn)
+    {
+        g_bSimSysTickOn = true;
+        g_ullSimSysTickStart = g_ullSimCycles;
+        g_ullSimSysTickNext = g_ullSimCycles + g_ulSimSysTickPeriod;
+    }
+}
+
+void SysTickDisable(void)
+{
+    g_bSimSysTickOn = false;
+}
+
+void SysTickIntEnable(void)
+{
+    g_bSimSysTickInt = true;
+}
+
+void SysTickIntDisable(void)
+{
+    g_bSimSysTickInt = false;
+}
+
+void SysTickPeriodSet(unsigned int ulPeriod)
+{
+    g_ulSimSysTickPeriod = ulPeriod ? ulPeriod : 1;
+}
+
+unsigned int SysTickPeriodGet(void)
+{
+    return g_ulSimSysTickPeriod;
+}
+
+unsigned int SysTickValueGet(void)
+{
+    if(!g_bSimSysTickOn)
+    {
+        return 0;
+    }
+
+    return g_ulSimSysTickPeriod - 1 - (t_u32)((g_ullSimCycles - g_ullSimSysTickStart) % g_ulSimSysTickPeriod);
+}
+
+//*****************************************************************************
+//
+// General purpose timers (timer A in 32 bits one-shot or periodic mode).
+//
+//*****************************************************************************
+static t_sim_timer *SimTimer(unsigned int ulBase)
+{
+    t_u32 i;
+
+    for(i = 0; i < 3; i++)
+    {
+        if(g_sSimTimers[i].ulBase == ulBase)
+        {
+            return &g_sSimTimers[i];
+        }
+    }
+
+    fprintf(stderr, "sim: timer 0x%08X not simulated\n", ulBase);
+    exit(2);
+}
+
+static void SimTimerIrqUpdate(t_sim_timer *psTimer)
+{
+    SimIrqSet(psTimer->ulInterrupt, (psTimer->ulRaw & psTimer->ulMask) != 0);
+}
+
+void TimerConfigure(unsigned int ulBase, unsigned int ulConfig)
+{
+    t_sim_timer *psTimer;
+
+    psTimer = SimTimer(ulBase);
+    psTimer->bOn = false;
+    psTimer->bPeriodic = (ulConfig == TIMER_CFG_32_BIT_PER);
+}
+
+void TimerLoadSet(unsigned int ulBase, unsigned int ulTimer, unsigned int ulValue)
+{
+    t_sim_timer *psTimer;
+
+    psTimer = SimTimer(ulBase);
+    psTimer->ulLoad = ulValue;
+    if(psTimer->bOn)
+    {
+        psTimer->ullNext = g_ullSimCycles + (ulValue ? ulValue : 1);
+    }
+}
+
+void TimerEnable(unsigned int ulBase, unsigned int ulTimer)
+{
+    t_sim_timer *psTimer;
+
+    psTimer = SimTimer(ulBase);
+    if(!psTimer->bOn)
+    {
+        psTimer->bOn = true;
+        psTimer->ullNext = g_ullSimCycles + (psTimer->ulLoad ? psTimer->ulLoad : 1);
+    }
+}
+
+void TimerDisable(unsigned int ulBase, unsigned int ulTimer)
+{
+    SimTimer(ulBase)->bOn = false;
+}
+
+unsigned int TimerValueGet(unsigned int ulBase, unsigned int ulTimer)
+{
+    t_sim_timer *psTimer;
+
+    psTimer = SimTimer(ulBase);
+
+    return psTimer->bOn ? (t_u32)(psTimer->ullNext - g_ullSimCycles) : psTimer->ulLoad;
+}
+
+void TimerIntEnable(unsigned int ulBase, unsigned int ulIntFlags)
+{
+    t_sim_timer *psTimer;
+
+    psTimer = SimTimer(ulBase);
+    psTimer->ulMask |= ulIntFlags;
+    SimTimerIrqUpdate(psTimer);
+}
+
+void TimerIntDisable(unsigned int ulBase, unsigned int ulIntFlags)
+{
+    t_sim_timer *psTimer;
+
+    psTimer = SimTimer(ulBase);
+    psTimer->ulMask &= ~ulIntFlags;
+    SimTimerIrqUpdate(psTimer);
+}
+
+void TimerIntClear(unsigned int ulBase, unsigned int ulIntFlags)
+{
+    t_sim_timer *psTimer;
+
+    psTimer = SimTimer(ulBase);
+    psTimer->ulRaw &= ~ulIntFlags;
+    SimTimerIrqUpdate(psTimer);
+}
+
+//*****************************************************************************
+//
+// Simulator API.
+//
+//*****************************************************************************
+void SIM_init(const t_sim_timing *psTiming)
+{
+    static const t_u32 ulTimerBase[3] = { TIMER0_BASE, TIMER1_BASE, TIMER2_BASE };
+    static const t_u32 ulTimerInt[3] = { INT_TIMER0A, INT_TIMER1A, INT_TIMER2A };
+    t_u32 i;
+
+    g_sSimTiming = (psTiming != NULL) ? *psTiming : g_sSimTimingDefault;
+    memset(&g_sSimHooks, 0, sizeof(g_sSimHooks));
+
+    g_ullSimCycles = 0;
+    g_ulSimHeapCount = 0;
+    g_ullSimSeq = 0;
+
+    g_ullSimIrqLevel = 0;
+    g_ullSimIrqEnabled = 0;
+    g_bSimPrimask = false;
+    g_bSimInIsr = false;
+
+    g_bSimSysTickOn = false;
+    g_bSimSysTickInt = false;
+    g_bSimSysTickPending = false;
+    g_ulSimSysTickPeriod = 1;
+
+    memset(g_sSimTimers, 0, sizeof(g_sSimTimers));
+    for(i = 0; i < 3; i++)
+    {
+        g_sSimTimers[i].ulBase = ulTimerBase[i];
+        g_sSimTimers[i].ulInterrupt = ulTimerInt[i];
+    }
+
+    memset(g_sSimRegs, 0, sizeof(g_sSimRegs));
+    g_ulSimCycCntOffset = 0;
+    g_ulSimCycCntLast = 0;
+    g_pulSimBitBandWord = NULL;
+
+    g_bSimAwake = false;
+    g_ulSimWakeups = 0;
+    SIM_samplesFree(&g_sSimLoopUs);
+    SIM_samplesFree(&g_sSimLoopNs);
+
+    SimPeriphReset();
+    SimUsbReset();
+}
+
+void SIM_hooks(const t_sim_hooks *psHooks)
+{
+    g_sSimHooks = *psHooks;
+}
+
+//*****************************************************************************
+//
+//! This function runs the firmware in the simulator.
+//!
+//! \param end_us is the virtual time the run ends at.
+//! \param pfnEntry is the firmware entry point.
+//!
+//! The firmware never returns from its main loop, the simulator jumps back
+//! here when the virtual time reaches end_us or SIM_stop() was called.  The
+//! firmware state is left as is, SIM_init() starts a new run (the firmware
+//! globals are not reset, use one process per run).
+//!
+//! \return None.
+//
+//*****************************************************************************
+void SIM_run(t_u64 end_us, int (*pfnEntry)(void))
+{
+    g_ullSimEnd = SIM_US_TO_CYCLES(end_us);
+    g_bSimRunning = true;
+
+    if(setjmp(g_sSimExit) == 0)
+    {
+        pfnEntry();
+    }
+
+    g_bSimRunning = false;
+    g_bSimInIsr = false;
+}
+
+void SIM_stop(void)
+{
+    g_bSimRunning = false;
+}
+
+t_u64 SIM_now_us(void)
+{
+    return g_ullSimCycles / SIM_CYCLES_PER_US;
+}
+
+t_u64 SIM_nowCycles(void)
+{
+    return g_ullSimCycles;
+}
+
+void SIM_at(t_u64 at_us, t_sim_action pfnAction, void *pvData, t_u32 ulArg)
+{
+    SimAtCycles(SIM_US_TO_CYCLES(at_us), pfnAction, pvData, ulArg);
+}
+
+void SIM_advance(t_u32 us)
+{
+    SimAdvanceTo(g_ullSimCycles + SIM_US_TO_CYCLES(us));
+}
+
+void SIM_loopLatency(t_sim_dist *psVirtualUs, t_sim_dist *psHostNs)
+{
+    SIM_samplesDist(&g_sSimLoopUs, psVirtualUs);
+    SIM_samplesDist(&g_sSimLoopNs, psHostNs);
+}
+
+t_u32 SIM_loopWakeups(void)
+{
+    return g_ulSimWakeups;
+}
+
+void SIM_samplesAdd(t_sim_samples *psSamples, t_u32 ulValue)
+{
+    if(psSamples->ulCount == psSamples->ulSize)
+    {
+        psSamples->ulSize = psSamples->ulSize ? (psSamples->ulSize * 2) : 1024;
+        psSamples->pulData = realloc(psSamples->pulData, psSamples->ulSize * sizeof(t_u32));
+    }
+    psSamples->pulData[psSamples->ulCount++] = ulValue;
+}
+
+static int SimCompareU32(const void *pvA, const void *pvB)
+{
+    t_u32 ulA = *(const t_u32 *)pvA;
+    t_u32 ulB = *(const t_u32 *)pvB;
+
+    return (ulA > ulB) - (ulA < ulB);
+}
+
+void SIM_samplesDist(const t_sim_samples *psSamples, t_sim_dist *psDist)
+{
+    t_u32 *pulSorted;
+    t_u64 ullSum;
+    t_u32 n, i;
+
+    memset(psDist, 0, sizeof(*psDist));
+    n = psSamples->ulCount;
+    if(n == 0)
+    {
+        return;
+    }
+
+    pulSorted = malloc(n * sizeof(t_u32));
+    memcpy(pulSorted, psSamples->pulData, n * sizeof(t_u32));
+    qsort(pulSorted, n, sizeof(t_u32), SimCompareU32);
+
+    ullSum = 0;
+    for(i = 0; i < n; i++)
+    {
+        ullSum += pulSorted[i];
+    }
+
+    psDist->count = n;
+    psDist->min = pulSorted[0];
+    psDist->p50 = pulSorted[(n * 50) / 100];
+    psDist->p90 = pulSorted[(n * 90) / 100];
+    psDist->p99 = pulSorted[(n * 99) / 100];
+    psDist->max = pulSorted[n - 1];
+    psDist->mean = (t_u32)(ullSum / n);
+
+    free(pulSorted);
+}
+
+void SIM_samplesFree(t_sim_samples *psSamples)
+{
+    free(psSamples->pulData);
+    memset(psSamples, 0, sizeof(*psSamples));
+}
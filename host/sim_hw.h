@@ -0,0 +1,60 @@
+//*****************************************************************************
+//
+// sim_hw.h - Simulator internals shared by the simulated peripherals.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __SIM_HW_H__
+#define __SIM_HW_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SIM_NEVER   (0xFFFFFFFFFFFFFFFFULL)
+
+#define SIM_US_TO_CYCLES(us)    ((t_u64)(us) * SIM_CYCLES_PER_US)
+
+/* Timings of the current run */
+extern t_sim_timing g_sSimTiming;
+
+/* Observers of the current run */
+extern t_sim_hooks g_sSimHooks;
+
+/* Virtual time in core cycles */
+extern t_u64 g_ullSimCycles;
+
+/* Schedule an action at a virtual time in cycles (same time actions run in scheduling order) */
+extern void SimAtCycles(t_u64 ullAt, t_sim_action pfnAction, void *pvData, t_u32 ulArg);
+
+/* Consume virtual time from the firmware context up to ullAt cycles */
+extern void SimAdvanceTo(t_u64 ullAt);
+
+/* Set the level of a peripheral interrupt line (taken once enabled and unmasked) */
+extern void SimIrqSet(t_u32 ulInterrupt, bool bAsserted);
+
+/* Reset of the peripherals at SIM_init() */
+extern void SimPeriphReset(void);
+
+extern void SimUsbReset(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SIM_HW_H__
@@ -0,0 +1,414 @@
+//*****************************************************************************
+//
+// sim_main.c - Run the firmware in the simulator with a device timing script.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "drivers/motor.h"
+#include "usblib/usblib.h"
+
+#include "usb_android.h"
+#include "sim.h"
+
+/*
+ * Script syntax, one action per line ('#' starts a comment):
+ *   timing <name> <value>           set a t_sim_timing member (before the first action)
+ *   android <name> <value>          set a t_sim_android_config member of the phone
+ *   <ms> plug accessory             plug a device already in accessory mode
+ *   <ms> plug android               plug the Android phone (accessory switch, DemoKit probes)
+ *   <ms> plug unknown               plug a device without class driver (HID, events driver only)
+ *   <ms> unplug                     unplug the cable
+ *   <ms> power_fault                VBUS power fault, VBUS stays off until the next unplug
+ *   <ms> in <ep> <hex bytes>        the device queues data on its Bulk IN endpoint
+ *   <ms> nak in|out <duration ms>   the device NAKs the IN or OUT transactions
+ *   <ms> halt in|out <ep>           the device halts its Bulk IN or OUT endpoint (STALL)
+ *   <ms> button <name> press|release  sw1, sw2, bump_l or bump_r
+ *   <ms> end                        end of the run
+ * The times are in virtual milliseconds from reset, in any order.
+ */
+#define SIM_SCRIPT_LINE_MAX     (512)
+#define SIM_SCRIPT_DATA_MAX     (256)
+#define SIM_DEFAULT_END_MS      (10000)
+
+typedef struct
+{
+    t_u32 ulLine;
+    t_u64 ullAtUs;
+    char cAction[16];
+    char cArg[16];
+    t_u32 ulValue;
+    t_u8 ucData[SIM_SCRIPT_DATA_MAX];
+    t_u32 ulDataSize;
+} t_sim_action_line;
+
+typedef struct
+{
+    const char *pcName;
+    t_u32 ulPort;
+    t_u8 ucPin;
+} t_sim_button;
+
+static const t_sim_button g_sSimButtons[] =
+{
+    { "sw1", USER_SW1_PORT_BASE, USER_SW1_PIN },
+    { "sw2", USER_SW2_PORT_BASE, USER_SW2_PIN },
+    { "bump_l", BUMP_L_SW3_PORT_BASE, BUMP_L_SW3_PIN },
+    { "bump_r", BUMP_R_SW4_PORT_BASE, BUMP_R_SW4_PIN }
+};
+#define SIM_NB_BUTTONS  (sizeof(g_sSimButtons) / sizeof(g_sSimButtons[0]))
+
+static t_sim_action_line *g_psSimLines;
+static t_u32 g_ulSimNbLines;
+static t_u64 g_ullSimEndUs = (t_u64)SIM_DEFAULT_END_MS * 1000;
+static t_sim_android_config g_sSimAndroidConfig;
+static bool g_bSimAndroid;
+
+static void SimScriptError(const char *pcFile, t_u32 ulLine, const char *pcMsg)
+{
+    fprintf(stderr, "%s:%u: %s\n", pcFile, ulLine, pcMsg);
+    exit(1);
+}
+
+static bool SimTimingSet(t_sim_timing *psTiming, const char *pcName, t_u32 ulValue)
+{
+    if(strcmp(pcName, "usb_reset_ms") == 0)
+    {
+        psTiming->usb_reset_ms = ulValue;
+    }
+    else if(strcmp(pcName, "usb_stage_us") == 0)
+    {
+        psTiming->usb_stage_us = ulValue;
+    }
+    else if(strcmp(pcName, "usb_packet_us") == 0)
+    {
+        psTiming->usb_packet_us = ulValue;
+    }
+    else if(strcmp(pcName, "usb_rx_packet_cycles") == 0)
+    {
+        psTiming->usb_rx_packet_cycles = ulValue;
+    }
+    else if(strcmp(pcName, "usb_rx_byte_cycles") == 0)
+    {
+        psTiming->usb_rx_byte_cycles = ulValue;
+    }
+    else if(strcmp(pcName, "display_byte_us") == 0)
+    {
+        psTiming->display_byte_us = ulValue;
+    }
+    else if(strcmp(pcName, "uart_baud") == 0)
+    {
+        psTiming->uart_baud = ulValue;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static bool SimAndroidSet(t_sim_android_config *psConfig, const char *pcName, t_u32 ulValue)
+{
+    static const struct
+    {
+        const char *pcName;
+        size_t ulOffset;
+    } sFields[] =
+    {
+        { "start_to_detach_ms", offsetof(t_sim_android_config, start_to_detach_ms) },
+        { "detach_to_attach_ms", offsetof(t_sim_android_config, detach_to_attach_ms) },
+        { "app_open_ms", offsetof(t_sim_android_config, app_open_ms) },
+        { "motor_period_us", offsetof(t_sim_android_config, motor_period_us) },
+        { "button_period_us", offsetof(t_sim_android_config, button_period_us) },
+        { "probe_jitter_us", offsetof(t_sim_android_config, probe_jitter_us) },
+        { "load_period_us", offsetof(t_sim_android_config, load_period_us) },
+        { "load_commands", offsetof(t_sim_android_config, load_commands) }
+    };
+    t_u32 i;
+
+    for(i = 0; i < (sizeof(sFields) / sizeof(sFields[0])); i++)
+    {
+        if(strcmp(pcName, sFields[i].pcName) == 0)
+        {
+            *(t_u32 *)((t_u8 *)psConfig + sFields[i].ulOffset) = ulValue;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//*****************************************************************************
+//
+// Parse the script, the timings are applied to psTiming.
+//
+//*****************************************************************************
+static void SimScriptLoad(const char *pcFile, t_sim_timing *psTiming)
+{
+    char cLine[SIM_SCRIPT_LINE_MAX];
+    t_sim_action_line sAction;
+    char *pcToken;
+    char *pcSave;
+    t_u32 ulLine;
+    FILE *pFile;
+
+    pFile = fopen(pcFile, "r");
+    if(pFile == NULL)
+    {
+        perror(pcFile);
+        exit(1);
+    }
+
+    ulLine = 0;
+    while(fgets(cLine, sizeof(cLine), pFile) != NULL)
+    {
+        ulLine++;
+        if(strchr(cLine, '#') != NULL)
+        {
+            *strchr(cLine, '#') = 0;
+        }
+
+        pcToken = strtok_r(cLine, " \t\r\n", &pcSave);
+        if(pcToken == NULL)
+        {
+            continue;
+        }
+
+        if(strcmp(pcToken, "timing") == 0)
+        {
+            char *pcName = strtok_r(NULL, " \t\r\n", &pcSave);
+            char *pcValue = strtok_r(NULL, " \t\r\n", &pcSave);
+
+            if((pcName == NULL) || (pcValue == NULL) ||
+               !SimTimingSet(psTiming, pcName, strtoul(pcValue, NULL, 0)))
+            {
+                SimScriptError(pcFile, ulLine, "unknown timing");
+            }
+            continue;
+        }
+
+        if(strcmp(pcToken, "android") == 0)
+        {
+            char *pcName = strtok_r(NULL, " \t\r\n", &pcSave);
+            char *pcValue = strtok_r(NULL, " \t\r\n", &pcSave);
+
+            if((pcName == NULL) || (pcValue == NULL) ||
+               !SimAndroidSet(&g_sSimAndroidConfig, pcName, strtoul(pcValue, NULL, 0)))
+            {
+                SimScriptError(pcFile, ulLine, "unknown android setting");
+            }
+            continue;
+        }
+
+        memset(&sAction, 0, sizeof(sAction));
+        sAction.ulLine = ulLine;
+        sAction.ullAtUs = (t_u64)(strtod(pcToken, NULL) * 1000);
+
+        pcToken = strtok_r(NULL, " \t\r\n", &pcSave);
+        if((pcToken == NULL) || (strlen(pcToken) >= sizeof(sAction.cAction)))
+        {
+            SimScriptError(pcFile, ulLine, "missing action");
+        }
+        strcpy(sAction.cAction, pcToken);
+
+        if(strcmp(sAction.cAction, "end") == 0)
+        {
+            g_ullSimEndUs = sAction.ullAtUs;
+            continue;
+        }
+
+        // Action argument, then a value or hex bytes.
+        pcToken = strtok_r(NULL, " \t\r\n", &pcSave);
+        if(pcToken != NULL)
+        {
+            if(strlen(pcToken) >= sizeof(sAction.cArg))
+            {
+                SimScriptError(pcFile, ulLine, "argument too long");
+            }
+            strcpy(sAction.cArg, pcToken);
+        }
+        while((pcToken = strtok_r(NULL, " \t\r\n", &pcSave)) != NULL)
+        {
+            if(strcmp(sAction.cAction, "in") == 0)
+            {
+                while((pcToken[0] != 0) && (pcToken[1] != 0))
+                {
+                    char cByte[3] = { pcToken[0], pcToken[1], 0 };
+
+                    if(sAction.ulDataSize == SIM_SCRIPT_DATA_MAX)
+                    {
+                        SimScriptError(pcFile, ulLine, "too many data bytes");
+                    }
+                    sAction.ucData[sAction.ulDataSize++] = (t_u8)strtoul(cByte, NULL, 16);
+                    pcToken += 2;
+                }
+            }
+            else if(strcmp(sAction.cAction, "halt") == 0)
+            {
+                sAction.ulValue = strtoul(pcToken, NULL, 0);
+            }
+            else
+            {
+                sAction.ulValue = (strcmp(pcToken, "press") == 0) ? 1 :
+                                  (strcmp(pcToken, "release") == 0) ? 0 :
+                                  (t_u32)(strtod(pcToken, NULL) * 1000);
+            }
+        }
+
+        g_psSimLines = realloc(g_psSimLines, (g_ulSimNbLines + 1) * sizeof(t_sim_action_line));
+        g_psSimLines[g_ulSimNbLines++] = sAction;
+    }
+
+    fclose(pFile);
+}
+
+//*****************************************************************************
+//
+// Run one script action (scheduled at its time).
+//
+//*****************************************************************************
+static void SimScriptAction(void *pvData, t_u32 ulArg)
+{
+    t_sim_action_line *psAction;
+    t_u32 i;
+
+    psAction = (t_sim_action_line *)pvData;
+
+    if(strcmp(psAction->cAction, "plug") == 0)
+    {
+        if(strcmp(psAction->cArg, "accessory") == 0)
+        {
+            SIM_usbPlug(SIM_usbAccessoryDevice());
+            return;
+        }
+        if(strcmp(psAction->cArg, "android") == 0)
+        {
+            g_bSimAndroid = true;
+            SIM_androidPlug();
+            return;
+        }
+        if(strcmp(psAction->cArg, "unknown") == 0)
+        {
+            SIM_usbPlug(SIM_usbUnknownDevice());
+            return;
+        }
+    }
+    else if(strcmp(psAction->cAction, "unplug") == 0)
+    {
+        SIM_usbUnplug();
+        return;
+    }
+    else if(strcmp(psAction->cAction, "power_fault") == 0)
+    {
+        SIM_usbPowerFault();
+        return;
+    }
+    else if(strcmp(psAction->cAction, "in") == 0)
+    {
+        SIM_usbInQueue(strtoul(psAction->cArg, NULL, 0), psAction->ucData, psAction->ulDataSize);
+        return;
+    }
+    else if(strcmp(psAction->cAction, "nak") == 0)
+    {
+        SIM_usbNak(strcmp(psAction->cArg, "in") == 0, SIM_now_us(), SIM_now_us() + psAction->ulValue);
+        return;
+    }
+    else if(strcmp(psAction->cAction, "halt") == 0)
+    {
+        SIM_usbHalt(strcmp(psAction->cArg, "in") == 0, psAction->ulValue);
+        return;
+    }
+    else if(strcmp(psAction->cAction, "button") == 0)
+    {
+        for(i = 0; i < SIM_NB_BUTTONS; i++)
+        {
+            if(strcmp(psAction->cArg, g_sSimButtons[i].pcName) == 0)
+            {
+                // Active low.
+                SIM_gpioInput(g_sSimButtons[i].ulPort, g_sSimButtons[i].ucPin,
+                              psAction->ulValue ? 0 : g_sSimButtons[i].ucPin);
+                return;
+            }
+        }
+    }
+
+    fprintf(stderr, "line %u: unknown action %s %s\n", psAction->ulLine, psAction->cAction, psAction->cArg);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    t_sim_timing sTiming;
+    t_sim_usb_stats sStats;
+    t_sim_dist sLoopUs, sLoopNs;
+    t_sim_android_stats sAndroid;
+    t_sim_dist sButtonUs, sMotorUs;
+    bool bQuiet;
+    t_u32 i;
+    int iArg;
+
+    bQuiet = false;
+    iArg = 1;
+    if((argc > 1) && (strcmp(argv[1], "-q") == 0))
+    {
+        bQuiet = true;
+        iArg++;
+    }
+    if(iArg != (argc - 1))
+    {
+        fprintf(stderr, "usage: %s [-q] script.sim\n", argv[0]);
+        return 1;
+    }
+
+    sTiming = g_sSimTimingDefault;
+    g_sSimAndroidConfig = g_sSimAndroidConfigDefault;
+    SimScriptLoad(argv[iArg], &sTiming);
+
+    SIM_init(&sTiming);
+    SIM_androidInit(&g_sSimAndroidConfig);
+    SIM_uartEcho(!bQuiet);
+    for(i = 0; i < g_ulSimNbLines; i++)
+    {
+        SIM_at(g_psSimLines[i].ullAtUs, SimScriptAction, &g_psSimLines[i], 0);
+    }
+
+    SIM_run(g_ullSimEndUs, firmware_main);
+
+    SIM_usbStats(&sStats);
+    SIM_loopLatency(&sLoopUs, &sLoopNs);
+    printf("end_ms=%u wakeups=%u\n", (t_u32)(SIM_now_us() / 1000), SIM_loopWakeups());
+    printf("usb control=%u in_packets=%u in_bytes=%u out_packets=%u out_bytes=%u in_naks=%u out_naks=%u"
+           " stalls=%u toggle_drops=%u\n",
+           sStats.control_transfers, sStats.in_packets, sStats.in_bytes, sStats.out_packets,
+           sStats.out_bytes, sStats.in_naks, sStats.out_naks, sStats.stalls, sStats.toggle_drops);
+    printf("loop_us p50=%u p90=%u p99=%u max=%u\n", sLoopUs.p50, sLoopUs.p90, sLoopUs.p99, sLoopUs.max);
+    printf("loop_host_ns p50=%u p90=%u p99=%u max=%u\n", sLoopNs.p50, sLoopNs.p90, sLoopNs.p99, sLoopNs.max);
+
+    if(g_bSimAndroid)
+    {
+        SIM_androidStats(&sAndroid);
+        SIM_androidLatency(&sButtonUs, &sMotorUs);
+        printf("android protocol=%u strings=%u starts=%u commands_sent=%u buttons_received=%u"
+               " button_missed=%u motor_missed=%u\n",
+               sAndroid.protocol_requests, sAndroid.strings_received, sAndroid.starts, sAndroid.commands_sent,
+               sAndroid.buttons_received, sAndroid.button_missed, sAndroid.motor_missed);
+        printf("android manufacturer=\"%s\" model=\"%s\" version=\"%s\"\n", SIM_androidString(0),
+               SIM_androidString(1), SIM_androidString(3));
+        printf("button_to_phone_us count=%u p50=%u p90=%u p99=%u max=%u\n", sButtonUs.count, sButtonUs.p50,
+               sButtonUs.p90, sButtonUs.p99, sButtonUs.max);
+        printf("phone_to_motor_us count=%u p50=%u p90=%u p99=%u max=%u\n", sMotorUs.count, sMotorUs.p50,
+               sMotorUs.p90, sMotorUs.p99, sMotorUs.max);
+    }
+
+    return 0;
+}
@@ -0,0 +1,689 @@
+//*****************************************************************************
+//
+// sim_periph.c - Simulated GPIO, UART (uartstdio), motors and OLED display.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "driverlib/uart.h"
+#include "drivers/display96x16x1.h"
+#include "drivers/motor.h"
+#include "usblib/usblib.h"
+#include "utils/uartstdio.h"
+
+#include "usb_android.h"
+#include "sim.h"
+#include "sim_hw.h"
+
+//*****************************************************************************
+//
+// GPIO ports A to F.  The level of an input pin is driven by SIM_gpioInput()
+// (all inputs high at reset, the EvalBot switches are active low with pull
+// ups), an output pin reads its data latch.
+//
+//*****************************************************************************
+typedef struct
+{
+    t_u32 ulBase;
+    t_u32 ulInterrupt;
+    t_u8 ucData;
+    t_u8 ucInput;
+    t_u8 ucDir;
+    t_u8 ucIm;
+    t_u8 ucRis;
+    t_u8 ucIntType[8];
+} t_sim_gpio;
+
+static t_sim_gpio g_sSimGpio[6];
+
+// UART TX buffer of uartstdio (UART_TX_BUFFER_SIZE), drained at the baud rate.
+#define SIM_UART_TX_BUFFER  (1024)
+#define SIM_UART_LINE_MAX   (256)
+
+static t_u32 g_ulSimUartLevel;
+static t_u64 g_ullSimUartUpdate;
+static char g_cSimUartLine[SIM_UART_LINE_MAX];
+static t_u32 g_ulSimUartLineLen;
+static bool g_bSimUartEcho;
+
+// Motors.
+typedef struct
+{
+    bool bRun;
+    tDirection eDir;
+    t_u16 usSpeed;
+} t_sim_motor;
+
+static t_sim_motor g_sSimMotors[2];
+
+// OLED display, one byte per column and line of 8 rows.
+#define SIM_DISPLAY_COLUMNS     (96)
+#define SIM_DISPLAY_LINES       (2)
+#define SIM_DISPLAY_CMD_BYTES   (4) /* Page and column address commands sent before the data */
+
+static t_u8 g_ucSimDisplay[SIM_DISPLAY_LINES][SIM_DISPLAY_COLUMNS];
+static bool g_bSimDisplayOn;
+
+void SimPeriphReset(void)
+{
+    static const t_u32 ulBase[6] =
+    {
+        GPIO_PORTA_BASE, GPIO_PORTB_BASE, GPIO_PORTC_BASE,
+        GPIO_PORTD_BASE, GPIO_PORTE_BASE, GPIO_PORTF_BASE
+    };
+    static const t_u32 ulInterrupt[6] =
+    {
+        INT_GPIOA, INT_GPIOB, INT_GPIOC, INT_GPIOD, INT_GPIOE, INT_GPIOF
+    };
+    t_u32 i;
+
+    memset(g_sSimGpio, 0, sizeof(g_sSimGpio));
+    for(i = 0; i < 6; i++)
+    {
+        g_sSimGpio[i].ulBase = ulBase[i];
+        g_sSimGpio[i].ulInterrupt = ulInterrupt[i];
+        g_sSimGpio[i].ucInput = 0xFF;
+    }
+
+    g_ulSimUartLevel = 0;
+    g_ullSimUartUpdate = 0;
+    g_ulSimUartLineLen = 0;
+    g_bSimUartEcho = false;
+
+    memset(g_sSimMotors, 0, sizeof(g_sSimMotors));
+    memset(g_ucSimDisplay, 0, sizeof(g_ucSimDisplay));
+    g_bSimDisplayOn = false;
+}
+
+//*****************************************************************************
+//
+// GPIO.
+//
+//*****************************************************************************
+static t_sim_gpio *SimGpio(unsigned int ulPort)
+{
+    t_u32 i;
+
+    for(i = 0; i < 6; i++)
+    {
+        if(g_sSimGpio[i].ulBase == ulPort)
+        {
+            return &g_sSimGpio[i];
+        }
+    }
+
+    fprintf(stderr, "sim: GPIO port 0x%08X not simulated\n", ulPort);
+    exit(2);
+}
+
+static t_u8 SimGpioLevel(const t_sim_gpio *psGpio)
+{
+    return (psGpio->ucData & psGpio->ucDir) | (psGpio->ucInput & ~psGpio->ucDir);
+}
+
+static void SimGpioIrqUpdate(t_sim_gpio *psGpio)
+{
+    SimIrqSet(psGpio->ulInterrupt, (psGpio->ucRis & psGpio->ucIm) != 0);
+}
+
+//*****************************************************************************
+//
+// Latch the interrupt of the pins whose level changed from ucOld.
+//
+//*****************************************************************************
+static void SimGpioEdges(t_sim_gpio *psGpio, t_u8 ucOld)
+{
+    t_u8 ucNew;
+    t_u8 ucChanged;
+    t_u32 i;
+
+    ucNew = SimGpioLevel(psGpio);
+    ucChanged = ucOld ^ ucNew;
+
+    for(i = 0; i < 8; i++)
+    {
+        switch(psGpio->ucIntType[i])
+        {
+            case GPIO_BOTH_EDGES:
+                psGpio->ucRis |= ucChanged & (1 << i);
+                break;
+
+            case GPIO_RISING_EDGE:
+                psGpio->ucRis |= ucChanged & ucNew & (1 << i);
+                break;
+
+            case GPIO_LOW_LEVEL:
+                psGpio->ucRis |= ~ucNew & (1 << i);
+                break;
+
+            case GPIO_HIGH_LEVEL:
+                psGpio->ucRis |= ucNew & (1 << i);
+                break;
+
+            default: /* GPIO_FALLING_EDGE */
+                psGpio->ucRis |= ucChanged & ~ucNew & (1 << i);
+                break;
+        }
+    }
+
+    SimGpioIrqUpdate(psGpio);
+}
+
+void GPIODirModeSet(unsigned int ulPort, unsigned char ucPins, unsigned int ulPinIO)
+{
+    t_sim_gpio *psGpio;
+    t_u8 ucOld;
+
+    psGpio = SimGpio(ulPort);
+    ucOld = SimGpioLevel(psGpio);
+    if(ulPinIO == GPIO_DIR_MODE_OUT)
+    {
+        psGpio->ucDir |= ucPins;
+    }
+    else
+    {
+        psGpio->ucDir &= ~ucPins;
+    }
+    SimGpioEdges(psGpio, ucOld);
+}
+
+void GPIOIntTypeSet(unsigned int ulPort, unsigned char ucPins, unsigned int ulIntType)
+{
+    t_sim_gpio *psGpio;
+    t_u32 i;
+
+    psGpio = SimGpio(ulPort);
+    for(i = 0; i < 8; i++)
+    {
+        if(ucPins & (1 << i))
+        {
+            psGpio->ucIntType[i] = (t_u8)ulIntType;
+        }
+    }
+}
+
+void GPIOPadConfigSet(unsigned int ulPort, unsigned char ucPins, unsigned int ulStrength,
+                      unsigned int ulPadType)
+{
+}
+
+void GPIOPinIntEnable(unsigned int ulPort, unsigned char ucPins)
+{
+    t_sim_gpio *psGpio;
+
+    psGpio = SimGpio(ulPort);
+    psGpio->ucIm |= ucPins;
+    SimGpioIrqUpdate(psGpio);
+}
+
+void GPIOPinIntDisable(unsigned int ulPort, unsigned char ucPins)
+{
+    t_sim_gpio *psGpio;
+
+    psGpio = SimGpio(ulPort);
+    psGpio->ucIm &= ~ucPins;
+    SimGpioIrqUpdate(psGpio);
+}
+
+int GPIOPinIntStatus(unsigned int ulPort, tBoolean bMasked)
+{
+    t_sim_gpio *psGpio;
+
+    psGpio = SimGpio(ulPort);
+
+    return bMasked ? (psGpio->ucRis & psGpio->ucIm) : psGpio->ucRis;
+}
+
+void GPIOPinIntClear(unsigned int ulPort, unsigned char ucPins)
+{
+    t_sim_gpio *psGpio;
+
+    psGpio = SimGpio(ulPort);
+    psGpio->ucRis &= ~ucPins;
+    SimGpioIrqUpdate(psGpio);
+}
+
+int GPIOPinRead(unsigned int ulPort, unsigned char ucPins)
+{
+    return SimGpioLevel(SimGpio(ulPort)) & ucPins;
+}
+
+void GPIOPinWrite(unsigned int ulPort, unsigned char ucPins, unsigned char ucVal)
+{
+    t_sim_gpio *psGpio;
+    t_u8 ucOld;
+
+    psGpio = SimGpio(ulPort);
+    ucOld = SimGpioLevel(psGpio);
+    psGpio->ucData = (psGpio->ucData & ~ucPins) | (ucVal & ucPins);
+    SimGpioEdges(psGpio, ucOld);
+
+    if(g_sSimHooks.pfnGpioWrite != NULL)
+    {
+        g_sSimHooks.pfnGpioWrite(ulPort, ucPins, ucVal);
+    }
+}
+
+void GPIOPinTypeGPIOInput(unsigned int ulPort, unsigned char ucPins)
+{
+    GPIODirModeSet(ulPort, ucPins, GPIO_DIR_MODE_IN);
+}
+
+void GPIOPinTypeGPIOOutput(unsigned int ulPort, unsigned char ucPins)
+{
+    GPIODirModeSet(ulPort, ucPins, GPIO_DIR_MODE_OUT);
+}
+
+void GPIOPinTypeUART(unsigned int ulPort, unsigned char ucPins)
+{
+}
+
+void GPIOPinTypeUSBDigital(unsigned int ulPort, unsigned char ucPins)
+{
+}
+
+void GPIOPinConfigure(unsigned int ulPinConfig)
+{
+}
+
+void SIM_gpioInput(t_u32 ulPort, t_u8 ucPins, t_u8 ucValue)
+{
+    t_sim_gpio *psGpio;
+    t_u8 ucOld;
+
+    psGpio = SimGpio(ulPort);
+    ucOld = SimGpioLevel(psGpio);
+    psGpio->ucInput = (psGpio->ucInput & ~ucPins) | (ucValue & ucPins);
+    SimGpioEdges(psGpio, ucOld);
+}
+
+t_u8 SIM_gpioOutput(t_u32 ulPort)
+{
+    t_sim_gpio *psGpio;
+
+    psGpio = SimGpio(ulPort);
+
+    return psGpio->ucData & psGpio->ucDir;
+}
+
+//*****************************************************************************
+//
+// UART console (utils/uartstdio.c API).  The characters are stored in the TX
+// buffer, drained at uart_baud: with UART_BUFFERED a write drops what does
+// not fit, without it the write waits for the UART (blocking time).
+//
+//*****************************************************************************
+static void SimUartDrain(void)
+{
+    t_u64 ullBytes;
+
+    ullBytes = ((g_ullSimCycles - g_ullSimUartUpdate) * (g_sSimTiming.uart_baud / 10)) / SIM_CLOCK_HZ;
+    if(ullBytes == 0)
+    {
+        return;
+    }
+
+    g_ulSimUartLevel = (ullBytes >= g_ulSimUartLevel) ? 0 : (g_ulSimUartLevel - (t_u32)ullBytes);
+    g_ullSimUartUpdate = g_ullSimCycles;
+}
+
+static void SimUartChar(char cChar)
+{
+    if(cChar != '\n')
+    {
+        if(g_ulSimUartLineLen < (SIM_UART_LINE_MAX - 1))
+        {
+            g_cSimUartLine[g_ulSimUartLineLen++] = cChar;
+        }
+        return;
+    }
+
+    g_cSimUartLine[g_ulSimUartLineLen] = 0;
+    g_ulSimUartLineLen = 0;
+
+    if(g_bSimUartEcho)
+    {
+        printf("[%10.3f ms] %s\n", (double)g_ullSimCycles / (SIM_CYCLES_PER_US * 1000), g_cSimUartLine);
+    }
+    if(g_sSimHooks.pfnUartLine != NULL)
+    {
+        g_sSimHooks.pfnUartLine(g_cSimUartLine);
+    }
+}
+
+void UARTStdioInit(unsigned int ulPort)
+{
+    g_ulSimUartLevel = 0;
+    g_ullSimUartUpdate = g_ullSimCycles;
+}
+
+int UARTwrite(const char *pcBuf, unsigned int ulLen)
+{
+    t_u32 ulWritten;
+
+    ulWritten = 0;
+    while(ulWritten < ulLen)
+    {
+        SimUartDrain();
+        if(g_ulSimUartLevel >= SIM_UART_TX_BUFFER)
+        {
+#ifdef UART_BUFFERED
+            break;
+#else
+            SimAdvanceTo(g_ullSimCycles + ((t_u64)SIM_CLOCK_HZ * 10) / g_sSimTiming.uart_baud);
+            continue;
+#endif
+        }
+
+        // uartstdio sends "\r\n" for each "\n".
+        if(pcBuf[ulWritten] == '\n')
+        {
+            g_ulSimUartLevel++;
+        }
+        g_ulSimUartLevel++;
+        SimUartChar(pcBuf[ulWritten]);
+        ulWritten++;
+    }
+
+    return ulWritten;
+}
+
+//*****************************************************************************
+//
+// The uartstdio format subset: %c %d %i %p %s %u %x %X %% with a width and a
+// '0' fill.  Each argument is one 32 bits word, a string is its address.
+//
+//*****************************************************************************
+void UARTprintf(const char *pcString, ...)
+{
+    char cOut[SIM_UART_LINE_MAX + 16];
+    char cNum[16];
+    const char *pcStr;
+    t_u32 ulOut, ulWidth, ulLen, ulValue, ulBase;
+    bool bNeg;
+    char cFill;
+    va_list vaArgP;
+
+    va_start(vaArgP, pcString);
+
+    ulOut = 0;
+    while((*pcString != 0) && (ulOut < SIM_UART_LINE_MAX))
+    {
+        if(*pcString != '%')
+        {
+            cOut[ulOut++] = *pcString++;
+            continue;
+        }
+        pcString++;
+
+        cFill = ' ';
+        if(*pcString == '0')
+        {
+            cFill = '0';
+            pcString++;
+        }
+        ulWidth = 0;
+        while((*pcString >= '0') && (*pcString <= '9'))
+        {
+            ulWidth = (ulWidth * 10) + (*pcString++ - '0');
+        }
+
+        pcStr = cNum;
+        ulLen = 0;
+        bNeg = false;
+        ulBase = 0;
+        switch(*pcString++)
+        {
+            case 'c':
+                cNum[0] = (char)va_arg(vaArgP, unsigned int);
+                ulLen = 1;
+                break;
+
+            case 'd':
+            case 'i':
+                ulValue = va_arg(vaArgP, unsigned int);
+                if((t_i32)ulValue < 0)
+                {
+                    ulValue = -ulValue;
+                    bNeg = true;
+                }
+                ulBase = 10;
+                break;
+
+            case 'u':
+                ulValue = va_arg(vaArgP, unsigned int);
+                ulBase = 10;
+                break;
+
+            case 'x':
+            case 'X':
+            case 'p':
+                ulValue = va_arg(vaArgP, unsigned int);
+                ulBase = 16;
+                break;
+
+            case 's':
+                pcStr = (const char *)(uintptr_t)va_arg(vaArgP, unsigned int);
+                ulLen = (pcStr != NULL) ? strlen(pcStr) : 0;
+                break;
+
+            case '%':
+                cNum[0] = '%';
+                ulLen = 1;
+                break;
+
+            default:
+                cNum[0] = '?';
+                ulLen = 1;
+                pcString--;
+                break;
+        }
+
+        if(ulBase != 0)
+        {
+            char cDigits[12];
+            t_u32 ulDigits = 0;
+
+            do
+            {
+                cDigits[ulDigits++] = "0123456789abcdef"[ulValue % ulBase];
+                ulValue /= ulBase;
+            }while(ulValue != 0);
+
+            if(bNeg && (cFill == '0'))
+            {
+                cNum[ulLen++] = '-';
+            }
+            while((ulLen + ulDigits + ((bNeg && (cFill == ' ')) ? 1 : 0)) < ulWidth)
+            {
+                cNum[ulLen++] = cFill;
+            }
+            if(bNeg && (cFill == ' '))
+            {
+                cNum[ulLen++] = '-';
+            }
+            while(ulDigits != 0)
+            {
+                cNum[ulLen++] = cDigits[--ulDigits];
+            }
+        }
+        else
+        {
+            while((ulWidth > ulLen) && (ulOut < SIM_UART_LINE_MAX))
+            {
+                cOut[ulOut++] = ' ';
+                ulWidth--;
+            }
+        }
+
+        while((ulLen != 0) && (ulOut < SIM_UART_LINE_MAX))
+        {
+            cOut[ulOut++] = *pcStr++;
+            ulLen--;
+        }
+    }
+
+    va_end(vaArgP);
+
+    UARTwrite(cOut, ulOut);
+}
+
+int UARTTxBytesFree(void)
+{
+    SimUartDrain();
+
+    return SIM_UART_TX_BUFFER - g_ulSimUartLevel;
+}
+
+tBoolean UARTBusy(unsigned int ulBase)
+{
+    SimUartDrain();
+
+    return g_ulSimUartLevel != 0;
+}
+
+void UARTStdioIntHandler(void)
+{
+}
+
+void SIM_uartEcho(bool bEcho)
+{
+    g_bSimUartEcho = bEcho;
+}
+
+//*****************************************************************************
+//
+// Motors (drivers/motor.c API), only the commands are recorded.
+//
+//*****************************************************************************
+static void SimMotorHook(tSide eMotor)
+{
+    if(g_sSimHooks.pfnMotor != NULL)
+    {
+        g_sSimHooks.pfnMotor(eMotor, g_sSimMotors[eMotor].bRun, g_sSimMotors[eMotor].eDir,
+                             g_sSimMotors[eMotor].usSpeed);
+    }
+}
+
+void MotorsInit(void)
+{
+    memset(g_sSimMotors, 0, sizeof(g_sSimMotors));
+}
+
+void MotorDir(tSide eMotor, tDirection eDirection)
+{
+    g_sSimMotors[eMotor].eDir = eDirection;
+    SimMotorHook(eMotor);
+}
+
+void MotorRun(tSide eMotor)
+{
+    g_sSimMotors[eMotor].bRun = true;
+    SimMotorHook(eMotor);
+}
+
+void MotorStop(tSide eMotor)
+{
+    g_sSimMotors[eMotor].bRun = false;
+    SimMotorHook(eMotor);
+}
+
+void MotorSpeed(tSide eMotor, unsigned short usPercent)
+{
+    g_sSimMotors[eMotor].usSpeed = usPercent;
+    SimMotorHook(eMotor);
+}
+
+void SIM_motorGet(tSide eSide, bool *pbRun, tDirection *peDir, t_u16 *pusSpeed)
+{
+    *pbRun = g_sSimMotors[eSide].bRun;
+    *peDir = g_sSimMotors[eSide].eDir;
+    *pusSpeed = g_sSimMotors[eSide].usSpeed;
+}
+
+//*****************************************************************************
+//
+// OLED display (drivers/display96x16x1.c API).  The driver waits for its bus
+// transfers: each call takes display_byte_us per byte sent, the interrupts
+// are serviced meanwhile.
+//
+//*****************************************************************************
+static void SimDisplayBus(t_u32 ulBytes)
+{
+    SimAdvanceTo(g_ullSimCycles + SIM_US_TO_CYCLES(ulBytes * g_sSimTiming.display_byte_us));
+}
+
+void Display96x16x1Init(tBoolean bFast)
+{
+    memset(g_ucSimDisplay, 0, sizeof(g_ucSimDisplay));
+    SimDisplayBus(32);
+}
+
+void Display96x16x1Clear(void)
+{
+    memset(g_ucSimDisplay, 0, sizeof(g_ucSimDisplay));
+    SimDisplayBus(SIM_DISPLAY_LINES * (SIM_DISPLAY_COLUMNS + SIM_DISPLAY_CMD_BYTES));
+}
+
+void Display96x16x1ClearLine(unsigned int ulY)
+{
+    if(ulY < SIM_DISPLAY_LINES)
+    {
+        memset(g_ucSimDisplay[ulY], 0, SIM_DISPLAY_COLUMNS);
+    }
+    SimDisplayBus(SIM_DISPLAY_COLUMNS + SIM_DISPLAY_CMD_BYTES);
+}
+
+void Display96x16x1StringDraw(const char *pcStr, unsigned int ulX, unsigned int ulY)
+{
+    t_u32 ulColumns;
+
+    // The text itself is not rendered, only its bus time is simulated.
+    ulColumns = strlen(pcStr) * CHAR_CELL_WIDTH;
+    if((ulX + ulColumns) > SIM_DISPLAY_COLUMNS)
+    {
+        ulColumns = (ulX < SIM_DISPLAY_COLUMNS) ? (SIM_DISPLAY_COLUMNS - ulX) : 0;
+    }
+    SimDisplayBus(ulColumns + SIM_DISPLAY_CMD_BYTES);
+}
+
+void Display96x16x1ImageDraw(const unsigned char *pucImage, unsigned int ulX, unsigned int ulY,
+                             unsigned int ulWidth, unsigned int ulHeight)
+{
+    t_u32 ulLine, ulCol;
+
+    for(ulLine = 0; ulLine < ulHeight; ulLine++)
+    {
+        for(ulCol = 0; ulCol < ulWidth; ulCol++)
+        {
+            if(((ulY + ulLine) < SIM_DISPLAY_LINES) && ((ulX + ulCol) < SIM_DISPLAY_COLUMNS))
+            {
+                g_ucSimDisplay[ulY + ulLine][ulX + ulCol] = pucImage[(ulLine * ulWidth) + ulCol];
+            }
+        }
+    }
+    SimDisplayBus(ulHeight * (ulWidth + SIM_DISPLAY_CMD_BYTES));
+}
+
+void Display96x16x1DisplayOn(void)
+{
+    g_bSimDisplayOn = true;
+    SimDisplayBus(2);
+}
+
+void Display96x16x1DisplayOff(void)
+{
+    g_bSimDisplayOn = false;
+    SimDisplayBus(2);
+}
@@ -0,0 +1,1574 @@
+//*****************************************************************************
+//
+// sim_usb.c - Simulated USB host controller, usblib host stack and bus.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/usb.h"
+#include "drivers/motor.h"
+#include "usblib/usblib.h"
+#include "usblib/host/usbhost.h"
+
+#include "usb_android.h"
+#include "sim.h"
+#include "sim_hw.h"
+
+/*
+ * Bus model (Full Speed, one transaction at a time):
+ * - a Bulk transaction takes usb_packet_us plus its data at 12Mbit/s, it
+ *   starts once the bus is free and the device does not NAK (SIM_usbNak()),
+ *   an IN transaction also waits for a packet queued by the device,
+ * - a halted endpoint (SIM_usbHalt()) answers STALL until the host clears
+ *   it with CLEAR_FEATURE(ENDPOINT_HALT), which also resets the data toggle
+ *   of the device endpoint (as SET_CONFIGURATION does for all of them),
+ * - the host pipe and the device endpoint toggle DATA0/DATA1 on each packet
+ *   acknowledged, a packet of the unexpected toggle is taken as a
+ *   retransmission: acknowledged and dropped (data lost),
+ * - a control transfer takes usb_stage_us per stage (setup, each data
+ *   packet, status) plus the device processing time, the caller waits for it
+ *   (blocking as in usblib), the interrupts are serviced meanwhile,
+ * - the firmware takes usb_rx_packet_cycles plus usb_rx_byte_cycles per byte
+ *   to handle each Bulk IN packet, charged when the packet is read from the
+ *   FIFO (the decoding in the main loop is not separated from the interrupt).
+ * Stack model (usblib OTG host): a plugged cable is seen on the next session
+ * poll of USBOTGMain(), the device connection raises the USB interrupt and
+ * the next USBOTGMain() resets (usb_reset_ms, blocking) and enumerates the
+ * device, then opens the class driver of its first interface (the events
+ * driver gets USB_EVENT_CONNECTED if none matches).  A device removal is
+ * handled the same way: interrupt, then close from USBOTGMain().  A VBUS
+ * power fault (SIM_usbPowerFault()) is raised by the interrupt and sent as
+ * USB_EVENT_POWER_FAULT to the events driver by the next USBOTGMain(), the
+ * device loses its power (removal) and the session ends, the power switch
+ * stays off until the cable is unplugged.
+ */
+#define SIM_USB_PIPES           (3)
+#define SIM_USB_ENDPOINTS       (16)
+#define SIM_USB_MAX_PACKET      (64)
+#define SIM_USB_DEV_ADDRESS     (1)
+#define SIM_USB_VBUS_RISE_US    (1000) /* Session start to VBUS valid and device connection seen */
+
+// USB interrupt sources of the controller.
+#define SIM_USB_INT_SESSION_START   (0x01)
+#define SIM_USB_INT_SESSION_END     (0x02)
+#define SIM_USB_INT_CONNECT         (0x04)
+#define SIM_USB_INT_DISCONNECT      (0x08)
+#define SIM_USB_INT_POWER_FAULT     (0x10)
+
+typedef struct
+{
+    bool bUsed;
+    t_u32 ulType;
+    t_u32 ulIndex;
+    t_u32 ulEndpoint;
+    t_u32 ulMaxPayload;
+    tHCDPipeCallback pfnCallback;
+
+    // Incremented when the pipe is allocated, freed or flushed: the
+    // transactions of the previous generation are dropped.
+    t_u32 ulGen;
+    bool bActive;
+    bool bWaiting;
+
+    t_u8 ucFifo[SIM_USB_MAX_PACKET];
+    t_u32 ulFifoCount;
+
+    bool bEventPending;
+    t_u32 ulEvent;
+
+    // Data toggle of the next packet, kept by the controller endpoint across
+    // the pipe allocations, cleared by USBHCDPipeConfig().
+    t_u8 ucToggle;
+} t_sim_pipe;
+
+typedef struct t_sim_packet
+{
+    struct t_sim_packet *psNext;
+    t_u32 ulSize;
+    t_u8 ucData[SIM_USB_MAX_PACKET];
+} t_sim_packet;
+
+typedef struct
+{
+    t_u64 ullStart;
+    t_u64 ullEnd;
+} t_sim_nak;
+
+typedef struct
+{
+    t_sim_nak *psPeriods;
+    t_u32 ulCount;
+    t_u32 ulSize;
+} t_sim_nak_list;
+
+static t_sim_pipe g_sSimInPipes[SIM_USB_PIPES];
+static t_sim_pipe g_sSimOutPipes[SIM_USB_PIPES];
+
+static t_sim_packet *g_psSimInHead[SIM_USB_ENDPOINTS];
+static t_sim_packet *g_psSimInTail[SIM_USB_ENDPOINTS];
+
+static t_sim_nak_list g_sSimNak[2]; /* OUT, IN */
+
+// Device endpoints halt and data toggle.
+static bool g_bSimHalt[2][SIM_USB_ENDPOINTS]; /* OUT, IN */
+static t_u8 g_ucSimToggle[2][SIM_USB_ENDPOINTS]; /* OUT, IN */
+
+static t_u64 g_ullSimBusFree;
+static t_sim_usb_stats g_sSimUsbStats;
+
+// Cable, device and controller state.
+static bool g_bSimCable;
+static bool g_bSimSession;
+static bool g_bSimPowerFault; // VBUS switch off after a fault, until the cable is unplugged
+static const t_sim_usb_device *g_psSimDevice;
+static t_u32 g_ulSimUsbInt;
+
+// Host stack state.
+static tUSBModeCallback g_pfnSimModeCallback;
+static const tUSBHostClassDriver * const *g_ppsSimDrivers;
+static t_u32 g_ulSimNbDrivers;
+static t_u8 *g_pucSimHostPool;
+static t_u32 g_ulSimHostPoolSize;
+static t_u32 g_ulSimPollMs;
+static t_u32 g_ulSimPollElapsedMs;
+
+static bool g_bSimStackConnect;
+static bool g_bSimStackDisconnect;
+static bool g_bSimStackEnumerated;
+static bool g_bSimStackPowerFault;
+static const tUSBHostClassDriver *g_psSimOpenDriver;
+static void *g_pvSimOpenInstance;
+static tUSBHostDevice g_sSimHostDevice;
+
+static void SimUsbInTry(void *pvData, t_u32 ulGen);
+
+static void SimUsbEndpointsReset(void)
+{
+    memset(g_bSimHalt, 0, sizeof(g_bSimHalt));
+    memset(g_ucSimToggle, 0, sizeof(g_ucSimToggle));
+}
+
+void SimUsbReset(void)
+{
+    t_sim_packet *psPacket;
+    t_u32 i;
+
+    memset(g_sSimInPipes, 0, sizeof(g_sSimInPipes));
+    memset(g_sSimOutPipes, 0, sizeof(g_sSimOutPipes));
+    for(i = 0; i < SIM_USB_PIPES; i++)
+    {
+        g_sSimInPipes[i].ulIndex = i;
+        g_sSimOutPipes[i].ulIndex = i;
+    }
+
+    for(i = 0; i < SIM_USB_ENDPOINTS; i++)
+    {
+        while(g_psSimInHead[i] != NULL)
+        {
+            psPacket = g_psSimInHead[i];
+            g_psSimInHead[i] = psPacket->psNext;
+            free(psPacket);
+        }
+        g_psSimInTail[i] = NULL;
+    }
+
+    for(i = 0; i < 2; i++)
+    {
+        free(g_sSimNak[i].psPeriods);
+        memset(&g_sSimNak[i], 0, sizeof(g_sSimNak[i]));
+    }
+    SimUsbEndpointsReset();
+
+    g_ullSimBusFree = 0;
+    memset(&g_sSimUsbStats, 0, sizeof(g_sSimUsbStats));
+
+    g_bSimCable = false;
+    g_bSimSession = false;
+    g_bSimPowerFault = false;
+    g_psSimDevice = NULL;
+    g_ulSimUsbInt = 0;
+
+    g_pfnSimModeCallback = NULL;
+    g_ppsSimDrivers = NULL;
+    g_ulSimNbDrivers = 0;
+    g_pucSimHostPool = NULL;
+    g_ulSimHostPoolSize = 0;
+    g_ulSimPollMs = 0;
+    g_ulSimPollElapsedMs = 0;
+
+    g_bSimStackConnect = false;
+    g_bSimStackDisconnect = false;
+    g_bSimStackEnumerated = false;
+    g_bSimStackPowerFault = false;
+    g_psSimOpenDriver = NULL;
+    g_pvSimOpenInstance = NULL;
+    memset(&g_sSimHostDevice, 0, sizeof(g_sSimHostDevice));
+}
+
+//*****************************************************************************
+//
+// USB interrupt line: controller sources or a pipe event not yet handled.
+//
+//*****************************************************************************
+static void SimUsbIrqUpdate(void)
+{
+    bool bAsserted;
+    t_u32 i;
+
+    bAsserted = (g_ulSimUsbInt != 0);
+    for(i = 0; i < SIM_USB_PIPES; i++)
+    {
+        bAsserted |= g_sSimInPipes[i].bEventPending | g_sSimOutPipes[i].bEventPending;
+    }
+
+    SimIrqSet(INT_USB0, bAsserted);
+}
+
+static void SimUsbPipeEvent(t_sim_pipe *psPipe, t_u32 ulEvent)
+{
+    psPipe->bEventPending = true;
+    psPipe->ulEvent = ulEvent;
+    SimUsbIrqUpdate();
+}
+
+static t_sim_pipe *SimUsbPipe(unsigned int ulPipe)
+{
+    t_sim_pipe *psPipes;
+
+    psPipes = (ulPipe & EP_PIPE_TYPE_IN) ? g_sSimInPipes : g_sSimOutPipes;
+    if((ulPipe & 0xFF) >= SIM_USB_PIPES)
+    {
+        return NULL;
+    }
+
+    return &psPipes[ulPipe & 0xFF];
+}
+
+static t_u32 SimUsbPipeHandle(const t_sim_pipe *psPipe)
+{
+    return psPipe->ulType | psPipe->ulIndex;
+}
+
+//*****************************************************************************
+//
+// Return the end of the NAK period of a direction at the given time, 0 if the
+// device does not NAK at that time.
+//
+//*****************************************************************************
+static t_u64 SimUsbNakEnd(bool bIn, t_u64 ullAt)
+{
+    t_sim_nak_list *psList;
+    t_u64 ullEnd;
+    t_u32 i;
+    bool bFound;
+
+    psList = &g_sSimNak[bIn ? 1 : 0];
+    ullEnd = 0;
+    do
+    {
+        bFound = false;
+        for(i = 0; i < psList->ulCount; i++)
+        {
+            if((psList->psPeriods[i].ullStart <= ullAt) && (ullAt < psList->psPeriods[i].ullEnd))
+            {
+                ullAt = psList->psPeriods[i].ullEnd;
+                ullEnd = ullAt;
+                bFound = true;
+            }
+        }
+    }while(bFound);
+
+    // Forget the periods already over.
+    i = 0;
+    while(i < psList->ulCount)
+    {
+        if(psList->psPeriods[i].ullEnd <= g_ullSimCycles)
+        {
+            psList->psPeriods[i] = psList->psPeriods[--psList->ulCount];
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return ullEnd;
+}
+
+static t_u64 SimUsbPacketCycles(t_u32 ulSize)
+{
+    // Data at 12Mbit/s: 8 bits per byte at 12 bits per us.
+    return SIM_US_TO_CYCLES(g_sSimTiming.usb_packet_us) + (((t_u64)ulSize * 8 * SIM_CYCLES_PER_US) / 12);
+}
+
+//*****************************************************************************
+//
+// Transaction stalled by a halted endpoint (handshake only), the pipe stops.
+//
+//*****************************************************************************
+static void SimUsbStall(void *pvData, t_u32 ulGen)
+{
+    t_sim_pipe *psPipe;
+
+    psPipe = (t_sim_pipe *)pvData;
+    if((psPipe->ulGen != ulGen) || !psPipe->bActive)
+    {
+        return;
+    }
+
+    psPipe->bActive = false;
+    psPipe->ulFifoCount = 0;
+    g_sSimUsbStats.stalls++;
+    SimUsbPipeEvent(psPipe, USB_EVENT_STALL);
+}
+
+static bool SimUsbHalted(t_sim_pipe *psPipe, bool bIn, t_u32 ulGen)
+{
+    t_u64 ullEnd;
+
+    if(!g_bSimHalt[bIn ? 1 : 0][psPipe->ulEndpoint])
+    {
+        return false;
+    }
+
+    ullEnd = g_ullSimCycles + SimUsbPacketCycles(0);
+    g_ullSimBusFree = ullEnd;
+    SimAtCycles(ullEnd, SimUsbStall, psPipe, ulGen);
+
+    return true;
+}
+
+//*****************************************************************************
+//
+// Bulk IN transactions.
+//
+//*****************************************************************************
+static void SimUsbInDone(void *pvData, t_u32 ulGen)
+{
+    t_sim_pipe *psPipe;
+
+    psPipe = (t_sim_pipe *)pvData;
+    if((psPipe->ulGen != ulGen) || !psPipe->bActive)
+    {
+        return;
+    }
+
+    psPipe->bActive = false;
+    g_sSimUsbStats.in_packets++;
+    g_sSimUsbStats.in_bytes += psPipe->ulFifoCount;
+    SimUsbPipeEvent(psPipe, USB_EVENT_RX_AVAILABLE);
+}
+
+static void SimUsbInTry(void *pvData, t_u32 ulGen)
+{
+    t_sim_pipe *psPipe;
+    t_sim_packet *psPacket;
+    t_u64 ullNak;
+    t_u64 ullEnd;
+    t_u8 ucToggle;
+
+    psPipe = (t_sim_pipe *)pvData;
+    if((psPipe->ulGen != ulGen) || !psPipe->bActive)
+    {
+        return;
+    }
+    psPipe->bWaiting = false;
+
+    if(g_psSimDevice == NULL)
+    {
+        psPipe->bWaiting = true;
+        return;
+    }
+
+    if(g_ullSimCycles < g_ullSimBusFree)
+    {
+        SimAtCycles(g_ullSimBusFree, SimUsbInTry, psPipe, ulGen);
+        return;
+    }
+
+    ullNak = SimUsbNakEnd(true, g_ullSimCycles);
+    if(ullNak != 0)
+    {
+        g_sSimUsbStats.in_naks++;
+        SimAtCycles(ullNak, SimUsbInTry, psPipe, ulGen);
+        return;
+    }
+
+    if(SimUsbHalted(psPipe, true, ulGen))
+    {
+        return;
+    }
+
+    // Nothing to send, the device NAKs until a packet is queued.
+    psPacket = g_psSimInHead[psPipe->ulEndpoint];
+    if(psPacket == NULL)
+    {
+        psPipe->bWaiting = true;
+        return;
+    }
+    g_psSimInHead[psPipe->ulEndpoint] = psPacket->psNext;
+    if(g_psSimInHead[psPipe->ulEndpoint] == NULL)
+    {
+        g_psSimInTail[psPipe->ulEndpoint] = NULL;
+    }
+
+    ullEnd = g_ullSimCycles + SimUsbPacketCycles(psPacket->ulSize);
+    g_ullSimBusFree = ullEnd;
+
+    // The device sent the packet and gets the handshake in any case.
+    ucToggle = g_ucSimToggle[1][psPipe->ulEndpoint];
+    g_ucSimToggle[1][psPipe->ulEndpoint] ^= 1;
+    if(ucToggle != psPipe->ucToggle)
+    {
+        g_sSimUsbStats.toggle_drops++;
+        free(psPacket);
+        SimAtCycles(ullEnd, SimUsbInTry, psPipe, ulGen);
+        return;
+    }
+    psPipe->ucToggle ^= 1;
+
+    memcpy(psPipe->ucFifo, psPacket->ucData, psPacket->ulSize);
+    psPipe->ulFifoCount = psPacket->ulSize;
+    free(psPacket);
+
+    SimAtCycles(ullEnd, SimUsbInDone, psPipe, ulGen);
+}
+
+//*****************************************************************************
+//
+// Bulk OUT transactions.
+//
+//*****************************************************************************
+static void SimUsbOutDone(void *pvData, t_u32 ulGen)
+{
+    t_sim_pipe *psPipe;
+    t_u8 ucToggle;
+
+    psPipe = (t_sim_pipe *)pvData;
+    if((psPipe->ulGen != ulGen) || !psPipe->bActive)
+    {
+        return;
+    }
+
+    psPipe->bActive = false;
+    g_sSimUsbStats.out_packets++;
+    g_sSimUsbStats.out_bytes += psPipe->ulFifoCount;
+
+    // The host sees the handshake in any case.
+    ucToggle = psPipe->ucToggle;
+    psPipe->ucToggle ^= 1;
+    if(ucToggle != g_ucSimToggle[0][psPipe->ulEndpoint])
+    {
+        g_sSimUsbStats.toggle_drops++;
+    }
+    else
+    {
+        g_ucSimToggle[0][psPipe->ulEndpoint] ^= 1;
+        if((g_psSimDevice != NULL) && (g_psSimDevice->pfnBulkOut != NULL))
+        {
+            g_psSimDevice->pfnBulkOut(g_psSimDevice->pvDevice, psPipe->ulEndpoint, psPipe->ucFifo,
+                                      psPipe->ulFifoCount);
+        }
+    }
+    SimUsbPipeEvent(psPipe, USB_EVENT_TX_COMPLETE);
+}
+
+static void SimUsbOutTry(void *pvData, t_u32 ulGen)
+{
+    t_sim_pipe *psPipe;
+    t_u64 ullNak;
+    t_u64 ullEnd;
+
+    psPipe = (t_sim_pipe *)pvData;
+    if((psPipe->ulGen != ulGen) || !psPipe->bActive)
+    {
+        return;
+    }
+
+    // No device: the transfer never completes (usblib has no NAK limit on this pipe).
+    if(g_psSimDevice == NULL)
+    {
+        return;
+    }
+
+    if(g_ullSimCycles < g_ullSimBusFree)
+    {
+        SimAtCycles(g_ullSimBusFree, SimUsbOutTry, psPipe, ulGen);
+        return;
+    }
+
+    ullNak = SimUsbNakEnd(false, g_ullSimCycles);
+    if(ullNak != 0)
+    {
+        g_sSimUsbStats.out_naks++;
+        SimAtCycles(ullNak, SimUsbOutTry, psPipe, ulGen);
+        return;
+    }
+
+    if(SimUsbHalted(psPipe, false, ulGen))
+    {
+        return;
+    }
+
+    ullEnd = g_ullSimCycles + SimUsbPacketCycles(psPipe->ulFifoCount);
+    g_ullSimBusFree = ullEnd;
+    SimAtCycles(ullEnd, SimUsbOutDone, psPipe, ulGen);
+}
+
+//*****************************************************************************
+//
+// Host controller driver pipes API.
+//
+//*****************************************************************************
+unsigned int USBHCDPipeAllocSize(unsigned int ulIndex, unsigned int ulEndpointType,
+                                 unsigned int ulDevAddr, unsigned int ulFIFOSize,
+                                 tHCDPipeCallback pCallback)
+{
+    t_sim_pipe *psPipes;
+    t_u32 i;
+
+    psPipes = (ulEndpointType & EP_PIPE_TYPE_IN) ? g_sSimInPipes : g_sSimOutPipes;
+    for(i = 0; i < SIM_USB_PIPES; i++)
+    {
+        if(!psPipes[i].bUsed)
+        {
+            psPipes[i].bUsed = true;
+            psPipes[i].ulType = ulEndpointType;
+            psPipes[i].ulEndpoint = 0;
+            psPipes[i].ulMaxPayload = SIM_USB_MAX_PACKET;
+            psPipes[i].pfnCallback = pCallback;
+            psPipes[i].ulGen++;
+            psPipes[i].bActive = false;
+            psPipes[i].bWaiting = false;
+            psPipes[i].ulFifoCount = 0;
+            psPipes[i].bEventPending = false;
+
+            return SimUsbPipeHandle(&psPipes[i]);
+        }
+    }
+
+    return 0;
+}
+
+unsigned int USBHCDPipeAlloc(unsigned int ulIndex, unsigned int ulEndpointType,
+                             unsigned int ulDevAddr, tHCDPipeCallback pCallback)
+{
+    return USBHCDPipeAllocSize(ulIndex, ulEndpointType, ulDevAddr, SIM_USB_MAX_PACKET, pCallback);
+}
+
+unsigned int USBHCDPipeConfig(unsigned int ulPipe, unsigned int ulMaxPayload,
+                              unsigned int ulInterval, unsigned int ulTargetEndpoint)
+{
+    t_sim_pipe *psPipe;
+
+    psPipe = SimUsbPipe(ulPipe);
+    if(psPipe == NULL)
+    {
+        return 0;
+    }
+
+    psPipe->ulMaxPayload = (ulMaxPayload < SIM_USB_MAX_PACKET) ? ulMaxPayload : SIM_USB_MAX_PACKET;
+    psPipe->ulEndpoint = ulTargetEndpoint & (SIM_USB_ENDPOINTS - 1);
+    psPipe->ucToggle = 0;
+
+    return 0;
+}
+
+void USBHCDPipeFree(unsigned int ulPipe)
+{
+    t_sim_pipe *psPipe;
+
+    psPipe = SimUsbPipe(ulPipe);
+    if(psPipe == NULL)
+    {
+        return;
+    }
+
+    psPipe->bUsed = false;
+    psPipe->ulGen++;
+    psPipe->bActive = false;
+    psPipe->bWaiting = false;
+    psPipe->bEventPending = false;
+    SimUsbIrqUpdate();
+}
+
+unsigned int USBHCDPipeSchedule(unsigned int ulPipe, unsigned char *pData, unsigned int ulSize)
+{
+    t_sim_pipe *psPipe;
+
+    psPipe = SimUsbPipe(ulPipe);
+    if((psPipe == NULL) || !psPipe->bUsed)
+    {
+        return 0;
+    }
+
+    psPipe->bActive = true;
+    psPipe->bWaiting = false;
+    if(ulPipe & EP_PIPE_TYPE_IN)
+    {
+        psPipe->ulFifoCount = 0;
+        SimAtCycles(g_ullSimCycles, SimUsbInTry, psPipe, psPipe->ulGen);
+    }
+    else
+    {
+        if(ulSize > psPipe->ulMaxPayload)
+        {
+            ulSize = psPipe->ulMaxPayload;
+        }
+        memcpy(psPipe->ucFifo, pData, ulSize);
+        psPipe->ulFifoCount = ulSize;
+        SimAtCycles(g_ullSimCycles, SimUsbOutTry, psPipe, psPipe->ulGen);
+    }
+
+    return ulSize;
+}
+
+unsigned int USBHCDPipeReadNonBlocking(unsigned int ulPipe, unsigned char *pData, unsigned int ulSize)
+{
+    t_sim_pipe *psPipe;
+
+    psPipe = SimUsbPipe(ulPipe);
+    if(psPipe == NULL)
+    {
+        return 0;
+    }
+
+    if(ulSize > psPipe->ulFifoCount)
+    {
+        ulSize = psPipe->ulFifoCount;
+    }
+    memcpy(pData, psPipe->ucFifo, ulSize);
+    psPipe->ulFifoCount = 0;
+
+    // Firmware load of the received packet.
+    if((ulPipe & EP_PIPE_TYPE_IN) && (ulSize != 0))
+    {
+        SimAdvanceTo(g_ullSimCycles + g_sSimTiming.usb_rx_packet_cycles +
+                     ((t_u64)ulSize * g_sSimTiming.usb_rx_byte_cycles));
+    }
+
+    return ulSize;
+}
+
+//*****************************************************************************
+//
+// Wait for the transfer of a pipe (blocking usblib calls), false if the
+// device was removed meanwhile.
+//
+//*****************************************************************************
+static bool SimUsbPipeWait(t_sim_pipe *psPipe)
+{
+    while(psPipe->bActive)
+    {
+        if(g_psSimDevice == NULL)
+        {
+            return false;
+        }
+        SimAdvanceTo(g_ullSimCycles + SIM_US_TO_CYCLES(10));
+    }
+
+    return true;
+}
+
+unsigned int USBHCDPipeWrite(unsigned int ulPipe, unsigned char *pData, unsigned int ulSize)
+{
+    t_sim_pipe *psPipe;
+    t_u32 ulDone, ulPacket;
+
+    psPipe = SimUsbPipe(ulPipe);
+    if(psPipe == NULL)
+    {
+        return 0;
+    }
+
+    ulDone = 0;
+    while(ulDone < ulSize)
+    {
+        ulPacket = USBHCDPipeSchedule(ulPipe, pData + ulDone, ulSize - ulDone);
+        if((ulPacket == 0) || !SimUsbPipeWait(psPipe))
+        {
+            break;
+        }
+        psPipe->bEventPending = false;
+        ulDone += ulPacket;
+    }
+    SimUsbIrqUpdate();
+
+    return ulDone;
+}
+
+unsigned int USBHCDPipeRead(unsigned int ulPipe, unsigned char *pData, unsigned int ulSize)
+{
+    t_sim_pipe *psPipe;
+    t_u32 ulDone, ulPacket;
+
+    psPipe = SimUsbPipe(ulPipe);
+    if(psPipe == NULL)
+    {
+        return 0;
+    }
+
+    ulDone = 0;
+    while(ulDone < ulSize)
+    {
+        USBHCDPipeSchedule(ulPipe, NULL, 0);
+        if(!SimUsbPipeWait(psPipe))
+        {
+            break;
+        }
+        psPipe->bEventPending = false;
+        ulPacket = USBHCDPipeReadNonBlocking(ulPipe, pData + ulDone, ulSize - ulDone);
+        ulDone += ulPacket;
+
+        // A short packet ends the transfer.
+        if(ulPacket < psPipe->ulMaxPayload)
+        {
+            break;
+        }
+    }
+    SimUsbIrqUpdate();
+
+    return ulDone;
+}
+
+//*****************************************************************************
+//
+// Controller endpoints FIFO access (driverlib usb.c), host endpoint n is the
+// pipe n - 1.
+//
+//*****************************************************************************
+unsigned int USBEndpointDataAvail(unsigned int ulBase, unsigned int ulEndpoint)
+{
+    t_u32 ulIdx;
+
+    ulIdx = (ulEndpoint >> 4) - 1;
+    if(ulIdx >= SIM_USB_PIPES)
+    {
+        return 0;
+    }
+
+    return g_sSimInPipes[ulIdx].ulFifoCount;
+}
+
+int USBEndpointDataGet(unsigned int ulBase, unsigned int ulEndpoint, unsigned char *pucData,
+                       unsigned int *pulSize)
+{
+    t_u32 ulIdx;
+
+    ulIdx = (ulEndpoint >> 4) - 1;
+    if(ulIdx >= SIM_USB_PIPES)
+    {
+        *pulSize = 0;
+        return -1;
+    }
+
+    *pulSize = USBHCDPipeReadNonBlocking(EP_PIPE_TYPE_IN | ulIdx, pucData, *pulSize);
+
+    return 0;
+}
+
+void USBEndpointDataToggleClear(unsigned int ulBase, unsigned int ulEndpoint, unsigned int ulFlags)
+{
+    t_u32 ulIdx;
+
+    ulIdx = (ulEndpoint >> 4) - 1;
+    if(ulIdx >= SIM_USB_PIPES)
+    {
+        return;
+    }
+
+    if(ulFlags & USB_EP_HOST_OUT)
+    {
+        g_sSimOutPipes[ulIdx].ucToggle = 0;
+    }
+    else
+    {
+        g_sSimInPipes[ulIdx].ucToggle = 0;
+    }
+}
+
+void USBFIFOFlush(unsigned int ulBase, unsigned int ulEndpoint, unsigned int ulFlags)
+{
+    t_sim_pipe *psPipe;
+    t_u32 ulIdx;
+
+    ulIdx = (ulEndpoint >> 4) - 1;
+    if(ulIdx >= SIM_USB_PIPES)
+    {
+        return;
+    }
+
+    psPipe = (ulFlags & USB_EP_HOST_OUT) ? &g_sSimOutPipes[ulIdx] : &g_sSimInPipes[ulIdx];
+    psPipe->ulGen++;
+    psPipe->bActive = false;
+    psPipe->bWaiting = false;
+    psPipe->ulFifoCount = 0;
+}
+
+//*****************************************************************************
+//
+// Control transfers on the default pipe.  The standard requests of the
+// enumeration are answered from the device descriptors, the other ones by
+// the device handler.
+//
+//*****************************************************************************
+static int SimUsbDeviceRequest(const t_sim_usb_device *psDevice, const tUSBRequest *psSetup,
+                               t_u8 *pucData, t_u32 ulSize)
+{
+    t_u32 ulLen;
+    t_u32 ulDir;
+
+    if((psSetup->bmRequestType & USB_RTYPE_TYPE_M) != USB_RTYPE_STANDARD)
+    {
+        if(psDevice->pfnControl == NULL)
+        {
+            return SIM_USB_STALL;
+        }
+        return psDevice->pfnControl(psDevice->pvDevice, psSetup, pucData, ulSize);
+    }
+
+    // A new configuration resets all the endpoints, CLEAR_FEATURE(ENDPOINT_HALT) one of them.
+    if(psSetup->bRequest == USBREQ_SET_CONFIG)
+    {
+        SimUsbEndpointsReset();
+        return 0;
+    }
+    if(psSetup->bRequest == USBREQ_CLEAR_FEATURE)
+    {
+        if(((psSetup->bmRequestType & USB_RTYPE_RECIPIENT_M) != USB_RTYPE_ENDPOINT) ||
+           (psSetup->wValue != USB_FEATURE_EP_HALT))
+        {
+            return SIM_USB_STALL;
+        }
+        ulDir = (psSetup->wIndex & USB_RTYPE_DIR_IN) ? 1 : 0;
+        g_bSimHalt[ulDir][psSetup->wIndex & (SIM_USB_ENDPOINTS - 1)] = false;
+        g_ucSimToggle[ulDir][psSetup->wIndex & (SIM_USB_ENDPOINTS - 1)] = 0;
+        return 0;
+    }
+    if(psSetup->bRequest != USBREQ_GET_DESCRIPTOR)
+    {
+        return 0;
+    }
+
+    switch(psSetup->wValue >> 8)
+    {
+        case USB_DTYPE_DEVICE:
+            ulLen = sizeof(tDeviceDescriptor);
+            memcpy(pucData, psDevice->pucDeviceDesc, (ulSize < ulLen) ? ulSize : ulLen);
+            break;
+
+        case USB_DTYPE_CONFIGURATION:
+            ulLen = ((const tConfigDescriptor *)psDevice->pucConfigDesc)->wTotalLength;
+            memcpy(pucData, psDevice->pucConfigDesc, (ulSize < ulLen) ? ulSize : ulLen);
+            break;
+
+        default:
+            return SIM_USB_STALL;
+    }
+
+    return (ulSize < ulLen) ? ulSize : ulLen;
+}
+
+unsigned int USBHCDControlTransfer(unsigned int ulIndex, tUSBRequest *pSetupPacket,
+                                   unsigned int ulDevAddress, unsigned char *pData,
+                                   unsigned int ulSize, unsigned int ulMaxPacketSize)
+{
+    const t_sim_usb_device *psDevice;
+    t_u64 ullStage;
+    t_u32 ulPackets;
+    bool bIn;
+    int iLen;
+
+    psDevice = g_psSimDevice;
+    if(psDevice == NULL)
+    {
+        return 0;
+    }
+
+    g_sSimUsbStats.control_transfers++;
+    bIn = (pSetupPacket->bmRequestType & USB_RTYPE_DIR_IN) != 0;
+    if(ulSize > pSetupPacket->wLength)
+    {
+        ulSize = pSetupPacket->wLength;
+    }
+    if(ulMaxPacketSize == 0)
+    {
+        ulMaxPacketSize = MAX_PACKET_SIZE_EP0;
+    }
+    ullStage = SIM_US_TO_CYCLES(g_sSimTiming.usb_stage_us);
+
+    // Setup stage once the bus is free, then the device processing.
+    if(g_ullSimBusFree < g_ullSimCycles)
+    {
+        g_ullSimBusFree = g_ullSimCycles;
+    }
+    g_ullSimBusFree += ullStage + SIM_US_TO_CYCLES(psDevice->ulControlDelayUs);
+    SimAdvanceTo(g_ullSimBusFree);
+
+    iLen = 0;
+    if(bIn)
+    {
+        iLen = SimUsbDeviceRequest(psDevice, pSetupPacket, pData, ulSize);
+    }
+
+    // Data stage (a zero length packet for an empty IN data stage) and status stage.
+    ulPackets = bIn ? ((((iLen > 0) ? iLen : 0) / ulMaxPacketSize) + 1) :
+                      ((ulSize + ulMaxPacketSize - 1) / ulMaxPacketSize);
+    if(g_ullSimBusFree < g_ullSimCycles)
+    {
+        g_ullSimBusFree = g_ullSimCycles;
+    }
+    g_ullSimBusFree += ullStage * (ulPackets + 1);
+    SimAdvanceTo(g_ullSimBusFree);
+
+    if(!bIn)
+    {
+        iLen = SimUsbDeviceRequest(psDevice, pSetupPacket, pData, ulSize);
+        if(iLen >= 0)
+        {
+            iLen = ulSize;
+        }
+    }
+
+    // The device was removed or the request stalled.
+    if((g_psSimDevice != psDevice) || (iLen < 0))
+    {
+        return 0;
+    }
+
+    return iLen;
+}
+
+//*****************************************************************************
+//
+// Standard request on an endpoint of the device (usblib usbhostenum.c), the
+// data toggle of the pipe restarts at DATA0 as the device endpoint one.
+//
+//*****************************************************************************
+void USBHCDClearFeature(unsigned int ulDevAddress, unsigned int ulPipe, unsigned int ulFeature)
+{
+    t_sim_pipe *psPipe;
+    tUSBRequest sSetup;
+
+    psPipe = SimUsbPipe(ulPipe);
+    if(psPipe == NULL)
+    {
+        return;
+    }
+
+    sSetup.bmRequestType = USB_RTYPE_DIR_OUT | USB_RTYPE_STANDARD | USB_RTYPE_ENDPOINT;
+    sSetup.bRequest = USBREQ_CLEAR_FEATURE;
+    sSetup.wValue = ulFeature;
+    sSetup.wIndex = psPipe->ulEndpoint | ((ulPipe & EP_PIPE_TYPE_IN) ? USB_RTYPE_DIR_IN : 0);
+    sSetup.wLength = 0;
+    USBHCDControlTransfer(0, &sSetup, ulDevAddress, NULL, 0, MAX_PACKET_SIZE_EP0);
+
+    if(ulFeature == USB_FEATURE_EP_HALT)
+    {
+        USBEndpointDataToggleClear(USB0_BASE, ((ulPipe & 0xFF) + 1) << 4,
+                                   (ulPipe & EP_PIPE_TYPE_IN) ? USB_EP_HOST_IN : USB_EP_HOST_OUT);
+    }
+}
+
+//*****************************************************************************
+//
+// Host stack: enumeration and class drivers.
+//
+//*****************************************************************************
+// Send an event to the events driver (USBHCDEvents() of the firmware).
+static void SimUsbEvent(t_u32 ulEvent)
+{
+    tEventInfo sEvent;
+    t_u32 i;
+
+    for(i = 0; i < g_ulSimNbDrivers; i++)
+    {
+        if((g_ppsSimDrivers[i]->ulInterfaceClass == USB_CLASS_EVENTS) &&
+           (g_ppsSimDrivers[i]->pfnIntHandler != NULL))
+        {
+            sEvent.ulEvent = ulEvent;
+            sEvent.ulInstance = 0;
+            g_ppsSimDrivers[i]->pfnIntHandler(&sEvent);
+        }
+    }
+}
+
+static void SimUsbEnumerate(void)
+{
+    const t_sim_usb_device *psDevice;
+    tUSBRequest sSetup;
+    tInterfaceDescriptor *psInterface;
+    t_u32 ulTotal;
+    t_u32 i;
+
+    psDevice = g_psSimDevice;
+
+    // Bus reset and recovery.
+    SimAdvanceTo(g_ullSimCycles + SIM_US_TO_CYCLES(g_sSimTiming.usb_reset_ms * 1000));
+    if((g_psSimDevice != psDevice) || (psDevice == NULL))
+    {
+        return;
+    }
+
+    memset(&g_sSimHostDevice, 0, sizeof(g_sSimHostDevice));
+
+    // Device descriptor first 8 bytes (max packet size of EP0) at address 0.
+    sSetup.bmRequestType = USB_RTYPE_DIR_IN | USB_RTYPE_STANDARD | USB_RTYPE_DEVICE;
+    sSetup.bRequest = USBREQ_GET_DESCRIPTOR;
+    sSetup.wValue = USB_DTYPE_DEVICE << 8;
+    sSetup.wIndex = 0;
+    sSetup.wLength = 8;
+    if(USBHCDControlTransfer(0, &sSetup, 0, (t_u8 *)&g_sSimHostDevice.DeviceDescriptor, 8, 8) != 8)
+    {
+        return;
+    }
+
+    sSetup.bmRequestType = USB_RTYPE_DIR_OUT | USB_RTYPE_STANDARD | USB_RTYPE_DEVICE;
+    sSetup.bRequest = USBREQ_SET_ADDRESS;
+    sSetup.wValue = SIM_USB_DEV_ADDRESS;
+    sSetup.wLength = 0;
+    USBHCDControlTransfer(0, &sSetup, 0, NULL, 0, 8);
+    g_sSimHostDevice.ulAddress = SIM_USB_DEV_ADDRESS;
+
+    sSetup.bmRequestType = USB_RTYPE_DIR_IN | USB_RTYPE_STANDARD | USB_RTYPE_DEVICE;
+    sSetup.bRequest = USBREQ_GET_DESCRIPTOR;
+    sSetup.wValue = USB_DTYPE_DEVICE << 8;
+    sSetup.wLength = sizeof(tDeviceDescriptor);
+    if(USBHCDControlTransfer(0, &sSetup, SIM_USB_DEV_ADDRESS, (t_u8 *)&g_sSimHostDevice.DeviceDescriptor,
+                             sizeof(tDeviceDescriptor), g_sSimHostDevice.DeviceDescriptor.bMaxPacketSize0) !=
+       sizeof(tDeviceDescriptor))
+    {
+        return;
+    }
+
+    // Configuration descriptor header, then the whole descriptor in the application memory.
+    ulTotal = ((const tConfigDescriptor *)psDevice->pucConfigDesc)->wTotalLength;
+    if((g_pucSimHostPool == NULL) || (ulTotal > g_ulSimHostPoolSize))
+    {
+        fprintf(stderr, "sim: configuration descriptor of %u bytes too large for the host memory\n", ulTotal);
+        return;
+    }
+    sSetup.wValue = USB_DTYPE_CONFIGURATION << 8;
+    sSetup.wLength = sizeof(tConfigDescriptor);
+    USBHCDControlTransfer(0, &sSetup, SIM_USB_DEV_ADDRESS, g_pucSimHostPool, sizeof(tConfigDescriptor),
+                          g_sSimHostDevice.DeviceDescriptor.bMaxPacketSize0);
+    sSetup.wLength = ulTotal;
+    if(USBHCDControlTransfer(0, &sSetup, SIM_USB_DEV_ADDRESS, g_pucSimHostPool, ulTotal,
+                             g_sSimHostDevice.DeviceDescriptor.bMaxPacketSize0) != ulTotal)
+    {
+        return;
+    }
+    g_sSimHostDevice.pConfigDescriptor = (tConfigDescriptor *)g_pucSimHostPool;
+    g_sSimHostDevice.ulConfigDescriptorSize = ulTotal;
+
+    sSetup.bmRequestType = USB_RTYPE_DIR_OUT | USB_RTYPE_STANDARD | USB_RTYPE_DEVICE;
+    sSetup.bRequest = USBREQ_SET_CONFIG;
+    sSetup.wValue = g_sSimHostDevice.pConfigDescriptor->bConfigurationValue;
+    sSetup.wLength = 0;
+    USBHCDControlTransfer(0, &sSetup, SIM_USB_DEV_ADDRESS, NULL, 0,
+                          g_sSimHostDevice.DeviceDescriptor.bMaxPacketSize0);
+    if(g_psSimDevice != psDevice)
+    {
+        return;
+    }
+
+    g_bSimStackEnumerated = true;
+    g_sSimUsbStats.enumerations++;
+
+    // Class driver of the first interface, or the events driver.
+    psInterface = USBDescGetInterface(g_sSimHostDevice.pConfigDescriptor, 0, 0);
+    for(i = 0; i < g_ulSimNbDrivers; i++)
+    {
+        if((psInterface != NULL) &&
+           (g_ppsSimDrivers[i]->ulInterfaceClass == psInterface->bInterfaceClass) &&
+           (g_ppsSimDrivers[i]->pfnOpen != NULL))
+        {
+            g_psSimOpenDriver = g_ppsSimDrivers[i];
+            g_pvSimOpenInstance = g_psSimOpenDriver->pfnOpen(&g_sSimHostDevice);
+            return;
+        }
+    }
+
+    SimUsbEvent(USB_EVENT_CONNECTED);
+}
+
+static void SimUsbClose(void)
+{
+    if(!g_bSimStackEnumerated)
+    {
+        return;
+    }
+    g_bSimStackEnumerated = false;
+
+    if(g_psSimOpenDriver != NULL)
+    {
+        if(g_psSimOpenDriver->pfnClose != NULL)
+        {
+            g_psSimOpenDriver->pfnClose(g_pvSimOpenInstance);
+        }
+        g_psSimOpenDriver = NULL;
+        g_pvSimOpenInstance = NULL;
+        return;
+    }
+
+    SimUsbEvent(USB_EVENT_DISCONNECTED);
+}
+
+static void SimUsbSessionStart(void *pvData, t_u32 ulArg)
+{
+    if(!g_bSimCable || g_bSimSession || g_bSimPowerFault)
+    {
+        return;
+    }
+
+    g_bSimSession = true;
+    g_ulSimUsbInt |= SIM_USB_INT_SESSION_START;
+    if(g_psSimDevice != NULL)
+    {
+        g_ulSimUsbInt |= SIM_USB_INT_CONNECT;
+    }
+    SimUsbIrqUpdate();
+}
+
+void USBStackModeSet(unsigned int ulIndex, tUSBMode eUSBMode, tUSBModeCallback pfnCallback)
+{
+    g_pfnSimModeCallback = pfnCallback;
+}
+
+void USBHCDRegisterDrivers(unsigned int ulIndex, const tUSBHostClassDriver * const *ppHClassDrvrs,
+                           unsigned int ulNumDrivers)
+{
+    g_ppsSimDrivers = ppHClassDrvrs;
+    g_ulSimNbDrivers = ulNumDrivers;
+}
+
+void USBHCDPowerConfigInit(unsigned int ulIndex, unsigned int ulPwrConfig)
+{
+}
+
+void USBOTGModeInit(unsigned int ulIndex, unsigned int ulPollingRate, void *pHostData,
+                    unsigned int ulHostDataSize)
+{
+    g_ulSimPollMs = ulPollingRate;
+    g_ulSimPollElapsedMs = 0;
+    g_pucSimHostPool = (t_u8 *)pHostData;
+    g_ulSimHostPoolSize = ulHostDataSize;
+
+    // As usblib, the USB interrupt is enabled by the OTG mode init.
+    IntEnable(INT_USB0);
+}
+
+//*****************************************************************************
+//
+// OTG main routine: session polling, then the power fault, device connection
+// and removal seen by the interrupt handler.
+//
+//*****************************************************************************
+void USBOTGMain(unsigned int ulMsTicks)
+{
+    if(!g_bSimSession)
+    {
+        g_ulSimPollElapsedMs += ulMsTicks;
+        if(g_bSimCable && (g_ulSimPollElapsedMs >= g_ulSimPollMs))
+        {
+            g_ulSimPollElapsedMs = 0;
+            SimAtCycles(g_ullSimCycles + SIM_US_TO_CYCLES(SIM_USB_VBUS_RISE_US), SimUsbSessionStart, NULL, 0);
+        }
+    }
+
+    if(g_bSimStackPowerFault)
+    {
+        g_bSimStackPowerFault = false;
+        SimUsbEvent(USB_EVENT_POWER_FAULT);
+    }
+
+    if(g_bSimStackDisconnect)
+    {
+        g_bSimStackDisconnect = false;
+        SimUsbClose();
+    }
+
+    if(g_bSimStackConnect)
+    {
+        g_bSimStackConnect = false;
+        if(g_psSimDevice != NULL)
+        {
+            SimUsbEnumerate();
+        }
+    }
+}
+
+void USB0OTGModeIntHandler(void)
+{
+    t_sim_pipe *psPipe;
+    t_u32 ulInt;
+    t_u32 i;
+
+    ulInt = g_ulSimUsbInt;
+    g_ulSimUsbInt = 0;
+
+    if((ulInt & SIM_USB_INT_SESSION_START) && (g_pfnSimModeCallback != NULL))
+    {
+        g_pfnSimModeCallback(0, USB_MODE_HOST);
+    }
+    if(ulInt & SIM_USB_INT_POWER_FAULT)
+    {
+        g_bSimStackPowerFault = true;
+    }
+    if(ulInt & SIM_USB_INT_DISCONNECT)
+    {
+        g_bSimStackDisconnect = true;
+        g_bSimStackConnect = false;
+    }
+    if(ulInt & SIM_USB_INT_CONNECT)
+    {
+        g_bSimStackConnect = true;
+    }
+    if((ulInt & SIM_USB_INT_SESSION_END) && (g_pfnSimModeCallback != NULL))
+    {
+        g_pfnSimModeCallback(0, USB_MODE_NONE);
+    }
+
+    for(i = 0; i < (SIM_USB_PIPES * 2); i++)
+    {
+        psPipe = (i < SIM_USB_PIPES) ? &g_sSimInPipes[i] : &g_sSimOutPipes[i - SIM_USB_PIPES];
+        if(psPipe->bEventPending)
+        {
+            psPipe->bEventPending = false;
+            if(psPipe->pfnCallback != NULL)
+            {
+                psPipe->pfnCallback(SimUsbPipeHandle(psPipe), psPipe->ulEvent);
+            }
+        }
+    }
+
+    SimUsbIrqUpdate();
+}
+
+//*****************************************************************************
+//
+// Descriptors parsing (usblib usbdesc.c).
+//
+//*****************************************************************************
+tInterfaceDescriptor *USBDescGetInterface(tConfigDescriptor *psConfig, unsigned int ulIndex,
+                                          unsigned int ulAltCfg)
+{
+    t_u8 *pucDesc;
+    t_u8 *pucEnd;
+    tInterfaceDescriptor *psInterface;
+
+    pucDesc = (t_u8 *)psConfig;
+    pucEnd = pucDesc + psConfig->wTotalLength;
+    while((pucDesc < pucEnd) && (pucDesc[0] != 0))
+    {
+        if(pucDesc[1] == USB_DTYPE_INTERFACE)
+        {
+            psInterface = (tInterfaceDescriptor *)pucDesc;
+            if((psInterface->bInterfaceNumber == ulIndex) && (psInterface->bAlternateSetting == ulAltCfg))
+            {
+                return psInterface;
+            }
+        }
+        pucDesc += pucDesc[0];
+    }
+
+    return NULL;
+}
+
+tEndpointDescriptor *USBDescGetInterfaceEndpoint(tInterfaceDescriptor *psInterface,
+                                                 unsigned int ulIndex, unsigned int ulSize)
+{
+    t_u8 *pucDesc;
+    t_u8 *pucEnd;
+    t_u32 ulCount;
+
+    if(psInterface == NULL)
+    {
+        return NULL;
+    }
+
+    pucDesc = (t_u8 *)psInterface;
+    pucEnd = pucDesc + ulSize;
+    pucDesc += pucDesc[0];
+    ulCount = 0;
+    while((pucDesc < pucEnd) && (pucDesc[0] != 0) && (pucDesc[1] != USB_DTYPE_INTERFACE))
+    {
+        if(pucDesc[1] == USB_DTYPE_ENDPOINT)
+        {
+            if(ulCount == ulIndex)
+            {
+                return (tEndpointDescriptor *)pucDesc;
+            }
+            ulCount++;
+        }
+        pucDesc += pucDesc[0];
+    }
+
+    return NULL;
+}
+
+//*****************************************************************************
+//
+// Device side.
+//
+//*****************************************************************************
+void SIM_usbPlug(const t_sim_usb_device *psDevice)
+{
+    g_bSimCable = true;
+    g_psSimDevice = psDevice;
+    SimUsbEndpointsReset();
+}
+
+void SIM_usbUnplug(void)
+{
+    SIM_usbDeviceDetach();
+    g_bSimCable = false;
+    g_bSimPowerFault = false;
+    if(g_bSimSession)
+    {
+        g_bSimSession = false;
+        g_ulSimUsbInt |= SIM_USB_INT_SESSION_END;
+        SimUsbIrqUpdate();
+    }
+}
+
+void SIM_usbDeviceDetach(void)
+{
+    t_sim_packet *psPacket;
+    t_u32 i;
+
+    if(g_psSimDevice == NULL)
+    {
+        return;
+    }
+    g_psSimDevice = NULL;
+
+    // The transactions in progress are lost, the pipes stay allocated until the driver closes.
+    for(i = 0; i < SIM_USB_PIPES; i++)
+    {
+        g_sSimInPipes[i].ulGen++;
+        g_sSimInPipes[i].bActive = false;
+        g_sSimInPipes[i].bWaiting = false;
+        g_sSimOutPipes[i].ulGen++;
+        g_sSimOutPipes[i].bActive = false;
+    }
+    for(i = 0; i < SIM_USB_ENDPOINTS; i++)
+    {
+        while(g_psSimInHead[i] != NULL)
+        {
+            psPacket = g_psSimInHead[i];
+            g_psSimInHead[i] = psPacket->psNext;
+            free(psPacket);
+        }
+        g_psSimInTail[i] = NULL;
+    }
+
+    if(g_bSimSession)
+    {
+        g_ulSimUsbInt |= SIM_USB_INT_DISCONNECT;
+        SimUsbIrqUpdate();
+    }
+}
+
+void SIM_usbDeviceAttach(const t_sim_usb_device *psDevice)
+{
+    g_psSimDevice = psDevice;
+    SimUsbEndpointsReset();
+    if(g_bSimSession)
+    {
+        g_ulSimUsbInt |= SIM_USB_INT_CONNECT;
+        SimUsbIrqUpdate();
+    }
+}
+
+void SIM_usbInQueue(t_u32 ulEndpoint, const t_u8 *pucData, t_u32 ulSize)
+{
+    t_sim_packet *psPacket;
+    t_u32 ulPacket;
+    t_u32 i;
+
+    ulEndpoint &= (SIM_USB_ENDPOINTS - 1);
+    if(g_psSimDevice == NULL)
+    {
+        return;
+    }
+
+    // Split in max packet size packets, an empty transfer is one zero length packet.
+    do
+    {
+        ulPacket = (ulSize < SIM_USB_MAX_PACKET) ? ulSize : SIM_USB_MAX_PACKET;
+        psPacket = malloc(sizeof(t_sim_packet));
+        psPacket->psNext = NULL;
+        psPacket->ulSize = ulPacket;
+        memcpy(psPacket->ucData, pucData, ulPacket);
+        if(g_psSimInTail[ulEndpoint] != NULL)
+        {
+            g_psSimInTail[ulEndpoint]->psNext = psPacket;
+        }
+        else
+        {
+            g_psSimInHead[ulEndpoint] = psPacket;
+        }
+        g_psSimInTail[ulEndpoint] = psPacket;
+        pucData += ulPacket;
+        ulSize -= ulPacket;
+    }while(ulSize != 0);
+
+    // Restart the IN pipes waiting for this endpoint.
+    for(i = 0; i < SIM_USB_PIPES; i++)
+    {
+        if(g_sSimInPipes[i].bWaiting && (g_sSimInPipes[i].ulEndpoint == ulEndpoint))
+        {
+            g_sSimInPipes[i].bWaiting = false;
+            SimAtCycles(g_ullSimCycles, SimUsbInTry, &g_sSimInPipes[i], g_sSimInPipes[i].ulGen);
+        }
+    }
+}
+
+t_u32 SIM_usbInPending(void)
+{
+    t_sim_packet *psPacket;
+    t_u32 ulCount;
+    t_u32 i;
+
+    ulCount = 0;
+    for(i = 0; i < SIM_USB_ENDPOINTS; i++)
+    {
+        for(psPacket = g_psSimInHead[i]; psPacket != NULL; psPacket = psPacket->psNext)
+        {
+            ulCount++;
+        }
+    }
+
+    return ulCount;
+}
+
+void SIM_usbNak(bool bIn, t_u64 start_us, t_u64 end_us)
+{
+    t_sim_nak_list *psList;
+
+    if(end_us <= start_us)
+    {
+        return;
+    }
+
+    psList = &g_sSimNak[bIn ? 1 : 0];
+    if(psList->ulCount == psList->ulSize)
+    {
+        psList->ulSize = psList->ulSize ? (psList->ulSize * 2) : 16;
+        psList->psPeriods = realloc(psList->psPeriods, psList->ulSize * sizeof(t_sim_nak));
+    }
+    psList->psPeriods[psList->ulCount].ullStart = SIM_US_TO_CYCLES(start_us);
+    psList->psPeriods[psList->ulCount].ullEnd = SIM_US_TO_CYCLES(end_us);
+    psList->ulCount++;
+}
+
+void SIM_usbHalt(bool bIn, t_u32 ulEndpoint)
+{
+    t_u32 i;
+
+    ulEndpoint &= (SIM_USB_ENDPOINTS - 1);
+    g_bSimHalt[bIn ? 1 : 0][ulEndpoint] = true;
+
+    // The IN pipes waiting for a packet get the STALL now.
+    for(i = 0; bIn && (i < SIM_USB_PIPES); i++)
+    {
+        if(g_sSimInPipes[i].bWaiting && (g_sSimInPipes[i].ulEndpoint == ulEndpoint))
+        {
+            g_sSimInPipes[i].bWaiting = false;
+            SimAtCycles(g_ullSimCycles, SimUsbInTry, &g_sSimInPipes[i], g_sSimInPipes[i].ulGen);
+        }
+    }
+}
+
+void SIM_usbPowerFault(void)
+{
+    if(!g_bSimSession)
+    {
+        return;
+    }
+
+    // The power switch cuts VBUS: the device is removed and the session ends.
+    g_bSimPowerFault = true;
+    SIM_usbDeviceDetach();
+    g_bSimSession = false;
+    g_ulSimUsbInt |= SIM_USB_INT_POWER_FAULT | SIM_USB_INT_SESSION_END;
+    SimUsbIrqUpdate();
+}
+
+void SIM_usbStats(t_sim_usb_stats *psStats)
+{
+    *psStats = g_sSimUsbStats;
+}
+
+//*****************************************************************************
+//
+// Device already in accessory mode: one vendor interface with a Bulk IN and a
+// Bulk OUT endpoint.
+//
+//*****************************************************************************
+static const t_u8 g_ucSimAccessoryDeviceDesc[18] =
+{
+    18, USB_DTYPE_DEVICE, 0x00, 0x02, 0x00, 0x00, 0x00, MAX_PACKET_SIZE_EP0,
+    0xD1, 0x18, 0x00, 0x2D, 0x00, 0x01, 1, 2, 3, 1
+};
+
+static const t_u8 g_ucSimAccessoryConfigDesc[32] =
+{
+    9, USB_DTYPE_CONFIGURATION, 32, 0, 1, 1, 0, 0x80, 250,
+    9, USB_DTYPE_INTERFACE, 0, 0, 2, USB_CLASS_VEND_SPECIFIC, 0xFF, 0x00, 0,
+    7, USB_DTYPE_ENDPOINT, USB_EP_DESC_IN | 1, USB_EP_ATTR_BULK, SIM_USB_MAX_PACKET, 0, 0,
+    7, USB_DTYPE_ENDPOINT, 2, USB_EP_ATTR_BULK, SIM_USB_MAX_PACKET, 0, 0
+};
+
+static const t_sim_usb_device g_sSimAccessoryDevice =
+{
+    g_ucSimAccessoryDeviceDesc,
+    g_ucSimAccessoryConfigDesc,
+    NULL,
+    NULL,
+    50,
+    NULL
+};
+
+const t_sim_usb_device *SIM_usbAccessoryDevice(void)
+{
+    return &g_sSimAccessoryDevice;
+}
+
+static const t_u8 g_ucSimUnknownDeviceDesc[18] =
+{
+    18, USB_DTYPE_DEVICE, 0x00, 0x02, 0x00, 0x00, 0x00, MAX_PACKET_SIZE_EP0,
+    0x34, 0x12, 0x01, 0x00, 0x00, 0x01, 0, 0, 0, 1
+};
+
+static const t_u8 g_ucSimUnknownConfigDesc[25] =
+{
+    9, USB_DTYPE_CONFIGURATION, 25, 0, 1, 1, 0, 0x80, 50,
+    9, USB_DTYPE_INTERFACE, 0, 0, 1, USB_CLASS_HID, 0x00, 0x00, 0,
+    7, USB_DTYPE_ENDPOINT, USB_EP_DESC_IN | 1, USB_EP_ATTR_INT, 8, 0, 10
+};
+
+static const t_sim_usb_device g_sSimUnknownDevice =
+{
+    g_ucSimUnknownDeviceDesc,
+    g_ucSimUnknownConfigDesc,
+    NULL,
+    NULL,
+    50,
+    NULL
+};
+
+const t_sim_usb_device *SIM_usbUnknownDevice(void)
+{
+    return &g_sSimUnknownDevice;
+}
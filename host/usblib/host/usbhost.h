@@ -0,0 +1,91 @@
+//*****************************************************************************
+//
+// usbhost.h - Host build: USB host controller driver API (simulated stack).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __USBHOST_H__
+#define __USBHOST_H__
+
+typedef struct
+{
+    unsigned int ulAddress;
+    tDeviceDescriptor DeviceDescriptor;
+    tConfigDescriptor *pConfigDescriptor;
+    unsigned int ulConfigDescriptorSize;
+}
+tUSBHostDevice;
+
+typedef struct
+{
+    unsigned int ulInterfaceClass;
+    void * (*pfnOpen)(tUSBHostDevice *pDevice);
+    void (*pfnClose)(void *pvInstance);
+    void (*pfnIntHandler)(void *pvInstance);
+}
+tUSBHostClassDriver;
+
+typedef struct
+{
+    unsigned int ulEvent;
+    unsigned int ulInstance;
+}
+tEventInfo;
+
+#define DECLARE_EVENT_DRIVER(VarName, pfnOpen, pfnClose, pfnEvent)          \
+void IntFn(void *pvData);                                                   \
+const tUSBHostClassDriver VarName =                                         \
+{                                                                           \
+    USB_CLASS_EVENTS,                                                       \
+    0,                                                                      \
+    0,                                                                      \
+    pfnEvent                                                                \
+}
+
+extern void USBHCDEvents(void *pvData);
+
+typedef void (*tHCDPipeCallback)(unsigned int ulPipe, unsigned int ulEvent);
+
+#define EP_PIPE_TYPE_OUT        0x00000000
+#define EP_PIPE_TYPE_IN         0x00001000
+#define EP_PIPE_USE_UDMA        0x00002000
+#define EP_PIPE_TYPE_CONTROL    0x00010000
+#define EP_PIPE_TYPE_BULK       0x00040000
+
+#define USBHCD_PIPE_BULK_OUT        (EP_PIPE_TYPE_BULK | EP_PIPE_TYPE_OUT)
+#define USBHCD_PIPE_BULK_OUT_DMA    (EP_PIPE_TYPE_BULK | EP_PIPE_TYPE_OUT | EP_PIPE_USE_UDMA)
+#define USBHCD_PIPE_BULK_IN         (EP_PIPE_TYPE_BULK | EP_PIPE_TYPE_IN)
+#define USBHCD_PIPE_BULK_IN_DMA     (EP_PIPE_TYPE_BULK | EP_PIPE_TYPE_IN | EP_PIPE_USE_UDMA)
+
+#define USBHCD_VBUS_AUTO_HIGH   0x00000002
+#define USBHCD_VBUS_FILTER      0x00010000
+
+extern unsigned int USBHCDPipeAlloc(unsigned int ulIndex, unsigned int ulEndpointType,
+                                    unsigned int ulDevAddr, tHCDPipeCallback pCallback);
+extern unsigned int USBHCDPipeAllocSize(unsigned int ulIndex, unsigned int ulEndpointType,
+                                        unsigned int ulDevAddr, unsigned int ulFIFOSize,
+                                        tHCDPipeCallback pCallback);
+extern unsigned int USBHCDPipeConfig(unsigned int ulPipe, unsigned int ulMaxPayload,
+                                     unsigned int ulInterval, unsigned int ulTargetEndpoint);
+extern void USBHCDPipeFree(unsigned int ulPipe);
+extern unsigned int USBHCDPipeWrite(unsigned int ulPipe, unsigned char *pData, unsigned int ulSize);
+extern unsigned int USBHCDPipeRead(unsigned int ulPipe, unsigned char *pData, unsigned int ulSize);
+extern unsigned int USBHCDPipeSchedule(unsigned int ulPipe, unsigned char *pData, unsigned int ulSize);
+extern unsigned int USBHCDPipeReadNonBlocking(unsigned int ulPipe, unsigned char *pData,
+                                              unsigned int ulSize);
+extern unsigned int USBHCDControlTransfer(unsigned int ulIndex, tUSBRequest *pSetupPacket,
+                                          unsigned int ulDevAddress, unsigned char *pData,
+                                          unsigned int ulSize, unsigned int ulMaxPacketSize);
+extern void USBHCDClearFeature(unsigned int ulDevAddress, unsigned int ulPipe, unsigned int ulFeature);
+extern void USBHCDRegisterDrivers(unsigned int ulIndex, const tUSBHostClassDriver * const *ppHClassDrvrs,
+                                  unsigned int ulNumDrivers);
+extern void USBHCDPowerConfigInit(unsigned int ulIndex, unsigned int ulPwrConfig);
+extern void USBOTGModeInit(unsigned int ulIndex, unsigned int ulPollingRate, void *pHostData,
+                           unsigned int ulHostDataSize);
+extern void USBOTGMain(unsigned int ulMsTicks);
+extern void USB0OTGModeIntHandler(void);
+
+#endif // __USBHOST_H__
@@ -0,0 +1,150 @@
+//*****************************************************************************
+//
+// usblib.h - Host build: USB library types and descriptors (simulated stack).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __USBLIB_H__
+#define __USBLIB_H__
+
+#define PACKED __attribute__ ((packed))
+
+typedef struct
+{
+    unsigned char bmRequestType;
+    unsigned char bRequest;
+    unsigned short wValue;
+    unsigned short wIndex;
+    unsigned short wLength;
+}
+PACKED tUSBRequest;
+
+typedef struct
+{
+    unsigned char bLength;
+    unsigned char bDescriptorType;
+    unsigned short bcdUSB;
+    unsigned char bDeviceClass;
+    unsigned char bDeviceSubClass;
+    unsigned char bDeviceProtocol;
+    unsigned char bMaxPacketSize0;
+    unsigned short idVendor;
+    unsigned short idProduct;
+    unsigned short bcdDevice;
+    unsigned char iManufacturer;
+    unsigned char iProduct;
+    unsigned char iSerialNumber;
+    unsigned char bNumConfigurations;
+}
+PACKED tDeviceDescriptor;
+
+typedef struct
+{
+    unsigned char bLength;
+    unsigned char bDescriptorType;
+    unsigned short wTotalLength;
+    unsigned char bNumInterfaces;
+    unsigned char bConfigurationValue;
+    unsigned char iConfiguration;
+    unsigned char bmAttributes;
+    unsigned char bMaxPower;
+}
+PACKED tConfigDescriptor;
+
+typedef struct
+{
+    unsigned char bLength;
+    unsigned char bDescriptorType;
+    unsigned char bInterfaceNumber;
+    unsigned char bAlternateSetting;
+    unsigned char bNumEndpoints;
+    unsigned char bInterfaceClass;
+    unsigned char bInterfaceSubClass;
+    unsigned char bInterfaceProtocol;
+    unsigned char iInterface;
+}
+PACKED tInterfaceDescriptor;
+
+typedef struct
+{
+    unsigned char bLength;
+    unsigned char bDescriptorType;
+    unsigned char bEndpointAddress;
+    unsigned char bmAttributes;
+    unsigned short wMaxPacketSize;
+    unsigned char bInterval;
+}
+PACKED tEndpointDescriptor;
+
+#define USB_RTYPE_DIR_IN        0x80
+#define USB_RTYPE_DIR_OUT       0x00
+#define USB_RTYPE_TYPE_M        0x60
+#define USB_RTYPE_STANDARD      0x00
+#define USB_RTYPE_CLASS         0x20
+#define USB_RTYPE_VENDOR        0x40
+#define USB_RTYPE_RECIPIENT_M   0x1f
+#define USB_RTYPE_DEVICE        0x00
+#define USB_RTYPE_ENDPOINT      0x02
+
+#define USBREQ_CLEAR_FEATURE    0x01
+#define USBREQ_SET_ADDRESS      0x05
+#define USBREQ_GET_DESCRIPTOR   0x06
+#define USBREQ_SET_CONFIG       0x09
+
+#define USB_FEATURE_EP_HALT     0x0000
+
+#define USB_DTYPE_DEVICE        1
+#define USB_DTYPE_CONFIGURATION 2
+#define USB_DTYPE_INTERFACE     4
+#define USB_DTYPE_ENDPOINT      5
+
+#define USB_EP_ATTR_TYPE_M      0x03
+#define USB_EP_ATTR_BULK        0x02
+#define USB_EP_ATTR_INT         0x03
+#define USB_EP_DESC_IN          0x80
+#define USB_EP_DESC_NUM_M       0x0f
+
+#define USB_CLASS_EVENTS        0xffffffff
+#define USB_CLASS_HID           0x03
+#define USB_CLASS_MASS_STORAGE  0x08
+#define USB_CLASS_VEND_SPECIFIC 0xff
+
+#define MAX_PACKET_SIZE_EP0     64
+
+#define USB_EVENT_BASE          0x0000
+#define USB_EVENT_CONNECTED     (USB_EVENT_BASE + 0)
+#define USB_EVENT_DISCONNECTED  (USB_EVENT_BASE + 1)
+#define USB_EVENT_RX_AVAILABLE  (USB_EVENT_BASE + 2)
+#define USB_EVENT_DATA_REMAINING (USB_EVENT_BASE + 3)
+#define USB_EVENT_REQUEST_BUFFER (USB_EVENT_BASE + 4)
+#define USB_EVENT_TX_COMPLETE   (USB_EVENT_BASE + 5)
+#define USB_EVENT_ERROR         (USB_EVENT_BASE + 6)
+#define USB_EVENT_SUSPEND       (USB_EVENT_BASE + 7)
+#define USB_EVENT_RESUME        (USB_EVENT_BASE + 8)
+#define USB_EVENT_SCHEDULER     (USB_EVENT_BASE + 9)
+#define USB_EVENT_STALL         (USB_EVENT_BASE + 10)
+#define USB_EVENT_POWER_FAULT   (USB_EVENT_BASE + 11)
+#define USB_EVENT_POWER_ENABLE  (USB_EVENT_BASE + 12)
+#define USB_EVENT_POWER_DISABLE (USB_EVENT_BASE + 13)
+
+typedef enum
+{
+    USB_MODE_DEVICE = 0,
+    USB_MODE_HOST,
+    USB_MODE_OTG,
+    USB_MODE_NONE
+}
+tUSBMode;
+
+typedef void (*tUSBModeCallback)(unsigned int ulIndex, tUSBMode eMode);
+
+extern void USBStackModeSet(unsigned int ulIndex, tUSBMode eUSBMode, tUSBModeCallback pfnCallback);
+extern tInterfaceDescriptor *USBDescGetInterface(tConfigDescriptor *psConfig, unsigned int ulIndex,
+                                                 unsigned int ulAltCfg);
+extern tEndpointDescriptor *USBDescGetInterfaceEndpoint(tInterfaceDescriptor *psInterface,
+                                                        unsigned int ulIndex, unsigned int ulSize);
+
+#endif // __USBLIB_H__
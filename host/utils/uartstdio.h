@@ -0,0 +1,19 @@
+//*****************************************************************************
+//
+// uartstdio.h - Host build: UART stdio API (simulated serial port).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __UARTSTDIO_H__
+#define __UARTSTDIO_H__
+
+extern void UARTStdioInit(unsigned int ulPort);
+extern int UARTwrite(const char *pcBuf, unsigned int ulLen);
+extern void UARTprintf(const char *pcString, ...);
+extern int UARTTxBytesFree(void);
+extern void UARTStdioIntHandler(void);
+
+#endif // __UARTSTDIO_H__
@@ -0,0 +1,192 @@
+//*****************************************************************************
+//
+// input.c - EvalBot switches and bumpers edge capture.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "driverlib/rom.h"
+
+#include "drivers/motor.h"
+
+#include "usb_android.h"
+#include "event.h"
+#include "debounce.h"
+#include "input.h"
+#include "reflex.h"
+#include "speed.h"
+
+//*****************************************************************************
+//
+// The edge queue.  Only GPIOInputIntHandler() writes the head and only
+// INPUT_get() writes the tail, so no locking is needed.  The number of
+// entries must be a power of 2.
+//
+//*****************************************************************************
+#define INPUT_QUEUE_EDGES   (16)
+#define INPUT_QUEUE_MASK    (INPUT_QUEUE_EDGES - 1)
+
+static t_input_edge g_sInputQueue[INPUT_QUEUE_EDGES];
+
+// Free running queue indexes.
+static volatile t_u32 g_ulInputHead = 0;
+static volatile t_u32 g_ulInputTail = 0;
+
+// Number of edge events lost because the queue was full.
+static volatile t_u32 g_ulInputDropped = 0;
+
+// Debounced inputs (main loop only).
+static t_debounce g_sInputDebounce;
+
+//*****************************************************************************
+//
+//! This function initializes the inputs debounce with the current inputs
+//! state (no press/release event for the inputs already pressed).
+//!
+//! \return None.
+//
+//*****************************************************************************
+void INPUT_init(void)
+{
+    DEBOUNCE_init(&g_sInputDebounce, INPUT_read());
+}
+
+//*****************************************************************************
+//
+//! This function reads the state of all the inputs.
+//!
+//! The port D and port E data registers are read once each, the inputs are
+//! active low.
+//!
+//! \return Returns the INPUT_XXX bits of the pressed inputs.
+//
+//*****************************************************************************
+t_u32 INPUT_read(void)
+{
+    t_u32 ulPins;
+
+    ulPins = (ROM_GPIOPinRead(GPIO_PORTD_BASE, 0xFF) << INPUT_PORTD_SHIFT) |
+             (ROM_GPIOPinRead(GPIO_PORTE_BASE, 0xFF) << INPUT_PORTE_SHIFT);
+
+    return ~ulPins & INPUT_ALL;
+}
+
+//*****************************************************************************
+//
+//! This function samples and debounces all the inputs.
+//!
+//! This function must be called periodically from the main loop, an input
+//! state change is reported after DEBOUNCE_SAMPLES identical samples.
+//!
+//! \return Returns the INPUT_XXX bits which were pressed or released since
+//! the previous call (use INPUT_state() to know which ones are pressed).
+//
+//*****************************************************************************
+t_u32 INPUT_debounce(void)
+{
+    return DEBOUNCE_update(&g_sInputDebounce, INPUT_read());
+}
+
+t_u32 INPUT_state(void)
+{
+    return g_sInputDebounce.state;
+}
+
+//*****************************************************************************
+//
+// This is the handler for the GPIO port D (User Switch 1 & 2) and port E
+// (Bumper Switch 3 & 4, wheel encoders) interrupts.
+//
+//*****************************************************************************
+void
+GPIOInputIntHandler(void)
+{
+    t_input_edge *pEdge;
+    t_u32 ulTime;
+    t_u32 ulStatusD, ulStatusE;
+    t_u32 ulEncoder;
+    t_u32 ulChanged;
+    t_u32 ulState;
+
+    // Timestamp first, before any other work.
+    ulTime = GetTime_us();
+
+    ulStatusD = ROM_GPIOPinIntStatus(GPIO_PORTD_BASE, true) & (INPUT_ALL >> INPUT_PORTD_SHIFT) & 0xFF;
+    ulStatusE = ROM_GPIOPinIntStatus(GPIO_PORTE_BASE, true);
+
+    // The wheel encoders share the port E interrupt.
+    ulEncoder = ulStatusE & (ENCODER_L_PIN | ENCODER_R_PIN);
+    if(ulEncoder != 0)
+    {
+        ROM_GPIOPinIntClear(ENCODER_PORT_BASE, ulEncoder);
+        SPEED_encoderEdges(ulEncoder, ulTime);
+    }
+
+    ulStatusE &= (INPUT_ALL >> INPUT_PORTE_SHIFT) & 0xFF;
+    ROM_GPIOPinIntClear(GPIO_PORTD_BASE, ulStatusD);
+    ROM_GPIOPinIntClear(GPIO_PORTE_BASE, ulStatusE);
+
+    ulChanged = (ulStatusD << INPUT_PORTD_SHIFT) | (ulStatusE << INPUT_PORTE_SHIFT);
+    if(ulChanged == 0)
+    {
+        return;
+    }
+
+    // Local reflexes first (motors stop without waiting for the main loop).
+    ulState = INPUT_read();
+    REFLEX_run(ulChanged, ulState);
+
+    if((g_ulInputHead - g_ulInputTail) >= INPUT_QUEUE_EDGES)
+    {
+        g_ulInputDropped++;
+    }
+    else
+    {
+        pEdge = &g_sInputQueue[g_ulInputHead & INPUT_QUEUE_MASK];
+        pEdge->time_us = ulTime;
+        pEdge->changed = ulChanged;
+        pEdge->state = ulState;
+
+        // Publish the edge once it is complete.
+        g_ulInputHead++;
+    }
+
+    EVENT_post(EVENT_INPUT);
+}
+
+//*****************************************************************************
+//
+//! This function gets the oldest edge event from the queue.
+//!
+//! \param edge is the edge event copied from the queue.
+//!
+//! This function must be called only from the main loop.
+//!
+//! \return Returns true if an edge event was copied or false if the queue is
+//! empty.
+//
+//*****************************************************************************
+bool INPUT_get(t_input_edge* const edge/*out*/)
+{
+    if(g_ulInputTail == g_ulInputHead)
+    {
+        return false;
+    }
+
+    *edge = g_sInputQueue[g_ulInputTail & INPUT_QUEUE_MASK];
+
+    // Release the slot once copied.
+    g_ulInputTail++;
+
+    return true;
+}
+
+t_u32 INPUT_dropped(void)
+{
+    return g_ulInputDropped;
+}
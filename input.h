@@ -0,0 +1,85 @@
+//*****************************************************************************
+//
+// input.h - EvalBot switches and bumpers edge capture.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Each GPIO edge on the switches/bumpers (pins defined in usb_android.h)
+ * is timestamped in the GPIO interrupt and pushed in a single producer
+ * (GPIO interrupt) / single consumer (main loop) lock-free queue, then
+ * EVENT_INPUT is posted.  An edge is captured even when the main loop is busy,
+ * a pulse shorter than the interrupt latency is reported with changed bit set
+ * and state bit unchanged (press and release in the same edge event).
+ * The edges are raw (contact bounce included), the press/release events are
+ * given by INPUT_debounce() which samples all the inputs once per call.
+ */
+
+/*
+ * Inputs bits (bit set = pressed): the GPIO port D pins are bits 0-7 and the
+ * GPIO port E pins are bits 8-15 of the inputs word, so all the inputs are
+ * sampled with one data register read per port (see debounce.h).
+ */
+#define INPUT_PORTD_SHIFT   (0)
+#define INPUT_PORTE_SHIFT   (8)
+
+#define INPUT_SW1       (USER_SW1_PIN << INPUT_PORTD_SHIFT) /* User Switch 1 */
+#define INPUT_SW2       (USER_SW2_PIN << INPUT_PORTD_SHIFT) /* User Switch 2 */
+#define INPUT_BUMP_L    (BUMP_L_SW3_PIN << INPUT_PORTE_SHIFT) /* Bumper Left Switch 3 */
+#define INPUT_BUMP_R    (BUMP_R_SW4_PIN << INPUT_PORTE_SHIFT) /* Bumper Right Switch 4 */
+#define INPUT_ALL       (INPUT_SW1 | INPUT_SW2 | INPUT_BUMP_L | INPUT_BUMP_R)
+
+typedef struct
+{
+    t_u32 time_us; /* GetTime_us() in the GPIO interrupt */
+    t_u16 changed; /* INPUT_XXX bits with at least one edge */
+    t_u16 state; /* INPUT_XXX bits pressed after the edge(s) */
+} t_input_edge;
+
+/* API */
+
+/* Initialize the debounced state with the current inputs */
+extern void INPUT_init(void);
+
+/* Return the INPUT_XXX bits pressed now (raw sample, not debounced) */
+extern t_u32 INPUT_read(void);
+
+/* Sample and debounce all the inputs (call periodically), return the INPUT_XXX bits pressed or released */
+extern t_u32 INPUT_debounce(void);
+
+/* Return the INPUT_XXX bits pressed (debounced) */
+extern t_u32 INPUT_state(void);
+
+/* Get the oldest edge event, return false if the queue is empty (main loop only) */
+extern bool INPUT_get(t_input_edge* const edge/*out*/);
+
+/* Return the number of edge events lost because the queue was full */
+extern t_u32 INPUT_dropped(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __INPUT_H__
@@ -7,6 +7,7 @@
 //
 //*****************************************************************************
 
+#include <string.h>
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "inc/lm3s9b92.h"
@@ -16,14 +17,22 @@
 #include "usblib/usblib.h"
 #include "usblib/host/usbhost.h"
 
-#include "utils/uartstdio.h"
-
 #include "drivers/motor.h"
-#include "drivers/display96x16x1.h"
 
 #include "usb_android.h"
-
-t_u8 msg[256];
+#include "deferred_log.h"
+#include "profile.h"
+#include "event.h"
+#include "input.h"
+#include "reflex.h"
+#include "trajectory.h"
+#include "motor_ctrl.h"
+#include "speed.h"
+#include "odometry.h"
+#include "display.h"
+#include "bench.h"
+#include "usb_trace.h"
+#include "demokit_protocol.h"
 
 const t_ident_android_accessory ident_android_accessory =
 {
@@ -44,208 +53,606 @@ char char_anim[ANIM_NB_FRAMES][2] =
   "|",
  };
 
+/*
+ * Motors speed (Servo1/2) and on/off (Relay1/2) set by DemoKit, duty cycle is 8.8 fixed point percent
+ * */
+#define MOTOR_DUTY_DEFAULT  (10 << 8) /* 10% */
+static t_i16 g_sMotorDuty[2] = { MOTOR_DUTY_DEFAULT, MOTOR_DUTY_DEFAULT };
+static bool g_bMotorOn[2] = { false, false };
+
+static void DemoKitMotorUpdate(const tSide side/*in*/)
+{
+    SPEED_disable(side);
+    MCTRL_setTarget(side, g_bMotorOn[side] ? g_sMotorDuty[side] : 0);
+}
+
+/*
+ * DemoKit command handlers registered in DEMOKIT_COMMANDS (demokit_protocol.h)
+ * */
+void DemoKitServo1(const t_u8* const cmd/*in*/) /* Servo1 => Left Side change speed */
+{
+    g_sMotorDuty[LEFT_SIDE] = MCTRL_duty(cmd[2]);
+    DemoKitMotorUpdate(LEFT_SIDE);
+}
+
+void DemoKitServo2(const t_u8* const cmd/*in*/) /* Servo2 => Right Side change speed */
+{
+    g_sMotorDuty[RIGHT_SIDE] = MCTRL_duty(cmd[2]);
+    DemoKitMotorUpdate(RIGHT_SIDE);
+}
+
+void DemoKitRelay1(const t_u8* const cmd/*in*/) /* RELAY1 = LED1, Motor Left */
+{
+    GPIOPinWrite(LED1_PORT_BASE, LED1_PIN, cmd[2] ? LED1_PIN : 0);
+    g_bMotorOn[LEFT_SIDE] = (cmd[2] != 0);
+    DemoKitMotorUpdate(LEFT_SIDE);
+}
+
+void DemoKitRelay2(const t_u8* const cmd/*in*/) /* RELAY2 = LED2, Motor Right */
+{
+    GPIOPinWrite(LED2_PORT_BASE, LED2_PIN, cmd[2] ? LED2_PIN : 0);
+    g_bMotorOn[RIGHT_SIDE] = (cmd[2] != 0);
+    DemoKitMotorUpdate(RIGHT_SIDE);
+}
+
+void DemoKitMotorRamp(const t_u8* const cmd/*in*/) /* Motors ramp time from 0 to 100% in 10ms units, 0 = no limit */
+{
+    MCTRL_setRamp(cmd[2] * DEMOKIT_RAMP_UNIT_MS);
+}
+
+void DemoKitProfile(const t_u8* const cmd/*in*/) /* Log profiling probes, value 1 = clear probes after dump */
+{
+    PROFILE_dump();
+    if(cmd[2] == 1)
+    {
+        PROFILE_reset();
+    }
+}
+
+void DemoKitBench(const t_u8* const cmd/*in*/) /* Start a USB benchmark (BENCH_TEST_XXX), 0 = stop */
+{
+    BENCH_start(cmd[2]);
+}
+
+void DemoKitUsbTrace(const t_u8* const cmd/*in*/) /* Dump the USB trace on the UART, value 1 = clear the trace after dump */
+{
+    USBTRACE_dump(cmd[2] == 1);
+}
+
+/*
+ * Post the report of the benchmark just ended (DEMOKIT_BENCH_FRAME_SIZE bytes, see demokit_protocol.h)
+ * */
+static void BenchReportPost(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/)
+{
+    t_bench_report report;
+    t_u8 frame[DEMOKIT_BENCH_FRAME_SIZE];
+    t_u32 values[DEMOKIT_BENCH_PAYLOAD_SIZE / 4];
+    t_u32 i;
+
+    BENCH_getReport(&report);
+    values[0] = report.duration_ms;
+    values[1] = report.bytes;
+    values[2] = report.packets;
+    values[3] = report.rtt_p50_us;
+    values[4] = report.rtt_p90_us;
+    values[5] = report.rtt_p99_us;
+    values[6] = report.lost;
+    values[7] = report.rtt_max_us;
+    values[8] = report.rtt_min_us;
+
+    frame[0] = DEMOKIT_TYPE_SYSTEM;
+    frame[1] = DEMOKIT_ID_BENCH_REPORT;
+    frame[2] = report.test;
+    for(i = 0; i < (DEMOKIT_BENCH_PAYLOAD_SIZE / 4); i++)
+    {
+        frame[DEMOKIT_CMD_SIZE + (i * 4)] = (t_u8)(values[i] >> 24);
+        frame[DEMOKIT_CMD_SIZE + (i * 4) + 1] = (t_u8)(values[i] >> 16);
+        frame[DEMOKIT_CMD_SIZE + (i * 4) + 2] = (t_u8)(values[i] >> 8);
+        frame[DEMOKIT_CMD_SIZE + (i * 4) + 3] = (t_u8)values[i];
+    }
+    for(i = DEMOKIT_CMD_SIZE + ((DEMOKIT_BENCH_PAYLOAD_SIZE / 4) * 4); i < DEMOKIT_BENCH_FRAME_SIZE; i++)
+    {
+        frame[i] = 0;
+    }
+
+    DEMOKIT_eventsPostRaw(events, handle, frame, DEMOKIT_BENCH_FRAME_SIZE);
+}
+
+/*
+ * DemoKit button id of each input
+ * */
+static const struct
+{
+    t_u32 input; /* INPUT_XXX */
+    t_u8 id; /* DEMOKIT_ID_BUTTONX */
+} g_sInputButtons[] =
+{
+    { INPUT_SW1, DEMOKIT_ID_BUTTON1 },
+    { INPUT_SW2, DEMOKIT_ID_BUTTON2 },
+    { INPUT_BUMP_L, DEMOKIT_ID_BUTTON3 },
+    { INPUT_BUMP_R, DEMOKIT_ID_BUTTON4 }
+};
+#define NB_INPUT_BUTTONS (sizeof(g_sInputButtons) / sizeof(g_sInputButtons[0]))
+
+/*
+ * Post the DemoKit button events of the changed inputs, value 1=pressed 0=released.
+ * */
+static void InputsPost(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/,
+                       const t_u32 changed/*in*/, const t_u32 state/*in*/)
+{
+    t_u32 i;
+
+    for(i = 0; i < NB_INPUT_BUTTONS; i++)
+    {
+        if(changed & g_sInputButtons[i].input)
+        {
+            DEMOKIT_eventPost(events, handle, DEMOKIT_TYPE_BUTTON, g_sInputButtons[i].id,
+                              (state & g_sInputButtons[i].input) ? 1 : 0);
+        }
+    }
+}
+
+void DemoKitReflex(const t_u8* const cmd/*in*/) /* Reflex rule of button cmd[1], value = REFLEX_XXX actions, 0 = no rule */
+{
+    t_u32 i;
+
+    for(i = 0; i < NB_INPUT_BUTTONS; i++)
+    {
+        if(g_sInputButtons[i].id == cmd[1])
+        {
+            if(REFLEX_set(g_sInputButtons[i].input, cmd[2]) == false)
+            {
+                DLOG_ERROR("Reflex table full, rule of button %d ignored\n", cmd[1]);
+            }
+            return;
+        }
+    }
+}
+
+void DemoKitSpeed(const t_u8* const cmd/*in*/) /* Closed loop wheels speed, value signed in 4mm/s units */
+{
+    switch(cmd[1])
+    {
+        case DEMOKIT_ID_SPEED_LEFT:
+            SPEED_setTarget(LEFT_SIDE, (t_i32)((t_i8)cmd[2]) * DEMOKIT_SPEED_UNIT_MM_S);
+            break;
+
+        case DEMOKIT_ID_SPEED_RIGHT:
+            SPEED_setTarget(RIGHT_SIDE, (t_i32)((t_i8)cmd[2]) * DEMOKIT_SPEED_UNIT_MM_S);
+            break;
+
+        default:
+            SPEED_disable(LEFT_SIDE);
+            SPEED_disable(RIGHT_SIDE);
+            MCTRL_stop(LEFT_SIDE);
+            MCTRL_stop(RIGHT_SIDE);
+            break;
+    }
+}
+
+/*
+ * Odometry: pose frames period (0 = off) and sequence number
+ * */
+static t_u32 g_ulOdomPeriodMs = 0;
+static t_u8 g_ucOdomSeq = 0;
+
+void DemoKitOdometry(const t_u8* const cmd/*in*/) /* Pose frames rate in frames per second (0 = off) or pose reset */
+{
+    if(cmd[1] == DEMOKIT_ID_ODOM_RESET)
+    {
+        ODOM_reset();
+        return;
+    }
+
+    if(cmd[2] == 0)
+    {
+        g_ulOdomPeriodMs = 0;
+    }else
+    {
+        g_ulOdomPeriodMs = 1000 / ((cmd[2] > DEMOKIT_ODOM_RATE_MAX) ? DEMOKIT_ODOM_RATE_MAX : cmd[2]);
+    }
+}
+
+/*
+ * Post one pose frame (DEMOKIT_ODOM_FRAME_SIZE bytes, see demokit_protocol.h)
+ * */
+static void OdometryPost(t_demokit_events* const events/*in/out*/, t_AndroidInstance handle/*in*/)
+{
+    t_odom_pose pose;
+    t_u8 frame[DEMOKIT_ODOM_FRAME_SIZE];
+    t_u16 x_mm, y_mm, heading;
+
+    ODOM_get(&pose);
+    x_mm = (t_u16)(pose.x_um / 1000);
+    y_mm = (t_u16)(pose.y_um / 1000);
+    heading = (t_u16)(pose.heading >> 16);
+
+    frame[0] = DEMOKIT_TYPE_ODOMETRY;
+    frame[1] = DEMOKIT_ID_ODOM_POSE;
+    frame[2] = g_ucOdomSeq++;
+    frame[3] = (t_u8)(x_mm >> 8);
+    frame[4] = (t_u8)x_mm;
+    frame[5] = (t_u8)(y_mm >> 8);
+    frame[6] = (t_u8)y_mm;
+    frame[7] = (t_u8)(heading >> 8);
+    frame[8] = (t_u8)heading;
+
+    DEMOKIT_eventsPostRaw(events, handle, frame, DEMOKIT_ODOM_FRAME_SIZE);
+}
+
+/*
+ * Trajectory: fields of the next setpoint and status request for the main loop
+ * */
+static t_traj_setpoint g_sTrajSetpoint;
+static bool g_bTrajStatus = false;
+
+void DemoKitTrajectory(const t_u8* const cmd/*in*/) /* Build, queue, start or stop the timed motors setpoints */
+{
+    switch(cmd[1])
+    {
+        case DEMOKIT_ID_TRAJ_LEFT:
+            g_sTrajSetpoint.left = cmd[2];
+            break;
+
+        case DEMOKIT_ID_TRAJ_RIGHT:
+            g_sTrajSetpoint.right = cmd[2];
+            break;
+
+        case DEMOKIT_ID_TRAJ_DIR:
+            g_sTrajSetpoint.dir = cmd[2];
+            break;
+
+        case DEMOKIT_ID_TRAJ_PUSH:
+            g_sTrajSetpoint.delay_ms = cmd[2] * DEMOKIT_TRAJ_DELAY_UNIT_MS;
+            if(TRAJ_push(&g_sTrajSetpoint) == false)
+            {
+                DLOG_ERROR("Trajectory queue full, setpoint ignored\n");
+                g_bTrajStatus = true;
+            }
+            break;
+
+        case DEMOKIT_ID_TRAJ_RUN:
+            if(cmd[2] == 0)
+            {
+                TRAJ_stop();
+                MCTRL_stop(LEFT_SIDE);
+                MCTRL_stop(RIGHT_SIDE);
+            }else
+            {
+                TRAJ_start();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*
+ * Called by the decoder for each command received from Android
+ * */
+static void DemoKitCommand(const t_u8* const cmd/*in*/, void* pvData/*in*/)
+{
+    DLOG_DEBUG("read from Android: 0x%02X 0x%02X 0x%02X\n",
+             cmd[0], cmd[1], cmd[2]);
+
+    PROF_BEGIN(PROF_DISPATCH);
+    DEMOKIT_dispatch(cmd);
+    PROF_END(PROF_DISPATCH);
+}
+
+#if (DLOG_LEVEL >= DLOG_LEVEL_INFO)
+/*
+ * Log the time from plug to connected and of each connection phase (0 = phase not done),
+ * and the path taken: normal mode then accessory switch, or device plugged already in accessory mode
+ * */
+static t_u32 PhaseTime(const t_u32 start_us/*in*/, const t_u32 end_us/*in*/)
+{
+    return ((start_us != 0) && (end_us != 0)) ? (end_us - start_us) : 0;
+}
+
+static void ConnectReportLog(void)
+{
+    t_android_connect_report report;
+    t_u32 first_us;
+
+    ANDROID_getConnectReport(&report);
+    first_us = (report.plug_us != 0) ? report.plug_us :
+               ((report.open_us != 0) ? report.open_us : report.accessory_us);
+
+    if(report.open_us == 0)
+    {
+        /* Direct accessory: no accessory switch, the only enumeration ends when the accessory is opened */
+        DLOG_INFO("Connected in %u us (direct accessory): enum %u, pipes %u\n",
+                  PhaseTime(first_us, report.connected_us),
+                  PhaseTime(report.plug_us, report.accessory_us),
+                  PhaseTime(report.accessory_us, report.connected_us));
+        return;
+    }
+
+    DLOG_INFO("Connected in %u us (normal->switch): enum %u, protocol %u, strings %u, re-enum %u, pipes %u\n",
+              PhaseTime(first_us, report.connected_us),
+              PhaseTime(report.plug_us, report.open_us),
+              PhaseTime(report.open_us, report.protocol_us),
+              PhaseTime(report.protocol_us, report.strings_us),
+              PhaseTime(report.start_us, report.accessory_us),
+              PhaseTime(report.accessory_us, report.connected_us));
+}
+#else
+#define ConnectReportLog()
+#endif
+
 /*
  * Main example code
  * 
- * Warning never use ANDROID_write/ANDROID_read when if you just remove the USB cable else
- * the usblib driver USBHCDPipeWrite() or USBHCDPipeRead() will just do a loop forever and will need a reboot.
- * ANDROID_write/ANDROID_read need to be asynchronous/non blocking in a future update. 
+ * ANDROID_rxPeek/ANDROID_write are non blocking:
+ * ANDROID_rxPeek only gives access to data already received in the driver RX ring and
+ * ANDROID_write only queues the frame in the driver TX queue (sent from the USB interrupt). 
+ *
+ * The loop is event driven: the SysTick, USB and inputs GPIO interrupts post events,
+ * each loop runs only the work of the pending events and the core sleeps (WFI)
+ * when there is nothing to do.
+ * The display is drawn in a RAM framebuffer, each loop sends at most one slice of the changed
+ * columns so the blocking display bus never delays the USB and motors work by more than a slice.
  *  
  * */
  #define DISPLAY_REFRESH_MILLISEC    (125)
+ #define INPUT_EVENTS_WINDOW_MILLISEC (0) /* 0=Inputs changes of one loop are sent in one frame */
+ #define INPUT_DEBOUNCE_MILLISEC      (2) /* Inputs sample period, debounce time = DEBOUNCE_SAMPLES * 2ms */
 int main(void)
 {
-    t_u8 b1=0, b2=0, b3=0, b4=0;
+    t_u32 toggled;
+    t_u32 debounce_start;
+    t_u32 odom_start;
+#if (DLOG_LEVEL >= DLOG_LEVEL_DEBUG)
+    t_u32 first_edge_us; /* Only logged */
+#endif
+    bool edge_pending;
+    t_input_edge edge;
     t_u8 connected;
     t_u8 anim;
     t_u32 delta_ms;
     t_u32 start, end;    
-    float speed;
-    t_u16 speed_final;
+    t_u32 pending;
+    bool display_dirty;
+    int len;
+    const t_u8* rx_data;
+    bool bench_running;
+    t_demokit_decoder decoder;
+    t_demokit_events events;
     // The instance data for the Android driver.
     t_AndroidInstance ANDROIDInstance;
 
     connected = 0;
+    edge_pending = false;
+#if (DLOG_LEVEL >= DLOG_LEVEL_DEBUG)
+    first_edge_us = 0;
+#endif
     anim = 0;
     delta_ms = 0;
+
+    DEMOKIT_decoderInit(&decoder, DemoKitCommand, NULL);
+    DEMOKIT_eventsInit(&events, INPUT_EVENTS_WINDOW_MILLISEC);
     
     /* Hardware Init must be called before any use of Android API or GPIO defined in usb_android.h */
     Hardware_Init();
+    PROFILE_init();
+    INPUT_init();
+    TRAJ_init();
     
-    /* Init Motor with default value */
+    /* Init Motor, all the motors commands go through the fixed point command stage (motors stopped) */
     MotorsInit();
+    MCTRL_init();
+    SPEED_init();
+    ODOM_init();
     
-    /* Init Display */
-    Display96x16x1Init(true);    
-    Display96x16x1Clear();    
-    Display96x16x1DisplayOn();
+    /* Init Display, the texts are drawn in the framebuffer and sent by slices from the main loop */
+    DISPLAY_init();
     
-    Display96x16x1StringDraw("Android USB ADK", 0, 0);    
-    Display96x16x1StringDraw("Plug And2.3.4+", 0, 1);
-    UARTprintf("Please plug Android 2.3.4+ with DemoKit installed\n");
-    
-    MotorStop(LEFT_SIDE);
-    MotorDir(LEFT_SIDE, REVERSE);
-    MotorSpeed(LEFT_SIDE, 10 << 8); /* Set the motor duty cycle to 10% => Duty cycle is specified as 8.8 fixed point. */
+    DISPLAY_stringDraw("Android USB ADK", 0, 0);    
+    DISPLAY_stringDraw("Plug And2.3.4+", 0, 1);
+    display_dirty = true;
+    DLOG_INFO("Please plug Android 2.3.4+ with DemoKit installed\n");
 
-    MotorStop(RIGHT_SIDE);
-    MotorDir(RIGHT_SIDE, REVERSE);    
-    MotorSpeed(RIGHT_SIDE, 10 << 8);  /* Set the motor duty cycle to 10% => Duty cycle is specified as 8.8 fixed point. */
 
     // Open an instance of the ANDROID class driver.
     ANDROIDInstance = ANDROID_open(&ident_android_accessory);    
 
     start = GetTime_ms();
+    debounce_start = start;
+    odom_start = start;
 
     // Enter an infinite loop and manage USB Android
     while(1)
     {    
-        /* Wait a bit before to read/write to do not overload USB for nothing */
-        WaitTime_ms(1);
+        /* Sleep until an interrupt posts an event */
+        pending = EVENT_wait();
+        PROF_BEGIN(PROF_LOOP);
         
-        /* USB stack management */
+        /* USB stack management (the enumeration state machine also needs the tick) */
+        PROF_BEGIN(PROF_USB_REFRESH);
         USBStackRefresh();
+        PROF_END(PROF_USB_REFRESH);
+
+        /* Raw inputs edges, only the time of the first edge (bounce included) is kept */
+        if(pending & EVENT_MASK(EVENT_INPUT))
+        {
+            while(INPUT_get(&edge) == true)
+            {
+                if(edge_pending == false)
+                {
+#if (DLOG_LEVEL >= DLOG_LEVEL_DEBUG)
+                    first_edge_us = edge.time_us;
+#endif
+                    edge_pending = true;
+                }
+            }
+        }
+
+        /* Trajectory done (or starved), tell Android the queue is empty */
+        if((pending & EVENT_MASK(EVENT_TRAJ)) && (TRAJ_count() == 0))
+        {
+            g_bTrajStatus = true;
+        }
+
+        /* End of the reflexes back off */
+        if(pending & EVENT_MASK(EVENT_TICK))
+        {
+            REFLEX_update();
+        }
+
+        /* Debounce all inputs, the press/release events are sent at the end of the loop */
+        toggled = 0;
+        if((pending & EVENT_MASK(EVENT_TICK)) &&
+           (Delta_time_ms(debounce_start, GetTime_ms()) >= INPUT_DEBOUNCE_MILLISEC))
+        {
+            debounce_start = GetTime_ms();
+            toggled = INPUT_debounce();
+            if(toggled != 0)
+            {
+                DLOG_DEBUG("Inputs 0x%04X toggled state 0x%04X, first edge to event %u us\n",
+                           toggled, INPUT_state(), edge_pending ? (GetTime_us() - first_edge_us) : 0);
+                edge_pending = false;
+            }
+        }
         
        if(ANDROID_isConnected(ANDROIDInstance) == true)
         {  
-            t_u8 b;
-
             if(connected == 0)
             {
-                Display96x16x1ClearLine(1);
-                Display96x16x1StringDraw("Connected", 0, 1);
+                DISPLAY_clearLine(1);
+                DISPLAY_stringDraw("Connected", 0, 1);
+                display_dirty = true;
+                DEMOKIT_decoderReset(&decoder);
+                DEMOKIT_eventsInit(&events, INPUT_EVENTS_WINDOW_MILLISEC);
+                memset(&g_sTrajSetpoint, 0, sizeof(g_sTrajSetpoint));
+                g_bTrajStatus = false;
+                g_ulOdomPeriodMs = 0;
+                g_ucOdomSeq = 0;
                 connected = 1;
+                ConnectReportLog();
+#ifdef BENCH_AUTOSTART
+                BENCH_start(BENCH_AUTOSTART);
+#endif
+                /* Send the current state of all inputs to the new accessory */
+                InputsPost(&events, ANDROIDInstance, INPUT_ALL, INPUT_state());
+                toggled = 0;
             }
             
             /* Refresh display after "Connected " */
             end = GetTime_ms();            
             delta_ms = Delta_time_ms(start, end);        
-            if(delta_ms >= DISPLAY_REFRESH_MILLISEC)
+            if((pending & EVENT_MASK(EVENT_TICK)) && (delta_ms >= DISPLAY_REFRESH_MILLISEC))
             {
                 anim++;
                 if(anim>ANIM_NB_FRAMES)
                 {
                     anim=1;    
                 }
-                Display96x16x1StringDraw(char_anim[anim-1], 11*CHAR_CELL_WIDTH, 1);
+                DISPLAY_stringDraw(char_anim[anim-1], 11*DISPLAY_CHAR_WIDTH, 1);
+                display_dirty = true;
                 start = GetTime_ms();                
             }
 
-            if( (ANDROID_read(ANDROIDInstance, msg, 3)) > 0)
+            /* Decode all the commands received since last loop in place in the driver RX ring (one USB packet
+               can contain several commands, a command split over two packets is completed with the next packet),
+               data is received only by the USB interrupt */
+            if(pending & EVENT_MASK(EVENT_USB))
             {
-                UARTprintf("read from Android: 0x%02X 0x%02X 0x%02X\n",
-                         msg[0], msg[1], msg[2]);
-                    
-                // assumes only one command per packet
-                if (msg[0] == 2) 
+                do
                 {
-                    switch(msg[1])
-                    {
-                        case 0: /* LED1_RED */
-                        case 1: /* LED1_GREEN */
-                        case 2: /* LED1_BLUE */
-                        break;
-                        
-                        case 3: /* LED2_RED */
-                        case 4: /* LED2_GREEN */
-                        case 5: /* LED2_BLUE */
-                        break;
-                        
-                        case 6: /* LED3_RED */
-                        case 7: /* LED3_GREEN */
-                        case 8: /* LED3_BLUE */
-                        break;
-                        
-                        case 0x10: /* Servo1 => Left Side change speed */
-                            speed = ((float)(msg[2])/2.56f);
-                            // Duty cycle is specified as 8.8 fixed point.
-                            speed_final = ((t_u16)(speed))<<8;                     
-                            MotorSpeed(LEFT_SIDE, speed_final);
-                        break;
-                        
-                        case 0x11: /* Servo2 => Right Side change speed */
-                            speed = ((float)(msg[2])/2.56f);
-                            // Duty cycle is specified as 8.8 fixed point.
-                            speed_final = ((t_u16)(speed))<<8;                     
-                            MotorSpeed(RIGHT_SIDE, speed_final);                            
-                        break;
-                        
-                        case 0x12: /* Servo3 */
-                        break;
-                        
-                        default:
-                        break;
-                    }
-                } else if (msg[0] == 3) 
-                {
-                    if (msg[1] == 0) /* RELAY1 = LED1, Motor Left */
-                    {
-                        GPIOPinWrite(LED1_PORT_BASE, LED1_PIN, msg[2] ? LED1_PIN : 0);
-                        if(msg[2] == 0)
-                        {
-                            MotorStop(LEFT_SIDE);
-                        }else
-                        {
-                            // Start the motor running
-                            MotorRun(LEFT_SIDE);
-                        }                    
-                    }
-                    else if (msg[1] == 1)  /* RELAY2 = LED2, Motor Right */
+                    PROF_BEGIN(PROF_ANDROID_READ);
+                    len = ANDROID_rxPeek(ANDROIDInstance, &rx_data);
+                    PROF_END(PROF_ANDROID_READ);
+                    if(len > 0)
                     {
-                        GPIOPinWrite(LED2_PORT_BASE, LED2_PIN, msg[2] ? LED2_PIN : 0);
-                        if(msg[2] == 0)
+                        /* During a benchmark the data is the test traffic, not commands, except a packet of
+                           exactly one SYSTEM BENCH command (stop or next test, see bench.h) */
+                        if((BENCH_isRunning() == true) &&
+                           ((len != DEMOKIT_CMD_SIZE) || (rx_data[0] != DEMOKIT_TYPE_SYSTEM) ||
+                            (rx_data[1] != DEMOKIT_ID_BENCH)))
                         {
-                            MotorStop(RIGHT_SIDE);
+                            BENCH_rx(rx_data, len);
                         }else
                         {
-                            // Start the motor running
-                            MotorRun(RIGHT_SIDE);
-                        }    
+                            DEMOKIT_decode(&decoder, rx_data, len);
+                        }
+                        ANDROID_rxRelease(ANDROIDInstance, len);
                     }
-                }
+                }while(len > 0);
             }
 
-            msg[0] = 0x1;
-            b = GPIOPinRead(USER_SW1_PORT_BASE, USER_SW1_PIN);
-            if (b != b1) {
-                msg[1] = 0;
-                msg[2] = b ? 0 : 1;
-                ANDROID_write(ANDROIDInstance, msg, 3);
-                b1 = b;
+            /* Inputs changes are gathered in one frame sent at the end of the loop */
+            if(toggled != 0)
+            {
+                InputsPost(&events, ANDROIDInstance, toggled, INPUT_state());
             }
-    
-            b = GPIOPinRead(USER_SW2_PORT_BASE, USER_SW2_PIN);
-            if (b != b2) {
-                msg[1] = 1;
-                msg[2] = b ? 0 : 1;
-                ANDROID_write(ANDROIDInstance, msg, 3);
-                b2 = b;
+
+            if(g_bTrajStatus == true)
+            {
+                DEMOKIT_eventPost(&events, ANDROIDInstance, DEMOKIT_TYPE_TRAJECTORY, DEMOKIT_ID_TRAJ_STATUS,
+                                  TRAJ_QUEUE_SETPOINTS - TRAJ_count());
+                g_bTrajStatus = false;
             }
-            
-            b = GPIOPinRead(BUMP_L_SW3_PORT_BASE, BUMP_L_SW3_PIN);
-            if (b != b3) {
-                msg[1] = 2;
-                msg[2] = b ? 0 : 1;
-                ANDROID_write(ANDROIDInstance, msg, 3);
-                b3 = b;
-            }    
-                    
-            b = GPIOPinRead(BUMP_R_SW4_PORT_BASE, BUMP_R_SW4_PIN);
-            if (b != b4) {
-                msg[1] = 3;
-                msg[2] = b ? 0 : 1;
-                ANDROID_write(ANDROIDInstance, msg, 3);
-                b4 = b;
+
+            /* Pose frames at the rate set by Android (integrated by the speed control interrupt) */
+            if((g_ulOdomPeriodMs != 0) && (pending & EVENT_MASK(EVENT_TICK)) &&
+               (Delta_time_ms(odom_start, GetTime_ms()) >= g_ulOdomPeriodMs))
+            {
+                odom_start = GetTime_ms();
+                OdometryPost(&events, ANDROIDInstance);
+            }
+
+            /* Benchmark frames go straight to the TX queue, the report is sent once the test ends.  The
+               commands stream restarts on a command boundary when a test starts or ends (no partial command
+               completed with the test traffic) */
+            bench_running = BENCH_isRunning();
+            if(BENCH_process(ANDROIDInstance) == true)
+            {
+                DEMOKIT_decoderReset(&decoder);
+                BenchReportPost(&events, ANDROIDInstance);
+            }else if(BENCH_isRunning() != bench_running)
+            {
+                DEMOKIT_decoderReset(&decoder);
             }
+
+            /* Send the events frame (one USB transfer for all the events of the window) */
+            PROF_BEGIN(PROF_ANDROID_WRITE);
+            DEMOKIT_eventsFlush(&events, ANDROIDInstance);
+            PROF_END(PROF_ANDROID_WRITE);
         }else
         {
             if(connected == 1)
             {
-                Display96x16x1ClearLine(1);
-                Display96x16x1StringDraw("Disconnected", 0, 1);
+                DISPLAY_clearLine(1);
+                DISPLAY_stringDraw("Disconnected", 0, 1);
+                display_dirty = true;
+                /* The rules and setpoints belong to the Android application */
+                REFLEX_clear();
+                TRAJ_stop();
+                BENCH_stop();
                 connected = 0;
             }            
         }
+
+        /* Send one slice of the changed display columns, the rest is sent on next loops */
+        if(display_dirty == true)
+        {
+            PROF_BEGIN(PROF_DISPLAY);
+            display_dirty = DISPLAY_flush(DISPLAY_FLUSH_COLUMNS);
+            PROF_END(PROF_DISPLAY);
+        }
+
+        PROF_END(PROF_LOOP);
+
+        /* Loop work done, send pending log entries to the UART (never waits for the serial port) */
+        DLOG_process();
+
+        /* USB trace dump lines once the log entries are sent */
+        if(DLOG_isEmpty() == true)
+        {
+            USBTRACE_process();
+        }
     }
 }
 
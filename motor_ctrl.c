@@ -0,0 +1,233 @@
+//*****************************************************************************
+//
+// motor_ctrl.c - Fixed point motors command stage with slew rate limiting.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+
+#include "drivers/motor.h"
+
+#include "usb_android.h"
+#include "motor_ctrl.h"
+
+//*****************************************************************************
+//
+// Target and applied duty of each motor side (LEFT_SIDE, RIGHT_SIDE).
+//
+//*****************************************************************************
+typedef struct
+{
+    volatile t_i16 target;
+    volatile t_i16 duty;
+} t_mctrl_motor;
+
+static t_mctrl_motor g_sMCTRLMotors[2];
+
+// Maximum duty change per control period, 0 = no limit.
+static volatile t_u16 g_usMCTRLSlewStep = 0;
+
+// Duty of each DemoKit value.
+static t_u16 g_usMCTRLDutyLut[256];
+
+//*****************************************************************************
+//
+// Apply a duty to one motor, only the motor driver calls needed for the
+// change are done.
+//
+//*****************************************************************************
+static void MCTRL_apply(tSide eSide, t_i16 sDuty)
+{
+    t_i16 sOld;
+
+    sOld = g_sMCTRLMotors[eSide].duty;
+    if(sDuty == sOld)
+    {
+        return;
+    }
+    g_sMCTRLMotors[eSide].duty = sDuty;
+
+    if(sDuty == 0)
+    {
+        MotorStop(eSide);
+        return;
+    }
+
+    if(((sOld <= 0) && (sDuty > 0)) || ((sOld >= 0) && (sDuty < 0)))
+    {
+        MotorDir(eSide, (sDuty < 0) ? MOTOR_DIR_BACK : MOTOR_DIR_AHEAD);
+    }
+
+    MotorSpeed(eSide, (t_u16)((sDuty < 0) ? -sDuty : sDuty));
+
+    if(sOld == 0)
+    {
+        MotorRun(eSide);
+    }
+}
+
+//*****************************************************************************
+//
+// This is the handler for the Timer1 A interrupt (MCTRL_RATE_HZ): move the
+// applied duty of each motor toward its target.
+//
+//*****************************************************************************
+void
+MotorCtrlTimerIntHandler(void)
+{
+    t_i32 lDelta;
+    t_i32 lStep;
+    t_u32 i;
+
+    ROM_TimerIntClear(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
+
+    lStep = g_usMCTRLSlewStep;
+    for(i = 0; i < 2; i++)
+    {
+        lDelta = g_sMCTRLMotors[i].target - g_sMCTRLMotors[i].duty;
+        if(lDelta == 0)
+        {
+            continue;
+        }
+
+        if(lStep != 0)
+        {
+            if(lDelta > lStep)
+            {
+                lDelta = lStep;
+            }
+            else if(lDelta < -lStep)
+            {
+                lDelta = -lStep;
+            }
+        }
+
+        MCTRL_apply((tSide)i, (t_i16)(g_sMCTRLMotors[i].duty + lDelta));
+    }
+}
+
+//*****************************************************************************
+//
+//! This function initializes the motors command stage.
+//!
+//! The DemoKit value to duty lookup table is computed (value 0 is stopped,
+//! values 1 to 255 are spread from MCTRL_DUTY_MIN to MCTRL_DUTY_MAX) and
+//! Timer1 A is started as the periodic control timer.  The motors must be
+//! stopped.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void MCTRL_init(void)
+{
+    t_u32 i;
+
+    g_usMCTRLDutyLut[0] = 0;
+    for(i = 1; i < 256; i++)
+    {
+        g_usMCTRLDutyLut[i] = MCTRL_DUTY_MIN + (((MCTRL_DUTY_MAX - MCTRL_DUTY_MIN) * i) / 255);
+    }
+
+    for(i = 0; i < 2; i++)
+    {
+        g_sMCTRLMotors[i].target = 0;
+        g_sMCTRLMotors[i].duty = 0;
+    }
+    MCTRL_setRamp(MCTRL_RAMP_MS_DEFAULT);
+
+    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER1);
+    ROM_TimerConfigure(TIMER1_BASE, TIMER_CFG_32_BIT_PER);
+    ROM_TimerLoadSet(TIMER1_BASE, TIMER_A, ROM_SysCtlClockGet() / MCTRL_RATE_HZ);
+    ROM_TimerIntEnable(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
+    ROM_IntEnable(INT_TIMER1A);
+    ROM_TimerEnable(TIMER1_BASE, TIMER_A);
+}
+
+t_i16 MCTRL_duty(const t_u8 value/*in*/)
+{
+    return (t_i16)g_usMCTRLDutyLut[value];
+}
+
+void MCTRL_setTarget(const tSide side/*in*/, const t_i16 duty/*in*/)
+{
+    g_sMCTRLMotors[side].target = duty;
+}
+
+t_i16 MCTRL_getTarget(const tSide side/*in*/)
+{
+    return g_sMCTRLMotors[side].target;
+}
+
+t_i16 MCTRL_getDuty(const tSide side/*in*/)
+{
+    return g_sMCTRLMotors[side].duty;
+}
+
+//*****************************************************************************
+//
+//! This function sets the slew rate limit.
+//!
+//! \param ramp_ms is the time to go from 0 to MCTRL_DUTY_MAX, 0 disables the
+//! limit (the target is applied on the next control period).
+//!
+//! \return None.
+//
+//*****************************************************************************
+void MCTRL_setRamp(const t_u32 ramp_ms/*in*/)
+{
+    t_u32 ulStep;
+
+    ulStep = 0;
+    if(ramp_ms != 0)
+    {
+        ulStep = (MCTRL_DUTY_MAX * 1000) / (ramp_ms * MCTRL_RATE_HZ);
+        if(ulStep == 0)
+        {
+            ulStep = 1;
+        }
+    }
+
+    g_usMCTRLSlewStep = (t_u16)ulStep;
+}
+
+//*****************************************************************************
+//
+//! This function applies a duty immediately.
+//!
+//! \param side is the motor.
+//! \param duty is the new target and applied duty.
+//!
+//! The interrupts are masked so the control interrupt can not apply an old
+//! target in the middle of the change.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void MCTRL_setNow(const tSide side/*in*/, const t_i16 duty/*in*/)
+{
+    tBoolean bIntDisabled;
+
+    bIntDisabled = IntMasterDisable();
+
+    g_sMCTRLMotors[side].target = duty;
+    MCTRL_apply(side, duty);
+
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
+
+void MCTRL_stop(const tSide side/*in*/)
+{
+    MCTRL_setNow(side, 0);
+}
@@ -0,0 +1,76 @@
+//*****************************************************************************
+//
+// motor_ctrl.h - Fixed point motors command stage with slew rate limiting.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __MOTOR_CTRL_H__
+#define __MOTOR_CTRL_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * All the motors commands go through this stage, duty cycles are signed 8.8
+ * fixed point percent (MotorSpeed() format, negative = backward).
+ * The application sets a target duty, the Timer1 A interrupt runs at
+ * MCTRL_RATE_HZ and moves the applied duty toward the target by at most the
+ * slew step per period, the motor driver is called only when the applied
+ * duty changes.  MCTRL_stop() and MCTRL_setNow() bypass the ramp (reflexes).
+ * There is no floating point: DemoKit values 0 to 255 are converted with a
+ * lookup table computed once by MCTRL_init().
+ */
+#define MCTRL_RATE_HZ       (1000)
+
+#define MCTRL_DUTY_MAX      (100 << 8) /* 100% */
+#define MCTRL_DUTY_MIN      (0) /* Duty of value 1, raise it to skip the motors dead band */
+
+/* Default ramp: 0 to 100% in 250ms */
+#define MCTRL_RAMP_MS_DEFAULT   (250)
+
+/* API */
+
+/* Compute the lookup table and start the control timer (call after MotorsInit()) */
+extern void MCTRL_init(void);
+
+/* Convert a 0 to 255 value to a duty cycle (0 = stopped, 255 = MCTRL_DUTY_MAX) */
+extern t_i16 MCTRL_duty(const t_u8 value/*in*/);
+
+/* Set the target duty, reached with the slew rate limit */
+extern void MCTRL_setTarget(const tSide side/*in*/, const t_i16 duty/*in*/);
+
+extern t_i16 MCTRL_getTarget(const tSide side/*in*/);
+
+/* Return the duty applied to the motor now */
+extern t_i16 MCTRL_getDuty(const tSide side/*in*/);
+
+/* Set the ramp time from 0 to 100% (0 = no slew rate limit) */
+extern void MCTRL_setRamp(const t_u32 ramp_ms/*in*/);
+
+/* Apply a duty immediately, without ramp (any context) */
+extern void MCTRL_setNow(const tSide side/*in*/, const t_i16 duty/*in*/);
+
+/* Stop the motor immediately (any context) */
+extern void MCTRL_stop(const tSide side/*in*/);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MOTOR_CTRL_H__
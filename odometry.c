@@ -0,0 +1,178 @@
+//*****************************************************************************
+//
+// odometry.c - Fixed point robot pose integration from the wheel encoders.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+
+#include "drivers/motor.h"
+
+#include "usb_android.h"
+#include "speed.h"
+#include "odometry.h"
+
+//*****************************************************************************
+//
+// Quarter wave sine table, 64 steps from 0 to 90 degrees in Q15.
+//
+//*****************************************************************************
+static const t_i16 g_sOdomSinTable[65] =
+{
+        0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+     6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767
+};
+
+#define ODOM_QUARTER_TURN   (0x40000000UL)
+
+//*****************************************************************************
+//
+// The pose, written only by the speed control interrupt (and ODOM_reset()
+// with the interrupts masked).
+//
+//*****************************************************************************
+static volatile t_odom_pose g_sOdomPose;
+
+// Encoder counts at the previous update.
+static t_i32 g_lOdomLastCount[2];
+
+//*****************************************************************************
+//
+//! This function returns the sine of a binary angle.
+//!
+//! \param angle is the angle, 1<<32 = one turn.
+//!
+//! The quarter wave table is interpolated with the 8 bits below its index.
+//!
+//! \return The sine in Q15.
+//
+//*****************************************************************************
+t_i32 ODOM_sin(const t_u32 angle/*in*/)
+{
+    t_u32 ulPhase;
+    t_u32 ulIndex;
+    t_i32 lSin;
+
+    ulPhase = angle & (ODOM_QUARTER_TURN - 1);
+    if(angle & ODOM_QUARTER_TURN)
+    {
+        ulPhase = ODOM_QUARTER_TURN - ulPhase;
+    }
+
+    ulIndex = ulPhase >> 24;
+    lSin = g_sOdomSinTable[ulIndex];
+    if(ulIndex < 64)
+    {
+        lSin += ((g_sOdomSinTable[ulIndex + 1] - lSin) * (t_i32)((ulPhase >> 16) & 0xFF)) >> 8;
+    }
+
+    return (angle & (ODOM_QUARTER_TURN << 1)) ? -lSin : lSin;
+}
+
+t_i32 ODOM_cos(const t_u32 angle/*in*/)
+{
+    return ODOM_sin(angle + ODOM_QUARTER_TURN);
+}
+
+//*****************************************************************************
+//
+//! This function integrates the wheels motion since the previous call.
+//!
+//! The robot is moved by the mean distance of the wheels along the heading
+//! of the middle of the period, then turned by the difference of the wheels
+//! distances.  At SPEED_RATE_HZ the distance of one period is far below the
+//! 65mm that would overflow the 32 bits products.
+//!
+//! This function is called from the speed control interrupt.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void ODOM_update(void)
+{
+    t_i32 lCount[2];
+    t_i32 lDelta[2];
+    t_i32 lDist;
+    t_u32 ulTurn;
+    t_u32 ulMid;
+    t_u32 i;
+
+    for(i = 0; i < 2; i++)
+    {
+        lCount[i] = SPEED_getCount((tSide)i);
+        lDelta[i] = lCount[i] - g_lOdomLastCount[i];
+        g_lOdomLastCount[i] = lCount[i];
+    }
+
+    if((lDelta[LEFT_SIDE] == 0) && (lDelta[RIGHT_SIDE] == 0))
+    {
+        return;
+    }
+
+    lDist = ((lDelta[LEFT_SIDE] + lDelta[RIGHT_SIDE]) * SPEED_UM_PER_EDGE) / 2;
+    ulTurn = (t_u32)((t_i64)(lDelta[RIGHT_SIDE] - lDelta[LEFT_SIDE]) * ODOM_ANGLE_PER_EDGE);
+    ulMid = g_sOdomPose.heading + (t_u32)((t_i32)ulTurn / 2);
+
+    g_sOdomPose.x_um += ((lDist * ODOM_cos(ulMid)) + (1 << 14)) >> 15;
+    g_sOdomPose.y_um += ((lDist * ODOM_sin(ulMid)) + (1 << 14)) >> 15;
+    g_sOdomPose.heading += ulTurn;
+}
+
+//*****************************************************************************
+//
+//! This function initializes the odometry.
+//!
+//! The current encoder counts are the reference of the first update.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void ODOM_init(void)
+{
+    t_u32 i;
+
+    for(i = 0; i < 2; i++)
+    {
+        g_lOdomLastCount[i] = SPEED_getCount((tSide)i);
+    }
+    ODOM_reset();
+}
+
+void ODOM_reset(void)
+{
+    tBoolean bIntDisabled;
+
+    bIntDisabled = IntMasterDisable();
+    g_sOdomPose.x_um = 0;
+    g_sOdomPose.y_um = 0;
+    g_sOdomPose.heading = 0;
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
+
+void ODOM_get(t_odom_pose* const pose/*out*/)
+{
+    tBoolean bIntDisabled;
+
+    bIntDisabled = IntMasterDisable();
+    pose->x_um = g_sOdomPose.x_um;
+    pose->y_um = g_sOdomPose.y_um;
+    pose->heading = g_sOdomPose.heading;
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
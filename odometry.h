@@ -0,0 +1,73 @@
+//*****************************************************************************
+//
+// odometry.h - Fixed point robot pose integration from the wheel encoders.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __ODOMETRY_H__
+#define __ODOMETRY_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * The pose is integrated by the speed control interrupt (SPEED_RATE_HZ) from
+ * the encoder edges counted by speed.c, there is no floating point:
+ * - x and y are in micrometers (start pose = origin, x ahead),
+ * - the heading is a binary angle, 1<<32 = one turn (wraps naturally),
+ *   counterclockwise positive,
+ * - sin/cos come from a quarter wave table (Q15) with linear interpolation.
+ */
+#define ODOM_WHEEL_BASE_MM  (100) /* Distance between the wheels (calibrate on the robot) */
+
+/* Heading change of one edge difference between the wheels (binary angle) */
+#define ODOM_ANGLE_PER_EDGE ((t_i32)(((t_u64)SPEED_UM_PER_EDGE << 32) / ((ODOM_WHEEL_BASE_MM * 6283185) / 1000)))
+
+typedef struct
+{
+    t_i32 x_um;
+    t_i32 y_um;
+    t_u32 heading; /* Binary angle, 1<<32 = 360 degrees */
+} t_odom_pose;
+
+/* API */
+
+/* Clear the pose (call after SPEED_init()) */
+extern void ODOM_init(void);
+
+/* Set the current pose as the origin (any context) */
+extern void ODOM_reset(void);
+
+/* Copy a consistent snapshot of the pose (any context) */
+extern void ODOM_get(t_odom_pose* const pose/*out*/);
+
+/* Integrate the encoder edges since the previous call (speed control interrupt only) */
+extern void ODOM_update(void);
+
+/* Sine of a binary angle in Q15 (-32767 to 32767) */
+extern t_i32 ODOM_sin(const t_u32 angle/*in*/);
+
+/* Cosine of a binary angle in Q15 (-32767 to 32767) */
+extern t_i32 ODOM_cos(const t_u32 angle/*in*/);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ODOMETRY_H__
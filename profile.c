@@ -0,0 +1,117 @@
+//*****************************************************************************
+//
+// profile.c - Hot path profiling with the Cortex-M3 DWT cycle counter.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_types.h"
+
+#include "usb_android.h"
+#include "deferred_log.h"
+#include "profile.h"
+
+#ifdef PROFILE_ENABLE
+
+//*****************************************************************************
+//
+// The probes statistics and names.
+//
+//*****************************************************************************
+t_profile_stat g_sProfileStats[PROF_NB_PROBES];
+
+#define PROFILE_PROBE_NAME(probe, name) name,
+static const char * const g_pcProfileNames[PROF_NB_PROBES] =
+{
+    PROFILE_PROBES(PROFILE_PROBE_NAME)
+};
+
+//*****************************************************************************
+//
+//! This function enables the DWT cycle counter and clears all the probes.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void PROFILE_init(void)
+{
+    HWREG(PROFILE_DEMCR) |= PROFILE_DEMCR_TRCENA;
+    HWREG(PROFILE_DWT_CYCCNT) = 0;
+    HWREG(PROFILE_DWT_CTRL) |= PROFILE_DWT_CTRL_CYCCNTENA;
+
+    PROFILE_reset();
+}
+
+void PROFILE_reset(void)
+{
+    int i;
+
+    for(i = 0; i < PROF_NB_PROBES; i++)
+    {
+        g_sProfileStats[i].count = 0;
+        g_sProfileStats[i].min = MAX_T_U32;
+        g_sProfileStats[i].max = 0;
+        g_sProfileStats[i].total = 0;
+    }
+}
+
+//*****************************************************************************
+//
+//! This function adds one measure to a probe.
+//!
+//! \param probe is the probe measured.
+//! \param cycles is the number of core cycles measured (the unsigned
+//! difference of two CYCCNT values is right across a counter wrap).
+//!
+//! \return None.
+//
+//*****************************************************************************
+void PROFILE_update(const t_profile_probe probe/*in*/, const t_u32 cycles/*in*/)
+{
+    t_profile_stat *pStat;
+
+    pStat = &g_sProfileStats[probe];
+    pStat->count++;
+    pStat->total += cycles;
+    if(cycles < pStat->min)
+    {
+        pStat->min = cycles;
+    }
+    if(cycles > pStat->max)
+    {
+        pStat->max = cycles;
+    }
+}
+
+//*****************************************************************************
+//
+//! This function logs the statistics of all probes (cycles and microseconds).
+//!
+//! \return None.
+//
+//*****************************************************************************
+void PROFILE_dump(void)
+{
+    int i;
+    t_u32 mean;
+    t_profile_stat *pStat;
+
+    DLOG_INFO("Profile (cycles @%dMHz): count min max mean\n", PROFILE_CYCLES_PER_US);
+    for(i = 0; i < PROF_NB_PROBES; i++)
+    {
+        pStat = &g_sProfileStats[i];
+        if(pStat->count == 0)
+        {
+            DLOG_INFO(" %s: no measure\n", (t_u32)g_pcProfileNames[i]);
+            continue;
+        }
+        mean = (t_u32)(pStat->total / pStat->count);
+        DLOG_INFO(" %s: %d %d %d %d (max %dus)\n", (t_u32)g_pcProfileNames[i],
+                  pStat->count, pStat->min, pStat->max, mean,
+                  pStat->max / PROFILE_CYCLES_PER_US);
+    }
+}
+
+#endif /* PROFILE_ENABLE */
@@ -0,0 +1,105 @@
+//*****************************************************************************
+//
+// profile.h - Hot path profiling with the Cortex-M3 DWT cycle counter.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Profiling probes: X(probe, name)
+ * Each probe keeps count/min/max/mean of the cycles measured between
+ * PROF_BEGIN(probe) and PROF_END(probe), PROFILE_dump() logs the table.
+ * Probes are not reentrant (one measure in progress per probe).
+ */
+#define PROFILE_PROBES(X) \
+    X(PROF_LOOP,            "Main loop") \
+    X(PROF_USB_REFRESH,     "USBStackRefresh") \
+    X(PROF_ANDROID_READ,    "ANDROID_read") \
+    X(PROF_ANDROID_WRITE,   "ANDROID_write") \
+    X(PROF_DISPATCH,        "Command dispatch") \
+    X(PROF_DISPLAY,         "Display update") \
+    X(PROF_SPEED_LOOP,      "Speed PI loop and odometry")
+
+#define PROFILE_PROBE_ENUM(probe, name) probe,
+typedef enum
+{
+    PROFILE_PROBES(PROFILE_PROBE_ENUM)
+    PROF_NB_PROBES
+} t_profile_probe;
+
+/* Cortex-M3 Data Watchpoint and Trace unit cycle counter */
+#define PROFILE_DEMCR           (0xE000EDFC) /* Debug Exception and Monitor Control Register */
+#define PROFILE_DEMCR_TRCENA    (0x01000000)
+#define PROFILE_DWT_CTRL        (0xE0001000)
+#define PROFILE_DWT_CTRL_CYCCNTENA (0x00000001)
+#define PROFILE_DWT_CYCCNT      (0xE0001004)
+
+/* Core clock (Hardware_Init() sets 50MHz), used to display microseconds */
+#define PROFILE_CYCLES_PER_US   (50)
+
+typedef struct
+{
+    t_u32 start; /* CYCCNT at PROF_BEGIN() */
+    t_u32 count;
+    t_u32 min;
+    t_u32 max;
+    t_u64 total;
+} t_profile_stat;
+
+#ifdef PROFILE_ENABLE
+
+extern t_profile_stat g_sProfileStats[PROF_NB_PROBES];
+
+#define PROF_BEGIN(probe)   (g_sProfileStats[probe].start = HWREG(PROFILE_DWT_CYCCNT))
+#define PROF_END(probe)     PROFILE_update(probe, HWREG(PROFILE_DWT_CYCCNT) - g_sProfileStats[probe].start)
+
+/* API */
+
+/* Enable the DWT cycle counter and clear all the probes */
+extern void PROFILE_init(void);
+
+extern void PROFILE_reset(void);
+
+/* Add one measure to a probe (use PROF_END() instead) */
+extern void PROFILE_update(const t_profile_probe probe/*in*/, const t_u32 cycles/*in*/);
+
+/* Log count/min/max/mean of all probes (with DLOG_INFO) */
+extern void PROFILE_dump(void);
+
+#else /* PROFILE_ENABLE */
+
+/* Profiling disabled, no code and no data */
+#define PROF_BEGIN(probe)
+#define PROF_END(probe)
+#define PROFILE_init()
+#define PROFILE_reset()
+#define PROFILE_dump()
+
+#endif /* PROFILE_ENABLE */
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PROFILE_H__
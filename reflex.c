@@ -0,0 +1,216 @@
+//*****************************************************************************
+//
+// reflex.c - Local reflexes: motor actions run from the inputs interrupt.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+
+#include "drivers/motor.h"
+
+#include "usb_android.h"
+#include "deferred_log.h"
+#include "motor_ctrl.h"
+#include "speed.h"
+#include "trajectory.h"
+#include "reflex.h"
+
+//*****************************************************************************
+//
+// The rules table.  Written by the main loop, read by the GPIO interrupt: a
+// rule is disabled (actions 0) while its input is changed, each field is
+// updated with a single store.
+//
+//*****************************************************************************
+typedef struct
+{
+    volatile t_u32 input; /* INPUT_XXX bit */
+    volatile t_u8 actions; /* REFLEX_XXX, 0=free rule */
+} t_reflex_rule;
+
+static t_reflex_rule g_sReflexRules[REFLEX_NB_RULES];
+
+//*****************************************************************************
+//
+// Back off in progress for each motor side (LEFT_SIDE, RIGHT_SIDE).
+//
+//*****************************************************************************
+static volatile bool g_bReflexBackoff[2];
+static volatile t_u32 g_ulReflexBackoffStart[2];
+static volatile t_u32 g_ulReflexBackoffMs[2];
+
+//*****************************************************************************
+//
+//! This function adds, replaces or removes the rule of one input.
+//!
+//! \param input is the INPUT_XXX bit triggering the rule on press.
+//! \param actions is the REFLEX_XXX actions, 0 removes the rule.
+//!
+//! \return Returns false if there is no free rule, true otherwise.
+//
+//*****************************************************************************
+bool REFLEX_set(const t_u32 input/*in*/, const t_u8 actions/*in*/)
+{
+    t_u32 i;
+    t_reflex_rule *pFree;
+
+    pFree = NULL;
+    for(i = 0; i < REFLEX_NB_RULES; i++)
+    {
+        if((g_sReflexRules[i].actions != 0) && (g_sReflexRules[i].input == input))
+        {
+            g_sReflexRules[i].actions = actions;
+            return true;
+        }
+        if((g_sReflexRules[i].actions == 0) && (pFree == NULL))
+        {
+            pFree = &g_sReflexRules[i];
+        }
+    }
+
+    if(actions == 0)
+    {
+        return true;
+    }
+
+    if(pFree == NULL)
+    {
+        return false;
+    }
+
+    // The rule becomes active with its actions store.
+    pFree->input = input;
+    pFree->actions = actions;
+
+    return true;
+}
+
+void REFLEX_clear(void)
+{
+    t_u32 i;
+
+    for(i = 0; i < REFLEX_NB_RULES; i++)
+    {
+        g_sReflexRules[i].actions = 0;
+    }
+}
+
+//*****************************************************************************
+//
+// Start the back off of one motor.
+//
+//*****************************************************************************
+static void REFLEX_backoff(tSide eSide, t_u32 ulBackoffMs)
+{
+    MCTRL_setNow(eSide, -REFLEX_BACKOFF_DUTY);
+
+    g_ulReflexBackoffStart[eSide] = GetTime_ms();
+    g_ulReflexBackoffMs[eSide] = ulBackoffMs;
+    g_bReflexBackoff[eSide] = true;
+}
+
+//*****************************************************************************
+//
+//! This function runs the rules of the inputs pressed.
+//!
+//! \param changed is the INPUT_XXX bits with an edge.
+//! \param state is the INPUT_XXX bits pressed.
+//!
+//! This function is called from the GPIO edge interrupt, before the edge is
+//! queued for the main loop.  Contact bounce triggers the rule again, which
+//! only restarts the back off time.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void REFLEX_run(const t_u32 changed/*in*/, const t_u32 state/*in*/)
+{
+    t_u32 ulPressed;
+    t_u32 ulBackoffMs;
+    t_u8 ucActions;
+    t_u32 i;
+
+    ulPressed = changed & state;
+    if(ulPressed == 0)
+    {
+        return;
+    }
+
+    for(i = 0; i < REFLEX_NB_RULES; i++)
+    {
+        ucActions = g_sReflexRules[i].actions;
+        if((ucActions == 0) || ((g_sReflexRules[i].input & ulPressed) == 0))
+        {
+            continue;
+        }
+
+        // The planned motion is obsolete after a collision.
+        TRAJ_stop();
+
+        if(ucActions & (REFLEX_STOP_LEFT | REFLEX_BACK_LEFT))
+        {
+            SPEED_disable(LEFT_SIDE);
+            MCTRL_stop(LEFT_SIDE);
+        }
+        if(ucActions & (REFLEX_STOP_RIGHT | REFLEX_BACK_RIGHT))
+        {
+            SPEED_disable(RIGHT_SIDE);
+            MCTRL_stop(RIGHT_SIDE);
+        }
+
+        ulBackoffMs = (ucActions >> REFLEX_BACKOFF_SHIFT) * REFLEX_BACKOFF_UNIT_MS;
+        if(ucActions & REFLEX_BACK_LEFT)
+        {
+            REFLEX_backoff(LEFT_SIDE, ulBackoffMs);
+        }
+        if(ucActions & REFLEX_BACK_RIGHT)
+        {
+            REFLEX_backoff(RIGHT_SIDE, ulBackoffMs);
+        }
+
+        DLOG_INFO("Reflex input 0x%04X actions 0x%02X\n", g_sReflexRules[i].input, ucActions);
+    }
+}
+
+//*****************************************************************************
+//
+//! This function ends the back off of the motors.
+//!
+//! This function must be called periodically from the main loop, the motor is
+//! stopped when the back off time is elapsed.  The check is done with interrupts masked since a new reflex can
+//! restart the back off at any time.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void REFLEX_update(void)
+{
+    tBoolean bIntDisabled;
+    t_u32 i;
+
+    for(i = 0; i < 2; i++)
+    {
+        if(g_bReflexBackoff[i] == false)
+        {
+            continue;
+        }
+
+        bIntDisabled = IntMasterDisable();
+
+        if((g_bReflexBackoff[i] == true) &&
+           (Delta_time_ms(g_ulReflexBackoffStart[i], GetTime_ms()) >= g_ulReflexBackoffMs[i]))
+        {
+            MCTRL_stop((tSide)i);
+            g_bReflexBackoff[i] = false;
+        }
+
+        if(!bIntDisabled)
+        {
+            IntMasterEnable();
+        }
+    }
+}
@@ -0,0 +1,75 @@
+//*****************************************************************************
+//
+// reflex.h - Local reflexes: motor actions run from the inputs interrupt.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __REFLEX_H__
+#define __REFLEX_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * A reflex rule is "on press of input X: actions". The rules are uploaded by
+ * Android (DEMOKIT_TYPE_REFLEX) and run by REFLEX_run() directly from the GPIO
+ * edge interrupt, the motors react in a few microseconds without waiting for
+ * the main loop or an USB round trip.  A rule also stops the trajectory
+ * (trajectory.h) in progress and the speed control (speed.h) of the motors
+ * it stops.
+ *
+ * Rule actions (one byte, DemoKit command value):
+ *  bit 0: stop the left motor
+ *  bit 1: stop the right motor
+ *  bit 2: run the left motor backward (back off) then stop it
+ *  bit 3: run the right motor backward (back off) then stop it
+ *  bit 4-7: back off time in REFLEX_BACKOFF_UNIT_MS units
+ * Actions 0 removes the rule of the input.
+ */
+#define REFLEX_STOP_LEFT        (0x01)
+#define REFLEX_STOP_RIGHT       (0x02)
+#define REFLEX_BACK_LEFT        (0x04)
+#define REFLEX_BACK_RIGHT       (0x08)
+#define REFLEX_BACKOFF_SHIFT    (4)
+#define REFLEX_BACKOFF_UNIT_MS  (50)
+
+#define REFLEX_NB_RULES         (4)
+
+/* Back off duty cycle (8.8 fixed point percent, applied without ramp) */
+#define REFLEX_BACKOFF_DUTY     (25 << 8)
+
+/* API */
+
+/* Add, replace (same input) or remove (actions 0) the rule of one input, return false if no free rule */
+extern bool REFLEX_set(const t_u32 input/*in*/, const t_u8 actions/*in*/);
+
+/* Remove all the rules */
+extern void REFLEX_clear(void);
+
+/* Run the rules of the pressed inputs (GPIO interrupt context) */
+extern void REFLEX_run(const t_u32 changed/*in*/, const t_u32 state/*in*/);
+
+/* Stop the motors at the end of the back off time (main loop, once per tick) */
+extern void REFLEX_update(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __REFLEX_H__
@@ -0,0 +1,260 @@
+//*****************************************************************************
+//
+// speed.c - Closed loop wheels speed control with the wheel encoders.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "driverlib/rom.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+
+#include "drivers/motor.h"
+
+#include "usb_android.h"
+#include "deferred_log.h"
+#include "profile.h"
+#include "motor_ctrl.h"
+#include "speed.h"
+#include "odometry.h"
+
+//*****************************************************************************
+//
+// State of each wheel (LEFT_SIDE, RIGHT_SIDE).  count and edge_us are
+// written by the GPIO port E interrupt, the other fields by the control
+// interrupt (same priority, they do not preempt each other).
+//
+//*****************************************************************************
+typedef struct
+{
+    volatile t_i32 count; /* Encoder edges, signed with the motor direction */
+    volatile t_u32 edge_us; /* Time of the last edge */
+    t_i32 last_count; /* count at the last speed measure */
+    t_u32 last_edge_us; /* edge_us at the last speed measure */
+    volatile t_i32 speed; /* Measured speed in mm/s */
+    volatile t_i32 target; /* Target speed in mm/s */
+    t_i32 integ; /* Integral term, duty << SPEED_GAIN_SHIFT */
+    volatile bool enabled;
+} t_speed_wheel;
+
+static t_speed_wheel g_sSpeedWheels[2];
+
+// Encoder pin of each wheel.
+static const t_u8 g_ucSpeedEncoderPins[2] = { ENCODER_L_PIN, ENCODER_R_PIN };
+
+#ifdef PROFILE_ENABLE
+static bool g_bSpeedOverBudget = false;
+#endif
+
+//*****************************************************************************
+//
+//! This function counts the encoder edges.
+//!
+//! \param pins is the ENCODER_X_PIN bits with an edge.
+//! \param time_us is the edge time (GetTime_us()).
+//!
+//! This function is called from the GPIO port E interrupt.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void SPEED_encoderEdges(const t_u32 pins/*in*/, const t_u32 time_us/*in*/)
+{
+    t_u32 i;
+
+    for(i = 0; i < 2; i++)
+    {
+        if(pins & g_ucSpeedEncoderPins[i])
+        {
+            g_sSpeedWheels[i].count += (MCTRL_getDuty((tSide)i) < 0) ? -1 : 1;
+            g_sSpeedWheels[i].edge_us = time_us;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Measure the speed of one wheel.
+//
+//*****************************************************************************
+static void SPEED_measure(t_speed_wheel *pWheel, t_u32 ulNow)
+{
+    t_i32 lDelta;
+    t_i32 lBound;
+    t_u32 ulDt;
+
+    lDelta = pWheel->count - pWheel->last_count;
+    if(lDelta != 0)
+    {
+        // Distance of the new edges over the time between the last edges.
+        ulDt = pWheel->edge_us - pWheel->last_edge_us;
+        if(ulDt != 0)
+        {
+            pWheel->speed = (lDelta * (SPEED_UM_PER_EDGE * 1000)) / (t_i32)ulDt;
+        }
+        pWheel->last_count = pWheel->count;
+        pWheel->last_edge_us = pWheel->edge_us;
+    }
+    else
+    {
+        // No edge: the speed is lower than one edge since the last edge.
+        ulDt = ulNow - pWheel->last_edge_us;
+        lBound = (ulDt != 0) ? (t_i32)((SPEED_UM_PER_EDGE * 1000) / ulDt) : 0;
+        if(pWheel->speed > lBound)
+        {
+            pWheel->speed = lBound;
+        }
+        else if(pWheel->speed < -lBound)
+        {
+            pWheel->speed = -lBound;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Run the PI controller of one wheel, return the duty.
+//
+//*****************************************************************************
+static t_i32 SPEED_control(t_speed_wheel *pWheel)
+{
+    t_i32 lError;
+    t_i32 lDuty;
+    t_i32 lMax;
+
+    if(pWheel->target == 0)
+    {
+        pWheel->integ = 0;
+        return 0;
+    }
+
+    lError = pWheel->target - pWheel->speed;
+    lMax = MCTRL_DUTY_MAX << SPEED_GAIN_SHIFT;
+
+    // Integral with anti windup clamp.
+    pWheel->integ += SPEED_KI * lError;
+    if(pWheel->integ > lMax)
+    {
+        pWheel->integ = lMax;
+    }
+    else if(pWheel->integ < -lMax)
+    {
+        pWheel->integ = -lMax;
+    }
+
+    lDuty = ((SPEED_KP * lError) + pWheel->integ) >> SPEED_GAIN_SHIFT;
+    if(lDuty > MCTRL_DUTY_MAX)
+    {
+        lDuty = MCTRL_DUTY_MAX;
+    }
+    else if(lDuty < -MCTRL_DUTY_MAX)
+    {
+        lDuty = -MCTRL_DUTY_MAX;
+    }
+
+    return lDuty;
+}
+
+//*****************************************************************************
+//
+// This is the handler for the Timer2 A interrupt (SPEED_RATE_HZ), the
+// odometry is integrated in the same period.
+//
+//*****************************************************************************
+void
+SpeedTimerIntHandler(void)
+{
+    t_u32 ulNow;
+    t_u32 i;
+
+    ROM_TimerIntClear(TIMER2_BASE, TIMER_TIMA_TIMEOUT);
+
+    PROF_BEGIN(PROF_SPEED_LOOP);
+
+    ulNow = GetTime_us();
+    for(i = 0; i < 2; i++)
+    {
+        SPEED_measure(&g_sSpeedWheels[i], ulNow);
+
+        if(g_sSpeedWheels[i].enabled == true)
+        {
+            MCTRL_setTarget((tSide)i, (t_i16)SPEED_control(&g_sSpeedWheels[i]));
+        }
+    }
+
+    ODOM_update();
+
+    PROF_END(PROF_SPEED_LOOP);
+
+#ifdef PROFILE_ENABLE
+    if((g_bSpeedOverBudget == false) && (g_sProfileStats[PROF_SPEED_LOOP].max > SPEED_CYCLE_BUDGET))
+    {
+        DLOG_ERROR("Speed loop over budget: %d cycles\n", g_sProfileStats[PROF_SPEED_LOOP].max);
+        g_bSpeedOverBudget = true;
+    }
+#endif
+}
+
+//*****************************************************************************
+//
+//! This function initializes the encoders and the speed control timer.
+//!
+//! The encoders IR emitters are turned on and the encoder pins interrupt on
+//! both edges (the GPIO port E interrupt is enabled by Hardware_Init()).
+//!
+//! \return None.
+//
+//*****************************************************************************
+void SPEED_init(void)
+{
+    ROM_SysCtlPeripheralEnable(ENCODER_SYSCTL_PERIPH);
+    ROM_GPIOPinTypeGPIOOutput(ENCODER_PORT_BASE, ENCODER_IR_LED_PINS);
+    ROM_GPIOPinWrite(ENCODER_PORT_BASE, ENCODER_IR_LED_PINS, ENCODER_IR_LED_PINS);
+
+    ROM_GPIODirModeSet(ENCODER_PORT_BASE, ENCODER_L_PIN | ENCODER_R_PIN, GPIO_DIR_MODE_IN);
+    ROM_GPIOPadConfigSet(ENCODER_PORT_BASE, ENCODER_L_PIN | ENCODER_R_PIN, GPIO_STRENGTH_2MA,
+                         GPIO_PIN_TYPE_STD);
+    ROM_GPIOIntTypeSet(ENCODER_PORT_BASE, ENCODER_L_PIN | ENCODER_R_PIN, GPIO_BOTH_EDGES);
+    ROM_GPIOPinIntClear(ENCODER_PORT_BASE, ENCODER_L_PIN | ENCODER_R_PIN);
+    ROM_GPIOPinIntEnable(ENCODER_PORT_BASE, ENCODER_L_PIN | ENCODER_R_PIN);
+
+    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER2);
+    ROM_TimerConfigure(TIMER2_BASE, TIMER_CFG_32_BIT_PER);
+    ROM_TimerLoadSet(TIMER2_BASE, TIMER_A, ROM_SysCtlClockGet() / SPEED_RATE_HZ);
+    ROM_TimerIntEnable(TIMER2_BASE, TIMER_TIMA_TIMEOUT);
+    ROM_IntEnable(INT_TIMER2A);
+    ROM_TimerEnable(TIMER2_BASE, TIMER_A);
+}
+
+void SPEED_setTarget(const tSide side/*in*/, const t_i32 speed_mm_s/*in*/)
+{
+    // The control interrupt does not use integ while disabled.
+    if(g_sSpeedWheels[side].enabled == false)
+    {
+        g_sSpeedWheels[side].integ = 0;
+    }
+    g_sSpeedWheels[side].target = speed_mm_s;
+    g_sSpeedWheels[side].enabled = true;
+}
+
+void SPEED_disable(const tSide side/*in*/)
+{
+    g_sSpeedWheels[side].enabled = false;
+    g_sSpeedWheels[side].target = 0;
+}
+
+t_i32 SPEED_get(const tSide side/*in*/)
+{
+    return g_sSpeedWheels[side].speed;
+}
+
+t_i32 SPEED_getCount(const tSide side/*in*/)
+{
+    return g_sSpeedWheels[side].count;
+}
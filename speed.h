@@ -0,0 +1,81 @@
+//*****************************************************************************
+//
+// speed.h - Closed loop wheels speed control with the wheel encoders.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __SPEED_H__
+#define __SPEED_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * The encoder edges are counted by the GPIO port E interrupt (the encoders
+ * have one channel, the direction is the sign of the duty applied by
+ * motor_ctrl), the Timer2 A interrupt runs at SPEED_RATE_HZ: it measures
+ * each wheel speed (distance of the edges of the period divided by the time
+ * between their last edges, so slow speeds are measured with the encoder
+ * resolution) and runs an integer PI controller per wheel whose output is
+ * the motor_ctrl target duty.
+ * The controller of a wheel runs from SPEED_setTarget() to SPEED_disable().
+ */
+#define SPEED_RATE_HZ   (50)
+
+/* EvalBot wheel geometry (calibrate on the robot) */
+#define SPEED_WHEEL_DIAMETER_MM (60)
+#define SPEED_EDGES_PER_REV     (16) /* Encoder edges per wheel revolution (both edges counted) */
+#define SPEED_UM_PER_EDGE       ((314159 * SPEED_WHEEL_DIAMETER_MM) / (SPEED_EDGES_PER_REV * 100))
+
+/*
+ * PI gains, fixed point with SPEED_GAIN_SHIFT fractional bits:
+ * duty (8.8 percent) = (KP * error + KI * sum(error)) >> SPEED_GAIN_SHIFT, error in mm/s
+ */
+#define SPEED_GAIN_SHIFT    (4)
+#define SPEED_KP            (320) /* 20 duty units (0.08%) per mm/s */
+#define SPEED_KI            (64) /* 4 duty units per mm/s per period */
+
+/* Maximum cycles of one control period for both wheels and the odometry (checked when PROFILE_ENABLE is defined) */
+#define SPEED_CYCLE_BUDGET  (2000)
+
+/* API */
+
+/* Configure the encoders inputs and start the control timer (call after MCTRL_init()) */
+extern void SPEED_init(void);
+
+/* Set the wheel target speed in mm/s (negative = backward) and enable its controller */
+extern void SPEED_setTarget(const tSide side/*in*/, const t_i32 speed_mm_s/*in*/);
+
+/* Disable the controller of the wheel, the motor duty is left unchanged (any context) */
+extern void SPEED_disable(const tSide side/*in*/);
+
+/* Return the measured wheel speed in mm/s */
+extern t_i32 SPEED_get(const tSide side/*in*/);
+
+/* Return the encoder edges count (signed, wraps) */
+extern t_i32 SPEED_getCount(const tSide side/*in*/);
+
+/* Count the edges of the encoder pins (GPIO port E interrupt only) */
+extern void SPEED_encoderEdges(const t_u32 pins/*in*/, const t_u32 time_us/*in*/);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SPEED_H__
@@ -53,7 +53,12 @@ extern unsigned long __STACK_TOP;
 //
 //*****************************************************************************
 extern void SysTickIntHandler(void);
-extern void USB0OTGModeIntHandler(void);
+extern void USB0IntHandler(void);
+extern void GPIOInputIntHandler(void);
+extern void TrajectoryTimerIntHandler(void);
+extern void MotorCtrlTimerIntHandler(void);
+extern void SpeedTimerIntHandler(void);
+extern void UARTStdioIntHandler(void);
 
 //*****************************************************************************
 //
@@ -85,9 +90,9 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // GPIO Port A
     IntDefaultHandler,                      // GPIO Port B
     IntDefaultHandler,                      // GPIO Port C
-    IntDefaultHandler,                      // GPIO Port D
-    IntDefaultHandler,                      // GPIO Port E
-    IntDefaultHandler,                      // UART0 Rx and Tx
+    GPIOInputIntHandler,                    // GPIO Port D
+    GPIOInputIntHandler,                    // GPIO Port E
+    UARTStdioIntHandler,                    // UART0 Rx and Tx
     IntDefaultHandler,                      // UART1 Rx and Tx
     IntDefaultHandler,                      // SSI0 Rx and Tx
     IntDefaultHandler,                      // I2C0 Master and Slave
@@ -101,11 +106,11 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // ADC Sequence 2
     IntDefaultHandler,                      // ADC Sequence 3
     IntDefaultHandler,                      // Watchdog timer
-    IntDefaultHandler,                      // Timer 0 subtimer A
+    TrajectoryTimerIntHandler,              // Timer 0 subtimer A
     IntDefaultHandler,                      // Timer 0 subtimer B
-    IntDefaultHandler,                      // Timer 1 subtimer A
+    MotorCtrlTimerIntHandler,               // Timer 1 subtimer A
     IntDefaultHandler,                      // Timer 1 subtimer B
-    IntDefaultHandler,                      // Timer 2 subtimer A
+    SpeedTimerIntHandler,                   // Timer 2 subtimer A
     IntDefaultHandler,                      // Timer 2 subtimer B
     IntDefaultHandler,                      // Analog Comparator 0
     IntDefaultHandler,                      // Analog Comparator 1
@@ -126,7 +131,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // CAN2
     IntDefaultHandler,                      // Ethernet
     IntDefaultHandler,                      // Hibernate
-    USB0OTGModeIntHandler,                  // USB0
+    USB0IntHandler,                         // USB0
     IntDefaultHandler,                      // PWM Generator 3
     IntDefaultHandler,                      // uDMA Software Transfer
     IntDefaultHandler,                      // uDMA Error
@@ -0,0 +1,244 @@
+//*****************************************************************************
+//
+// trajectory.c - Timed motors setpoints queue executed by a timer interrupt.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+
+#include "drivers/motor.h"
+
+#include "usb_android.h"
+#include "event.h"
+#include "motor_ctrl.h"
+#include "speed.h"
+#include "trajectory.h"
+
+//*****************************************************************************
+//
+// The setpoints queue.  Only TRAJ_push() writes the head and only the timer
+// interrupt writes the tail while running.  TRAJ_stop() can be called from an
+// interrupt, it only requests the flush: the queue is flushed by the main
+// loop (TRAJ_push()/TRAJ_start()) once stopped.  The number of setpoints must
+// be a power of 2.
+//
+//*****************************************************************************
+#define TRAJ_QUEUE_MASK (TRAJ_QUEUE_SETPOINTS - 1)
+
+static t_traj_setpoint g_sTrajQueue[TRAJ_QUEUE_SETPOINTS];
+
+// Free running queue indexes.
+static volatile t_u32 g_ulTrajHead = 0;
+static volatile t_u32 g_ulTrajTail = 0;
+
+// TRAJ_start() called and not stopped.
+static volatile bool g_bTrajRunning = false;
+
+// Timer loaded with the delay of the tail setpoint.
+static volatile bool g_bTrajArmed = false;
+
+// TRAJ_stop() called, the queue is flushed by the main loop.
+static volatile bool g_bTrajFlush = false;
+
+// Timer clocks per millisecond.
+static t_u32 g_ulTrajClocksPerMs = 1;
+
+//*****************************************************************************
+//
+// Load the one shot timer with the delay of the next setpoint.
+//
+//*****************************************************************************
+static void TRAJ_arm(t_u32 ulDelayMs)
+{
+    t_u32 ulClocks;
+
+    ulClocks = ulDelayMs * g_ulTrajClocksPerMs;
+    if(ulClocks == 0)
+    {
+        ulClocks = 1;
+    }
+
+    g_bTrajArmed = true;
+    ROM_TimerLoadSet(TIMER0_BASE, TIMER_A, ulClocks);
+    ROM_TimerEnable(TIMER0_BASE, TIMER_A);
+}
+
+//*****************************************************************************
+//
+// Apply a setpoint to one motor, the motors command stage ramps from the
+// previous setpoint.
+//
+//*****************************************************************************
+static void TRAJ_motor(tSide eSide, t_u8 ucDuty, bool bBack)
+{
+    SPEED_disable(eSide);
+    MCTRL_setTarget(eSide, bBack ? -MCTRL_duty(ucDuty) : MCTRL_duty(ucDuty));
+}
+
+//*****************************************************************************
+//
+// This is the handler for the Timer0 A interrupt: apply the tail setpoint and
+// load the timer for the next one.
+//
+//*****************************************************************************
+void
+TrajectoryTimerIntHandler(void)
+{
+    t_traj_setpoint *pSetpoint;
+
+    ROM_TimerIntClear(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
+
+    g_bTrajArmed = false;
+
+    if((g_bTrajRunning == false) || (g_ulTrajTail == g_ulTrajHead))
+    {
+        return;
+    }
+
+    pSetpoint = &g_sTrajQueue[g_ulTrajTail & TRAJ_QUEUE_MASK];
+    TRAJ_motor(LEFT_SIDE, pSetpoint->left, (pSetpoint->dir & TRAJ_DIR_LEFT_BACK) ? true : false);
+    TRAJ_motor(RIGHT_SIDE, pSetpoint->right, (pSetpoint->dir & TRAJ_DIR_RIGHT_BACK) ? true : false);
+
+    g_ulTrajTail++;
+
+    if(g_ulTrajTail != g_ulTrajHead)
+    {
+        TRAJ_arm(g_sTrajQueue[g_ulTrajTail & TRAJ_QUEUE_MASK].delay_ms);
+    }
+
+    EVENT_post(EVENT_TRAJ);
+}
+
+//*****************************************************************************
+//
+// Drop the queued setpoints once stopped (main loop only), the interrupt does
+// not read the queue while stopped.
+//
+//*****************************************************************************
+static void TRAJ_flush(void)
+{
+    tBoolean bIntDisabled;
+
+    bIntDisabled = IntMasterDisable();
+    if((g_bTrajFlush == true) && (g_bTrajRunning == false))
+    {
+        g_ulTrajTail = g_ulTrajHead;
+        g_bTrajFlush = false;
+    }
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
+
+//*****************************************************************************
+//
+//! This function configures Timer0 A as a one shot timer for the setpoints.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void TRAJ_init(void)
+{
+    g_ulTrajClocksPerMs = ROM_SysCtlClockGet() / 1000;
+
+    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER0);
+    ROM_TimerConfigure(TIMER0_BASE, TIMER_CFG_32_BIT_OS);
+    ROM_TimerIntEnable(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
+    ROM_IntEnable(INT_TIMER0A);
+}
+
+//*****************************************************************************
+//
+//! This function queues one setpoint.
+//!
+//! \param setpoint is the setpoint copied in the queue.
+//!
+//! This function must be called only from the main loop.  If the trajectory
+//! is running and the timer is idle (all the previous setpoints applied) the
+//! timer is loaded with the setpoint delay.
+//!
+//! \return Returns false if the queue is full, true otherwise.
+//
+//*****************************************************************************
+bool TRAJ_push(const t_traj_setpoint* const setpoint/*in*/)
+{
+    tBoolean bIntDisabled;
+
+    TRAJ_flush();
+
+    if((g_ulTrajHead - g_ulTrajTail) >= TRAJ_QUEUE_SETPOINTS)
+    {
+        return false;
+    }
+
+    g_sTrajQueue[g_ulTrajHead & TRAJ_QUEUE_MASK] = *setpoint;
+
+    // Publish the setpoint once it is complete.
+    g_ulTrajHead++;
+
+    bIntDisabled = IntMasterDisable();
+    if((g_bTrajRunning == true) && (g_bTrajArmed == false) && (g_ulTrajTail != g_ulTrajHead))
+    {
+        TRAJ_arm(g_sTrajQueue[g_ulTrajTail & TRAJ_QUEUE_MASK].delay_ms);
+    }
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+
+    return true;
+}
+
+void TRAJ_start(void)
+{
+    tBoolean bIntDisabled;
+
+    TRAJ_flush();
+
+    bIntDisabled = IntMasterDisable();
+    g_bTrajRunning = true;
+    if((g_bTrajArmed == false) && (g_ulTrajTail != g_ulTrajHead))
+    {
+        TRAJ_arm(g_sTrajQueue[g_ulTrajTail & TRAJ_QUEUE_MASK].delay_ms);
+    }
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
+
+void TRAJ_stop(void)
+{
+    tBoolean bIntDisabled;
+
+    bIntDisabled = IntMasterDisable();
+    ROM_TimerDisable(TIMER0_BASE, TIMER_A);
+    ROM_TimerIntClear(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
+    g_bTrajRunning = false;
+    g_bTrajArmed = false;
+    g_bTrajFlush = true;
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
+
+t_u32 TRAJ_count(void)
+{
+    if(g_bTrajFlush == true)
+    {
+        return 0;
+    }
+
+    return (g_ulTrajHead - g_ulTrajTail);
+}
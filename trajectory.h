@@ -0,0 +1,72 @@
+//*****************************************************************************
+//
+// trajectory.h - Timed motors setpoints queue executed by a timer interrupt.
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __TRAJECTORY_H__
+#define __TRAJECTORY_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Android sends the setpoints ahead of time, they are queued by the main loop
+ * (single producer) and applied by the Timer0 A interrupt (single consumer):
+ * the timer is loaded with the delay of the next setpoint each time a
+ * setpoint is applied, so the motion timing does not depend on the USB
+ * latency.  When the queue runs empty the last setpoint is kept, a setpoint
+ * queued afterwards is applied after its delay counted from its queuing.
+ */
+#define TRAJ_QUEUE_SETPOINTS    (64)
+
+/* t_traj_setpoint.dir bits, bit set = motor runs backward */
+#define TRAJ_DIR_LEFT_BACK      (0x01)
+#define TRAJ_DIR_RIGHT_BACK     (0x02)
+
+typedef struct
+{
+    t_u16 delay_ms; /* Time from the previous setpoint (or from TRAJ_start()) */
+    t_u8 left; /* Left motor duty cycle 0 to 255 (0=stopped) */
+    t_u8 right; /* Right motor duty cycle 0 to 255 (0=stopped) */
+    t_u8 dir; /* TRAJ_DIR_XXX */
+} t_traj_setpoint;
+
+/* API */
+
+/* Configure the timer (call after Hardware_Init()) */
+extern void TRAJ_init(void);
+
+/* Queue one setpoint (main loop only), return false if the queue is full */
+extern bool TRAJ_push(const t_traj_setpoint* const setpoint/*in*/);
+
+/* Start to apply the queued setpoints, the first one is applied after its delay */
+extern void TRAJ_start(void);
+
+/* Stop the timer (any context), the queue is flushed by the next TRAJ_push()/TRAJ_start(), motors are not changed */
+extern void TRAJ_stop(void);
+
+/* Return the number of setpoints not yet applied */
+extern t_u32 TRAJ_count(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TRAJECTORY_H__
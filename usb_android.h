@@ -29,49 +29,26 @@ extern "C"
 typedef unsigned char bool;
 
 typedef unsigned char t_u8;
-typedef char t_i8;
+typedef signed char t_i8;
 
 typedef unsigned short t_u16;
 typedef short t_i16;
 
+#if defined(__LP64__)
+/* Host build (host/Makefile), long is 64 bits */
+typedef unsigned int t_u32;
+typedef int t_i32;
+#else
 typedef unsigned long t_u32;
 typedef long t_i32;
+#endif
 
-#define MAX_T_U32    (0xFFFFFFFF)
-
-/* Android DemoKit protocol */
-#define  LED3_RED       2
-#define  LED3_GREEN     4
-#define  LED3_BLUE      3
-
-#define  LED2_RED       5
-#define  LED2_GREEN     7
-#define  LED2_BLUE      6
-
-#define  LED1_RED       8
-#define  LED1_GREEN     10
-#define  LED1_BLUE      9
-
-#define  SERVO1         11
-#define  SERVO2         12
-#define  SERVO3         13
-
-#define  TOUCH_RECV     14
-#define  TOUCH_SEND     15
-
-#define  RELAY1         A0
-#define  RELAY2         A1
-
-#define  LIGHT_SENSOR   A2
-#define  TEMP_SENSOR    A3
+typedef unsigned long long t_u64;
+typedef long long t_i64;
 
-#define  BUTTON1        A6
-#define  BUTTON2        A7
-#define  BUTTON3        A8
+#define MAX_T_U32    (0xFFFFFFFF)
 
-#define  JOY_SWITCH     A9      // pulls line down when pressed
-#define  JOY_nINT       A10     // active low interrupt input
-#define  JOY_nRESET     A11     // active low reset output
+/* Android DemoKit protocol types and ids are defined in demokit_protocol.h */
 
 /********************************/
 /* EvalBot specific peripherals */
@@ -104,6 +81,17 @@ typedef long t_i32;
 #define LED2_PORT_BASE      (GPIO_PORTF_BASE)
 #define LED2_PIN            (GPIO_PIN_5)
 
+/* Wheel encoders: one IR sensor per wheel (PE3 left, PE2 right) and the IR emitters enable (PE4 left, PE5 right) */
+#define ENCODER_SYSCTL_PERIPH   (SYSCTL_PERIPH_GPIOE) /* Used to enable the peripheral */
+#define ENCODER_PORT_BASE       (GPIO_PORTE_BASE)
+#define ENCODER_L_PIN           (GPIO_PIN_3)
+#define ENCODER_R_PIN           (GPIO_PIN_2)
+#define ENCODER_IR_LED_PINS     (GPIO_PIN_4 | GPIO_PIN_5)
+
+/* Motors direction (drivers/motor.h), EvalBot moves ahead with MotorDir(REVERSE) */
+#define MOTOR_DIR_AHEAD     (REVERSE)
+#define MOTOR_DIR_BACK      (FORWARD)
+
 /*
 http://developer.android.com/guide/topics/usb/adk.html
 The following string IDs are supported, with a maximum size of 256 bytes for each string (must be zero terminated with \0).
@@ -127,6 +115,60 @@ typedef struct
 
 typedef void * t_AndroidInstance;
 
+/*
+ * Connection latency report, time of the end of each phase in microseconds
+ * (GetTime_us()), 0 if the phase did not happen.
+ */
+typedef struct
+{
+    t_u32 plug_us; /* USB host session started (cable plugged) */
+    t_u32 open_us; /* Device enumerated by the host stack in its normal mode */
+    t_u32 protocol_us; /* Accessory protocol version read */
+    t_u32 strings_us; /* Accessory identity strings sent */
+    t_u32 start_us; /* Accessory mode start sent, the device re-enumerates */
+    t_u32 accessory_us; /* Device enumerated in accessory mode */
+    t_u32 connected_us; /* Bulk pipes ready, ANDROID_isConnected() returns true */
+} t_android_connect_report;
+
+/* ANDROID_writeAsync() errors */
+#define ANDROID_ERROR_INVALID_PARAM     (-1) /* Invalid handle or len */
+#define ANDROID_ERROR_NOT_CONNECTED     (-2) /* No Android Accessory connected */
+#define ANDROID_ERROR_TX_QUEUE_FULL     (-3) /* No free frame in TX queue, retry later */
+#define ANDROID_ERROR_TX_BORROWED       (-4) /* A frame is borrowed (ANDROID_txBorrow()), submit it first */
+
+/* Status passed to t_ANDROID_tx_callback */
+#define ANDROID_TX_DONE     (0) /* Frame sent to Android */
+#define ANDROID_TX_ERROR    (1) /* Frame not sent (USB error) */
+#define ANDROID_TX_ABORTED  (2) /* Frame not sent (device removed or closed, or ANDROID_cancel()) */
+#define ANDROID_TX_TIMEOUT  (3) /* Frame not sent before its deadline (device not reading) */
+
+/* Deadline of a TX frame from the start of its transfer */
+#define ANDROID_TX_TIMEOUT_MS   (100)
+
+/* ANDROID_cancel() flags */
+#define ANDROID_CANCEL_TX   (0x01) /* Drop the frame being sent and the queued frames */
+#define ANDROID_CANCEL_RX   (0x02) /* Drop the received data not read yet */
+
+/* Maximum size of one TX frame (Full Speed Bulk max packet size) */
+#define ANDROID_TX_FRAME_SIZE   (64)
+
+/* TX frame completion callback, called from USB interrupt context (or from USBStackRefresh()/ANDROID_cancel() when aborted or timed out) */
+typedef void (*t_ANDROID_tx_callback)(void *pvCBData, int status);
+
+/*
+ * Latency of the driver calls, none of them waits for the device:
+ * - ANDROID_read()/ANDROID_readMsg()/ANDROID_available() only copy from the RX ring (len bytes at most),
+ * - ANDROID_write()/ANDROID_writeAsync() only copy the frame in the TX queue (ANDROID_TX_FRAME_SIZE bytes at most),
+ * - ANDROID_rxPeek()/ANDROID_rxRelease()/ANDROID_txBorrow()/ANDROID_txSubmit() are O(1) (no copy),
+ * - ANDROID_cancel() resets the Bulk OUT pipe and calls the aborted frames callbacks,
+ * - a queued frame completes (any status) at most ANDROID_TX_TIMEOUT_MS plus one USBStackRefresh() after its
+ *   transfer starts, so at most 8 times that (TX queue depth) after ANDROID_write(),
+ * - USBStackRefresh() runs the usblib host stack: only while a device is enumerated or switched to accessory
+ *   mode it waits for the control transfers (usblib aborts them when the device is removed).
+ * When the device is removed USBHANDROIDClose() frees the pipes and aborts the TX queue, the next device is
+ * opened with new pipes and the Bulk IN pipe armed, ANDROID_isConnected() tells the application.
+ */
+
 /* API */
 
 extern void Hardware_Init(void);
@@ -139,10 +181,46 @@ extern void ANDROID_close(t_AndroidInstance handle);
 
 extern bool ANDROID_isConnected(t_AndroidInstance handle); /* Return true(1) if ADK is connected or false(0) if it is not connected */
 
+/* Copy the connection latency report of the last plugged device */
+extern void ANDROID_getConnectReport(t_android_connect_report* const report/*out*/);
+
+/* Non blocking, copy up to len bytes already received and return the number of bytes copied (0 if none) */
 extern int ANDROID_read(t_AndroidInstance handle, t_u8* const buff/*out*/, const int len/*in*/);
 
+/* Non blocking, copy exactly len bytes once they are all received (message reassembled across USB packets), return len, 0 or ANDROID_ERROR_INVALID_PARAM if len exceeds the RX ring */
+extern int ANDROID_readMsg(t_AndroidInstance handle, t_u8* const buff/*out*/, const int len/*in*/);
+
+/* Return the number of received bytes ready to be read (exact byte count, binary data are supported) */
+extern int ANDROID_available(t_AndroidInstance handle);
+
+/* Non blocking, queue a frame of len bytes (max ANDROID_TX_FRAME_SIZE), return len or ANDROID_ERROR_XXX */
 extern int ANDROID_write(t_AndroidInstance handle, const void* const buff/*in*/, const int len/*in*/);
 
+/* Same as ANDROID_write() with callback called when the frame is sent (callback can be NULL) */
+extern int ANDROID_writeAsync(t_AndroidInstance handle, const void* const buff/*in*/, const int len/*in*/,
+                              t_ANDROID_tx_callback callback/*in*/, void* pvCBData/*in*/);
+
+/*
+ * Zero copy API: the received packets are parsed in their RX ring slot and the frames are filled in their
+ * TX queue slot, the other slots keep the Bulk pipes busy meanwhile (no memcpy per packet).
+ */
+
+/* Non blocking, point data to the received bytes of the oldest packet in place, return their number (0 if none) */
+extern int ANDROID_rxPeek(t_AndroidInstance handle, const t_u8** const data/*out*/);
+
+/* Consume len bytes returned by ANDROID_rxPeek(), the packet slot is rearmed once fully consumed */
+extern void ANDROID_rxRelease(t_AndroidInstance handle, const int len/*in*/);
+
+/* Non blocking, lend the next free TX frame (ANDROID_TX_FRAME_SIZE bytes), NULL if none */
+extern t_u8* ANDROID_txBorrow(t_AndroidInstance handle);
+
+/* Queue the borrowed frame with len bytes (0 = give it back), return len or ANDROID_ERROR_XXX */
+extern int ANDROID_txSubmit(t_AndroidInstance handle, const int len/*in*/,
+                            t_ANDROID_tx_callback callback/*in*/, void* pvCBData/*in*/);
+
+/* Non blocking, cancel the pending transfers (ANDROID_CANCEL_XXX flags) */
+extern void ANDROID_cancel(t_AndroidInstance handle, const t_u32 flags/*in*/);
+
 /* Other useful function */
 
 /* Get time from reset */
@@ -150,6 +228,9 @@ extern t_u32 GetTime_ms(void);
 
 extern t_u32 Delta_time_ms(t_u32 start, t_u32 end);
 
+/* Get time from reset in microseconds (can be called from interrupt context) */
+extern t_u32 GetTime_us(void);
+
 extern void WaitTime_ms(t_u32 wait_ms);
 
 //*****************************************************************************
@@ -8,14 +8,16 @@
 //*****************************************************************************
 
 #include <string.h>
+#include "inc/hw_ints.h"
 #include "inc/hw_memmap.h"
+#include "inc/hw_nvic.h"
 #include "inc/hw_types.h"
 #include "inc/lm3s9b92.h"
 #include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/rom.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/uart.h"
-#include "driverlib/udma.h"
 #include "driverlib/usb.h"
 #include "usblib/usblib.h"
 #include "usblib/host/usbhost.h"
@@ -23,23 +25,47 @@
 #include "utils/uartstdio.h"
 
 #include "usb_android.h"
+#include "deferred_log.h"
+#include "usb_trace.h"
+#include "event.h"
 
 #define BULK_READ_TIMEOUT    (2)
-#define BULK_WRITE_TIMEOUT    (0) /* 0=No Timeout*/
+#define BULK_WRITE_TIMEOUT    (0) /* 0=No hardware NAK limit, the TX frames have the ANDROID_TX_TIMEOUT_MS deadline */
+#define BULK_READ_RETRIES    (3) /* Bulk IN errors in a row scheduled again from the pipe callback, then the endpoint is recovered from USBStackRefresh() */
 
+/* OTG session polling interval, time to detect a plugged cable (must not be higher than 250ms to connect Android ADK) */
+#define OTG_POLL_MILLISEC   (100)
+
+/*
+ * Define ANDROID_DESC_DUMP to read and log the configuration and device
+ * descriptors of each device opened (two more control transfers, debug only).
+ */
+
+#ifdef ANDROID_DESC_DUMP
 t_u8 configDesc[256];
 t_u16 configDescSize = 256;
 
 t_u8 devDesc[256];
 t_u16 devDescSize = 256;
+#endif
 
-t_u8 writedata[256];
-
-bool rx_data_available = 0;
 volatile t_u32 g_ulSysTickCount = 0;
 
 t_ident_android_accessory* id_android_accessory;
 
+/* Accessory identity strings sent to the device, with their length (trailing 0 included) computed by ANDROID_open() */
+#define ACCESSORY_NB_STRINGS    (6)
+typedef struct
+{
+    const char *str;
+    t_u16 len;
+} t_accessory_string;
+
+static t_accessory_string g_sAccessoryStrings[ACCESSORY_NB_STRINGS];
+
+/* Connection latency of the last plugged device, times in microseconds (GetTime_us()) */
+static t_android_connect_report g_sConnectReport;
+
 /********************************/
 /* Start of ANDROID Host Driver */
 /********************************/
@@ -78,13 +104,70 @@ t_ident_android_accessory* id_android_accessory;
 //*****************************************************************************
 typedef void (*tUSBHANDROIDCallback)(t_u32 ulInstance, t_u32 ulEvent, void *pvEventData);
 
+//*****************************************************************************
+//
+// The bulk IN receive ring.  A transfer is always scheduled on the bulk IN
+// pipe while a free slot exists, each completed packet is stored in its own
+// slot by the pipe callback (interrupt context) and ANDROID_read() only copies
+// out of the ring.  The number of slots must be a power of 2.
+//
+// Transfers are always requested with the endpoint wMaxPacketSize so a burst
+// from Android is absorbed in one transaction per packet, the ring is then
+// read as a byte stream (ANDROID_read()), as fixed size messages
+// reassembled across packets (ANDROID_readMsg()) or in place without copy
+// (ANDROID_rxPeek()/ANDROID_rxRelease()) while the next slots keep receiving.
+//
+//*****************************************************************************
+#define ANDROID_RX_RING_PACKETS     (8)
+#define ANDROID_RX_RING_MASK        (ANDROID_RX_RING_PACKETS - 1)
+#define ANDROID_RX_PACKET_SIZE      (64) /* Full Speed Bulk max packet size */
+
+typedef struct
+{
+    // Number of bytes received in this slot.
+    t_u16 usLength;
+
+    // Number of bytes already consumed (ANDROID_rxRelease()).
+    t_u16 usOffset;
+
+    t_u8 pucData[ANDROID_RX_PACKET_SIZE];
+} t_ANDROIDRxPacket;
+
+static t_ANDROIDRxPacket g_sANDROIDRxRing[ANDROID_RX_RING_PACKETS];
+
+//*****************************************************************************
+//
+// The bulk OUT transmit queue.  ANDROID_writeAsync() copies each frame in the
+// queue (or ANDROID_txBorrow() lends the next free frame to be filled in
+// place and ANDROID_txSubmit() queues it) and returns at once, the frames are sent one by one on the Bulk OUT
+// pipe and the next one is started from the pipe callback (interrupt context)
+// or from USBStackRefresh().  The number of frames must be a power of 2.
+//
+//*****************************************************************************
+#define ANDROID_TX_QUEUE_FRAMES     (8)
+#define ANDROID_TX_QUEUE_MASK       (ANDROID_TX_QUEUE_FRAMES - 1)
+
+typedef struct
+{
+    // Number of bytes to send.
+    t_u16 usLength;
+
+    // Completion callback (can be NULL) and its data.
+    t_ANDROID_tx_callback pfnCallback;
+    void *pvCBData;
+
+    t_u8 pucData[ANDROID_TX_FRAME_SIZE];
+} t_ANDROIDTxFrame;
+
+static t_ANDROIDTxFrame g_sANDROIDTxQueue[ANDROID_TX_QUEUE_FRAMES];
+
 //*****************************************************************************
 //
 // Prototypes for the USB ANDROID host driver APIs.
 //
 //*****************************************************************************
-void* USBHANDROIDOpen(tUSBHostDevice *pDevice);
-void USBHANDROIDClose(void *pvInstance);
+static void * USBHANDROIDOpen(tUSBHostDevice *pDevice);
+static void USBHANDROIDClose(void *pvInstance);
 
 //*****************************************************************************
 //
@@ -119,6 +202,74 @@ typedef struct
     // Bulk OUT pipe.
     //
     t_u32 ulBulkOutPipe;
+
+    //
+    // Size of the transfers scheduled on the Bulk IN pipe.
+    //
+    t_u32 ulRxPacketSize;
+
+    //
+    // RX ring indexes, free running (head written by the pipe callback,
+    // tail written by ANDROID_read()).
+    //
+    volatile t_u32 ulRxHead;
+    volatile t_u32 ulRxTail;
+
+    //
+    // Set while a transfer is scheduled on the Bulk IN pipe.
+    //
+    volatile bool bRxArmed;
+
+    //
+    // Total bytes stored in the RX ring (written by the pipe callback) and
+    // copied out of it (written by ANDROID_read()), free running.
+    //
+    volatile t_u32 ulRxBytesIn;
+    volatile t_u32 ulRxBytesOut;
+
+    //
+    // TX queue indexes, free running (head written by ANDROID_writeAsync(),
+    // tail written when a frame completes).
+    //
+    volatile t_u32 ulTxHead;
+    volatile t_u32 ulTxTail;
+
+    //
+    // Set while the frame at ulTxTail is being sent on the Bulk OUT pipe.
+    //
+    volatile bool bTxBusy;
+
+    //
+    // Time (GetTime_ms()) the frame at ulTxTail started, for its deadline.
+    //
+    volatile t_u32 ulTxStartMs;
+
+    //
+    // Bulk OUT endpoint number and max packet size, to reallocate the pipe,
+    // and the controller endpoint of the pipe (USB_EP_x) to flush its FIFO.
+    //
+    t_u32 ulBulkOutEndpoint;
+    t_u32 ulBulkOutPacketSize;
+    t_u32 ulBulkOutFifoEndpoint;
+
+    //
+    // Frames completed by their deadline and Bulk IN transfers failed.
+    //
+    t_u32 ulTxTimeouts;
+    t_u32 ulRxErrors;
+
+    //
+    // Bulk IN errors in a row, and the pipes waiting for their endpoint halt
+    // and data toggle reset from USBStackRefresh() (not rescheduled meanwhile).
+    //
+    t_u32 ulRxRetries;
+    volatile bool bRxHalted;
+    volatile bool bTxHalted;
+
+    //
+    // Set while the frame at ulTxHead is lent by ANDROID_txBorrow().
+    //
+    bool bTxBorrowed;
 } t_USBHANDROIDInstance;
 
 //*****************************************************************************
@@ -169,17 +320,335 @@ static t_USBHANDROIDInstance g_USBHANDROIDDevice =
     NULL, /* pfnCallback  is not allocated = NULL */
     0, /* ulBlockSize = 0 */
     0, /* ulBulkInPipe = 0 */
-    0 /* ulBulkOutPipe = 0 */
+    0, /* ulBulkOutPipe = 0 */
+    0, /* ulRxPacketSize = 0 */
+    0, /* ulRxHead = 0 */
+    0, /* ulRxTail = 0 */
+    false, /* bRxArmed = false */
+    0, /* ulRxBytesIn = 0 */
+    0, /* ulRxBytesOut = 0 */
+    0, /* ulTxHead = 0 */
+    0, /* ulTxTail = 0 */
+    false, /* bTxBusy = false */
+    0, /* ulTxStartMs = 0 */
+    0, /* ulBulkOutEndpoint = 0 */
+    0, /* ulBulkOutPacketSize = 0 */
+    0, /* ulBulkOutFifoEndpoint = 0 */
+    0, /* ulTxTimeouts = 0 */
+    0, /* ulRxErrors = 0 */
+    0, /* ulRxRetries = 0 */
+    false, /* bRxHalted = false */
+    false, /* bTxHalted = false */
+    false /* bTxBorrowed = false */
 };
 
 void USBHANDROIDCallback(t_u32 ulInstance, t_u32 ulEvent, void *pvData);
 
+//*****************************************************************************
+//
+// Schedule the next Bulk IN transfer in the next free RX ring slot.
+//
+// If the ring is full the pipe is left idle (the device is NAKed) until
+// ANDROID_read() frees a slot and calls this function again.
+//
+//*****************************************************************************
+static void USBHANDROIDRxArm(t_USBHANDROIDInstance *pANDROIDDevice)
+{
+    t_ANDROIDRxPacket *pPacket;
+
+    if((pANDROIDDevice->bRxHalted == true) ||
+       ((pANDROIDDevice->ulRxHead - pANDROIDDevice->ulRxTail) >= ANDROID_RX_RING_PACKETS))
+    {
+        pANDROIDDevice->bRxArmed = false;
+        return;
+    }
+
+    pPacket = &g_sANDROIDRxRing[pANDROIDDevice->ulRxHead & ANDROID_RX_RING_MASK];
+    pANDROIDDevice->bRxArmed = true;
+    USBHCDPipeSchedule(pANDROIDDevice->ulBulkInPipe, pPacket->pucData,
+                       pANDROIDDevice->ulRxPacketSize);
+}
+
+//*****************************************************************************
+//
+// Start sending the frame at the TX queue tail if the Bulk OUT pipe is idle.
+//
+// Called from ANDROID_writeAsync(), USBStackRefresh() and from the pipe
+// callback when the previous frame completes.
+//
+//*****************************************************************************
+static void USBHANDROIDTxKick(t_USBHANDROIDInstance *pANDROIDDevice)
+{
+    t_ANDROIDTxFrame *pFrame;
+
+    if((pANDROIDDevice->bTxBusy == true) || (pANDROIDDevice->bTxHalted == true) ||
+       (pANDROIDDevice->ulTxTail == pANDROIDDevice->ulTxHead) ||
+       (pANDROIDDevice->ulBulkOutPipe == 0))
+    {
+        return;
+    }
+
+    pFrame = &g_sANDROIDTxQueue[pANDROIDDevice->ulTxTail & ANDROID_TX_QUEUE_MASK];
+    pANDROIDDevice->bTxBusy = true;
+    pANDROIDDevice->ulTxStartMs = g_ulSysTickCount;
+    USBHCDPipeSchedule(pANDROIDDevice->ulBulkOutPipe, pFrame->pucData,
+                       pFrame->usLength);
+}
+
+//*****************************************************************************
+//
+// Publish the frame at the TX queue head (its data already in place) and
+// start it if the pipe is idle.
+//
+//*****************************************************************************
+static void USBHANDROIDTxQueue(t_USBHANDROIDInstance *pANDROIDDevice, t_ANDROIDTxFrame *pFrame, int len,
+                               t_ANDROID_tx_callback callback, void *pvCBData)
+{
+    pFrame->usLength = len;
+    pFrame->pfnCallback = callback;
+    pFrame->pvCBData = pvCBData;
+
+    // Publish the frame before checking if the pipe is idle, the pipe
+    // callback picks it up if a frame is completing meanwhile.
+    pANDROIDDevice->ulTxHead++;
+    USBHANDROIDTxKick(pANDROIDDevice);
+}
+
+//*****************************************************************************
+//
+// Complete the frame at the TX queue tail with the given status, call its
+// callback and free it.
+//
+//*****************************************************************************
+static void USBHANDROIDTxComplete(t_USBHANDROIDInstance *pANDROIDDevice, int status)
+{
+    t_ANDROIDTxFrame *pFrame;
+
+    pFrame = &g_sANDROIDTxQueue[pANDROIDDevice->ulTxTail & ANDROID_TX_QUEUE_MASK];
+    USBTRACE_BULK_TX(pFrame->usLength, status);
+    if(pFrame->pfnCallback != NULL)
+    {
+        pFrame->pfnCallback(pFrame->pvCBData, status);
+    }
+    pANDROIDDevice->ulTxTail++;
+    pANDROIDDevice->bTxBusy = false;
+}
+
+static void USBHANDROIDPipeCallback(t_u32 ulPipe, t_u32 ulEvent);
+
+//*****************************************************************************
+//
+// Allocate and configure the Bulk OUT pipe.
+//
+//*****************************************************************************
+static void USBHANDROIDTxPipeOpen(t_USBHANDROIDInstance *pANDROIDDevice)
+{
+    pANDROIDDevice->ulBulkOutPipe = USBHCDPipeAllocSize(0, USBHCD_PIPE_BULK_OUT,
+                                                        pANDROIDDevice->pDevice->ulAddress,
+                                                        pANDROIDDevice->ulBulkOutPacketSize,
+                                                        USBHANDROIDPipeCallback);
+    USBHCDPipeConfig(pANDROIDDevice->ulBulkOutPipe,
+                     pANDROIDDevice->ulBulkOutPacketSize,
+                     BULK_WRITE_TIMEOUT,
+                     pANDROIDDevice->ulBulkOutEndpoint);
+
+    // usblib gives the controller endpoint n + 1 to the pipe index n (low
+    // byte of the handle), endpoint 0 is the control one.
+    pANDROIDDevice->ulBulkOutFifoEndpoint = ((pANDROIDDevice->ulBulkOutPipe & 0xff) + 1) << 4;
+}
+
+//*****************************************************************************
+//
+// Drop the transfer in progress on the Bulk OUT pipe: the packet is flushed
+// from the endpoint FIFO and the pipe is reallocated.  The interrupts must be
+// masked.  The device may have received the dropped packet: the data toggle
+// is resynchronised by USBHANDROIDRecover() (endpoint halt cleared) before
+// the next frame, else the device could drop it as a duplicate.
+//
+//*****************************************************************************
+static void USBHANDROIDTxPipeReset(t_USBHANDROIDInstance *pANDROIDDevice)
+{
+    if(pANDROIDDevice->ulBulkOutPipe == 0)
+    {
+        return;
+    }
+
+    USBFIFOFlush(USB0_BASE, pANDROIDDevice->ulBulkOutFifoEndpoint, USB_EP_HOST_OUT);
+    USBHCDPipeFree(pANDROIDDevice->ulBulkOutPipe);
+    USBHANDROIDTxPipeOpen(pANDROIDDevice);
+    pANDROIDDevice->bTxHalted = true;
+}
+
+//*****************************************************************************
+//
+// Clear the halt of the endpoints of the pipes stalled (or reset) and restart
+// them.  Called from USBStackRefresh(), the control transfers are blocking.
+//
+// CLEAR_FEATURE(ENDPOINT_HALT) resets the data toggle of the device endpoint
+// to DATA0, USBHCDClearFeature() also clears the toggle of the host pipe.
+//
+//*****************************************************************************
+static void USBHANDROIDRecover(t_USBHANDROIDInstance *pANDROIDDevice)
+{
+    if(pANDROIDDevice->bRxHalted == true)
+    {
+        DLOG_INFO("Bulk IN endpoint halt cleared\n");
+        USBHCDClearFeature(pANDROIDDevice->pDevice->ulAddress, pANDROIDDevice->ulBulkInPipe,
+                           USB_FEATURE_EP_HALT);
+        pANDROIDDevice->ulRxRetries = 0;
+        pANDROIDDevice->bRxHalted = false;
+        if(pANDROIDDevice->bRxArmed == false)
+        {
+            USBHANDROIDRxArm(pANDROIDDevice);
+        }
+    }
+
+    if(pANDROIDDevice->bTxHalted == true)
+    {
+        DLOG_INFO("Bulk OUT endpoint halt cleared\n");
+        USBHCDClearFeature(pANDROIDDevice->pDevice->ulAddress, pANDROIDDevice->ulBulkOutPipe,
+                           USB_FEATURE_EP_HALT);
+        pANDROIDDevice->bTxHalted = false;
+    }
+}
+
+//*****************************************************************************
+//
+// Complete the frame in progress with ANDROID_TX_TIMEOUT once its deadline is
+// elapsed and start the next one.  Called from USBStackRefresh().
+//
+//*****************************************************************************
+static void USBHANDROIDTxDeadline(t_USBHANDROIDInstance *pANDROIDDevice)
+{
+    tBoolean bIntDisabled;
+
+    if(pANDROIDDevice->bTxBusy == false)
+    {
+        return;
+    }
+
+    bIntDisabled = IntMasterDisable();
+    if((pANDROIDDevice->bTxBusy == true) &&
+       ((g_ulSysTickCount - pANDROIDDevice->ulTxStartMs) >= ANDROID_TX_TIMEOUT_MS))
+    {
+        USBHANDROIDTxPipeReset(pANDROIDDevice);
+        USBHANDROIDTxComplete(pANDROIDDevice, ANDROID_TX_TIMEOUT);
+        pANDROIDDevice->ulTxTimeouts++;
+        USBHANDROIDTxKick(pANDROIDDevice);
+    }
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
+
+//*****************************************************************************
+//
+// Bulk IN/OUT pipes callback, called by the host controller driver in
+// interrupt context.
+//
+// \param ulPipe is the pipe that generated the event.
+// \param ulEvent is the pipe event.
+//
+// On USB_EVENT_RX_AVAILABLE the received packet is moved from the endpoint
+// FIFO in the current RX ring slot, the ring head is advanced and the next
+// transfer is scheduled.  The packet length is the byte count read from the
+// endpoint FIFO so binary payloads (including all zero bytes) are received as
+// is.
+// On USB_EVENT_TX_COMPLETE (or an error on the Bulk OUT pipe) the current TX
+// frame is completed and the next queued frame is started.  An error on the
+// Bulk IN pipe schedules the transfer again.
+//
+//*****************************************************************************
+static void USBHANDROIDPipeCallback(t_u32 ulPipe, t_u32 ulEvent)
+{
+    t_ANDROIDRxPacket *pPacket;
+
+    if(ulPipe == g_USBHANDROIDDevice.ulBulkOutPipe)
+    {
+        if(g_USBHANDROIDDevice.bTxBusy == false)
+        {
+            return;
+        }
+
+        if(ulEvent == USB_EVENT_TX_COMPLETE)
+        {
+            USBHANDROIDTxComplete(&g_USBHANDROIDDevice, ANDROID_TX_DONE);
+        }
+        else if(ulEvent == USB_EVENT_ERROR)
+        {
+            USBHANDROIDTxComplete(&g_USBHANDROIDDevice, ANDROID_TX_ERROR);
+        }
+        else if(ulEvent == USB_EVENT_STALL)
+        {
+            // The next frames would stall too, the queue waits for the halt clear.
+            g_USBHANDROIDDevice.bTxHalted = true;
+            USBHANDROIDTxComplete(&g_USBHANDROIDDevice, ANDROID_TX_ERROR);
+        }
+        USBHANDROIDTxKick(&g_USBHANDROIDDevice);
+        return;
+    }
+
+    if(ulPipe != g_USBHANDROIDDevice.ulBulkInPipe)
+    {
+        return;
+    }
+
+    // A failed transfer is scheduled again a few times.  A halted endpoint
+    // stalls every IN token: it is not rescheduled from here (interrupts
+    // storm), USBStackRefresh() clears the halt and restarts it.
+    if((ulEvent == USB_EVENT_ERROR) || (ulEvent == USB_EVENT_STALL))
+    {
+        g_USBHANDROIDDevice.ulRxErrors++;
+        g_USBHANDROIDDevice.bRxArmed = false;
+        if((ulEvent == USB_EVENT_ERROR) && (g_USBHANDROIDDevice.ulRxRetries < BULK_READ_RETRIES))
+        {
+            g_USBHANDROIDDevice.ulRxRetries++;
+            USBHANDROIDRxArm(&g_USBHANDROIDDevice);
+        }
+        else
+        {
+            g_USBHANDROIDDevice.bRxHalted = true;
+        }
+        return;
+    }
+
+    if(ulEvent != USB_EVENT_RX_AVAILABLE)
+    {
+        return;
+    }
+
+    g_USBHANDROIDDevice.ulRxRetries = 0;
+
+    // The read is bounded by the bytes really received in the endpoint FIFO.
+    pPacket = &g_sANDROIDRxRing[g_USBHANDROIDDevice.ulRxHead & ANDROID_RX_RING_MASK];
+    pPacket->usLength = USBHCDPipeReadNonBlocking(ulPipe, pPacket->pucData, g_USBHANDROIDDevice.ulRxPacketSize);
+    pPacket->usOffset = 0;
+    USBTRACE_BULK_RX(pPacket->pucData, pPacket->usLength);
+
+    // Zero length packets carry no data, reuse the slot.
+    if(pPacket->usLength != 0)
+    {
+        g_USBHANDROIDDevice.ulRxBytesIn += pPacket->usLength;
+        g_USBHANDROIDDevice.ulRxHead++;
+
+        if(g_USBHANDROIDDevice.pfnCallback != 0)
+        {
+            g_USBHANDROIDDevice.pfnCallback((t_u32)&g_USBHANDROIDDevice,
+            ANDROID_EVENT_RX_AVAILABLE, 0);
+        }
+    }
+
+    USBHANDROIDRxArm(&g_USBHANDROIDDevice);
+}
+
 bool isAccessoryDevice(tDeviceDescriptor *desc)
 {
     return desc->idVendor == 0x18d1 &&
     (desc->idProduct == 0x2D00 || desc->idProduct == 0x2D01);
 }
 
+#ifdef ANDROID_DESC_DUMP
 int getConfigDesc(tUSBHostDevice *pDevice)
 {
     tUSBRequest SetupPacket;
@@ -207,20 +676,21 @@ int getConfigDesc(tUSBHostDevice *pDevice)
                                     (t_u8 *)&configDesc[0],
                                     SetupPacket.wLength,
                                     pDevice->DeviceDescriptor.bMaxPacketSize0);
+    USBTRACE_CONTROL_TRANSFER(&SetupPacket, (t_u8 *)&configDesc[0], ulBytes);
 
     pconf_desc = (tConfigDescriptor*)&configDesc[0];
-    UARTprintf("getConfigDesc() ctrlReq return %d bytes\n", ulBytes);
+    DLOG_DEBUG("getConfigDesc() ctrlReq return %d bytes\n", ulBytes);
     if(ulBytes > 0)
     {
-        UARTprintf("configDesc details:\n");
-        UARTprintf(" bLength=0x%02X (shall be 0x09)\n", pconf_desc->bLength);
-        UARTprintf(" wTotalLength=0x%04X\n", pconf_desc->wTotalLength);
-        UARTprintf(" bDescriptorType=0x%02X\n", pconf_desc->bDescriptorType);
-        UARTprintf(" bNumInterfaces=0x%02X\n", pconf_desc->bNumInterfaces);    
-        UARTprintf(" bConfigurationValue=0x%02X\n", pconf_desc->bConfigurationValue);
-        UARTprintf(" iConfiguration=0x%02X\n", pconf_desc->iConfiguration);
-        UARTprintf(" bmAttributes=0x%02X\n", pconf_desc->bmAttributes);
-        UARTprintf(" bMaxPower=0x%02X (unit of 2mA)\n\n", pconf_desc->bMaxPower);    
+        DLOG_DEBUG("configDesc details:\n");
+        DLOG_DEBUG(" bLength=0x%02X (shall be 0x09)\n", pconf_desc->bLength);
+        DLOG_DEBUG(" wTotalLength=0x%04X\n", pconf_desc->wTotalLength);
+        DLOG_DEBUG(" bDescriptorType=0x%02X\n", pconf_desc->bDescriptorType);
+        DLOG_DEBUG(" bNumInterfaces=0x%02X\n", pconf_desc->bNumInterfaces);    
+        DLOG_DEBUG(" bConfigurationValue=0x%02X\n", pconf_desc->bConfigurationValue);
+        DLOG_DEBUG(" iConfiguration=0x%02X\n", pconf_desc->iConfiguration);
+        DLOG_DEBUG(" bmAttributes=0x%02X\n", pconf_desc->bmAttributes);
+        DLOG_DEBUG(" bMaxPower=0x%02X (unit of 2mA)\n\n", pconf_desc->bMaxPower);    
     }
     
     return(ulBytes);
@@ -259,6 +729,7 @@ int getDeviceDesc(tUSBHostDevice *pDevice)
                                         (t_u8 *)&devDesc[0],
                                         sizeof(tDeviceDescriptor),
                                         MAX_PACKET_SIZE_EP0);
+        USBTRACE_CONTROL_TRANSFER(&SetupPacket, (t_u8 *)&devDesc[0], ulBytes);
     }
 
     // Now get the full descriptor now that the actual maximum packet size
@@ -272,31 +743,33 @@ int getDeviceDesc(tUSBHostDevice *pDevice)
         (t_u8 *)&devDesc[0],
         sizeof(tDeviceDescriptor),
         pDevice->DeviceDescriptor.bMaxPacketSize0);
+        USBTRACE_CONTROL_TRANSFER(&SetupPacket, (t_u8 *)&devDesc[0], ulBytes);
     }
 
     pdev_desc = (tDeviceDescriptor*)&devDesc[0];
-    UARTprintf("getDeviceDesc() ctrlReq return %d bytes\n", ulBytes);
+    DLOG_DEBUG("getDeviceDesc() ctrlReq return %d bytes\n", ulBytes);
     if(ulBytes > 0)
     {
-        UARTprintf("DeviceDesc details:\n");        
-        UARTprintf(" bLength=0x%02X (shall be 0x12)\n",  pdev_desc->bLength);
-        UARTprintf(" bDescriptorType=0x%02X\n", pdev_desc->bDescriptorType);
-        UARTprintf(" bcdUSB=0x%02X (USB2.0=0x200)\n",  pdev_desc->bcdUSB);
-        UARTprintf(" bDeviceClass=0x%02X\n",  pdev_desc->bDeviceClass);
-        UARTprintf(" bDeviceSubClass=0x%02X\n", pdev_desc->bDeviceSubClass);    
-        UARTprintf(" bDeviceProtocol=0x%02X\n", pdev_desc->bDeviceProtocol);
-        UARTprintf(" bMaxPacketSize0=0x%02X\n", pdev_desc->bMaxPacketSize0);
-        UARTprintf(" idVendor=0x%02X\n", pdev_desc->idVendor);
-        UARTprintf(" idProduct=0x%02X\n", pdev_desc->idProduct);
-        UARTprintf(" bcdDevice=0x%02X\n", pdev_desc->bcdDevice);
-        UARTprintf(" iManufacturer=0x%02X\n", pdev_desc->iManufacturer);        
-        UARTprintf(" iProduct=0x%02X\n", pdev_desc->iProduct);    
-        UARTprintf(" iSerialNumber=0x%02X\n", pdev_desc->iSerialNumber);    
-        UARTprintf(" bNumConfigurations=0x%02X\n\n", pdev_desc->bNumConfigurations);        
+        DLOG_DEBUG("DeviceDesc details:\n");        
+        DLOG_DEBUG(" bLength=0x%02X (shall be 0x12)\n",  pdev_desc->bLength);
+        DLOG_DEBUG(" bDescriptorType=0x%02X\n", pdev_desc->bDescriptorType);
+        DLOG_DEBUG(" bcdUSB=0x%02X (USB2.0=0x200)\n",  pdev_desc->bcdUSB);
+        DLOG_DEBUG(" bDeviceClass=0x%02X\n",  pdev_desc->bDeviceClass);
+        DLOG_DEBUG(" bDeviceSubClass=0x%02X\n", pdev_desc->bDeviceSubClass);    
+        DLOG_DEBUG(" bDeviceProtocol=0x%02X\n", pdev_desc->bDeviceProtocol);
+        DLOG_DEBUG(" bMaxPacketSize0=0x%02X\n", pdev_desc->bMaxPacketSize0);
+        DLOG_DEBUG(" idVendor=0x%02X\n", pdev_desc->idVendor);
+        DLOG_DEBUG(" idProduct=0x%02X\n", pdev_desc->idProduct);
+        DLOG_DEBUG(" bcdDevice=0x%02X\n", pdev_desc->bcdDevice);
+        DLOG_DEBUG(" iManufacturer=0x%02X\n", pdev_desc->iManufacturer);        
+        DLOG_DEBUG(" iProduct=0x%02X\n", pdev_desc->iProduct);    
+        DLOG_DEBUG(" iSerialNumber=0x%02X\n", pdev_desc->iSerialNumber);    
+        DLOG_DEBUG(" bNumConfigurations=0x%02X\n\n", pdev_desc->bNumConfigurations);        
     }
     
     return(ulBytes);
 }
+#endif
 
 int getProtocol(tUSBHostDevice *pDevice)
 {    
@@ -319,20 +792,24 @@ int getProtocol(tUSBHostDevice *pDevice)
                                     (t_u8 *)&protocol,
                                     SetupPacket.wLength,
                                     pDevice->DeviceDescriptor.bMaxPacketSize0);
-
-    UARTprintf("getProtocol() ctrlReq return %d bytes, protocol:0x%02X\n", ulBytes, protocol);
+    USBTRACE_CONTROL_TRANSFER(&SetupPacket, (t_u8 *)&protocol, ulBytes);
+    if(ulBytes != 2)
+    {
+        return -1;
+    }
 
     return protocol;
 }
 
-void sendString(tUSBHostDevice *pDevice, int index, const char *str)
+bool sendString(tUSBHostDevice *pDevice, int index)
 {        
     tUSBRequest SetupPacket;
     t_u32 ulBytes;
     t_u16 wlen;     
     ulBytes = 0;
 
-    wlen = strlen(str) + 1;
+    // Length computed once by ANDROID_open().
+    wlen = g_sAccessoryStrings[index].len;
 
     // This is a Vendor Device OUT request.
     SetupPacket.bmRequestType = USB_RTYPE_DIR_OUT | USB_RTYPE_VENDOR | USB_RTYPE_DEVICE;
@@ -345,18 +822,17 @@ void sendString(tUSBHostDevice *pDevice, int index, const char *str)
 
     // Put the setup packet in the buffer.
     ulBytes = USBHCDControlTransfer(0, &SetupPacket, pDevice->ulAddress,
-                                    (t_u8 *)str,
+                                    (t_u8 *)g_sAccessoryStrings[index].str,
                                     wlen,
                                     pDevice->DeviceDescriptor.bMaxPacketSize0);
-    
-    UARTprintf("sendString() ctrlReq return %d bytes\n", ulBytes);
+    USBTRACE_CONTROL_TRANSFER(&SetupPacket, NULL, ulBytes);
+
+    return (ulBytes == wlen);
 }
 
 void sendStartUpAccessoryMode(tUSBHostDevice *pDevice)
 {
     tUSBRequest SetupPacket;
-    t_u32 ulBytes;
-    ulBytes = 0;
     int nodata;    
 
     // This is a Vendor Device OUT request.
@@ -368,47 +844,53 @@ void sendStartUpAccessoryMode(tUSBHostDevice *pDevice)
     SetupPacket.wIndex = 0;
     SetupPacket.wLength = 0;
 
-    // Put the setup packet in the buffer.
-    ulBytes = USBHCDControlTransfer(0, &SetupPacket, pDevice->ulAddress,
-                                    (t_u8 *)&nodata,
-                                    0,
-                                    pDevice->DeviceDescriptor.bMaxPacketSize0);
-
-    UARTprintf("sendStartUpAccessoryMode() ctrlReq return %d bytes\n", ulBytes);
+    // Put the setup packet in the buffer, without data stage the transfer
+    // returns 0 bytes (the device switches to accessory mode, no status).
+    USBHCDControlTransfer(0, &SetupPacket, pDevice->ulAddress,
+                          (t_u8 *)&nodata,
+                          0,
+                          pDevice->DeviceDescriptor.bMaxPacketSize0);
+    USBTRACE_CONTROL_TRANSFER(&SetupPacket, NULL, 0);
 }
 
+//*****************************************************************************
+//
+// Switch the device to accessory mode.  The control transfers are issued back
+// to back (nothing is logged between them), each phase end is stored in the
+// connection report.
+//
+//*****************************************************************************
 bool switchDevice(tUSBHostDevice *pDevice)
 {
     int protocol;
-    
-    UARTprintf("Start switchDevice Time=%d\n", g_ulSysTickCount);
-    
-    /* For Debug purpose you can also list full Configuration Descriptor & Device Descriptor */
-/*
-    getConfigDesc(pDevice);
-    getDeviceDesc(pDevice);
-*/
+    int index;
+    bool bStrings;
 
     protocol = getProtocol(pDevice);
-    if (protocol == 1) 
-    {
-        UARTprintf("Device supports protocol 1\n");
-    } else 
+    g_sConnectReport.protocol_us = GetTime_us();
+    if (protocol != 1) 
     {
-        UARTprintf("Could not read device protocol version\n");
+        DLOG_ERROR("Could not read device protocol version (%d)\n", protocol);
         return false;
     }
 
-    sendString(pDevice, ACCESSORY_STRING_MANUFACTURER, id_android_accessory->manufacturer);
-    sendString(pDevice, ACCESSORY_STRING_MODEL, id_android_accessory->model);
-    sendString(pDevice, ACCESSORY_STRING_DESCRIPTION, id_android_accessory->description);   
-    sendString(pDevice, ACCESSORY_STRING_VERSION, id_android_accessory->version);
-    sendString(pDevice, ACCESSORY_STRING_URI, id_android_accessory->uri);
-    sendString(pDevice, ACCESSORY_STRING_SERIAL, id_android_accessory->serial);
+    bStrings = true;
+    for(index = 0; index < ACCESSORY_NB_STRINGS; index++)
+    {
+        if(sendString(pDevice, index) == false)
+        {
+            bStrings = false;
+        }
+    }
+    g_sConnectReport.strings_us = GetTime_us();
 
     sendStartUpAccessoryMode(pDevice);
+    g_sConnectReport.start_us = GetTime_us();
 
-    UARTprintf("End switchDevice Time=%d\n", g_ulSysTickCount);    
+    if(bStrings == false)
+    {
+        DLOG_ERROR("Accessory identity string not accepted by the device\n");
+    }
     
     return true;
 }
@@ -433,6 +915,8 @@ bool switchDevice(tUSBHostDevice *pDevice)
 //*****************************************************************************
 void USBHANDROIDCallback(t_u32 ulInstance, t_u32 ulEvent, void *pvData)
 {
+    USBTRACE_ANDROID(ulEvent);
+
     // Determine the event.
     switch(ulEvent)
     {
@@ -440,7 +924,7 @@ void USBHANDROIDCallback(t_u32 ulInstance, t_u32 ulEvent, void *pvData)
         // device.
         case ANDROID_EVENT_OPEN:
         {
-            UARTprintf("Android Open OK Time=%d\n", g_ulSysTickCount);    
+            DLOG_INFO("Android Open OK Time=%d\n", g_ulSysTickCount);    
             // Proceed to the enumeration state.
             g_eState = STATE_DEVICE_ENUM;
             break;
@@ -450,16 +934,16 @@ void USBHANDROIDCallback(t_u32 ulInstance, t_u32 ulEvent, void *pvData)
         // the device is no longer present.
         case ANDROID_EVENT_CLOSE:
         {
-            UARTprintf("Android Close OK Time=%d\n", g_ulSysTickCount);            
+            DLOG_INFO("Android Close OK Time=%d\n", g_ulSysTickCount);            
             // Go back to the "no device" state and wait for a new connection.
             g_eState = STATE_NO_DEVICE;
             break;
         }
 
+        // Called from interrupt context when a packet has been stored in
+        // the RX ring, ANDROID_read() will copy it out.
         case ANDROID_EVENT_RX_AVAILABLE:
         {
-            UARTprintf("Android RX avail Time=%d\n", g_ulSysTickCount);            
-            rx_data_available += 1;
             break;
         }
 
@@ -491,48 +975,22 @@ static void * USBHANDROIDOpen(tUSBHostDevice *pDevice)
     tEndpointDescriptor *pEndpointDescriptor;
     tInterfaceDescriptor *pInterface;
 
-    UARTprintf("\nStart USBHANDROIDOpen Time=%d\n", g_ulSysTickCount);
-
-    /* For Debug purpose you can also list full Configuration Descriptor & Device Descriptor */
+#ifdef ANDROID_DESC_DUMP
+    /* For Debug purpose list the full Configuration Descriptor & Device Descriptor */
     getConfigDesc(pDevice);
     getDeviceDesc(pDevice);
-/*
-    UARTprintf("Start pDevice->pConfigDescriptor details Time=%d:\n", g_ulSysTickCount);
-    UARTprintf(" bLength=0x%02X (shall be 0x09)\n", pDevice->pConfigDescriptor->bLength);
-    UARTprintf(" wTotalLength=0x%04X\n", pDevice->pConfigDescriptor->wTotalLength);
-    UARTprintf(" bDescriptorType=0x%02X\n", pDevice->pConfigDescriptor->bDescriptorType);
-    UARTprintf(" bNumInterfaces=0x%02X\n", pDevice->pConfigDescriptor->bNumInterfaces);    
-    UARTprintf(" bConfigurationValue=0x%02X\n", pDevice->pConfigDescriptor->bConfigurationValue);
-    UARTprintf(" iConfiguration=0x%02X\n", pDevice->pConfigDescriptor->iConfiguration);
-    UARTprintf(" bmAttributes=0x%02X\n", pDevice->pConfigDescriptor->bmAttributes);
-    UARTprintf(" bMaxPower=0x%02X (unit of 2mA)\n\n", pDevice->pConfigDescriptor->bMaxPower);
-
-    UARTprintf("pDevice->DeviceDescriptor details:\n");
-    UARTprintf(" bLength=0x%02X (shall be 0x12)\n",  pDevice->DeviceDescriptor.bLength);
-    UARTprintf(" bDescriptorType=0x%02X\n",  pDevice->DeviceDescriptor.bDescriptorType);
-    UARTprintf(" bcdUSB=0x%02X (USB2.0=0x200)\n",  pDevice->DeviceDescriptor.bcdUSB);
-    UARTprintf(" bDeviceClass=0x%02X\n",  pDevice->DeviceDescriptor.bDeviceClass);
-    UARTprintf(" bDeviceSubClass=0x%02X\n",  pDevice->DeviceDescriptor.bDeviceSubClass);    
-    UARTprintf(" bDeviceProtocol=0x%02X\n",  pDevice->DeviceDescriptor.bDeviceProtocol);
-    UARTprintf(" bMaxPacketSize0=0x%02X\n",  pDevice->DeviceDescriptor.bMaxPacketSize0);
-    UARTprintf(" idVendor=0x%02X\n",  pDevice->DeviceDescriptor.idVendor);
-    UARTprintf(" idProduct=0x%02X\n",  pDevice->DeviceDescriptor.idProduct);
-    UARTprintf(" bcdDevice=0x%02X\n",  pDevice->DeviceDescriptor.bcdDevice);
-    UARTprintf(" iManufacturer=0x%02X\n",  pDevice->DeviceDescriptor.iManufacturer);        
-    UARTprintf(" iProduct=0x%02X\n",  pDevice->DeviceDescriptor.iProduct);    
-    UARTprintf(" iSerialNumber=0x%02X\n",  pDevice->DeviceDescriptor.iSerialNumber);    
-    UARTprintf(" bNumConfigurations=0x%02X\n",  pDevice->DeviceDescriptor.bNumConfigurations);
-    UARTprintf("End pDevice->pConfigDescriptor details Time=%d:\n\n", g_ulSysTickCount);
-*/
+#endif
+
     // Don't allow the device to be opened without closing first.
     if(g_USBHANDROIDDevice.pDevice)
     {
-        UARTprintf("\nUSBHANDROIDOpen return 0 device already opened\n");
+        DLOG_ERROR("USBHANDROIDOpen return 0 device already opened\n");
         return(0);
     }
 
     // Save the device pointer.
     g_USBHANDROIDDevice.pDevice = pDevice;
+    USBTRACE_DEVICE_OPEN(pDevice->DeviceDescriptor.idVendor, pDevice->DeviceDescriptor.idProduct);
 
     // Save the callback.
     // The CallBack is the driver callback for any Android ADK events.
@@ -547,7 +1005,7 @@ static void * USBHANDROIDOpen(tUSBHostDevice *pDevice)
     /* Check Android Accessory device */
     if (isAccessoryDevice(&pDevice->DeviceDescriptor)) 
     {
-        UARTprintf("Found Android Accessory device Time=%d\n", g_ulSysTickCount);
+        g_sConnectReport.accessory_us = GetTime_us();
 
         // Get the interface descriptor.
         pInterface = USBDescGetInterface(pDevice->pConfigDescriptor, 0, 0);    
@@ -560,20 +1018,20 @@ static void * USBHANDROIDOpen(tUSBHostDevice *pDevice)
             USBDescGetInterfaceEndpoint(pInterface, iIdx,
             pDevice->ulConfigDescriptorSize);
             
-            UARTprintf("\nEndpoint%d USBDescGetInterfaceEndpoint()=pEndpointDescriptor res=0x%08X\n", iIdx, pEndpointDescriptor);
+            DLOG_DEBUG("Endpoint%d USBDescGetInterfaceEndpoint()=pEndpointDescriptor res=0x%08X\n", iIdx, (t_u32)pEndpointDescriptor);
 
             // If no more endpoints then break out.
             if(pEndpointDescriptor == 0)
             {
                 break;
             }
-            UARTprintf("pEndpointDescriptor details:\n");
-            UARTprintf(" bLength=0x%02X (shall be 0x07)\n", pEndpointDescriptor->bLength);
-            UARTprintf(" bDescriptorType=0x%02X\n", pEndpointDescriptor->bDescriptorType);
-            UARTprintf(" bEndpointAddress=0x%02X\n", pEndpointDescriptor->bEndpointAddress);
-            UARTprintf(" bmAttributes=0x%02X (0x00=CTRL, 0x01=ISOC, 0x02=BULK, 0x03=INT\n", pEndpointDescriptor->bmAttributes);
-            UARTprintf(" wMaxPacketSize=0x%04X\n", pEndpointDescriptor->wMaxPacketSize);
-            UARTprintf(" bInterval=0x%04X\n", pEndpointDescriptor->bInterval);
+            DLOG_DEBUG("pEndpointDescriptor details:\n");
+            DLOG_DEBUG(" bLength=0x%02X (shall be 0x07)\n", pEndpointDescriptor->bLength);
+            DLOG_DEBUG(" bDescriptorType=0x%02X\n", pEndpointDescriptor->bDescriptorType);
+            DLOG_DEBUG(" bEndpointAddress=0x%02X\n", pEndpointDescriptor->bEndpointAddress);
+            DLOG_DEBUG(" bmAttributes=0x%02X (0x00=CTRL, 0x01=ISOC, 0x02=BULK, 0x03=INT\n", pEndpointDescriptor->bmAttributes);
+            DLOG_DEBUG(" wMaxPacketSize=0x%04X\n", pEndpointDescriptor->wMaxPacketSize);
+            DLOG_DEBUG(" bInterval=0x%04X\n", pEndpointDescriptor->bInterval);
 
             // See if this is a bulk endpoint.
             if((pEndpointDescriptor->bmAttributes & USB_EP_ATTR_TYPE_M) ==
@@ -582,37 +1040,58 @@ static void * USBHANDROIDOpen(tUSBHostDevice *pDevice)
                 // See if this is bulk IN or bulk OUT.
                 if(pEndpointDescriptor->bEndpointAddress & USB_EP_DESC_IN)
                 {
-                    UARTprintf("Endpoint Bulk In alloc USB Pipe\n");
+                    DLOG_DEBUG("Endpoint Bulk In alloc USB Pipe\n");
                     // Allocate the USB Pipe for this Bulk IN endpoint.
-                    g_USBHANDROIDDevice.ulBulkInPipe = USBHCDPipeAllocSize(0, USBHCD_PIPE_BULK_IN_DMA,
+                    // Packets are read from the FIFO by the pipe callback.
+                    g_USBHANDROIDDevice.ulBulkInPipe = USBHCDPipeAllocSize(0, USBHCD_PIPE_BULK_IN,
                                                                            pDevice->ulAddress,
                                                                            pEndpointDescriptor->wMaxPacketSize,
-                                                                           0);
+                                                                           USBHANDROIDPipeCallback);
                     // Configure the USB pipe as a Bulk IN endpoint.
                     USBHCDPipeConfig(g_USBHANDROIDDevice.ulBulkInPipe,
                                      pEndpointDescriptor->wMaxPacketSize,
                                      BULK_READ_TIMEOUT,
                                      (pEndpointDescriptor->bEndpointAddress &
                                      USB_EP_DESC_NUM_M));
+
+                    // Always read full packets in the RX ring.
+                    g_USBHANDROIDDevice.ulRxPacketSize = pEndpointDescriptor->wMaxPacketSize;
+                    if(g_USBHANDROIDDevice.ulRxPacketSize > ANDROID_RX_PACKET_SIZE)
+                    {
+                        g_USBHANDROIDDevice.ulRxPacketSize = ANDROID_RX_PACKET_SIZE;
+                    }
+                    DLOG_DEBUG("Bulk In transfer size %d bytes\n", g_USBHANDROIDDevice.ulRxPacketSize);
                 }
                 else
                 {
-                    UARTprintf("Endpoint Bulk OUT alloc USB Pipe\n");
-                    // Allocate the USB Pipe for this Bulk OUT endpoint.
-                    g_USBHANDROIDDevice.ulBulkOutPipe = USBHCDPipeAllocSize(0, USBHCD_PIPE_BULK_OUT_DMA,
-                                                                            pDevice->ulAddress,
-                                                                            pEndpointDescriptor->wMaxPacketSize,
-                                                                            0);
-                    // Configure the USB pipe as a Bulk OUT endpoint.
-                    USBHCDPipeConfig(g_USBHANDROIDDevice.ulBulkOutPipe,
-                                     pEndpointDescriptor->wMaxPacketSize,
-                                     BULK_WRITE_TIMEOUT,
-                                     (pEndpointDescriptor->bEndpointAddress &
-                                     USB_EP_DESC_NUM_M));
+                    DLOG_DEBUG("Endpoint Bulk OUT alloc USB Pipe\n");
+                    // Allocate and configure the USB Pipe for this Bulk OUT endpoint
+                    // (the pipe is reallocated to drop a frame past its deadline).
+                    // Frames are written in the FIFO from the TX queue.
+                    g_USBHANDROIDDevice.ulBulkOutEndpoint = pEndpointDescriptor->bEndpointAddress &
+                                                            USB_EP_DESC_NUM_M;
+                    g_USBHANDROIDDevice.ulBulkOutPacketSize = pEndpointDescriptor->wMaxPacketSize;
+                    USBHANDROIDTxPipeOpen(&g_USBHANDROIDDevice);
                 }
             }
         }
 
+        // Start receiving in the RX ring with an empty TX queue.
+        g_USBHANDROIDDevice.ulRxHead = 0;
+        g_USBHANDROIDDevice.ulRxTail = 0;
+        g_USBHANDROIDDevice.ulRxBytesIn = 0;
+        g_USBHANDROIDDevice.ulRxBytesOut = 0;
+        g_USBHANDROIDDevice.ulTxHead = 0;
+        g_USBHANDROIDDevice.ulTxTail = 0;
+        g_USBHANDROIDDevice.bTxBusy = false;
+        g_USBHANDROIDDevice.ulRxRetries = 0;
+        g_USBHANDROIDDevice.bRxHalted = false;
+        g_USBHANDROIDDevice.bTxHalted = false;
+        if(g_USBHANDROIDDevice.ulBulkInPipe != 0)
+        {
+            USBHANDROIDRxArm(&g_USBHANDROIDDevice);
+        }
+
         // If the callback exists, call it with an Open event.
         if(g_USBHANDROIDDevice.pfnCallback != 0)
         {
@@ -622,16 +1101,18 @@ static void * USBHANDROIDOpen(tUSBHostDevice *pDevice)
         
         // Set Flag isConnected
         g_USBHANDROIDDevice.connected = true;
+        g_sConnectReport.connected_us = GetTime_us();
     } else 
     {
-        UARTprintf("Found possible device. switching to serial mode Time=%d\n", g_ulSysTickCount);
+        g_sConnectReport.open_us = GetTime_us();
         switchDevice(pDevice);
         
         // Set Flag isConnected
         g_USBHANDROIDDevice.connected = false;  
+
+        DLOG_INFO("Found possible device, switched to accessory mode\n");
     }
 
-    UARTprintf("\nEnd USBHANDROIDOpen Time=%d\n", g_ulSysTickCount);        
     // Return the only instance of this device.
     return(&g_USBHANDROIDDevice);
 }
@@ -651,7 +1132,7 @@ static void * USBHANDROIDOpen(tUSBHostDevice *pDevice)
 //*****************************************************************************
 static void USBHANDROIDClose(void *pvInstance)
 {
-    UARTprintf("Start USBHANDROIDClose Time=%d\n", g_ulSysTickCount);    
+    DLOG_INFO("Start USBHANDROIDClose Time=%d\n", g_ulSysTickCount);    
 
     // Do nothing if there is not a driver open.
     if(g_USBHANDROIDDevice.pDevice == 0)
@@ -665,19 +1146,33 @@ static void USBHANDROIDClose(void *pvInstance)
     // Reset the device pointer.
     g_USBHANDROIDDevice.pDevice = 0;
 
-    // Free the Bulk IN pipe.
+    // Free the Bulk IN pipe and drop any data left in the RX ring.
     if(g_USBHANDROIDDevice.ulBulkInPipe != 0)
     {
-        UARTprintf("Endpoint Bulk In Free USB Pipe 0x%08X\n", g_USBHANDROIDDevice.ulBulkInPipe);
+        DLOG_DEBUG("Endpoint Bulk In Free USB Pipe 0x%08X\n", g_USBHANDROIDDevice.ulBulkInPipe);
         USBHCDPipeFree(g_USBHANDROIDDevice.ulBulkInPipe);
+        g_USBHANDROIDDevice.ulBulkInPipe = 0;
     }
+    g_USBHANDROIDDevice.bRxArmed = false;
+    g_USBHANDROIDDevice.ulRxHead = 0;
+    g_USBHANDROIDDevice.ulRxTail = 0;
+    g_USBHANDROIDDevice.ulRxBytesIn = 0;
+    g_USBHANDROIDDevice.ulRxBytesOut = 0;
 
     // Free the Bulk OUT pipe.
     if(g_USBHANDROIDDevice.ulBulkOutPipe != 0)
     {
-        UARTprintf("Endpoint Bulk OUT Free USB Pipe 0x%08X\n", g_USBHANDROIDDevice.ulBulkOutPipe);        
+        DLOG_DEBUG("Endpoint Bulk OUT Free USB Pipe 0x%08X\n", g_USBHANDROIDDevice.ulBulkOutPipe);        
         USBHCDPipeFree(g_USBHANDROIDDevice.ulBulkOutPipe);
+        g_USBHANDROIDDevice.ulBulkOutPipe = 0;
+    }
+
+    // Abort all frames still in the TX queue, a borrowed frame can not be submitted anymore.
+    while(g_USBHANDROIDDevice.ulTxTail != g_USBHANDROIDDevice.ulTxHead)
+    {
+        USBHANDROIDTxComplete(&g_USBHANDROIDDevice, ANDROID_TX_ABORTED);
     }
+    g_USBHANDROIDDevice.bTxBorrowed = false;
 
     // If the callback exists then call it.
     if(g_USBHANDROIDDevice.pfnCallback != 0)
@@ -689,7 +1184,7 @@ static void USBHANDROIDClose(void *pvInstance)
     // Clear the callback indicating that the device is now closed.
     g_USBHANDROIDDevice.pfnCallback = 0;
     
-    UARTprintf("End USBHANDROIDClose Time=%d\n", g_ulSysTickCount);    
+    DLOG_INFO("End USBHANDROIDClose Time=%d\n", g_ulSysTickCount);    
 }
 
 //*****************************************************************************
@@ -700,6 +1195,15 @@ static void USBHANDROIDClose(void *pvInstance)
 #define TICKS_PER_SECOND 1000
 #define MS_PER_SYSTICK (1000 / TICKS_PER_SECOND)
 
+//*****************************************************************************
+//
+// SysTick counter reload value and number of SysTick clocks per microsecond,
+// set by Hardware_Init() and used by GetTime_us().
+//
+//*****************************************************************************
+static t_u32 g_ulSysTickPeriod = 1;
+static t_u32 g_ulSysTickPerUs = 1;
+
 //*****************************************************************************
 //
 // Our running system tick counter and a global used to determine the time
@@ -777,23 +1281,6 @@ static tUSBHostClassDriver const * const g_ppHostClassDrivers[] =
 /* End of ANDROID Host Driver */
 /******************************/
 
-//*****************************************************************************
-//
-// The control table used by the uDMA controller.  This table must be aligned
-// to a 1024 t_u8 boundary.  In this application uDMA is only used for USB,
-// so only the first 6 channels are needed.
-//
-//*****************************************************************************
-#if defined(ewarm)
-#pragma data_alignment=1024
-tDMAControlTable g_sDMAControlTable[6];
-#elif defined(ccs)
-#pragma DATA_ALIGN(g_sDMAControlTable, 1024)
-tDMAControlTable g_sDMAControlTable[6];
-#else
-tDMAControlTable g_sDMAControlTable[6] __attribute__ ((aligned(1024)));
-#endif
-
 //*****************************************************************************
 //
 // The current USB operating mode - Host, Device or unknown.
@@ -824,6 +1311,23 @@ SysTickIntHandler(void)
 {
     // Update our tick counter.
     g_ulSysTickCount++;
+
+    EVENT_post(EVENT_TICK);
+}
+
+//*****************************************************************************
+//
+// This is the handler for the USB0 interrupt.  The USB library handler runs
+// the host stack and the pipe callbacks, then the main loop is woken up to
+// process the new USB state and the received data.
+//
+//*****************************************************************************
+void
+USB0IntHandler(void)
+{
+    USB0OTGModeIntHandler();
+
+    EVENT_post(EVENT_USB);
 }
 
 //*****************************************************************************
@@ -860,6 +1364,15 @@ static t_u32 GetTickms(void)
 void USBStackRefresh(void)
 {
     USBOTGMain(GetTickms());
+
+    // Drop a frame past its deadline and restart the TX queue in case a frame
+    // was queued while the pipe was idle.
+    if(g_USBHANDROIDDevice.connected == true)
+    {
+        USBHANDROIDTxDeadline(&g_USBHANDROIDDevice);
+        USBHANDROIDRecover(&g_USBHANDROIDDevice);
+        USBHANDROIDTxKick(&g_USBHANDROIDDevice);
+    }
 }
 
 /* User function */
@@ -883,6 +1396,42 @@ t_u32 Delta_time_ms(t_u32 start, t_u32 end)
     return diff;
 } 
 
+//*****************************************************************************
+//
+//! This function returns the time from reset in microseconds.
+//!
+//! The time is the SysTick tick count plus the elapsed part of the current
+//! SysTick period.  It can be called from any context: when the SysTick
+//! counter has wrapped but the SysTick interrupt is still pending (caller
+//! running in an interrupt handler) the missing millisecond is added.
+//!
+//! \return Returns the time in microseconds (wraps every 71 minutes, use
+//! unsigned difference to compute durations).
+//
+//*****************************************************************************
+t_u32 GetTime_us(void)
+{
+    t_u32 ulTick, ulValue, ulPending;
+
+    // Retry if the SysTick counter wrapped during the reads.
+    do
+    {
+        ulTick = g_ulSysTickCount;
+        ulPending = HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_PEND_SYST;
+        ulValue = ROM_SysTickValueGet();
+    }while((ulTick != g_ulSysTickCount) ||
+           (ulPending != (HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_PEND_SYST)));
+
+    if(ulPending)
+    {
+        ulTick++;
+    }
+
+    // SysTick counts down from the reload value.
+    return (ulTick * (1000 * MS_PER_SYSTICK)) +
+           ((g_ulSysTickPeriod - 1 - ulValue) / g_ulSysTickPerUs);
+}
+
 void WaitTime_ms(t_u32 wait_ms)
 {
     t_u32 start, end;
@@ -914,6 +1463,13 @@ void WaitTime_ms(t_u32 wait_ms)
 //*****************************************************************************
 void ModeCallback(t_u32 ulIndex, tUSBMode eMode)
 {
+    // A new host session is the start of the connection latency.
+    if((eMode == USB_MODE_HOST) && (g_eCurrentUSBMode != USB_MODE_HOST))
+    {
+        memset(&g_sConnectReport, 0, sizeof(g_sConnectReport));
+        g_sConnectReport.plug_us = GetTime_us();
+    }
+
     // Save the new mode.
     g_eCurrentUSBMode = eMode;
 }
@@ -941,12 +1497,13 @@ void USBHCDEvents(void *pvData)
 
     // Cast this pointer to its actual type.
     pEventInfo = (tEventInfo *)pvData;
+    USBTRACE_HCD(pEventInfo->ulEvent);
 
     switch(pEventInfo->ulEvent)
     {
         case USB_EVENT_CONNECTED:
         {
-            UARTprintf("Unknown connected\n");
+            DLOG_INFO("Unknown connected\n");
             // An unknown device was detected.
             g_eState = STATE_UNKNOWN_DEVICE;
 
@@ -955,7 +1512,7 @@ void USBHCDEvents(void *pvData)
 
         case USB_EVENT_DISCONNECTED:
         {
-            UARTprintf("Unknown disconnected\n");
+            DLOG_INFO("Unknown disconnected\n");
             // Unknown device has been removed.
             g_eState = STATE_NO_DEVICE;
 
@@ -964,7 +1521,7 @@ void USBHCDEvents(void *pvData)
 
         case USB_EVENT_POWER_FAULT:
         {
-            UARTprintf("Unknown PowerFault\n");
+            DLOG_ERROR("Unknown PowerFault\n");
             // No power means no device is present.
             g_eState = STATE_POWER_FAULT;
             break;
@@ -972,7 +1529,7 @@ void USBHCDEvents(void *pvData)
 
         default:
         {
-            UARTprintf("Unknown Event\n");            
+            DLOG_INFO("Unknown Event\n");            
             break;
         }
     }
@@ -1020,6 +1577,16 @@ void Hardware_Init(void)
     ROM_GPIOPadConfigSet(BUMP_R_SW4_PORT_BASE, BUMP_R_SW4_PIN, GPIO_STRENGTH_2MA,
                         GPIO_PIN_TYPE_STD_WPU);
 
+    // Interrupt on both edges of the switches and bumpers to wake up the main loop.
+    ROM_GPIOIntTypeSet(USER_SW1_PORT_BASE, USER_SW1_PIN | USER_SW2_PIN, GPIO_BOTH_EDGES);
+    ROM_GPIOIntTypeSet(BUMP_L_SW3_PORT_BASE, BUMP_L_SW3_PIN | BUMP_R_SW4_PIN, GPIO_BOTH_EDGES);
+    ROM_GPIOPinIntClear(USER_SW1_PORT_BASE, USER_SW1_PIN | USER_SW2_PIN);
+    ROM_GPIOPinIntClear(BUMP_L_SW3_PORT_BASE, BUMP_L_SW3_PIN | BUMP_R_SW4_PIN);
+    ROM_GPIOPinIntEnable(USER_SW1_PORT_BASE, USER_SW1_PIN | USER_SW2_PIN);
+    ROM_GPIOPinIntEnable(BUMP_L_SW3_PORT_BASE, BUMP_L_SW3_PIN | BUMP_R_SW4_PIN);
+    ROM_IntEnable(INT_GPIOD);
+    ROM_IntEnable(INT_GPIOE);
+
     // Enable the GPIO pin for the LED1 (PF4) & LED2 (PF5) 
     // Set the direction as output, and enable the GPIO pin for digital function.
     ROM_SysCtlPeripheralEnable(LED1_SYSCTL_PERIPH);      
@@ -1028,7 +1595,9 @@ void Hardware_Init(void)
     GPIOPinTypeGPIOOutput(LED2_PORT_BASE, LED2_PIN);
 
     // Configure SysTick for a 1KHz interrupt.
-    ROM_SysTickPeriodSet(ROM_SysCtlClockGet() / TICKS_PER_SECOND);
+    g_ulSysTickPeriod = ROM_SysCtlClockGet() / TICKS_PER_SECOND;
+    g_ulSysTickPerUs = ROM_SysCtlClockGet() / 1000000;
+    ROM_SysTickPeriodSet(g_ulSysTickPeriod);
     ROM_SysTickEnable();
     ROM_SysTickIntEnable();
 
@@ -1050,11 +1619,6 @@ void Hardware_Init(void)
     // PB0 = GND =USB HOST Enabled.
     GPIO_PORTB_DATA_R &= ~(GPIO_PIN_0);      
 
-    // Enable the uDMA controller and set up the control table base.
-    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
-    ROM_uDMAEnable();
-    ROM_uDMAControlBaseSet(g_sDMAControlTable);
-
     // Initialize the USB stack mode and pass in a mode callback.
     USBStackModeSet(0, USB_MODE_OTG, ModeCallback);
 
@@ -1065,10 +1629,10 @@ void Hardware_Init(void)
     // to be active high and does not enable the power fault.
     USBHCDPowerConfigInit(0, USBHCD_VBUS_AUTO_HIGH | USBHCD_VBUS_FILTER);
 
-    // Initialize the USB controller for OTG operation with a 250ms polling
-    // rate.
-    // Warning if this delay is higher it cannot connect correctly to Android ADK.
-    USBOTGModeInit(0, 250, g_pHCDPool, HCD_MEMORY_SIZE);
+    // Initialize the USB controller for OTG operation with a OTG_POLL_MILLISEC
+    // polling rate.
+    // Warning if this delay is higher than 250ms it cannot connect correctly to Android ADK.
+    USBOTGModeInit(0, OTG_POLL_MILLISEC, g_pHCDPool, HCD_MEMORY_SIZE);
 
 }
 
@@ -1084,8 +1648,22 @@ void Hardware_Init(void)
 //*****************************************************************************
 t_AndroidInstance ANDROID_open(const t_ident_android_accessory* android_accessory/*in*/)
 {
+    int iIdx;
+
     // Set Android Accessory
     id_android_accessory = (t_ident_android_accessory*)android_accessory;
+
+    // Serialize the identity strings once (ACCESSORY_STRING_XXX order).
+    g_sAccessoryStrings[ACCESSORY_STRING_MANUFACTURER].str = android_accessory->manufacturer;
+    g_sAccessoryStrings[ACCESSORY_STRING_MODEL].str = android_accessory->model;
+    g_sAccessoryStrings[ACCESSORY_STRING_DESCRIPTION].str = android_accessory->description;
+    g_sAccessoryStrings[ACCESSORY_STRING_VERSION].str = android_accessory->version;
+    g_sAccessoryStrings[ACCESSORY_STRING_URI].str = android_accessory->uri;
+    g_sAccessoryStrings[ACCESSORY_STRING_SERIAL].str = android_accessory->serial;
+    for(iIdx = 0; iIdx < ACCESSORY_NB_STRINGS; iIdx++)
+    {
+        g_sAccessoryStrings[iIdx].len = strlen(g_sAccessoryStrings[iIdx].str) + 1;
+    }
     
     // Return the requested device instance.
     return((t_AndroidInstance)&g_USBHANDROIDDevice);
@@ -1137,75 +1715,397 @@ bool ANDROID_isConnected(t_AndroidInstance handle)
     return connected;
 }
 
-/*
- * Todo replace this call by Asynchronous/Non Blocking
- * */
+//*****************************************************************************
+//
+//! This function returns the connection latency report of the last plugged
+//! device.
+//!
+//! \param report receives the time of each connection phase end.
+//!
+//! A phase not seen by the driver has a zero time (for example the switch
+//! phases when the device is already in accessory mode).  The report is
+//! complete once ANDROID_isConnected() returns true.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void ANDROID_getConnectReport(t_android_connect_report* const report/*out*/)
+{
+    *report = g_sConnectReport;
+}
+
+//*****************************************************************************
+//
+//! This function copies received data out of the RX ring.
+//!
+//! \param handle is the device instance returned by ANDROID_open().
+//! \param buff is the buffer receiving the data.
+//! \param len is the maximum number of bytes to copy in \e buff.
+//!
+//! This function never waits for the device: the Bulk IN pipe is serviced in
+//! interrupt context and this call only copies bytes already stored in the RX
+//! ring, it can be called at any time even when the device is removed.
+//!
+//! \return The number of bytes copied in \e buff (0 if no data is available).
+//
+//*****************************************************************************
 int ANDROID_read(t_AndroidInstance handle, t_u8* const buff/*out*/, const int len/*in*/)
 {
-    t_u16 i, nbdata;
-    t_u32 ulBytes;
-    t_USBHANDROIDInstance *pANDROIDDevice;
+    const t_u8 *pucData;
+    int nbdata, size;
 
-    // Get a pointer to the device instance data from the handle.
-    pANDROIDDevice = (t_USBHANDROIDInstance *)handle;
-    if(pANDROIDDevice != NULL)
+    nbdata = 0;
+    while(nbdata < len)
     {
-        /*
-        * TODO use asynchronous transfer maybe to have better performance ...
-        */
-        /*
-        if(rx_data_available == 0)
+        size = ANDROID_rxPeek(handle, &pucData);
+        if(size == 0)
         {
-            ulBytes = USBHCDPipeSchedule(g_USBHANDROIDDevice.ulBulkInPipe, (unsigned char*)buff, len);
-            rx_data_available = len;
+            break;
         }
-        ulBytes = USBHCDPipeReadNonBlocking(g_USBHANDROIDDevice.ulBulkInPipe, (unsigned char*)buff, len);
-        rx_data_available = rx_data_available - ulBytes;
-        */
-        
-        /* Workaround code to ensure data are received and are not equal to 0.
-        *  because USBHCDPipeRead() sometimes return size >0 (when timeout) even if there is no new data.
-        * */
-        for(i=0; i<len; i++)
+        if(size > (len - nbdata))
         {
-            buff[i] = 0;
+            size = len - nbdata;
         }
-        nbdata = 0;
-        ulBytes = USBHCDPipeRead(pANDROIDDevice->ulBulkInPipe, (unsigned char*)buff, len);
-        for(i=0; i<len; i++)
+        memcpy(&buff[nbdata], pucData, size);
+        ANDROID_rxRelease(handle, size);
+        nbdata += size;
+    }
+
+    return nbdata;
+}
+
+//*****************************************************************************
+//
+//! This function gives access to the received data in place.
+//!
+//! \param handle is the device instance returned by ANDROID_open().
+//! \param data receives a pointer to the first byte not read yet.
+//!
+//! The data is left in its RX ring slot (no copy), the slot is given back to
+//! the Bulk IN pipe by ANDROID_rxRelease() while the other slots keep
+//! receiving.  The pointer is valid until ANDROID_rxRelease() or
+//! USBStackRefresh() is called.  This function never waits for the device.
+//!
+//! \return The number of contiguous bytes at \e data (the rest of one USB
+//! packet), 0 if no data is available.
+//
+//*****************************************************************************
+int ANDROID_rxPeek(t_AndroidInstance handle, const t_u8** const data/*out*/)
+{
+    t_USBHANDROIDInstance *pANDROIDDevice;
+    t_ANDROIDRxPacket *pPacket;
+
+    // Get a pointer to the device instance data from the handle.
+    pANDROIDDevice = (t_USBHANDROIDInstance *)handle;
+    if(pANDROIDDevice == NULL)
+    {
+        /* Error invalid handle */
+        return 0;
+    }
+
+    // Nothing received, O(1) return.
+    if(pANDROIDDevice->ulRxTail == pANDROIDDevice->ulRxHead)
+    {
+        return 0;
+    }
+
+    pPacket = &g_sANDROIDRxRing[pANDROIDDevice->ulRxTail & ANDROID_RX_RING_MASK];
+    *data = &pPacket->pucData[pPacket->usOffset];
+
+    return pPacket->usLength - pPacket->usOffset;
+}
+
+//*****************************************************************************
+//
+//! This function consumes received data returned by ANDROID_rxPeek().
+//!
+//! \param handle is the device instance returned by ANDROID_open().
+//! \param len is the number of bytes consumed, at most the value returned by
+//! the last ANDROID_rxPeek().
+//!
+//! Once all its bytes are consumed the slot is given back to the Bulk IN pipe.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void ANDROID_rxRelease(t_AndroidInstance handle, const int len/*in*/)
+{
+    t_USBHANDROIDInstance *pANDROIDDevice;
+    t_ANDROIDRxPacket *pPacket;
+
+    // Get a pointer to the device instance data from the handle.
+    pANDROIDDevice = (t_USBHANDROIDInstance *)handle;
+    if((pANDROIDDevice == NULL) || (len <= 0) ||
+       (pANDROIDDevice->ulRxTail == pANDROIDDevice->ulRxHead))
+    {
+        return;
+    }
+
+    pPacket = &g_sANDROIDRxRing[pANDROIDDevice->ulRxTail & ANDROID_RX_RING_MASK];
+    if(len > (pPacket->usLength - pPacket->usOffset))
+    {
+        return;
+    }
+    pPacket->usOffset += len;
+    pANDROIDDevice->ulRxBytesOut += len;
+
+    // Slot fully consumed, give it back to the Bulk IN pipe.
+    if(pPacket->usOffset == pPacket->usLength)
+    {
+        pANDROIDDevice->ulRxTail++;
+        if((pANDROIDDevice->bRxArmed == false) && (pANDROIDDevice->connected == true))
         {
-            if(buff[i] != 0)
-            nbdata++;
+            USBHANDROIDRxArm(pANDROIDDevice);
         }
-        // Data have not changed assume no data received
-        if(nbdata == 0)
-            ulBytes = 0;
     }
-    else
+}
+
+//*****************************************************************************
+//
+//! This function reads one message of a fixed size from the RX stream.
+//!
+//! \param handle is the device instance returned by ANDROID_open().
+//! \param buff is the buffer receiving the message.
+//! \param len is the size of the message.
+//!
+//! The message is copied only once all its bytes are received, a message split
+//! over several USB packets is reassembled from the RX ring and several
+//! messages received in the same packet are returned by successive calls.
+//! This function never waits for the device.
+//!
+//! \return \e len if a message is copied in \e buff, 0 if the message is not
+//! completely received yet, ANDROID_ERROR_INVALID_PARAM if the message can
+//! never fit in the RX ring.
+//
+//*****************************************************************************
+int ANDROID_readMsg(t_AndroidInstance handle, t_u8* const buff/*out*/, const int len/*in*/)
+{
+    if(len > (ANDROID_RX_RING_PACKETS * ANDROID_RX_PACKET_SIZE))
     {
-        /* Error invalid handle */
-        ulBytes = 0;
+        return ANDROID_ERROR_INVALID_PARAM;
     }
-    
-    return ulBytes;
+
+    if((len <= 0) || (ANDROID_available(handle) < len))
+    {
+        return 0;
+    }
+
+    return ANDROID_read(handle, buff, len);
 }
 
-int ANDROID_write(t_AndroidInstance handle, const void * const buff/*in*/, int len)
+//*****************************************************************************
+//
+//! This function returns the number of received bytes waiting in the RX ring.
+//!
+//! \param handle is the device instance returned by ANDROID_open().
+//!
+//! \return The number of bytes a call to ANDROID_read() can return at once.
+//
+//*****************************************************************************
+int ANDROID_available(t_AndroidInstance handle)
 {
     t_USBHANDROIDInstance *pANDROIDDevice;
-    t_u32 ulBytes;
 
     // Get a pointer to the device instance data from the handle.
     pANDROIDDevice = (t_USBHANDROIDInstance *)handle;
-    if(pANDROIDDevice != NULL)
-    {    
-        ulBytes = USBHCDPipeWrite(pANDROIDDevice->ulBulkOutPipe, (unsigned char*)buff, len);
-    }else
+    if(pANDROIDDevice == NULL)
     {
         /* Error invalid handle */
-        ulBytes = 0;
+        return 0;
+    }
+
+    return (int)(pANDROIDDevice->ulRxBytesIn - pANDROIDDevice->ulRxBytesOut);
+}
+
+//*****************************************************************************
+//
+//! This function queues a frame to be sent to the Android device.
+//!
+//! \param handle is the device instance returned by ANDROID_open().
+//! \param buff is the frame to send, it is copied in the TX queue.
+//! \param len is the size of the frame (1 to ANDROID_TX_FRAME_SIZE bytes).
+//! \param callback is called from USB interrupt context with the frame
+//! status once it is sent, aborted or failed (can be NULL).
+//! \param pvCBData is passed back to \e callback.
+//!
+//! This function never waits for the device, the frame is sent from the USB
+//! interrupt or from USBStackRefresh() once the previous frames are sent.
+//!
+//! \return \e len if the frame is queued, ANDROID_ERROR_TX_QUEUE_FULL if the
+//! TX queue is full or another ANDROID_ERROR_XXX error.
+//
+//*****************************************************************************
+int ANDROID_writeAsync(t_AndroidInstance handle, const void* const buff/*in*/, const int len/*in*/,
+                       t_ANDROID_tx_callback callback/*in*/, void* pvCBData/*in*/)
+{
+    t_USBHANDROIDInstance *pANDROIDDevice;
+    t_ANDROIDTxFrame *pFrame;
+
+    // Get a pointer to the device instance data from the handle.
+    pANDROIDDevice = (t_USBHANDROIDInstance *)handle;
+    if((pANDROIDDevice == NULL) || (len <= 0) || (len > ANDROID_TX_FRAME_SIZE))
+    {
+        return ANDROID_ERROR_INVALID_PARAM;
+    }
+
+    if(pANDROIDDevice->connected == false)
+    {
+        return ANDROID_ERROR_NOT_CONNECTED;
+    }
+
+    if(pANDROIDDevice->bTxBorrowed == true)
+    {
+        return ANDROID_ERROR_TX_BORROWED;
+    }
+
+    if((pANDROIDDevice->ulTxHead - pANDROIDDevice->ulTxTail) >= ANDROID_TX_QUEUE_FRAMES)
+    {
+        return ANDROID_ERROR_TX_QUEUE_FULL;
     }
 
-    return ulBytes;
+    pFrame = &g_sANDROIDTxQueue[pANDROIDDevice->ulTxHead & ANDROID_TX_QUEUE_MASK];
+    memcpy(pFrame->pucData, buff, len);
+    USBHANDROIDTxQueue(pANDROIDDevice, pFrame, len, callback, pvCBData);
+
+    return len;
+}
+
+int ANDROID_write(t_AndroidInstance handle, const void * const buff/*in*/, const int len/*in*/)
+{
+    return ANDROID_writeAsync(handle, buff, len, NULL, NULL);
 }
 
+//*****************************************************************************
+//
+//! This function lends the next free TX frame to be filled in place.
+//!
+//! \param handle is the device instance returned by ANDROID_open().
+//!
+//! The frame must be queued by ANDROID_txSubmit() (or given back with a zero
+//! length), ANDROID_write() fails with ANDROID_ERROR_TX_BORROWED meanwhile.
+//! The frames already queued keep being sent.
+//!
+//! \return A buffer of ANDROID_TX_FRAME_SIZE bytes, NULL if the device is
+//! not connected, the TX queue is full or a frame is already borrowed.
+//
+//*****************************************************************************
+t_u8* ANDROID_txBorrow(t_AndroidInstance handle)
+{
+    t_USBHANDROIDInstance *pANDROIDDevice;
+
+    // Get a pointer to the device instance data from the handle.
+    pANDROIDDevice = (t_USBHANDROIDInstance *)handle;
+    if((pANDROIDDevice == NULL) || (pANDROIDDevice->connected == false) ||
+       (pANDROIDDevice->bTxBorrowed == true) ||
+       ((pANDROIDDevice->ulTxHead - pANDROIDDevice->ulTxTail) >= ANDROID_TX_QUEUE_FRAMES))
+    {
+        return NULL;
+    }
+
+    pANDROIDDevice->bTxBorrowed = true;
+
+    return g_sANDROIDTxQueue[pANDROIDDevice->ulTxHead & ANDROID_TX_QUEUE_MASK].pucData;
+}
+
+//*****************************************************************************
+//
+//! This function queues the frame lent by ANDROID_txBorrow().
+//!
+//! \param handle is the device instance returned by ANDROID_open().
+//! \param len is the number of bytes filled (1 to ANDROID_TX_FRAME_SIZE), 0
+//! gives the frame back without sending it.
+//! \param callback is called with the frame status as for
+//! ANDROID_writeAsync() (can be NULL).
+//! \param pvCBData is passed back to \e callback.
+//!
+//! \return \e len if the frame is queued, 0 if it is given back or
+//! ANDROID_ERROR_XXX (the frame is given back).
+//
+//*****************************************************************************
+int ANDROID_txSubmit(t_AndroidInstance handle, const int len/*in*/,
+                     t_ANDROID_tx_callback callback/*in*/, void* pvCBData/*in*/)
+{
+    t_USBHANDROIDInstance *pANDROIDDevice;
+
+    // Get a pointer to the device instance data from the handle.
+    pANDROIDDevice = (t_USBHANDROIDInstance *)handle;
+    if((pANDROIDDevice == NULL) || (len < 0) || (len > ANDROID_TX_FRAME_SIZE))
+    {
+        return ANDROID_ERROR_INVALID_PARAM;
+    }
+
+    // Given back by the application or lost by a disconnection.
+    if(pANDROIDDevice->bTxBorrowed == false)
+    {
+        return ANDROID_ERROR_NOT_CONNECTED;
+    }
+    pANDROIDDevice->bTxBorrowed = false;
+    if(len == 0)
+    {
+        return 0;
+    }
+
+    USBHANDROIDTxQueue(pANDROIDDevice, &g_sANDROIDTxQueue[pANDROIDDevice->ulTxHead & ANDROID_TX_QUEUE_MASK],
+                       len, callback, pvCBData);
+
+    return len;
+}
+
+//*****************************************************************************
+//
+//! This function cancels the pending transfers.
+//!
+//! \param handle is the device instance returned by ANDROID_open().
+//! \param flags is ANDROID_CANCEL_TX and/or ANDROID_CANCEL_RX.
+//!
+//! ANDROID_CANCEL_TX drops the frame being sent (the Bulk OUT pipe is reset)
+//! and all the queued frames, their callbacks are called with
+//! ANDROID_TX_ABORTED before this function returns.  ANDROID_CANCEL_RX drops
+//! the data received and not read yet.  This function never waits for the
+//! device.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void ANDROID_cancel(t_AndroidInstance handle, const t_u32 flags/*in*/)
+{
+    t_USBHANDROIDInstance *pANDROIDDevice;
+    tBoolean bIntDisabled;
+
+    // Get a pointer to the device instance data from the handle.
+    pANDROIDDevice = (t_USBHANDROIDInstance *)handle;
+    if(pANDROIDDevice == NULL)
+    {
+        return;
+    }
+
+    bIntDisabled = IntMasterDisable();
+
+    if(flags & ANDROID_CANCEL_TX)
+    {
+        if(pANDROIDDevice->bTxBusy == true)
+        {
+            USBHANDROIDTxPipeReset(pANDROIDDevice);
+        }
+        while(pANDROIDDevice->ulTxTail != pANDROIDDevice->ulTxHead)
+        {
+            USBHANDROIDTxComplete(pANDROIDDevice, ANDROID_TX_ABORTED);
+        }
+    }
+
+    if(flags & ANDROID_CANCEL_RX)
+    {
+        // The slot at ulRxHead is the one being received, it is kept.
+        pANDROIDDevice->ulRxTail = pANDROIDDevice->ulRxHead;
+        pANDROIDDevice->ulRxBytesOut = pANDROIDDevice->ulRxBytesIn;
+        if((pANDROIDDevice->bRxArmed == false) && (pANDROIDDevice->connected == true))
+        {
+            USBHANDROIDRxArm(pANDROIDDevice);
+        }
+    }
+
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
@@ -0,0 +1,321 @@
+//*****************************************************************************
+//
+// usb_trace.c - Binary trace of the USB accessory sessions (record and replay).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "usblib/usblib.h"
+#include "utils/uartstdio.h"
+
+#include "usb_android.h"
+#include "usb_trace.h"
+
+#ifdef USBTRACE_ENABLE
+
+//*****************************************************************************
+//
+// Space required in the UART TX buffer to send one dump line without waiting.
+//
+//*****************************************************************************
+#define USBTRACE_LINE_MAX   (16 + (USBTRACE_DUMP_BYTES * 2))
+
+#define USBTRACE_MASK       (USBTRACE_SIZE - 1)
+
+//*****************************************************************************
+//
+// The records ring.  The indexes are free running, the records are written
+// with interrupts masked (pipe callbacks and main loop), the oldest records
+// are removed to make room.
+//
+//*****************************************************************************
+static t_u8 g_ucUSBTraceRing[USBTRACE_SIZE];
+static t_u32 g_ulUSBTraceHead;
+static t_u32 g_ulUSBTraceTail;
+static t_u32 g_ulUSBTraceBaseUs; /* Time of the record before the tail one */
+static t_u32 g_ulUSBTraceLastUs; /* Time of the last record */
+static t_u32 g_ulUSBTraceRecords;
+static t_u32 g_ulUSBTraceDropped;
+
+// Dump in progress: next ring index to send, the recording is paused.
+static bool g_bUSBTraceDumping;
+static bool g_bUSBTraceBegin;
+static bool g_bUSBTraceClear;
+static t_u32 g_ulUSBTraceDumpIdx;
+
+static t_u32 USBTraceVarint(t_u8* const buff/*out*/, t_u32 value/*in*/)
+{
+    t_u32 len;
+
+    len = 0;
+    while(value >= 0x80)
+    {
+        buff[len++] = (t_u8)(value | 0x80);
+        value >>= 7;
+    }
+    buff[len++] = (t_u8)value;
+
+    return len;
+}
+
+//*****************************************************************************
+//
+// Store one record: the length, type and time fields are added in front of
+// the payload.
+//
+//*****************************************************************************
+static void USBTraceWrite(const t_u8 type/*in*/, const t_u8* const payload/*in*/, const t_u32 payload_len/*in*/,
+                          const t_u8* const data/*in*/, const t_u32 data_len/*in*/)
+{
+    t_u8 header[2 + 5];
+    t_u32 header_len;
+    t_u32 len;
+    t_u32 now_us;
+    t_u32 delta;
+    t_u32 i;
+    tBoolean bIntDisabled;
+
+    bIntDisabled = IntMasterDisable();
+
+    g_ulUSBTraceRecords++;
+    if(g_bUSBTraceDumping == true)
+    {
+        g_ulUSBTraceDropped++;
+    }
+    else
+    {
+        now_us = GetTime_us();
+        header_len = 2 + USBTraceVarint(&header[2], now_us - g_ulUSBTraceLastUs);
+        len = header_len + payload_len + data_len;
+        header[0] = (t_u8)len;
+        header[1] = type;
+
+        // Remove the oldest records, the base time follows the new tail.
+        while((USBTRACE_SIZE - (g_ulUSBTraceHead - g_ulUSBTraceTail)) < len)
+        {
+            delta = 0;
+            for(i = 0; i < 5; i++)
+            {
+                t_u8 byte = g_ucUSBTraceRing[(g_ulUSBTraceTail + 2 + i) & USBTRACE_MASK];
+
+                delta |= (t_u32)(byte & 0x7F) << (7 * i);
+                if((byte & 0x80) == 0)
+                {
+                    break;
+                }
+            }
+            g_ulUSBTraceBaseUs += delta;
+            g_ulUSBTraceTail += g_ucUSBTraceRing[g_ulUSBTraceTail & USBTRACE_MASK];
+            g_ulUSBTraceDropped++;
+        }
+
+        for(i = 0; i < header_len; i++)
+        {
+            g_ucUSBTraceRing[g_ulUSBTraceHead++ & USBTRACE_MASK] = header[i];
+        }
+        for(i = 0; i < payload_len; i++)
+        {
+            g_ucUSBTraceRing[g_ulUSBTraceHead++ & USBTRACE_MASK] = payload[i];
+        }
+        for(i = 0; i < data_len; i++)
+        {
+            g_ucUSBTraceRing[g_ulUSBTraceHead++ & USBTRACE_MASK] = data[i];
+        }
+        g_ulUSBTraceLastUs = now_us;
+    }
+
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
+
+void USBTRACE_device(const t_u16 vid/*in*/, const t_u16 pid/*in*/)
+{
+    t_u8 payload[4];
+
+    payload[0] = (t_u8)vid;
+    payload[1] = (t_u8)(vid >> 8);
+    payload[2] = (t_u8)pid;
+    payload[3] = (t_u8)(pid >> 8);
+    USBTraceWrite(USBTRACE_DEVICE, payload, sizeof(payload), NULL, 0);
+}
+
+void USBTRACE_control(const tUSBRequest* const setup/*in*/, const t_u8* const data/*in*/, const t_u32 result/*in*/)
+{
+    t_u8 payload[8 + 5];
+    t_u32 len;
+    t_u32 data_len;
+
+    payload[0] = setup->bmRequestType;
+    payload[1] = setup->bRequest;
+    payload[2] = (t_u8)setup->wValue;
+    payload[3] = (t_u8)(setup->wValue >> 8);
+    payload[4] = (t_u8)setup->wIndex;
+    payload[5] = (t_u8)(setup->wIndex >> 8);
+    payload[6] = (t_u8)setup->wLength;
+    payload[7] = (t_u8)(setup->wLength >> 8);
+    len = 8 + USBTraceVarint(&payload[8], result);
+
+    // Only the IN data stage is kept (the device answer).
+    data_len = 0;
+    if(setup->bmRequestType & USB_RTYPE_DIR_IN)
+    {
+        data_len = (result < USBTRACE_CONTROL_DATA_MAX) ? result : USBTRACE_CONTROL_DATA_MAX;
+    }
+    USBTraceWrite(USBTRACE_CONTROL, payload, len, data, data_len);
+}
+
+void USBTRACE_bulkIn(const t_u8* const data/*in*/, const t_u32 len/*in*/)
+{
+    USBTraceWrite(USBTRACE_BULK_IN, NULL, 0, data, (len < 64) ? len : 64);
+}
+
+void USBTRACE_bulkOut(const t_u32 len/*in*/, const int status/*in*/)
+{
+    t_u8 payload[5 + 1];
+    t_u32 payload_len;
+
+    payload_len = USBTraceVarint(payload, len);
+    payload[payload_len++] = (t_u8)status;
+    USBTraceWrite(USBTRACE_BULK_OUT, payload, payload_len, NULL, 0);
+}
+
+void USBTRACE_event(const t_u8 type/*in*/, const t_u32 event/*in*/)
+{
+    t_u8 payload[5];
+
+    USBTraceWrite(type, payload, USBTraceVarint(payload, event), NULL, 0);
+}
+
+t_u32 USBTRACE_records(void)
+{
+    return g_ulUSBTraceRecords;
+}
+
+t_u32 USBTRACE_copy(t_u8* const buff/*out*/, const t_u32 size/*in*/, t_u32* const base_us/*out*/)
+{
+    t_u32 len;
+    t_u32 i;
+    tBoolean bIntDisabled;
+
+    bIntDisabled = IntMasterDisable();
+
+    len = g_ulUSBTraceHead - g_ulUSBTraceTail;
+    if(len > size)
+    {
+        len = size;
+    }
+    for(i = 0; i < len; i++)
+    {
+        buff[i] = g_ucUSBTraceRing[(g_ulUSBTraceTail + i) & USBTRACE_MASK];
+    }
+    *base_us = g_ulUSBTraceBaseUs;
+
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+
+    return len;
+}
+
+void USBTRACE_reset(void)
+{
+    tBoolean bIntDisabled;
+
+    bIntDisabled = IntMasterDisable();
+    g_ulUSBTraceHead = 0;
+    g_ulUSBTraceTail = 0;
+    g_ulUSBTraceLastUs = GetTime_us();
+    g_ulUSBTraceBaseUs = g_ulUSBTraceLastUs;
+    g_ulUSBTraceDropped = 0;
+    if(!bIntDisabled)
+    {
+        IntMasterEnable();
+    }
+}
+
+//*****************************************************************************
+//
+//! This function starts a dump of the trace ring on the UART.
+//!
+//! \param clear resets the ring once it is dumped.
+//!
+//! The recording is paused until the dump ends, the lines are sent by
+//! USBTRACE_process().  A dump already in progress is not restarted.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void USBTRACE_dump(const bool clear/*in*/)
+{
+    if(g_bUSBTraceDumping == true)
+    {
+        return;
+    }
+
+    g_ulUSBTraceDumpIdx = g_ulUSBTraceTail;
+    g_bUSBTraceClear = clear;
+    g_bUSBTraceBegin = true;
+    g_bUSBTraceDumping = true;
+}
+
+//*****************************************************************************
+//
+//! This function sends the dump lines to the UART.
+//!
+//! As DLOG_process(), with the buffered UART (UART_BUFFERED) the lines are
+//! sent only while the UART TX buffer has room for a full line, without
+//! UART_BUFFERED one line is sent per call.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void USBTRACE_process(void)
+{
+    t_u32 i;
+
+    while(g_bUSBTraceDumping == true)
+    {
+#ifdef UART_BUFFERED
+        if(UARTTxBytesFree() < USBTRACE_LINE_MAX)
+        {
+            return;
+        }
+#endif
+        if(g_bUSBTraceBegin == true)
+        {
+            UARTprintf("USBTRACE BEGIN %u %u %u\n", g_ulUSBTraceHead - g_ulUSBTraceTail,
+                       g_ulUSBTraceBaseUs, g_ulUSBTraceDropped);
+            g_bUSBTraceBegin = false;
+        }
+        else if(g_ulUSBTraceDumpIdx != g_ulUSBTraceHead)
+        {
+            UARTprintf("USBTRACE ");
+            for(i = 0; (i < USBTRACE_DUMP_BYTES) && (g_ulUSBTraceDumpIdx != g_ulUSBTraceHead); i++)
+            {
+                UARTprintf("%02x", g_ucUSBTraceRing[g_ulUSBTraceDumpIdx++ & USBTRACE_MASK]);
+            }
+            UARTprintf("\n");
+        }
+        else
+        {
+            UARTprintf("USBTRACE END\n");
+            if(g_bUSBTraceClear == true)
+            {
+                USBTRACE_reset();
+            }
+            g_bUSBTraceDumping = false;
+        }
+#ifndef UART_BUFFERED
+        break;
+#endif
+    }
+}
+
+#endif /* USBTRACE_ENABLE */
@@ -0,0 +1,120 @@
+//*****************************************************************************
+//
+// usb_trace.h - Binary trace of the USB accessory sessions (record and replay).
+//
+// Copyright (c) 2011 Benjamin VERNOUX
+// Licensed under the GPL v2 or later, see the file gpl-2.0.txt in this archive.
+//
+//*****************************************************************************
+
+#ifndef __USB_TRACE_H__
+#define __USB_TRACE_H__
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * The driver records each USB event of the accessory sessions in a RAM ring
+ * (the oldest records are overwritten).  USBTRACE_dump() sends the ring in
+ * hexadecimal on the UART from the main loop (USBTRACE_process()), the dump
+ * can be fed back to the host build of the driver (host/evalbot_replay).
+ *
+ * Record: length (whole record, 1 byte), type (1 byte), time in us since the
+ * previous record (unsigned LEB128), then the payload:
+ * - USBTRACE_DEVICE: idVendor, idProduct (16 bits little endian), USBHANDROIDOpen()
+ * - USBTRACE_CONTROL: setup packet (8 bytes), result length (LEB128), then
+ *   the IN data stage (up to USBTRACE_CONTROL_DATA_MAX bytes)
+ * - USBTRACE_BULK_IN: received packet data (record length gives its size)
+ * - USBTRACE_BULK_OUT: frame length (LEB128), ANDROID_TX_XXX status (1 byte), frame completion
+ * - USBTRACE_HCD_EVENT: USB_EVENT_XXX of USBHCDEvents() (LEB128)
+ * - USBTRACE_ANDROID_EVENT: ANDROID_EVENT_XXX of USBHANDROIDCallback() (LEB128)
+ *
+ * Dump lines (each line starts with USBTRACE):
+ *  USBTRACE BEGIN <bytes> <time of the record before the first one, us> <records dropped>
+ *  USBTRACE <hex data, USBTRACE_DUMP_BYTES bytes per line>
+ *  USBTRACE END
+ * The recording is paused during the dump (records dropped).
+ */
+#define USBTRACE_DEVICE         (1)
+#define USBTRACE_CONTROL        (2)
+#define USBTRACE_BULK_IN        (3)
+#define USBTRACE_BULK_OUT       (4)
+#define USBTRACE_HCD_EVENT      (5)
+#define USBTRACE_ANDROID_EVENT  (6)
+#define USBTRACE_NB_TYPES       (7)
+
+#ifndef USBTRACE_SIZE
+#define USBTRACE_SIZE           (4096) /* Ring size in bytes, must be a power of 2 */
+#endif
+#define USBTRACE_CONTROL_DATA_MAX   (16)
+#define USBTRACE_DUMP_BYTES     (32)
+
+#ifdef USBTRACE_ENABLE
+
+#define USBTRACE_DEVICE_OPEN(vid, pid)          USBTRACE_device(vid, pid)
+#define USBTRACE_CONTROL_TRANSFER(setup, data, result) USBTRACE_control(setup, data, result)
+#define USBTRACE_BULK_RX(data, len)             USBTRACE_bulkIn(data, len)
+#define USBTRACE_BULK_TX(len, status)           USBTRACE_bulkOut(len, status)
+#define USBTRACE_HCD(event)                     USBTRACE_event(USBTRACE_HCD_EVENT, event)
+#define USBTRACE_ANDROID(event)                 USBTRACE_event(USBTRACE_ANDROID_EVENT, event)
+
+/* API */
+
+/* Record functions (use the USBTRACE_XXX() macros instead), thread or interrupt context */
+extern void USBTRACE_device(const t_u16 vid/*in*/, const t_u16 pid/*in*/);
+
+extern void USBTRACE_control(const tUSBRequest* const setup/*in*/, const t_u8* const data/*in*/, const t_u32 result/*in*/);
+
+extern void USBTRACE_bulkIn(const t_u8* const data/*in*/, const t_u32 len/*in*/);
+
+extern void USBTRACE_bulkOut(const t_u32 len/*in*/, const int status/*in*/);
+
+extern void USBTRACE_event(const t_u8 type/*in*/, const t_u32 event/*in*/);
+
+/* Number of records written since reset (dropped ones included) */
+extern t_u32 USBTRACE_records(void);
+
+/* Copy the ring (oldest record first), return its size in bytes, base_us is the time of the record before the first one */
+extern t_u32 USBTRACE_copy(t_u8* const buff/*out*/, const t_u32 size/*in*/, t_u32* const base_us/*out*/);
+
+extern void USBTRACE_reset(void);
+
+/* Start a dump of the ring on the UART, clear = reset the ring once dumped */
+extern void USBTRACE_dump(const bool clear/*in*/);
+
+/* Send the dump lines without blocking (main loop, once the log entries are sent) */
+extern void USBTRACE_process(void);
+
+#else /* USBTRACE_ENABLE */
+
+/* Trace disabled, no code and no data */
+#define USBTRACE_DEVICE_OPEN(vid, pid)
+#define USBTRACE_CONTROL_TRANSFER(setup, data, result)
+#define USBTRACE_BULK_RX(data, len)
+#define USBTRACE_BULK_TX(len, status)
+#define USBTRACE_HCD(event)
+#define USBTRACE_ANDROID(event)
+#define USBTRACE_reset()
+#define USBTRACE_dump(clear)
+#define USBTRACE_process()
+
+#endif /* USBTRACE_ENABLE */
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __USB_TRACE_H__